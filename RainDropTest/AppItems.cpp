@@ -6,6 +6,9 @@
 #include "Scripts.h"
 #include "Entity.h"
 #include "Content.h"
+#include "Lights.h"
+#include "Math.h"
+#include "AssetPack.h"
 #include "Utilities.h"
 #include "Core.h"
 #include "Vector.h"
@@ -24,7 +27,7 @@ namespace app {
         };
         
         UINT cube_model_id{ Invalid_Index };
-        UINT cube_entity_id{ Invalid_Index };
+        UINT render_item_entity_ids[1]{ Invalid_Index };
         UINT cube_item_id{ Invalid_Index };
         UINT material_ids[material_type::count]{};
 
@@ -48,6 +51,9 @@ namespace app {
 
         UINT texture_ids[texture_usage::count];
 
+        // Empty unless --asset-pack is given (see Main.cpp).
+        std::string asset_pack_path{};
+
         void remove_model(UINT model_id)
         {
             if (model_id != Invalid_Index)
@@ -56,32 +62,115 @@ namespace app {
             }
         }
 
+        struct asset_file
+        {
+            const char*                 path;
+            content::asset_type::type   type;
+            UINT*                       id;
+        };
+
+        // Called by utl::read_files() on a job thread when the asset file is read.
+        void create_asset_resource(std::span<const UINT8> data, void* context)
+        {
+            const asset_file& asset{ *(const asset_file*)context };
+            assert(data.size()); // the asset file is missing or couldn't be read.
+            *asset.id = data.size() ? content::create_resource(data, asset.type) : Invalid_Index;
+            assert(*asset.id != Invalid_Index);
+        }
+
+        struct light_set_states {
+            enum state {
+                left_set,
+                right_set
+            };
+        };
+
+        utl::vector<lights::Light> scene_lights;
+
+        constexpr float inv_rand_max{ 1.f / RAND_MAX };
+        float random(float min = 0.f)
+        {
+            float r = rand() * inv_rand_max;
+            return (r > min) ? r : min;
+        }
+
+        constexpr XMFLOAT3 rgb_to_color(UINT8 r, UINT8 g, UINT8 b)
+        {
+            return  { r / 255.f, g / 255.f , b / 255.f };
+        }
+
+        // Light with a random color for the entity.
+        void create_light(UINT entity_id, lights::light_type::type type, UINT64 key)
+        {
+            lights::light_init_info info{};
+            info.entity_id = entity_id;
+            info.type = type;
+            info.set_key = key;
+            info.intensity = 1.f;
+
+            info.color = { random(0.2f), random(0.2f), random(0.2f) };
+
+            if (type == lights::light_type::point)
+            {
+                info.point_params.range = 1.f;
+                info.point_params.attenuation = { 1, 1, 1 };
+            }
+            else if (type == lights::light_type::spot)
+            {
+                info.spot_params.range = 2.f;
+                info.spot_params.umbra = 0.1f * math::pi;
+                info.spot_params.penumbra = info.spot_params.umbra + (0.1f * math::pi);
+                info.spot_params.attenuation = { 1, 1, 1 };
+            }
+
+            scene_lights.emplace_back(lights::create_light(info));
+        }
+
     } // anonymous namespace
 
-    game_entity::entity create_entity_item(XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale, geometry::init_info* geometry_info, const char* script_name)
+    game_entity::entity create_entity_item(XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale, geometry::init_info* geometry_info, utl::hashed_name script_name)
     {
-        transform::init_info transform_info{};
-        XMVECTOR quat{ XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&rotation)) };
-        XMFLOAT4A rot_quat;
-        XMStoreFloat4A(&rot_quat, quat);
-        memcpy(&transform_info.rotation[0], &rot_quat.x, sizeof(transform_info.rotation));
-        memcpy(&transform_info.position[0], &position.x, sizeof(transform_info.position));
-        memcpy(&transform_info.scale[0], &scale.x, sizeof(transform_info.scale));
-
-        script::init_info script_info{};
-        if (script_name)
-        {
-            script_info.script_creator = script::detail::get_script_creator(std::hash<std::string>()(script_name));
-            assert(script_info.script_creator);
+        const entity_item_info item{ position, rotation, scale, geometry_info, script_name };
+        game_entity::entity entity{};
+        create_entity_items({ &item, 1 }, &entity);
+        return entity;
+    }
+
+    void create_entity_items(std::span<const entity_item_info> items, game_entity::entity* const entities)
+    {
+        const UINT count{ (UINT)items.size() };
+        utl::vector<transform::init_info> transform_infos(count);
+        utl::vector<script::init_info> script_infos(count);
+        utl::vector<game_entity::entity_info> entity_infos(count);
+
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            const entity_item_info& item{ items[i] };
+            transform::init_info& transform_info{ transform_infos[i] };
+            XMVECTOR quat{ XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&item.rotation)) };
+            XMFLOAT4A rot_quat;
+            XMStoreFloat4A(&rot_quat, quat);
+            memcpy(&transform_info.rotation[0], &rot_quat.x, sizeof(transform_info.rotation));
+            memcpy(&transform_info.position[0], &item.position.x, sizeof(transform_info.position));
+            memcpy(&transform_info.scale[0], &item.scale.x, sizeof(transform_info.scale));
+
+            if (item.script_name.is_valid())
+            {
+                script_infos[i].script_creator = script::detail::get_script_creator(item.script_name);
+                assert(script_infos[i].script_creator);
+            }
+
+            game_entity::entity_info& entity_info{ entity_infos[i] };
+            entity_info.transform = &transform_info;
+            entity_info.script = &script_infos[i];
+            entity_info.geometry = item.geometry_info;
         }
 
-        game_entity::entity_info entity_info{};
-        entity_info.transform = &transform_info;
-        entity_info.script = &script_info;
-        entity_info.geometry = geometry_info;
-        game_entity::entity entity = game_entity::create(entity_info);
-        assert(entity.is_valid());
-        return entity;
+        game_entity::create_batch({ entity_infos.data(), count }, entities);
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            assert(entities[i].is_valid());
+        }
     }
 
     void remove_game_entity(UINT id)
@@ -89,16 +178,9 @@ namespace app {
         game_entity::remove(id);
     }
 
-    [[nodiscard]] UINT load_asset(const char* path, content::asset_type::type type)
+    void remove_game_entities(std::span<const UINT> ids)
     {
-        std::unique_ptr<UINT8[]> buffer;
-        UINT64 size{ 0 };
-
-        utl::read_file(path, buffer, size);
-
-        const UINT model_id{ content::create_resource(buffer.get(), type) };
-        assert(model_id != Invalid_Index);
-        return model_id;
+        game_entity::remove_batch(ids);
     }
 
     void create_material()
@@ -116,60 +198,69 @@ namespace app {
         material_ids[material_type::dirty_material] = content::create_resource(&info, content::asset_type::material);
     }
 
+    void set_asset_pack(const char* path)
+    {
+        asset_pack_path = path ? path : "";
+    }
+
     void create_render_items()
     {
         memset(&texture_ids[0], 0xff, sizeof(UINT) * _countof(texture_ids));
-#define NO_THREAD
-#ifdef NO_THREAD
-        //texture_ids[texture_usage::fem_bot_ambient_occlusion] =     load_asset("../fem_bot_ambient_occlusion.texture", content::asset_type::texture); }},
-        //texture_ids[texture_usage::fem_bot_base_color] =            load_asset("../fem_bot_base_color.texture", content::asset_type::texture); }},
-        //texture_ids[texture_usage::fem_bot_emissive] =              load_asset("../fem_bot_emissive.texture", content::asset_type::texture); }},
-        //texture_ids[texture_usage::fem_bot_metal_rough] =           load_asset("../fem_bot_roughness.texture", content::asset_type::texture); }},
-        //texture_ids[texture_usage::fem_bot_normal] =                load_asset("../fem_bot_normal.texture", content::asset_type::texture); }},
-
-        texture_ids[texture_usage::dirty_metal_ambient_occlusion] = load_asset("../dirty_metal_ambient_occlusion.texture", content::asset_type::texture);
-        texture_ids[texture_usage::dirty_metal_base_color] = load_asset("../dirty_metal_base_color.texture", content::asset_type::texture);
-        texture_ids[texture_usage::dirty_metal_emissive] = load_asset("../dirty_metal_emissive.texture", content::asset_type::texture);
-        texture_ids[texture_usage::dirty_metal_metal_rough] = load_asset("../dirty_metal_roughness.texture", content::asset_type::texture);
-        texture_ids[texture_usage::dirty_metal_normal] = load_asset("../dirty_metal_normal.texture", content::asset_type::texture);
-
-        cube_model_id = load_asset("../cube.model", content::asset_type::mesh);
-
-#else
-        std::thread threads[]
-        {
-            //std::thread{ [] { texture_ids[texture_usage::fem_bot_ambient_occlusion] =     load_asset("../fem_bot_ambient_occlusion.texture", content::asset_type::texture); }},
-            //std::thread{ [] { texture_ids[texture_usage::fem_bot_base_color] =            load_asset("../fem_bot_base_color.texture", content::asset_type::texture); }},
-            //std::thread{ [] { texture_ids[texture_usage::fem_bot_emissive] =              load_asset("../fem_bot_emissive.texture", content::asset_type::texture); }},
-            //std::thread{ [] { texture_ids[texture_usage::fem_bot_metal_rough] =           load_asset("../fem_bot_roughness.texture", content::asset_type::texture); }},
-            //std::thread{ [] { texture_ids[texture_usage::fem_bot_normal] =                load_asset("../fem_bot_normal.texture", content::asset_type::texture); }},
-        
-            std::thread{ [] { texture_ids[texture_usage::dirty_metal_ambient_occlusion] = load_asset("../dirty_metal_ambient_occlusion.texture", content::asset_type::texture); }},
-            std::thread{ [] { texture_ids[texture_usage::dirty_metal_base_color] =        load_asset("../dirty_metal_base_color.texture", content::asset_type::texture); }},
-            std::thread{ [] { texture_ids[texture_usage::dirty_metal_emissive] =          load_asset("../dirty_metal_emissive.texture", content::asset_type::texture); }},
-            std::thread{ [] { texture_ids[texture_usage::dirty_metal_metal_rough] =       load_asset("../dirty_metal_roughness.texture", content::asset_type::texture); }},
-            std::thread{ [] { texture_ids[texture_usage::dirty_metal_normal] =            load_asset("../dirty_metal_normal.texture", content::asset_type::texture); }},
 
-            std::thread{ [] { cube_model_id =                                             load_asset("../cube.model", content::asset_type::mesh); }},
+        // NOTE: the files are read at the same time, and each resource is created as soon as its file is in.
+        asset_file assets[]
+        {
+            //{ "../fem_bot_ambient_occlusion.texture",     content::asset_type::texture, &texture_ids[texture_usage::fem_bot_ambient_occlusion] },
+            //{ "../fem_bot_base_color.texture",            content::asset_type::texture, &texture_ids[texture_usage::fem_bot_base_color] },
+            //{ "../fem_bot_emissive.texture",              content::asset_type::texture, &texture_ids[texture_usage::fem_bot_emissive] },
+            //{ "../fem_bot_roughness.texture",             content::asset_type::texture, &texture_ids[texture_usage::fem_bot_metal_rough] },
+            //{ "../fem_bot_normal.texture",                content::asset_type::texture, &texture_ids[texture_usage::fem_bot_normal] },
+
+            { "../dirty_metal_ambient_occlusion.texture",   content::asset_type::texture, &texture_ids[texture_usage::dirty_metal_ambient_occlusion] },
+            { "../dirty_metal_base_color.texture",          content::asset_type::texture, &texture_ids[texture_usage::dirty_metal_base_color] },
+            { "../dirty_metal_emissive.texture",            content::asset_type::texture, &texture_ids[texture_usage::dirty_metal_emissive] },
+            { "../dirty_metal_roughness.texture",           content::asset_type::texture, &texture_ids[texture_usage::dirty_metal_metal_rough] },
+            { "../dirty_metal_normal.texture",              content::asset_type::texture, &texture_ids[texture_usage::dirty_metal_normal] },
+
+            { "../cube.model",                              content::asset_type::mesh,    &cube_model_id },
         };
 
-        for (auto& t : threads)
+        utl::file_read reads[_countof(assets)]{};
+        for (UINT i{ 0 }; i < _countof(assets); ++i)
         {
-            t.join();
+            reads[i] = { assets[i].path, &create_asset_resource, &assets[i] };
         }
-#endif
+        // NOTE: the loose files are the default. In io_bench (bench/AssetPackBench.cpp) the pack doesn't load
+        //       faster yet, so it's only used when asked for, and the loose files are the fallback.
+        content::asset_pack pack{};
+        if (!asset_pack_path.empty() && pack.open(asset_pack_path)) pack.read_files(&reads[0], _countof(reads));
+        else utl::read_files(&reads[0], _countof(reads));
+
         create_material();
 
         geometry::init_info geometry_info{};
         geometry_info.material_count = 1;
         geometry_info.material_ids = &material_ids[material_type::dirty_material];
         geometry_info.geometry_content_id = cube_model_id;
-        cube_entity_id = create_entity_item({ 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f }, { 0.4f, 0.4f, 0.4f }, &geometry_info, nullptr).get_id();
+
+        // NOTE: all render item entities are created in one batch.
+        const entity_item_info items[]
+        {
+            { { 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f }, { 0.4f, 0.4f, 0.4f }, &geometry_info },
+        };
+        static_assert(_countof(items) == _countof(render_item_entity_ids));
+        game_entity::entity entities[_countof(items)];
+        create_entity_items(items, &entities[0]);
+
+        for (UINT i{ 0 }; i < _countof(items); ++i)
+        {
+            render_item_entity_ids[i] = entities[i].get_id();
+        }
     }
 
     void destroy_render_items()
     {
-        remove_game_entity(cube_entity_id);
+        remove_game_entities(render_item_entity_ids);
 
         remove_model(cube_model_id);
 
@@ -183,4 +274,88 @@ namespace app {
             content::destroy_resource(id, content::asset_type::texture);
         }
     }
-}
\ No newline at end of file
+
+    void generate_lights()
+    {
+        lights::create_light_set(light_set_states::left_set);
+        lights::create_light_set(light_set_states::right_set);
+
+        // NOTE: the entities of all lights are created in one batch.
+        const entity_item_info entity_items[]
+        {
+            // left
+            { {}, {} },
+            { { 1.f, 1.f, 1.f }, { -math::pi * 0.5f, -math::pi * 0.5f, -math::pi * 0.5f } },
+            // right
+            { {}, {} },
+            { { -1.f, -1.f, -1.f }, {} },
+            // random
+            { { 0.0f, -3.0f, 0.0f }, {} },
+            { { 0.0f,  0.2f, 1.0f }, {} },
+            { { 0.0f,  3.0f, 2.5f }, {} },
+            { { 0.0f,  0.1f, 7.0f }, { 0.0f, 3.14f, 0.f } },
+        };
+        game_entity::entity entities[_countof(entity_items)];
+        create_entity_items(entity_items, &entities[0]);
+
+        lights::light_init_info info{};
+        // left
+
+        // Directional light
+        info.entity_id = entities[0].get_id();
+        info.type = lights::light_type::directional;
+        info.set_key = light_set_states::left_set;
+        info.intensity = 1.f;
+        info.color = rgb_to_color(174, 174, 174);
+        scene_lights.emplace_back(lights::create_light(info));
+
+        info.entity_id = entities[1].get_id();
+        info.type = lights::light_type::spot;
+        info.set_key = light_set_states::left_set;
+        info.intensity = 1.f;
+        info.color = rgb_to_color(174, 174, 174);
+        info.spot_params.range = 1.0f;
+        scene_lights.emplace_back(lights::create_light(info));
+
+        // right
+
+        // Directional light
+        info.entity_id = entities[2].get_id();
+        info.type = lights::light_type::directional;
+        info.set_key = light_set_states::right_set;
+        info.intensity = 1.f;
+        info.color = rgb_to_color(200, 200, 200);
+        scene_lights.emplace_back(lights::create_light(info));
+
+        info.entity_id = entities[3].get_id();
+        info.type = lights::light_type::point;
+        info.set_key = light_set_states::right_set;
+        info.intensity = 1.f;
+        info.color = rgb_to_color(20, 200, 174);
+        scene_lights.emplace_back(lights::create_light(info));
+
+        create_light(entities[4].get_id(), lights::light_type::point, light_set_states::left_set);
+        create_light(entities[5].get_id(), lights::light_type::point, light_set_states::left_set);
+        create_light(entities[6].get_id(), lights::light_type::point, light_set_states::left_set);
+        create_light(entities[7].get_id(), lights::light_type::spot, light_set_states::left_set);
+    }
+
+    void remove_lights()
+    {
+        // NOTE: the lights go first, then their entities in one batch.
+        utl::vector<UINT> entity_ids;
+        entity_ids.reserve(scene_lights.size());
+        for (auto& light : scene_lights)
+        {
+            entity_ids.emplace_back(light.get_entity_id());
+            lights::remove_light(light);
+        }
+
+        remove_game_entities({ entity_ids.data(), entity_ids.size() });
+
+        scene_lights.clear();
+
+        lights::remove_light_set(light_set_states::left_set);
+        lights::remove_light_set(light_set_states::right_set);
+    }
+}
@@ -2,13 +2,30 @@
 #include "stdafx.h"
 #include "Entity.h"
 #include "Geometry.h"
+#include "HashedName.h"
 
 namespace app {
 
-    constexpr UINT min_deleted_elements{ 1024 };
+    struct entity_item_info
+    {
+        XMFLOAT3                position{ 0.f, 0.f, 0.f };
+        XMFLOAT3                rotation{ 0.f, 0.f, 0.f };  // pitch, yaw and roll in radians.
+        XMFLOAT3                scale{ 1.f, 1.f, 1.f };
+        geometry::init_info*    geometry_info{ nullptr };
+        utl::hashed_name        script_name{};
+    };
 
+    // Makes create_render_items() load the assets from an asset pack instead of the loose files.
+    void set_asset_pack(const char* path);
     void create_render_items();
     void destroy_render_items();
-    game_entity::entity create_entity_item(XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale, geometry::init_info* geometry_info, const char* script_name);
+    game_entity::entity create_entity_item(XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale, geometry::init_info* geometry_info, utl::hashed_name script_name);
+    // Same as create_entity_item() for each item, with one game_entity::create_batch() for all of them.
+    // 'entities' must have room for items.size() entities.
+    void create_entity_items(std::span<const entity_item_info> items, game_entity::entity* const entities);
     void remove_game_entity(UINT id);
+    void remove_game_entities(std::span<const UINT> ids);
+    // The scene's lights, in two light sets (see core::frame_info::light_set_key).
+    void generate_lights();
+    void remove_lights();
 }
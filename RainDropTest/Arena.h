@@ -0,0 +1,143 @@
+#pragma once
+#include "stdafx.h"
+#include "Vector.h"
+#include <atomic>
+
+namespace utl {
+
+    // Linear (bump) allocator for data that only lives for one frame. Allocating is a single
+    // atomic add, so job threads can use it at the same time. Nothing is freed on its own:
+    // reset() drops everything at once.
+    // If a frame needs more than the capacity, the extra allocations fall back to the heap
+    // and the arena grows to the peak size on the next reset(), so it settles after a few frames.
+    class linear_arena
+    {
+    public:
+        static constexpr UINT64 alignment{ 16 };
+
+        linear_arena() = default;
+        DISABLE_COPY_AND_MOVE(linear_arena);
+        ~linear_arena() { release(); }
+
+        void initialize(UINT64 capacity)
+        {
+            assert(!m_buffer && capacity);
+            m_capacity = align(capacity);
+            m_buffer = (UINT8*)::operator new(m_capacity, std::align_val_t{ alignment });
+            m_offset = 0;
+            m_peak = 0;
+        }
+
+        void release()
+        {
+            free_overflow();
+            if (m_buffer)
+            {
+                ::operator delete(m_buffer, std::align_val_t{ alignment });
+            }
+            m_buffer = nullptr;
+            m_capacity = 0;
+            m_offset = 0;
+            m_peak = 0;
+        }
+
+        // Returns 'size' bytes aligned to 16 bytes. Thread-safe.
+        [[nodiscard]] void* allocate(UINT64 size)
+        {
+            assert(m_buffer);
+            size = align(size ? size : 1);
+            const UINT64 offset{ m_offset.fetch_add(size, std::memory_order_relaxed) };
+            if (offset + size <= m_capacity)
+            {
+                return m_buffer + offset;
+            }
+
+            void* const memory{ ::operator new(size, std::align_val_t{ alignment }) };
+            std::lock_guard lock{ m_overflow_mutex };
+            m_overflow.emplace_back(memory);
+            return memory;
+        }
+
+        // Invalidates every allocation made since the last reset.
+        // NOTE: must not be called while other threads still allocate from this arena.
+        void reset()
+        {
+            const UINT64 used{ m_offset.load(std::memory_order_relaxed) };
+            if (used > m_peak) m_peak = used;
+
+            free_overflow();
+            if (m_peak > m_capacity)
+            {
+                const UINT64 new_capacity{ align(m_peak + (m_peak >> 1)) }; // 50% head room
+                release();
+                initialize(new_capacity);
+            }
+
+            m_offset.store(0, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] UINT64 used() const { return m_offset.load(std::memory_order_relaxed); }
+        [[nodiscard]] constexpr UINT64 capacity() const { return m_capacity; }
+
+    private:
+        [[nodiscard]] static constexpr UINT64 align(UINT64 size)
+        {
+            return (size + alignment - 1) & ~(alignment - 1);
+        }
+
+        void free_overflow()
+        {
+            std::lock_guard lock{ m_overflow_mutex };
+            for (void* memory : m_overflow)
+            {
+                ::operator delete(memory, std::align_val_t{ alignment });
+            }
+            m_overflow.clear();
+        }
+
+        UINT8*                  m_buffer{ nullptr };
+        UINT64                  m_capacity{ 0 };
+        std::atomic<UINT64>     m_offset{ 0 };
+        UINT64                  m_peak{ 0 };
+        std::mutex              m_overflow_mutex{};
+        utl::vector<void*>      m_overflow;
+    };
+
+    namespace detail {
+        inline linear_arena* current_frame_arena{ nullptr };
+    } // namespace detail
+
+    // Core sets the arena of the frame being recorded at the start of each frame.
+    inline void set_frame_arena(linear_arena* const arena)
+    {
+        detail::current_frame_arena = arena;
+    }
+
+    [[nodiscard]] inline linear_arena& frame_arena()
+    {
+        assert(detail::current_frame_arena);
+        return *detail::current_frame_arena;
+    }
+
+    // utl::vector allocator that takes memory from the current frame arena.
+    // Growing copies the items to a new block and the old one is simply abandoned.
+    // NOTE: a vector using it must not be kept past the frame it was filled in.
+    //       Assign an empty vector to it before reusing it in a later frame.
+    struct frame_allocator
+    {
+        [[nodiscard]] static void* reallocate(void* memory, UINT64 old_size, UINT64 new_size)
+        {
+            void* const new_memory{ frame_arena().allocate(new_size) };
+            if (memory && old_size)
+            {
+                memcpy(new_memory, memory, old_size);
+            }
+            return new_memory;
+        }
+
+        static void release(void*) {}
+    };
+
+    template<typename T, bool destruct = true>
+    using frame_vector = vector<T, destruct, frame_allocator>;
+}
@@ -0,0 +1,372 @@
+#include "AssetPack.h"
+#include "HashedName.h"
+#include "Jobs.h"
+#include "Lz4.h"
+#include "Math.h"
+#include "Vector.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+
+namespace content {
+    namespace {
+        constexpr UINT64 entry_alignment{ 16 };
+
+        // Only the file name counts, so "../cube.model" and "assets/cube.model" are the same entry.
+        [[nodiscard]] UINT64 name_hash(std::string_view path)
+        {
+            const size_t separator{ path.find_last_of("/\\") };
+            if (separator != std::string_view::npos) path.remove_prefix(separator + 1);
+            return utl::hashed_name{ path }.value();
+        }
+
+        [[nodiscard]] constexpr UINT block_count(UINT64 size, UINT block_size)
+        {
+            return (UINT)((size + block_size - 1) / block_size);
+        }
+
+        // Checks everything read_files() relies on, so a broken pack is rejected when it's opened.
+        [[nodiscard]] bool is_valid_table_of_contents(std::span<const asset_pack_entry> entries, std::span<const asset_pack_block> blocks,
+            UINT block_size, UINT64 file_size)
+        {
+            for (UINT i{ 0 }; i < entries.size(); ++i)
+            {
+                const asset_pack_entry& entry{ entries[i] };
+                // Sorted without repeats, for the binary search in find().
+                if (i && entry.name_hash <= entries[i - 1].name_hash) return false;
+
+                if (entry.codec == asset_pack_codec::none)
+                {
+                    if (entry.offset > file_size || entry.size > file_size - entry.offset) return false;
+                    continue;
+                }
+                if (entry.codec != asset_pack_codec::lz4) return false;
+
+                const UINT count{ block_count(entry.size, block_size) };
+                if (!count || entry.first_block > blocks.size() || count > blocks.size() - entry.first_block) return false;
+
+                // The blocks of an entry are back to back, so they can be prefetched as one range.
+                UINT64 end{ entry.offset };
+                for (UINT j{ 0 }; j < count; ++j)
+                {
+                    const asset_pack_block& block{ blocks[entry.first_block + j] };
+                    const UINT64 size{ std::min<UINT64>(block_size, entry.size - (UINT64)j * block_size) };
+                    if (block.size != size || !block.stored_size || block.stored_size > block.size) return false;
+                    if (block.offset < end || block.offset > file_size || block.stored_size > file_size - block.offset) return false;
+                    end = block.offset + block.stored_size;
+                }
+            }
+            return true;
+        }
+
+        struct pending_entry
+        {
+            const utl::file_read*       request{ nullptr };
+            const asset_pack_entry*     entry{ nullptr };
+            std::unique_ptr<UINT8[]>    data{};
+            std::atomic<UINT>           blocks_left{ 0 };
+            std::atomic<bool>           failed{ false };
+        };
+
+        struct block_task
+        {
+            pending_entry*  pending;
+            // Index in the pack's block table, or Invalid_Index if the entry isn't compressed (or not found).
+            UINT            block;
+        };
+
+        struct packed_file
+        {
+            utl::mapped_file    mapped{};
+            UINT64              name_hash{ 0 };
+            UINT                first_block{ 0 };
+            UINT                block_count{ 0 };
+            UINT64              stored_size{ 0 };
+        };
+
+        struct packed_block
+        {
+            const UINT8*                source{ nullptr };
+            std::unique_ptr<UINT8[]>    compressed{};   // null if the block is stored as is.
+            UINT                        stored_size{ 0 };
+            UINT                        size{ 0 };
+        };
+    } // anonymous namespace
+
+    bool asset_pack::open(const std::filesystem::path& path)
+    {
+        close();
+
+        // NOTE: blocks are read in no particular order. read_files() prefetches what it needs.
+        if (!_file.open(path, utl::mapped_file::access::random)) return false;
+
+        utl::blob_stream_reader blob{ _file.span() };
+        asset_pack_header header{};
+        blob.read(&header, 1);
+
+        const bool is_valid_header{ !blob.overrun() && header.magic == asset_pack_magic && header.version == asset_pack_version &&
+            header.block_size >= asset_pack_min_block_size && header.block_size <= asset_pack_max_block_size };
+        if (is_valid_header)
+        {
+            // NOTE: the table of contents is used where it is in the mapped file, it's never copied.
+            _entries = blob.read_span<asset_pack_entry>(header.entry_count);
+            _blocks = blob.read_span<asset_pack_block>(header.block_count);
+            _block_size = header.block_size;
+        }
+
+        if (!is_valid_header || blob.overrun() || !is_valid_table_of_contents(_entries, _blocks, _block_size, _file.size()))
+        {
+            assert(false); // not an asset pack, or it's truncated or corrupt.
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void asset_pack::close()
+    {
+        _file.close();
+        _entries = {};
+        _blocks = {};
+        _block_size = 0;
+    }
+
+    UINT asset_pack::find(std::string_view path) const
+    {
+        const UINT64 hash{ name_hash(path) };
+        const auto entry{ std::lower_bound(_entries.begin(), _entries.end(), hash,
+            [](const asset_pack_entry& e, UINT64 h) { return e.name_hash < h; }) };
+        return (entry != _entries.end() && entry->name_hash == hash) ? (UINT)(entry - _entries.begin()) : Invalid_Index;
+    }
+
+    void asset_pack::read_files(const utl::file_read* const reads, UINT count) const
+    {
+        assert(reads || !count);
+        if (!count) return;
+
+        std::unique_ptr<pending_entry[]> pending{ std::make_unique<pending_entry[]>(count) };
+        utl::vector<block_task> tasks{};
+
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            assert(reads[i].path && reads[i].on_read);
+            pending_entry& file{ pending[i] };
+            file.request = &reads[i];
+
+            const UINT index{ find(reads[i].path) };
+            assert(index != Invalid_Index); // the file isn't in the pack.
+            file.entry = (index != Invalid_Index) ? &_entries[index] : nullptr;
+
+            if (!file.entry || file.entry->codec == asset_pack_codec::none)
+            {
+                if (file.entry) _file.prefetch(file.entry->offset, file.entry->size);
+                tasks.emplace_back(block_task{ &file, Invalid_Index });
+                continue;
+            }
+
+            const asset_pack_entry& entry{ *file.entry };
+            const UINT blocks{ block_count(entry.size, _block_size) };
+            const asset_pack_block& last_block{ _blocks[entry.first_block + blocks - 1] };
+            _file.prefetch(entry.offset, last_block.offset + last_block.stored_size - entry.offset);
+
+            file.data = std::make_unique_for_overwrite<UINT8[]>(entry.size);
+            file.blocks_left.store(blocks, std::memory_order_relaxed);
+            for (UINT j{ 0 }; j < blocks; ++j)
+            {
+                tasks.emplace_back(block_task{ &file, entry.first_block + j });
+            }
+        }
+
+        // NOTE: all blocks are about the same size, so splitting them by count balances the work well enough.
+        //       The thread that finishes a file's last block calls its 'on_read'.
+        jobs::parallel_for((UINT)tasks.size(), 1, [&](UINT begin, UINT end) {
+            for (UINT i{ begin }; i < end; ++i)
+            {
+                pending_entry& file{ *tasks[i].pending };
+                const asset_pack_entry* const entry{ file.entry };
+
+                if (tasks[i].block == Invalid_Index)
+                {
+                    const std::span<const UINT8> data{ entry ? std::span<const UINT8>{ _file.data() + entry->offset, (size_t)entry->size } : std::span<const UINT8>{} };
+                    file.request->on_read(data, file.request->context);
+                    continue;
+                }
+
+                const asset_pack_block& block{ _blocks[tasks[i].block] };
+                const UINT8* const source{ _file.data() + block.offset };
+                UINT8* const destination{ &file.data[(UINT64)(tasks[i].block - entry->first_block) * _block_size] };
+
+                if (block.stored_size == block.size) memcpy(destination, source, block.size);
+                else if (!utl::lz4::decompress(source, block.stored_size, destination, block.size)) file.failed.store(true, std::memory_order_relaxed);
+
+                if (file.blocks_left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    const bool failed{ file.failed.load(std::memory_order_relaxed) };
+                    assert(!failed); // the pack is corrupt.
+                    const std::span<const UINT8> data{ failed ? std::span<const UINT8>{} : std::span<const UINT8>{ file.data.get(), (size_t)entry->size } };
+                    file.request->on_read(data, file.request->context);
+                    file.data.reset();
+                }
+            }
+            });
+    }
+
+    utl::vector<std::filesystem::path> list_files_to_pack(const std::filesystem::path* const inputs, UINT count)
+    {
+        assert(inputs || !count);
+        utl::vector<std::filesystem::path> files{};
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            std::error_code error{};
+            if (!std::filesystem::is_directory(inputs[i], error))
+            {
+                files.emplace_back(inputs[i]);
+                continue;
+            }
+
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{ inputs[i], error })
+            {
+                // NOTE: skip packs, so packing a directory again doesn't put the old pack in the new one.
+                if (entry.is_regular_file(error) && entry.path().extension() != ".pack") files.emplace_back(entry.path());
+            }
+        }
+        return files;
+    }
+
+    bool create_asset_pack(const std::filesystem::path& output, const std::filesystem::path* const files, UINT count, UINT block_size)
+    {
+        assert(files || !count);
+        assert(block_size >= asset_pack_min_block_size && block_size <= asset_pack_max_block_size);
+        if (block_size < asset_pack_min_block_size || block_size > asset_pack_max_block_size) return false;
+
+        std::unique_ptr<packed_file[]> packed{ std::make_unique<packed_file[]>(count) };
+        utl::vector<UINT> order(count);
+        UINT total_blocks{ 0 };
+
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            packed_file& file{ packed[i] };
+            if (!file.mapped.open(files[i], utl::mapped_file::access::sequential)) return false;
+
+            file.name_hash = name_hash(files[i].filename().string());
+            file.first_block = total_blocks;
+            file.block_count = block_count(file.mapped.size(), block_size);
+            total_blocks += file.block_count;
+            order[i] = i;
+        }
+
+        std::sort(order.begin(), order.end(), [&](UINT a, UINT b) { return packed[a].name_hash < packed[b].name_hash; });
+        for (UINT i{ 1 }; i < count; ++i)
+        {
+            // Two files with the same name (or, very unlikely, the same hash).
+            if (packed[order[i - 1]].name_hash == packed[order[i]].name_hash) return false;
+        }
+
+        std::unique_ptr<packed_block[]> blocks{ std::make_unique<packed_block[]>(total_blocks) };
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            const packed_file& file{ packed[i] };
+            for (UINT j{ 0 }; j < file.block_count; ++j)
+            {
+                packed_block& block{ blocks[file.first_block + j] };
+                block.source = file.mapped.data() + (UINT64)j * block_size;
+                block.size = (UINT)std::min<UINT64>(block_size, file.mapped.size() - (UINT64)j * block_size);
+            }
+        }
+
+        jobs::parallel_for(total_blocks, 1, [&](UINT begin, UINT end) {
+            for (UINT i{ begin }; i < end; ++i)
+            {
+                packed_block& block{ blocks[i] };
+                const UINT64 capacity{ utl::lz4::compress_bound(block.size) };
+                block.compressed = std::make_unique_for_overwrite<UINT8[]>(capacity);
+                const UINT64 compressed_size{ utl::lz4::compress(block.source, block.size, block.compressed.get(), capacity) };
+
+                // Keep blocks that don't get smaller as they are, they're faster to read that way.
+                if (compressed_size && compressed_size < block.size)
+                {
+                    block.stored_size = (UINT)compressed_size;
+                }
+                else
+                {
+                    block.compressed.reset();
+                    block.stored_size = block.size;
+                }
+            }
+            });
+
+        // Files that didn't get smaller are stored as they are, and read without a copy.
+        UINT table_block_count{ 0 };
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            packed_file& file{ packed[i] };
+            for (UINT j{ 0 }; j < file.block_count; ++j) file.stored_size += blocks[file.first_block + j].stored_size;
+            if (file.stored_size < file.mapped.size()) table_block_count += file.block_count;
+        }
+
+        asset_pack_header header{ asset_pack_magic, asset_pack_version, count, table_block_count, block_size, 0 };
+        utl::vector<asset_pack_entry> entries(count);
+        utl::vector<asset_pack_block> table_blocks{};
+        table_blocks.reserve(table_block_count);
+
+        UINT64 offset{ sizeof(asset_pack_header) + sizeof(asset_pack_entry) * count + sizeof(asset_pack_block) * table_block_count };
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            const packed_file& file{ packed[order[i]] };
+            const bool is_compressed{ file.stored_size < file.mapped.size() };
+            offset = math::align_size_up<entry_alignment>(offset);
+
+            entries[i] = { file.name_hash, offset, file.mapped.size(), (UINT)table_blocks.size(),
+                is_compressed ? asset_pack_codec::lz4 : asset_pack_codec::none };
+
+            if (!is_compressed)
+            {
+                offset += file.mapped.size();
+                continue;
+            }
+
+            for (UINT j{ 0 }; j < file.block_count; ++j)
+            {
+                const packed_block& block{ blocks[file.first_block + j] };
+                table_blocks.emplace_back(asset_pack_block{ offset, block.stored_size, block.size });
+                offset += block.stored_size;
+            }
+        }
+
+        std::ofstream pack{ output, std::ios::out | std::ios::binary | std::ios::trunc };
+        if (!pack) return false;
+
+        pack.write((const char*)&header, sizeof(header));
+        pack.write((const char*)entries.data(), sizeof(asset_pack_entry) * entries.size());
+        pack.write((const char*)table_blocks.data(), sizeof(asset_pack_block) * table_blocks.size());
+
+        UINT64 block_index{ 0 };
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            const packed_file& file{ packed[order[i]] };
+            const asset_pack_entry& entry{ entries[i] };
+
+            constexpr char padding[entry_alignment]{};
+            const UINT64 position{ (UINT64)pack.tellp() };
+            assert(position <= entry.offset && entry.offset - position < entry_alignment);
+            pack.write(&padding[0], entry.offset - position);
+
+            if (entry.codec == asset_pack_codec::none)
+            {
+                pack.write((const char*)file.mapped.data(), file.mapped.size());
+                continue;
+            }
+
+            for (UINT j{ 0 }; j < file.block_count; ++j, ++block_index)
+            {
+                const packed_block& block{ blocks[file.first_block + j] };
+                assert(table_blocks[block_index].stored_size == block.stored_size);
+                pack.write((const char*)(block.compressed ? block.compressed.get() : block.source), block.stored_size);
+            }
+        }
+
+        pack.close();
+        return !pack.fail();
+    }
+}
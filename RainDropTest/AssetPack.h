@@ -0,0 +1,104 @@
+#pragma once
+#include "stdafx.h"
+#include "MappedFile.h"
+#include "Utilities.h"
+#include "Vector.h"
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace content {
+
+    // Asset pack: many asset files in one file, so loading them costs one open instead of one per file.
+    // Layout (little-endian):
+    // struct {
+    //     asset_pack_header header,
+    //     asset_pack_entry entries[entry_count],   // sorted by name_hash
+    //     asset_pack_block blocks[block_count],
+    //     u8 data[]                                // each entry's data starts on a 16 byte boundary
+    // } asset_pack
+    //
+    // Compressed entries are cut in blocks of 'block_size' bytes (the last one may be shorter) that are
+    // compressed on their own, so they can be decompressed in parallel.
+    constexpr UINT asset_pack_magic{ 0x4b504452 }; // "RDPK"
+    constexpr UINT asset_pack_version{ 1 };
+    constexpr UINT asset_pack_min_block_size{ 64 * 1024 };
+    constexpr UINT asset_pack_max_block_size{ 256 * 1024 };
+    constexpr UINT asset_pack_default_block_size{ 128 * 1024 };
+
+    struct asset_pack_codec {
+        enum type : UINT {
+            none,       // stored as is, at 'offset'. Read straight from the pack without a copy.
+            lz4,        // blocks [first_block, first_block + block count) in LZ4 block format.
+
+            count
+        };
+    };
+
+    struct asset_pack_header
+    {
+        UINT magic;
+        UINT version;
+        UINT entry_count;
+        UINT block_count;
+        UINT block_size;
+        UINT reserved;
+    };
+
+    struct asset_pack_entry
+    {
+        UINT64 name_hash;       // utl::hashed_name of the file name, without the directory.
+        UINT64 offset;          // where the entry's data starts, from the start of the pack.
+        UINT64 size;            // uncompressed.
+        UINT first_block;       // for codec 'lz4'.
+        UINT codec;
+    };
+
+    struct asset_pack_block
+    {
+        UINT64 offset;          // from the start of the pack.
+        UINT stored_size;       // a block that didn't get smaller is stored as is, with stored_size == size.
+        UINT size;
+    };
+
+    // Read-only asset pack. The file is memory-mapped and stays open until close().
+    class asset_pack
+    {
+    public:
+        asset_pack() = default;
+        DISABLE_COPY_AND_MOVE(asset_pack);
+        ~asset_pack() { close(); }
+
+        // Maps the pack and checks its table of contents. Returns false if it's missing or malformed.
+        bool open(const std::filesystem::path& path);
+        void close();
+
+        // Returns the index of the entry for a file name (directories are ignored), or Invalid_Index.
+        [[nodiscard]] UINT find(std::string_view path) const;
+
+        // Same as utl::read_files(), but the files come from the pack: each request's path is looked up
+        // by its file name. The blocks of all files are decompressed in parallel on the job threads, and
+        // each 'on_read' is called as soon as its file is complete. Files that aren't in the pack get an
+        // empty span. Returns when all callbacks have returned.
+        void read_files(const utl::file_read* const reads, UINT count) const;
+
+        [[nodiscard]] constexpr bool is_open() const { return _file.is_open(); }
+        [[nodiscard]] constexpr UINT entry_count() const { return (UINT)_entries.size(); }
+
+    private:
+        utl::mapped_file                    _file{};
+        std::span<const asset_pack_entry>   _entries{};
+        std::span<const asset_pack_block>   _blocks{};
+        UINT                                _block_size{ 0 };
+    };
+
+    // The files to pack for a list of files and directories: files are taken as they are, directories add
+    // the files in them (without going into sub-directories). Packs (.pack) in a directory are skipped.
+    [[nodiscard]] utl::vector<std::filesystem::path> list_files_to_pack(const std::filesystem::path* const inputs, UINT count);
+
+    // Packs 'files' into a new asset pack at 'output'. Files are stored by file name, so two files
+    // with the same name can't go in one pack. Compression runs on the job threads.
+    // Returns false if a file can't be read, a name is repeated or the pack can't be written.
+    bool create_asset_pack(const std::filesystem::path& output, const std::filesystem::path* const files, UINT count,
+        UINT block_size = asset_pack_default_block_size);
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include "stdafx.h"
+#include "Vector.h"
+#include <atomic>
+#include <bit>
+
+namespace utl {
+
+    // Resizable set of bits packed in 64-bit words. Meant for dirty and visibility masks:
+    // for_each_set_bit() skips whole empty words and then jumps from one set bit to the next
+    // (count trailing zeros, then clear the lowest set bit), so the work depends on how many
+    // bits are set rather than on how many there are.
+    class bitset
+    {
+    public:
+        bitset() = default;
+
+        constexpr explicit bitset(UINT64 bit_count)
+        {
+            resize(bit_count);
+        }
+
+        // New bits are cleared.
+        constexpr void resize(UINT64 bit_count)
+        {
+            _words.resize(word_count_for(bit_count));
+            _size = bit_count;
+            clear_unused_bits();
+        }
+
+        [[nodiscard]] constexpr UINT64 size() const { return _size; }
+        [[nodiscard]] constexpr UINT64 word_count() const { return _words.size(); }
+        [[nodiscard]] constexpr const UINT64* words() const { return _words.data(); }
+
+        [[nodiscard]] constexpr bool test(UINT64 index) const
+        {
+            assert(index < _size);
+            return (_words[index >> 6] & bit(index)) != 0;
+        }
+
+        constexpr void set(UINT64 index)
+        {
+            assert(index < _size);
+            _words[index >> 6] |= bit(index);
+        }
+
+        constexpr void reset(UINT64 index)
+        {
+            assert(index < _size);
+            _words[index >> 6] &= ~bit(index);
+        }
+
+        // Same as test(), set() and reset(), but safe when other threads change bits in the same word.
+        [[nodiscard]] bool test_atomic(UINT64 index) const
+        {
+            assert(index < _size);
+            // NOTE: atomic_ref needs a non-const object even for loads.
+            UINT64& word{ const_cast<UINT64&>(_words[index >> 6]) };
+            return (std::atomic_ref<UINT64>{ word }.load(std::memory_order_relaxed) & bit(index)) != 0;
+        }
+
+        void set_atomic(UINT64 index)
+        {
+            assert(index < _size);
+            std::atomic_ref<UINT64>{ _words[index >> 6] }.fetch_or(bit(index), std::memory_order_relaxed);
+        }
+
+        void reset_atomic(UINT64 index)
+        {
+            assert(index < _size);
+            std::atomic_ref<UINT64>{ _words[index >> 6] }.fetch_and(~bit(index), std::memory_order_relaxed);
+        }
+
+        // Clears all bits.
+        constexpr void reset()
+        {
+            if (_words.size())
+            {
+                memset(_words.data(), 0, _words.size() * sizeof(UINT64));
+            }
+        }
+
+        // Clears the bits in [first, last).
+        constexpr void reset(UINT64 first, UINT64 last)
+        {
+            assert(first <= last && last <= _size);
+            while (first < last)
+            {
+                const UINT64 word{ first >> 6 };
+                const UINT64 word_end{ (word + 1) << 6 };
+                const UINT64 end{ last < word_end ? last : word_end };
+                _words[word] &= ~range_mask(first & 63, end - (word << 6));
+                first = end;
+            }
+        }
+
+        // Number of set bits.
+        [[nodiscard]] constexpr UINT64 count() const
+        {
+            UINT64 total{ 0 };
+            for (const UINT64 word : _words)
+            {
+                total += std::popcount(word);
+            }
+            return total;
+        }
+
+        [[nodiscard]] constexpr bool any() const
+        {
+            for (const UINT64 word : _words)
+            {
+                if (word) return true;
+            }
+            return false;
+        }
+
+        // Calls func(index) for every set bit, in increasing order.
+        template<typename F>
+        constexpr void for_each_set_bit(F&& func) const
+        {
+            for_each_set_bit(0, _size, std::forward<F>(func));
+        }
+
+        // Calls func(index) for every set bit in [first, last), in increasing order.
+        // NOTE: func may clear bits of this set, but must not set any.
+        template<typename F>
+        constexpr void for_each_set_bit(UINT64 first, UINT64 last, F&& func) const
+        {
+            assert(first <= last && last <= _size);
+            while (first < last)
+            {
+                const UINT64 word_index{ first >> 6 };
+                const UINT64 word_start{ word_index << 6 };
+                const UINT64 end{ (last - word_start) < 64 ? last : word_start + 64 };
+                UINT64 word{ _words[word_index] & range_mask(first - word_start, end - word_start) };
+                while (word)
+                {
+                    func(word_start + std::countr_zero(word));
+                    word &= word - 1; // clear the lowest set bit
+                }
+                first = end;
+            }
+        }
+
+    private:
+        [[nodiscard]] static constexpr UINT64 word_count_for(UINT64 bit_count)
+        {
+            return (bit_count + 63) >> 6;
+        }
+
+        [[nodiscard]] static constexpr UINT64 bit(UINT64 index)
+        {
+            return 1ull << (index & 63);
+        }
+
+        // Bits [first, last) of a word, with last <= 64.
+        [[nodiscard]] static constexpr UINT64 range_mask(UINT64 first, UINT64 last)
+        {
+            assert(first <= last && last <= 64);
+            const UINT64 high{ last == 64 ? ~0ull : (1ull << last) - 1 };
+            return high & ~((1ull << first) - 1);
+        }
+
+        // Keeps count() and any() right after the set shrinks.
+        constexpr void clear_unused_bits()
+        {
+            if (_size & 63)
+            {
+                _words.back() &= range_mask(0, _size & 63);
+            }
+        }
+
+        utl::vector<UINT64> _words;
+        UINT64              _size{ 0 };
+    };
+}
@@ -8,7 +8,9 @@ namespace camera {
 
     namespace {
 
-        utl::free_list<Camera> cameras{ 10 };
+        // NOTE: cameras are kept packed. They move when another camera is removed, so the reference
+        //       returned by get() is only good until then.
+        utl::sparse_free_list<Camera, true> cameras{ 10 };
 
     } // anonymous namespace
 
@@ -108,51 +110,52 @@ namespace camera {
 
     void remove(UINT id)
     {
-        assert(id != Invalid_Index);
+        assert(is_valid(id));
+        if (!is_valid(id)) return;
         cameras.remove(id);
     }
 
     Camera& get(UINT id)
     {
-        assert(id != Invalid_Index);
-        return cameras[id];
+        Camera* const camera{ cameras.get(id) };
+        assert(camera);
+        return *camera;
     }
 
+    bool is_valid(UINT id)
+    {
+        return cameras.contains(id);
+    }
 
+    // NOTE: the setters ignore a removed camera. It may still be referenced by a scene that is being torn down.
     void field_of_view(UINT id, float fov)
     {
-        assert(id != Invalid_Index);
-        cameras[id].field_of_view(fov);
+        if (Camera* const camera{ cameras.get(id) }) camera->field_of_view(fov);
     }
 
     void aspect_ratio(UINT id, float aspect_ratio)
     {
-        assert(id != Invalid_Index);
-        cameras[id].field_of_view(aspect_ratio);
+        if (Camera* const camera{ cameras.get(id) }) camera->aspect_ratio(aspect_ratio);
     }
 
     void view_width(UINT id, float width)
     {
-        assert(id != Invalid_Index);
-        cameras[id].field_of_view(width);
+        if (Camera* const camera{ cameras.get(id) }) camera->view_width(width);
     }
 
     void view_height(UINT id, float height)
     {
-        assert(id != Invalid_Index);
-        cameras[id].field_of_view(height);
+        if (Camera* const camera{ cameras.get(id) }) camera->view_height(height);
     }
 
     void near_z(UINT id, float near_z)
     {
-        assert(id != Invalid_Index);
-        cameras[id].field_of_view(near_z);
+        if (Camera* const camera{ cameras.get(id) }) camera->near_z(near_z);
     }
 
     void far_z(UINT id, float far_z)
     {
-        assert(id != Invalid_Index);
-        cameras[id].field_of_view(far_z);
+        if (Camera* const camera{ cameras.get(id) }) camera->far_z(far_z);
     }
 }
 
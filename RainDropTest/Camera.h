@@ -125,6 +125,8 @@ namespace camera {
     UINT create(camera_init_info info);
     void remove(UINT id);
     [[nodiscard]] Camera& get(UINT id);
+    // O(1), also in release builds. False once the camera was removed.
+    [[nodiscard]] bool is_valid(UINT id);
 
     void field_of_view(UINT id, float fov);
     void aspect_ratio(UINT id, float aspect_ratio);
@@ -0,0 +1,115 @@
+#include "CameraScript.h"
+#include "Math.h"
+
+namespace script {
+
+    class camera_script;
+    REGISTER_SCRIPT(camera_script);
+    camera_script::camera_script(game_entity::entity entity)
+        : script::entity_script{ entity }
+    {
+        _input_system.add_handler(input::input_source::mouse, this, &camera_script::mouse_move);
+
+        _input_system.add_handler(utl::hashed_name{ "move" }, this, &camera_script::on_move);
+
+        XMFLOAT3 pos{ position() };
+        _desired_position = _position = DirectX::XMLoadFloat3(&pos);
+
+        XMFLOAT3 dir{ orientation() };
+        float theta{ DirectX::XMScalarACos(dir.y) };
+        float phi{ std::atan2(-dir.z, dir.x) };
+        XMFLOAT3 rot{ theta - math::half_pi, phi + math::half_pi, 0.f };
+        _desired_spherical = _spherical = DirectX::XMLoadFloat3(&rot);
+    }
+
+    void camera_script::update(float dt)
+    {
+        using namespace DirectX;
+
+        if (_move_magnitude > math::epsilon)
+        {
+            const float fps_scale{ dt / 0.016667f };
+            XMFLOAT4 rot{ rotation() };
+            XMVECTOR d{ XMVector3Rotate(_move * 0.05f * fps_scale, XMLoadFloat4(&rot)) };
+            if (_position_acceleration < 1.f) _position_acceleration += (0.02f * fps_scale);
+            _desired_position += (d * _position_acceleration);
+            _move_position = true;
+        }
+        else if (_move_position)
+        {
+            _position_acceleration = 0.f;
+        }
+
+        if (_move_position || _move_rotation)
+        {
+            camera_seek(dt);
+        }
+    }
+
+    void camera_script::on_move(utl::hashed_name binding, const input::input_value& value)
+    {
+        using namespace DirectX;
+
+        _move = XMLoadFloat3(&value.current);
+        _move_magnitude = XMVectorGetX(XMVector3LengthSq(_move));
+    }
+
+    void camera_script::mouse_move(input::input_source::type type, input::input_code::code code, const input::input_value& mouse_pos)
+    {
+        using namespace DirectX;
+
+        if (code == input::input_code::mouse_position)
+        {
+            input::input_value value;
+            input::get(input::input_source::mouse, input::input_code::mouse_left, value);
+            if (value.current.z == 0.f) return;
+
+            const float scale{ 0.005f };
+            const float dx{ (mouse_pos.current.x - mouse_pos.previous.x) * scale };
+            const float dy{ (mouse_pos.current.y - mouse_pos.previous.y) * scale };
+
+            XMFLOAT3 spherical;
+            DirectX::XMStoreFloat3(&spherical, _desired_spherical);
+            spherical.x += dy;
+            spherical.y -= dx;
+            spherical.x = math::clamp(spherical.x, 0.0001f - math::half_pi, math::half_pi - 0.0001f);
+
+            _desired_spherical = DirectX::XMLoadFloat3(&spherical);
+            _move_rotation = true;
+        }
+    }
+
+    void camera_script::camera_seek(float dt)
+    {
+        using namespace DirectX;
+        XMVECTOR p{ _desired_position - _position };
+        XMVECTOR o{ _desired_spherical - _spherical };
+
+        _move_position = (XMVectorGetX(XMVector3LengthSq(p)) > math::epsilon);
+        _move_rotation = (XMVectorGetX(XMVector3LengthSq(o)) > math::epsilon);
+
+        const float scale{ 0.2f * dt / 0.016667f };
+
+        if (_move_position)
+        {
+            _position += (p * scale);
+            XMFLOAT3 new_pos;
+            XMStoreFloat3(&new_pos, _position);
+            set_position(new_pos);
+        }
+
+        if (_move_rotation)
+        {
+            _spherical += (o * scale);
+            XMFLOAT3 new_rot;
+            XMStoreFloat3(&new_rot, _spherical);
+            new_rot.x = math::clamp(new_rot.x, 0.0001f - math::half_pi, math::half_pi - 0.0001f);
+            _spherical = DirectX::XMLoadFloat3(&new_rot);
+
+            DirectX::XMVECTOR quat{ DirectX::XMQuaternionRotationRollPitchYawFromVector(_spherical) };
+            XMFLOAT4 rot_quat;
+            DirectX::XMStoreFloat4(&rot_quat, quat);
+            set_rotation(rot_quat);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Scripts.h"
+#include "Input.h"
+
+namespace script
+{
+    // The scene camera's script: moves with the "move" binding and turns while the left mouse button is down.
+    class camera_script : public script::entity_script
+    {
+    public:
+        camera_script() = default;
+        ~camera_script() = default;
+        explicit camera_script(game_entity::entity entity);
+        void begin_play() override {}
+        void update(float dt) override;
+
+    private:
+
+        void on_move(utl::hashed_name binding, const input::input_value& value);
+        void mouse_move(input::input_source::type type, input::input_code::code code, const input::input_value& mouse_pos);
+        void camera_seek(float dt);
+
+        input::input_system<camera_script>  _input_system{};
+
+        DirectX::XMVECTOR                   _desired_position;
+        DirectX::XMVECTOR                   _desired_spherical;
+        DirectX::XMVECTOR                   _position;
+        DirectX::XMVECTOR                   _spherical;
+        DirectX::XMVECTOR                   _move{};
+        float                               _move_magnitude{ 0.f };
+        float                               _position_acceleration{ 0.f };
+        bool                                _move_position{ false };
+        bool                                _move_rotation{ false };
+    };
+}
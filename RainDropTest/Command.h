@@ -1,6 +1,7 @@
 #pragma once
 #include "stdafx.h"
 #include "DXApp.h"
+#include "CommandList.h"
 //#include "Surface.h"
 
 namespace surface {
@@ -49,4 +50,22 @@ namespace command {
         UINT m_frame_index{ 0 };
     };
 
+    // Records into a D3D12 command list. The draw loops take a command_list, see DrawList.h.
+    class d3d12_command_list final : public command_list
+    {
+    public:
+        explicit d3d12_command_list(id3d12_graphics_command_list* const cmd_list) : m_cmd_list{ cmd_list } { assert(cmd_list); }
+
+        void set_root_signature(ID3D12RootSignature* const root_signature) override { m_cmd_list->SetGraphicsRootSignature(root_signature); }
+        void set_pipeline_state(ID3D12PipelineState* const pipeline_state) override { m_cmd_list->SetPipelineState(pipeline_state); }
+        void set_root_constant_buffer_view(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address) override { m_cmd_list->SetGraphicsRootConstantBufferView(parameter, address); }
+        void set_root_shader_resource_view(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address) override { m_cmd_list->SetGraphicsRootShaderResourceView(parameter, address); }
+        void set_index_buffer(const D3D12_INDEX_BUFFER_VIEW& view) override { m_cmd_list->IASetIndexBuffer(&view); }
+        void set_primitive_topology(D3D_PRIMITIVE_TOPOLOGY topology) override { m_cmd_list->IASetPrimitiveTopology(topology); }
+        void draw_indexed(UINT index_count) override { m_cmd_list->DrawIndexedInstanced(index_count, 1, 0, 0, 0); }
+
+    private:
+        id3d12_graphics_command_list* const m_cmd_list;
+    };
+
 }
\ No newline at end of file
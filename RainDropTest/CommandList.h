@@ -0,0 +1,23 @@
+#pragma once
+#include "stdafx.h"
+
+namespace command {
+
+    // The commands graphic_pass records for each render item. Recording goes through this interface so the
+    // same draw loops run without a GPU: Command.h forwards them to D3D12, and the headless frame_bench
+    // (bench/FrameBench.cpp) keeps a trace instead.
+    // NOTE: only takes the D3D12 types that the bench's stdafx.h also declares.
+    class command_list
+    {
+    public:
+        virtual ~command_list() = default;
+
+        virtual void set_root_signature(ID3D12RootSignature* const root_signature) = 0;
+        virtual void set_pipeline_state(ID3D12PipelineState* const pipeline_state) = 0;
+        virtual void set_root_constant_buffer_view(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+        virtual void set_root_shader_resource_view(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+        virtual void set_index_buffer(const D3D12_INDEX_BUFFER_VIEW& view) = 0;
+        virtual void set_primitive_topology(D3D_PRIMITIVE_TOPOLOGY topology) = 0;
+        virtual void draw_indexed(UINT index_count) = 0;
+    };
+}
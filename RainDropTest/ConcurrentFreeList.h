@@ -0,0 +1,210 @@
+#pragma once
+#include "stdafx.h"
+#include "FreeList.h"
+#include <atomic>
+
+namespace utl {
+
+    // Same interface as utl::free_list, but add() and remove() may be called from any number of
+    // threads at once and lookups are wait-free:
+    //  - items live in fixed-size pages that are never moved, so a lookup is two loads.
+    //  - free slots form a lock-free stack. The head carries a tag that changes on every push/pop,
+    //    which avoids the ABA problem when a slot is popped and pushed back between a load and a CAS.
+    // NOTE: as with free_list, removing an item while another thread still reads it is a bug.
+    template<typename T, bool generational = false>
+    class concurrent_free_list
+    {
+    public:
+        concurrent_free_list() = default;
+        concurrent_free_list(UINT list_index) : m_list_index{ list_index } {}
+        DISABLE_COPY_AND_MOVE(concurrent_free_list);
+
+        ~concurrent_free_list()
+        {
+            assert(!m_size);
+            for (UINT i{ 0 }; i < max_pages; ++i)
+            {
+                delete[] m_pages[i].load(std::memory_order_relaxed);
+            }
+        }
+
+        template<class... params>
+        UINT add(params&&... p)
+        {
+            UINT index{ pop_free_slot() };
+            if (index == Invalid_Index)
+            {
+                index = m_next_unused.fetch_add(1, std::memory_order_relaxed);
+                assert(index <= id::max_index && (index >> page_shift) < max_pages);
+            }
+
+            slot& s{ get_slot(index, true) };
+            new (s.storage) T(std::forward<params>(p)...);
+            s.next.store(live_marker, std::memory_order_release);
+            m_size.fetch_add(1, std::memory_order_relaxed);
+
+            if constexpr (generational)
+            {
+                return id::make(index, s.generation.load(std::memory_order_relaxed));
+            }
+            else
+            {
+                return index;
+            }
+        }
+
+        void remove(UINT id)
+        {
+            assert(check_id(id));
+            const UINT index{ slot_index(id) };
+            slot& s{ get_slot(index, false) };
+            ((T*)s.storage)->~T();
+            DEBUG_OP(memset(s.storage, 0xcc, sizeof(T)));
+
+            if constexpr (generational)
+            {
+                s.generation.store((UINT8)((s.generation.load(std::memory_order_relaxed) + 1) & id::generation_mask), std::memory_order_relaxed);
+            }
+
+            m_size.fetch_sub(1, std::memory_order_relaxed);
+            push_free_slot(index, s);
+        }
+
+        UINT size() const
+        {
+            return m_size.load(std::memory_order_relaxed);
+        }
+
+        UINT capacity() const
+        {
+            return m_next_unused.load(std::memory_order_relaxed);
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        // O(1) check that 'id' refers to a live item. Only available for generational lists.
+        [[nodiscard]] bool is_valid(UINT id) const
+        {
+            static_assert(generational, "is_valid() needs generation-tagged ids.");
+            return is_live(id) && get_slot(id::index(id), false).generation.load(std::memory_order_relaxed) == id::generation(id);
+        }
+
+        // Returns the item, or nullptr if 'id' is stale. Unlike operator[], this is checked in release builds too.
+        [[nodiscard]] T* get(UINT id)
+        {
+            return is_valid(id) ? (T*)get_slot(id::index(id), false).storage : nullptr;
+        }
+
+        [[nodiscard]] const T* get(UINT id) const
+        {
+            return is_valid(id) ? (const T*)get_slot(id::index(id), false).storage : nullptr;
+        }
+
+        [[nodiscard]] T& operator[](UINT id)
+        {
+            assert(check_id(id));
+            return *(T*)get_slot(slot_index(id), false).storage;
+        }
+
+        [[nodiscard]] const T& operator[](UINT id) const
+        {
+            assert(check_id(id));
+            return *(const T*)get_slot(slot_index(id), false).storage;
+        }
+
+    private:
+        static constexpr UINT page_shift{ 10 };
+        static constexpr UINT page_size{ 1u << page_shift };
+        static constexpr UINT page_mask{ page_size - 1 };
+        static constexpr UINT max_pages{ 4096 };
+        // Stored in 'next' while the slot holds an item. Never a valid slot index (see utl::id::max_index).
+        static constexpr UINT live_marker{ Invalid_Index - 1 };
+
+        struct slot
+        {
+            alignas(T) UINT8 storage[sizeof(T)];
+            std::atomic<UINT> next{ Invalid_Index };
+            std::atomic<UINT8> generation{ 0 };
+        };
+
+        [[nodiscard]] static constexpr UINT slot_index(UINT id)
+        {
+            if constexpr (generational) return id::index(id);
+            else return id;
+        }
+
+        bool is_live(UINT id) const
+        {
+            const UINT index{ slot_index(id) };
+            if (index >= m_next_unused.load(std::memory_order_acquire)) return false;
+            const slot* const page{ m_pages[index >> page_shift].load(std::memory_order_acquire) };
+            return page && page[index & page_mask].next.load(std::memory_order_acquire) == live_marker;
+        }
+
+        bool check_id(UINT id) const
+        {
+            if constexpr (generational) return is_valid(id);
+            else return is_live(id);
+        }
+
+        slot& get_slot(UINT index, bool allocate) const
+        {
+            std::atomic<slot*>& page_ptr{ m_pages[index >> page_shift] };
+            slot* page{ page_ptr.load(std::memory_order_acquire) };
+            if (!page)
+            {
+                assert(allocate);
+                // Several threads may get here for the same page. Only one allocation wins.
+                slot* const new_page{ new slot[page_size] };
+                if (page_ptr.compare_exchange_strong(page, new_page, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    page = new_page;
+                }
+                else
+                {
+                    delete[] new_page;
+                }
+            }
+            return page[index & page_mask];
+        }
+
+        UINT pop_free_slot()
+        {
+            UINT64 head{ m_free_head.load(std::memory_order_acquire) };
+            while (true)
+            {
+                const UINT index{ (UINT)head };
+                if (index == Invalid_Index) return Invalid_Index;
+
+                // NOTE: another thread may pop this slot and reuse it before our CAS. Then 'next' is
+                //       garbage, but the tag will have changed and the CAS fails.
+                const UINT next{ get_slot(index, false).next.load(std::memory_order_acquire) };
+                const UINT64 new_head{ (((head >> 32) + 1) << 32) | next };
+                if (m_free_head.compare_exchange_weak(head, new_head, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    return index;
+                }
+            }
+        }
+
+        void push_free_slot(UINT index, slot& s)
+        {
+            UINT64 head{ m_free_head.load(std::memory_order_relaxed) };
+            UINT64 new_head{ 0 };
+            do
+            {
+                s.next.store((UINT)head, std::memory_order_relaxed);
+                new_head = (((head >> 32) + 1) << 32) | index;
+            } while (!m_free_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        mutable std::atomic<slot*>  m_pages[max_pages]{};
+        std::atomic<UINT64>         m_free_head{ Invalid_Index };   // tag in the high 32 bits, slot index in the low 32 bits.
+        std::atomic<UINT>           m_next_unused{ 0 };
+        std::atomic<UINT>           m_size{ 0 };
+        UINT                        m_list_index{ Invalid_Index };
+    };
+}
@@ -1,16 +1,14 @@
-#include <unordered_map>
 #include "Content.h"
 #include "Math.h"
-#include "Buffers.h"
 #include "FreeList.h"
-#include "Main.h"
-#include "Helpers.h"
-#include "GraphicPass.h"
-#include "Core.h"
+#include "ConcurrentFreeList.h"
+#include "SmallVector.h"
+#include "FlatHashMap.h"
+#include "GraphicCache.h"
+#include "GpuDevice.h"
 #include "Utilities.h"
-#include "Upload.h"
+#include "Jobs.h"
 //#include "ContentToEngine.h"
-#include "Shaders.h"
 
 //#include <iostream>
 //#include <Windows.h>
@@ -39,36 +37,46 @@ namespace content
             UINT depth_pso_id;
         };
 
-        // sub mesh
+        // NOTE: sub meshes, textures, materials and render items are added and removed by loader threads
+        //       while the render thread reads them every frame, so their lists are lock-free instead of
+        //       sharing a mutex. Items never move once added (see utl::concurrent_free_list).
 
-        utl::free_list<ID3D12Resource*> sub_mesh_buffers{ 1 };
-        utl::free_list<sub_mesh_view> sub_mesh_views{ 2 };
-        std::mutex sub_mesh_mutex{};
+        // sub mesh
+        // The buffer is kept with its views, so both are added and removed under one id.
+        struct sub_mesh_entry
+        {
+            gpu::buffer     buffer;
+            sub_mesh_view   view;
+        };
+        utl::concurrent_free_list<sub_mesh_entry, true> sub_meshes{ 1 };
 
         // textures
-        utl::free_list<resource::Texture_Buffer> textures{ 3 };
-        utl::free_list<UINT> descriptor_indices{ 4 };
-        std::mutex texture_mutex{};
+        utl::concurrent_free_list<gpu::texture, true> textures{ 3 };
 
         // material
+        // NOTE: most material buffers fit in the inline storage.
+        using material_buffer = utl::small_vector<UINT8, 128>;
+        utl::concurrent_free_list<material_buffer, true> materials{ 5 };
+        // NOTE: root signatures are only added, by the first material that needs one. The mutex guards the
+        //       vector, which may grow while the PSO creation or a frame reads it.
         utl::vector<ID3D12RootSignature*> root_signatures;
-        std::unordered_map<UINT64, UINT> material_root_signature_map;
-        utl::free_list<std::unique_ptr<UINT8[]>> materials{ 5 };
-        std::mutex material_mutex{};
+        utl::flat_hash_map<UINT64, UINT> material_root_signature_map;
+        std::mutex root_signature_mutex{};
 
-        utl::free_list<d3d12_render_item> render_items{ 6 };
-        utl::free_list<std::unique_ptr<UINT[]>>render_item_ids{ 7 };
-        std::mutex render_item_mutex{};
+        utl::concurrent_free_list<d3d12_render_item, true> render_items{ 6 };
+        // [0] geometry content id, [1..n] d3d12 render item ids, [n+1] Invalid_Index
+        using render_item_id_list = utl::small_vector<UINT, 8>;
+        utl::concurrent_free_list<render_item_id_list, true> render_item_ids{ 7 };
 
         utl::vector<ID3D12PipelineState*> pipeline_states;
-        std::unordered_map<UINT64, UINT> pso_map;
+        // The description each PSO was created from, in the same order as pipeline_states. A PSO is only
+        // reused when its description matches byte for byte, so two descriptions with the same hash can't alias.
+        utl::vector<gpu::pipeline_state_desc> pipeline_state_descs;
+        // pso_map has the newest PSO for each hash. This links it to the previous one with the same hash.
+        utl::vector<UINT> pso_same_hash_next;
+        utl::flat_hash_map<UINT64, UINT> pso_map;
         std::mutex pso_mutex{};
 
-        struct {
-            utl::vector<level_of_detail_offset_count> lod_offsets_counts;
-            utl::vector<UINT> geometry_ids;
-        } frame_cache;
-
         // struct {
         //     material_type::type  type,
         //     shader_flags::flags  flags,
@@ -94,9 +102,9 @@ namespace content
             }
 
             // Create the new material buffer with the material init info
-            explicit Material_Stream(std::unique_ptr<UINT8[]>& material_buffer, material_init_info info)
+            explicit Material_Stream(material_buffer& new_buffer, material_init_info info)
             {
-                assert(!material_buffer);
+                assert(new_buffer.empty());
 
                 UINT shader_count{ 0 };
                 UINT flags{ 0 };
@@ -124,8 +132,8 @@ namespace content
                 };
 
                 // Make the material buffer
-                material_buffer = std::make_unique<UINT8[]>(buffer_size);
-                m_buffer = material_buffer.get();
+                new_buffer.resize(buffer_size);
+                m_buffer = new_buffer.data();
                 UINT8* const buffer{ m_buffer };
 
                 UINT root_signature_id = create_root_signature(info.type, (shaders::shader_flags::flags)flags);
@@ -159,7 +167,7 @@ namespace content
             }
 
             [[nodiscard]] constexpr UINT texture_count() const { return m_texture_count; }
-            [[nodiscard]] constexpr material_type::type material_type() const { return m_type; }
+            [[nodiscard]] constexpr content::material_type::type material_type() const { return m_type; }
             [[nodiscard]] constexpr shaders::shader_flags::flags shader_flags() const { return m_shader_flags; }
             [[nodiscard]] constexpr UINT root_signature_id() const { return m_root_signature_id; }
             [[nodiscard]] constexpr UINT* texture_ids() const { return m_texture_ids; }
@@ -216,35 +224,6 @@ namespace content
             return D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
         }
 
-        constexpr D3D12_PRIMITIVE_TOPOLOGY_TYPE get_d3d_primitive_topology_type(D3D_PRIMITIVE_TOPOLOGY topology)
-        {
-            switch (topology)
-            {
-            case D3D_PRIMITIVE_TOPOLOGY_POINTLIST: return D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
-            case D3D_PRIMITIVE_TOPOLOGY_LINELIST:
-            case D3D_PRIMITIVE_TOPOLOGY_LINESTRIP: return D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
-            case D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
-            case D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP: return D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-            }
-
-            return D3D12_PRIMITIVE_TOPOLOGY_TYPE_UNDEFINED;
-        }
-
-
-        constexpr D3D12_ROOT_SIGNATURE_FLAGS
-            get_root_signature_flags(shaders::shader_flags::flags flags)
-        {
-            D3D12_ROOT_SIGNATURE_FLAGS default_flags{ d3dx::d3d12_root_signature_desc::default_flags };
-            if (flags & shaders::shader_flags::vertex)           default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS;
-            if (flags & shaders::shader_flags::hull)             default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS;
-            if (flags & shaders::shader_flags::domain)           default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS;
-            if (flags & shaders::shader_flags::geometry)         default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
-            if (flags & shaders::shader_flags::pixel)            default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
-            if (flags & shaders::shader_flags::amplification)    default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS;
-            if (flags & shaders::shader_flags::mesh)             default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS;
-            return default_flags;
-        }
-
         UINT create_root_signature(material_type::type type, shaders::shader_flags::flags flags)
         {
             assert(type < material_type::count);
@@ -256,178 +235,96 @@ namespace content
                 return pair->second;
             }
 
-            ID3D12RootSignature* root_signature{ nullptr };
-
-            switch (type)
-            {
-            case material_type::opaque:
-            {
-                using params = opaque_root_parameter;
-                d3dx::d3d12_root_parameter parameters[params::count]{};
-
-                D3D12_SHADER_VISIBILITY buffer_visibility{ D3D12_SHADER_VISIBILITY_VERTEX };
-                D3D12_SHADER_VISIBILITY data_visibility{ D3D12_SHADER_VISIBILITY_ALL };
-
-                parameters[params::global_shader_data].as_cbv(D3D12_SHADER_VISIBILITY_ALL, 0);
-                parameters[params::per_object_data].as_cbv(data_visibility, 1);
-                parameters[params::position_buffer].as_srv(buffer_visibility, 0);
-                parameters[params::element_buffer].as_srv(buffer_visibility, 1);
-                parameters[params::srv_indices].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 2); // TODO: needs to be visible to any stages that need to sample textures.
-                parameters[params::directional_lights].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 3);
-                parameters[params::cullable_lights].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 4);
-                parameters[params::light_grid].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 5);
-                parameters[params::light_index_list].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 6);
-
-                const D3D12_STATIC_SAMPLER_DESC samplers[]
-                {
-                    d3dx::static_sampler(d3dx::sampler_state.static_point, 0, 0, D3D12_SHADER_VISIBILITY_PIXEL),
-                    d3dx::static_sampler(d3dx::sampler_state.static_linear, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL),
-                    d3dx::static_sampler(d3dx::sampler_state.static_anisotropic, 2, 0, D3D12_SHADER_VISIBILITY_PIXEL),
-                };
-
-                D3D12_ROOT_SIGNATURE_FLAGS flags{ d3dx::d3d12_root_signature_desc::default_flags };
-                flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS;
-                flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
-
-                root_signature = d3dx::d3d12_root_signature_desc
-                {
-                    &parameters[0],
-                    _countof(parameters),
-                    flags,
-                    &samplers[0], _countof(samplers)
-                }.create();
-            }
-            break;
-            }
-
+            ID3D12RootSignature* const root_signature{ gpu::current().create_root_signature(type, flags) };
             assert(root_signature);
             const UINT id{ (UINT)root_signatures.size() };
             root_signatures.emplace_back(root_signature);
             material_root_signature_map[key] = id;
-            NAME_D3D12_OBJECT_INDEXED(root_signature, key, L"Main Root Signature - key");
 
             return id;
         }
 
-        UINT create_pso_if_needed(const UINT8* const stream_ptr, UINT64 aligned_stream_size)
+        // NOTE: pso_mutex must be locked before calling this function.
+        UINT find_pso(UINT64 key, const gpu::pipeline_state_desc& desc)
         {
-            const UINT64 key{ math::calc_crc32_u64(stream_ptr, aligned_stream_size) };
+            const auto pair{ pso_map.find(key) };
+            UINT id{ pair != pso_map.end() ? pair->second : Invalid_Index };
+            while (id != Invalid_Index && memcmp(&pipeline_state_descs[id], &desc, sizeof(gpu::pipeline_state_desc)))
+            {
+                id = pso_same_hash_next[id];
+            }
+            return id;
+        }
+
+        UINT create_pso_if_needed(const gpu::pipeline_state_desc& desc)
+        {
+            const UINT64 key{ math::hash64(&desc, sizeof(gpu::pipeline_state_desc)) };
 
             // Lock scope to check if PSO already exists
             {
                 std::lock_guard lock{ pso_mutex };
-                auto pair = pso_map.find(key);
-
-                if (pair != pso_map.end())
+                const UINT id{ find_pso(key, desc) };
+                if (id != Invalid_Index)
                 {
-                    assert(pair->first == key);
-                    return pair->second;
+                    return id;
                 }
             }
 
             // Creating a new PSO is lock-free
-            d3dx::d3d12_pipeline_state_subobject_stream* const stream{ (d3dx::d3d12_pipeline_state_subobject_stream* const)stream_ptr };
-            ID3D12PipelineState* pso{ d3dx::create_pipeline_state(stream, sizeof(d3dx::d3d12_pipeline_state_subobject_stream)) };
+            gpu::device& device{ gpu::current() };
+            ID3D12PipelineState* pso{ device.create_pipeline_state(desc) };
 
             // Lock scope to add the new PSO's pointer and id (I know, scoping is not necessary, but it's more obvious this way.)
             {
                 std::lock_guard lock{ pso_mutex };
+
+                // Another thread may have created the same PSO in the meantime.
+                const UINT existing_id{ find_pso(key, desc) };
+                if (existing_id != Invalid_Index)
+                {
+                    device.release_pipeline_state(pso);
+                    return existing_id;
+                }
+
                 const UINT id{ (UINT)pipeline_states.size() };
                 pipeline_states.emplace_back(pso);
-                NAME_D3D12_OBJECT_INDEXED(pipeline_states.back(), key, L"Pipeline State Object - key");
+                pipeline_state_descs.emplace_back(desc);
 
-                pso_map[key] = id;
+                auto [pair, inserted]{ pso_map.try_emplace(key, id) };
+                pso_same_hash_next.emplace_back(inserted ? Invalid_Index : pair->second);
+                pair->second = id;
                 return id;
             }
         }
 
-        UINT create_graphic_pso(UINT material_id, D3D12_PRIMITIVE_TOPOLOGY primitive_topology, UINT elements_type)
+        gpu::pipeline_state_desc get_pipeline_state_desc(UINT material_id, D3D_PRIMITIVE_TOPOLOGY primitive_topology, UINT elements_type, gpu::pipeline_pass::pass pass)
         {
-            constexpr UINT64 aligned_stream_size{ math::align_size_up<sizeof(UINT64)>(sizeof(d3dx::d3d12_pipeline_state_subobject_stream)) };
-            UINT8* const stream_ptr{ (UINT8* const)_malloca(aligned_stream_size) };
-            ZeroMemory(stream_ptr, aligned_stream_size);
-            new (stream_ptr) d3dx::d3d12_pipeline_state_subobject_stream{};
-
-            d3dx::d3d12_pipeline_state_subobject_stream& stream{ *(d3dx::d3d12_pipeline_state_subobject_stream* const)stream_ptr };
-
-            // lock materials
+            gpu::pipeline_state_desc desc{};
             {
-                std::lock_guard lock{ material_mutex };
-
-                const  Material_Stream material{ materials[material_id].get() };
-                const UINT8* const material_ptr = (UINT8* const)materials[material_id].get();
-
-                D3D12_RT_FORMAT_ARRAY rt_array{};
-                rt_array.NumRenderTargets = 1;
-                rt_array.RTFormats[0] = graphic_pass::main_buffer_format;
-
-                stream.render_target_formats = rt_array;
-                stream.root_signature = root_signatures[material.root_signature_id()];
-                stream.primitive_topology = get_d3d_primitive_topology_type(primitive_topology);
-                stream.depth_stencil_format = graphic_pass::depth_buffer_format;
-                stream.rasterizer = d3dx::rasterizer_state.face_cull;
-                stream.depth_stencil1 = d3dx::depth_state.reversed_readonly;
-                stream.blend = d3dx::blend_state.disabled;
-
-                const shaders::shader_flags::flags flags{ material.shader_flags() };
-                const UINT key{ shaders::element_type_to_shader_id(elements_type) };
-                stream.vs = shaders::get_engine_shader(key);
-                //stream.ps = shaders::get_engine_shader(shaders::engine_shader::pixel_shader_ps);
-                stream.ps = shaders::get_engine_shader(shaders::engine_shader::texture_shader_ps);
-            }
-
-            UINT pso_id = create_pso_if_needed(stream_ptr, aligned_stream_size);
+                std::lock_guard lock{ root_signature_mutex };
 
-            //stream.depth_stencil1 = d3dx::depth_state.reversed;
-            //const UINT key{ shaders::element_type_to_shader_id(elements_type) };
-
-            _freea(stream_ptr);
-            return pso_id;
+                const Material_Stream material{ materials[material_id].data() };
+                desc.root_signature = root_signatures[material.root_signature_id()];
+                desc.shader_flags = material.shader_flags();
+            }
 
+            desc.elements_type = elements_type;
+            desc.primitive_topology = primitive_topology;
+            desc.pass = pass;
+            return desc;
         }
 
-        UINT create_depth_pso(UINT material_id, D3D12_PRIMITIVE_TOPOLOGY primitive_topology, UINT elements_type)
+        UINT create_graphic_pso(UINT material_id, D3D_PRIMITIVE_TOPOLOGY primitive_topology, UINT elements_type)
         {
-            constexpr UINT64 aligned_stream_size{ math::align_size_up<sizeof(UINT64)>(sizeof(d3dx::d3d12_pipeline_state_subobject_stream)) };
-            UINT8* const stream_ptr{ (UINT8* const)_malloca(aligned_stream_size) };
-            ZeroMemory(stream_ptr, aligned_stream_size);
-            new (stream_ptr) d3dx::d3d12_pipeline_state_subobject_stream{};
-
-            d3dx::d3d12_pipeline_state_subobject_stream& stream{ *(d3dx::d3d12_pipeline_state_subobject_stream* const)stream_ptr };
-
-            // lock materials
-            {
-                std::lock_guard lock{ material_mutex };
-
-                const  Material_Stream material{ materials[material_id].get() };
-                const UINT8* const material_ptr = (UINT8* const)materials[material_id].get();
-
-                stream.root_signature = root_signatures[material.root_signature_id()];
-
-                const shaders::shader_flags::flags flags{ material.shader_flags() };
-                const UINT key{ shaders::element_type_to_shader_id(elements_type) };
-                stream.vs = shaders::get_engine_shader(key);
-            }
-
-            D3D12_RT_FORMAT_ARRAY rt_array{};
-            rt_array.NumRenderTargets = 1;
-            rt_array.RTFormats[0] = graphic_pass::main_buffer_format;
-
-            stream.render_target_formats = rt_array;
-            stream.primitive_topology = get_d3d_primitive_topology_type(primitive_topology);
-            stream.depth_stencil_format = graphic_pass::depth_buffer_format;
-            stream.rasterizer = d3dx::rasterizer_state.face_cull;
-            stream.depth_stencil1 = d3dx::depth_state.reversed_readonly;
-            stream.blend = d3dx::blend_state.disabled;
-
-            stream.depth_stencil1 = d3dx::depth_state.reversed;
-            UINT pso_id = create_pso_if_needed(stream_ptr, aligned_stream_size);
+            return create_pso_if_needed(get_pipeline_state_desc(material_id, primitive_topology, elements_type, gpu::pipeline_pass::graphic));
+        }
 
-            _freea(stream_ptr);
-            return pso_id;
+        UINT create_depth_pso(UINT material_id, D3D_PRIMITIVE_TOPOLOGY primitive_topology, UINT elements_type)
+        {
+            return create_pso_if_needed(get_pipeline_state_desc(material_id, primitive_topology, elements_type, gpu::pipeline_pass::depth));
         }
 
-        resource::Texture_Buffer create_resource_from_texture_data(const UINT8* const data)
+        gpu::texture create_resource_from_texture_data(utl::blob_stream_reader& blob)
         {
             // struct {
             //     u32 width, height, array_size (or depth), flags, mip_levels, format,
@@ -437,181 +334,70 @@ namespace content
             //     } images[]
             // } texture
 
-            assert(data);
-            utl::blob_stream_reader blob{ data };
-            const UINT width{ blob.read<UINT>() };
-            const UINT height{ blob.read<UINT>() };
-            UINT depth{ 1 };
-            UINT array_size{ blob.read<UINT>() };
+            gpu::texture_desc desc{};
+            desc.width = blob.read<UINT>();
+            desc.height = blob.read<UINT>();
+            desc.array_size = blob.read<UINT>();
             const UINT flags{ blob.read<UINT>() };
-            const UINT mip_levels{ blob.read<UINT>() };
-            const DXGI_FORMAT format{ (DXGI_FORMAT)blob.read<UINT>() };
-            const bool is_3d{ (flags & content::texture_flags::is_volume_map) != 0 };
+            desc.mip_levels = blob.read<UINT>();
+            desc.format = (DXGI_FORMAT)blob.read<UINT>();
+            desc.is_volume_map = (flags & content::texture_flags::is_volume_map) != 0;
+            desc.is_cube_map = (flags & content::texture_flags::is_cube_map) != 0;
+            const UINT mip_levels{ desc.mip_levels };
 
-            assert(mip_levels <= resource::Texture_Buffer::max_mips);
+            assert(mip_levels <= gpu::max_texture_mips);
+            if (mip_levels > gpu::max_texture_mips) return {};
 
-            UINT depth_per_mip_level[resource::Texture_Buffer::max_mips]{};
-            for (UINT i{ 0 }; i < resource::Texture_Buffer::max_mips; ++i)
+            UINT depth_per_mip_level[gpu::max_texture_mips]{};
+            for (UINT i{ 0 }; i < gpu::max_texture_mips; ++i)
             {
                 depth_per_mip_level[i] = 1;
             }
 
-            if (is_3d)
+            if (desc.is_volume_map)
             {
-                depth = array_size;
-                array_size = 1;
-                UINT depth_per_mip{ depth };
+                desc.depth = desc.array_size;
+                desc.array_size = 1;
+                UINT depth_per_mip{ desc.depth };
 
                 for (UINT i{ 0 }; i < mip_levels; ++i)
                 {
                     depth_per_mip_level[i] = depth_per_mip;
-                    depth_per_mip = (depth_per_mip >> 1, (UINT)1) ? depth_per_mip >> 1 : (UINT)1;
+                    depth_per_mip = (depth_per_mip >> 1) > 1 ? depth_per_mip >> 1 : (UINT)1;
                 }
             }
 
-            // set the D3D12_SUBRESOURCE_DATA
-            utl::vector<D3D12_SUBRESOURCE_DATA> subresources{};
+            const UINT array_size{ desc.array_size };
+            utl::vector<gpu::subresource_data> subresources{};
+            subresources.reserve((UINT64)array_size * mip_levels);
 
             for (UINT i{ 0 }; i < array_size; ++i)
             {
                 for (UINT j{ 0 }; j < mip_levels; ++j)
                 {
-                    const UINT row_pitch{ blob.read<UINT>() };
-                    const UINT slice_pitch{ blob.read<UINT>() };
+                    UINT pitches[2]{};
+                    blob.read(&pitches[0], _countof(pitches));
+                    const UINT row_pitch{ pitches[0] };
+                    const UINT slice_pitch{ pitches[1] };
+
+                    // NOTE: the image stays in the blob, it's copied once, to the upload buffer.
+                    const std::span<const UINT8> image{ blob.read_span<UINT8>((UINT64)slice_pitch * depth_per_mip_level[j]) };
 
-                    subresources.emplace_back(D3D12_SUBRESOURCE_DATA
+                    subresources.emplace_back(gpu::subresource_data
                         {
-                            blob.position(),
+                            image.data(),
                             row_pitch,
                             slice_pitch
                         });
-
-                    // skip the rest of slices.
-                    blob.skip(slice_pitch * depth_per_mip_level[j]);
                 }
             }
 
-            // set the GetCopyableFootprints
-            D3D12_RESOURCE_DESC desc{};
-            desc.Dimension = is_3d ? D3D12_RESOURCE_DIMENSION_TEXTURE3D : D3D12_RESOURCE_DIMENSION_TEXTURE2D;  //  D3D12_RESOURCE_DIMENSION Dimension;
-            desc.Alignment = 0;                                                  //  UINT64 Alignment;
-            desc.Width = width;                                                  //  UINT64 Width;
-            desc.Height = height;                                                //  UINT Height;
-            desc.DepthOrArraySize = is_3d ? (UINT16)depth : (UINT16)array_size; //  UINT16 DepthOrArraySize;
-            desc.MipLevels = (UINT16)mip_levels;                                 //  UINT16 MipLevels;
-            desc.Format = format;                                                //  DXGI_FORMAT Format;
-            desc.SampleDesc = { 1, 0 };                                          //  DXGI_SAMPLE_DESC SampleDesc;
-            desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;                          //  D3D12_TEXTURE_LAYOUT Layout;
-            desc.Flags = D3D12_RESOURCE_FLAG_NONE;                               //  D3D12_RESOURCE_FLAGS Flags;
-
-            assert(!(flags & content::texture_flags::is_cube_map && (array_size % 6)));
-            const UINT subresource_count{ array_size * mip_levels };
-            assert(subresource_count);
-
-            // struct footprints_data
-            // {
-            //     D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint[subresource_count];
-            //     UINT num_rows[subresource_count];
-            //     UINT64 row_sizes[subresource_count];
-            // }
-            const UINT footprints_data_size{ (sizeof(D3D12_PLACED_SUBRESOURCE_FOOTPRINT) + sizeof(UINT) + sizeof(UINT64)) * subresource_count };
-            std::unique_ptr<UINT8[]> footprints_data{ std::make_unique<UINT8[]>(footprints_data_size) };
-
-            D3D12_PLACED_SUBRESOURCE_FOOTPRINT* const footprints_data_layouts{ (D3D12_PLACED_SUBRESOURCE_FOOTPRINT* const)footprints_data.get() };
-            UINT* const num_rows{ (UINT* const)&footprints_data_layouts[subresource_count] };
-            UINT64* const row_sizes{ (UINT64* const)&num_rows[subresource_count] };
-            UINT64 required_size{ 0 };
-
-            core::device()->GetCopyableFootprints(&desc, 0, subresource_count, 0, footprints_data_layouts, num_rows, row_sizes, &required_size);
-            assert(required_size);
-
-            // put the data in the gpu
-            upload::Upload_Context context{ (UINT)required_size };
-            UINT8* const cpu_address{ (UINT8* const)context.cpu_address() };
-
-            // Copy each of the subresource to CPU
-            for (UINT subresource_index{ 0 }; subresource_index < subresource_count; ++subresource_index)
-            {
-                const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint_layout{ footprints_data_layouts[subresource_index] };
-                const UINT rows{ num_rows[subresource_index] };
-                const UINT depth{ footprint_layout.Footprint.Depth };
-                const D3D12_SUBRESOURCE_DATA& subresource{ subresources[subresource_index] };
-
-                const D3D12_MEMCPY_DEST copy_dst
-                {
-                    cpu_address + footprint_layout.Offset,
-                    footprint_layout.Footprint.RowPitch,
-                    footprint_layout.Footprint.RowPitch * height
-                };
-
-                for (UINT depth_index{ 0 }; depth_index < depth; ++depth_index)
-                {
-                    UINT8* const src_slice{ (UINT8* const)subresource.pData + subresource.SlicePitch * depth_index };
-                    UINT8* const dst_slice{ (UINT8* const)copy_dst.pData + copy_dst.SlicePitch * depth_index };
-
-                    for (UINT row_index{ 0 }; row_index < rows; ++row_index)
-                    {
-                        size_t size = row_sizes[subresource_index];
-                        memcpy(dst_slice + copy_dst.RowPitch * row_index, src_slice + subresource.RowPitch * row_index, row_sizes[subresource_index]);
-                    }
-                }
-            }
-
-            // Create the default buffer on the gpu for the data
-            ID3D12Resource* resource{ nullptr };
-            ThrowIfFailed(core::device()->CreateCommittedResource(&d3dx::heap_properties.default_heap, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&resource)));
-            ID3D12Resource* upload_buffer{ context.upload_buffer() };
-
-            for (UINT i{ 0 }; i < subresource_count; ++i)
-            {
-                D3D12_TEXTURE_COPY_LOCATION src
-                {
-                    upload_buffer,
-                    D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
-                    footprints_data_layouts[i]
-                };
-
-                D3D12_TEXTURE_COPY_LOCATION dst
-                {
-                    resource,
-                    D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
-                    i
-                };
-                context.command_list()->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-            }
-
-            context.end_upload();
-
-            // Create the shader view
-            D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc{};
-            resource::texture_init_info info{};
-            info.resource = resource;
-
-            if (flags & content::texture_flags::is_cube_map)
-            {
-                assert(array_size % 6 == 0);
-                srv_desc.Format = format;
-                srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-
-                if (array_size > 6)
-                {
-                    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
-                    srv_desc.TextureCubeArray.MostDetailedMip = 0;
-                    srv_desc.TextureCubeArray.MipLevels = mip_levels;
-                    srv_desc.TextureCubeArray.NumCubes = array_size / 6;
-                }
-                else
-                {
-                    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-                    srv_desc.TextureCubeArray.MostDetailedMip = 0;
-                    srv_desc.TextureCubeArray.MipLevels = mip_levels;
-                    srv_desc.TextureCubeArray.ResourceMinLODClamp = 0.f;
-                }
-
-                info.srv_desc = &srv_desc;
-            }
+            assert(!blob.overrun()); // the texture data is truncated.
+            if (blob.overrun()) return {};
 
-            return resource::Texture_Buffer{ info };
+            assert(!(desc.is_cube_map && (array_size % 6)));
+            desc.subresources = subresources.data();
+            return gpu::current().create_texture(desc);
         }
 
         // ContentToEngine.cpp
@@ -620,36 +406,14 @@ namespace content
         utl::free_list<UINT8*> geometry_hierarchies{ 8 };
         std::mutex geometry_mutex;
 
-        UINT get_geometry_hierarchy_buffer_size(const void* const data)
-        {
-            const UINT8* data_ptr{ (UINT8*)data };
-            const geometry_data* geometry_ptr = (geometry_data*)(data);
-            const UINT level_of_detail_count = geometry_ptr->level_of_detail_count;
-
-            UINT size{ sizeof(UINT) + (sizeof(float) + sizeof(level_of_detail_offset_count) * level_of_detail_count) };
-            // Get the gpu_ids for the total_number_of_sub_meshes
-            UINT64 offset = sizeof(UINT);
-            for (UINT i{ 0 }; i < level_of_detail_count; ++i)
-            {
-                geometry_header* mesh_ptr = (geometry_header*)&data_ptr[offset];
-                size += sizeof(UINT) * mesh_ptr->sub_mesh_count;
-                offset += sizeof(geometry_header) + mesh_ptr->size_of_sub_meshes;
-            }
-
-            return size;
-        }
-
         UINT create_material_resource(const void* const data)
         {
             assert(data);
             return content::material::add(*(const content::material_init_info* const)data);
         }
 
-        UINT create_single_sub_mesh(const void* const data)
+        UINT create_single_sub_mesh(UINT gpu_id)
         {
-            const UINT8* ptr = (UINT8*)(data)+sizeof(geometry_data);
-            const UINT gpu_id{ sub_mesh::add(ptr) };
-
             // Create a fake pointer and it in the hierarchies.
             constexpr UINT8 shift_bits{ (sizeof(uintptr_t) - sizeof(UINT)) << 3 };
             UINT8* const fake_pointer{ (UINT8* const)((((uintptr_t)gpu_id) << shift_bits) | single_mesh_marker) };
@@ -658,22 +422,6 @@ namespace content
             return geometry_hierarchies.add(fake_pointer);
         }
 
-        // struct{
-        //     u32 lod_count,
-        //     struct {
-        //         f32 lod_threshold,
-        //         u32 submesh_count,
-        //         u32 size_of_submeshes,
-        //         struct {
-        //             u32 element_size, u32 vertex_count,
-        //             u32 index_count, u32 elements_type, u32 primitive_topology
-        //             u8 positions[sizeof(f32) * 3 * vertex_count],     // sizeof(positions) must be a multiple of 4 bytes. Pad if needed.
-        //             u8 elements[sizeof(element_size) * vertex_count], // sizeof(elements) must be a multiple of 4 bytes. Pad if needed.
-        //             u8 indices[index_size * index_count]
-        //         } submeshes[sub_mesh_count]
-        //     } mesh_lods[lod_count]
-        // } geometry;
-        //
         // Output format
         // If geometry has more than one LOD or sub_mesh:
         // struct {
@@ -685,39 +433,11 @@ namespace content
         //     } lod_offsets[lod_count],
         //     id::id_type gpu_ids[total_number_of_sub_meshes]
         // } geometry_hierarchy
-        UINT create_mesh_hierarchy(const void* const data)
+        UINT create_mesh_hierarchy(const utl::vector<float>& thresholds, const utl::vector<level_of_detail_offset_count>& lod_offset_counts,
+            const utl::vector<UINT>& gpu_ids)
         {
-            const UINT size{ get_geometry_hierarchy_buffer_size(data) };
-            UINT8* const hierarchy_buffer{ (UINT8* const)malloc(size) };
-            assert(hierarchy_buffer);
-
-            struct geometry_data* ptr = (geometry_data*)data;
-            const UINT level_of_detail_count{ ptr->level_of_detail_count };
-            assert(level_of_detail_count);
-
-            *(UINT*)hierarchy_buffer = level_of_detail_count;
-
-            float* const thresholds{ (float*)&hierarchy_buffer[sizeof(UINT)] };
-            level_of_detail_offset_count* lod_offset_count{ (level_of_detail_offset_count*)&hierarchy_buffer[sizeof(UINT) + (sizeof(float) * level_of_detail_count)] };
-            UINT* const gpu_ids{ (UINT*)&hierarchy_buffer[sizeof(UINT) + ((sizeof(float) + sizeof(level_of_detail_offset_count)) * level_of_detail_count)] };
-
-            UINT sub_mesh_index{ 0 };
-            for (UINT level_of_detail_idx{ 0 }; level_of_detail_idx < level_of_detail_count; ++level_of_detail_idx)
-            {
-                thresholds[level_of_detail_idx] = ptr->header.level_of_detail_threshold;
-                const UINT sub_mesh_count = ptr->header.sub_mesh_count;
-                assert(sub_mesh_count);
-                lod_offset_count[level_of_detail_idx].count = sub_mesh_count;
-                lod_offset_count[level_of_detail_idx].offset = sub_mesh_index;
-                const UINT8* sub_mesh_ptr = (UINT8*)data + sizeof(geometry_data);
-                for (UINT id_idx{ 0 }; id_idx < sub_mesh_count; ++id_idx)
-                {
-                    gpu_ids[sub_mesh_index] = sub_mesh::add(sub_mesh_ptr);
-                    ++sub_mesh_index;
-
-                    sub_mesh_ptr += ptr->header.size_of_sub_meshes;
-                }
-            }
+            const UINT level_of_detail_count{ (UINT)thresholds.size() };
+            assert(level_of_detail_count && lod_offset_counts.size() == level_of_detail_count);
 
             // Check the thresholds are increasing
             assert([&]() {
@@ -729,17 +449,20 @@ namespace content
                 }
                 return true;
                 }());
-            return geometry_hierarchies.add(hierarchy_buffer);
-        }
 
-        bool is_single_mesh(const void* const data)
-        {
-            struct geometry_data* ptr = (geometry_data*)data;
-            assert(ptr->level_of_detail_count);
-            if (ptr->level_of_detail_count > 1) return false;
+            const UINT64 thresholds_size{ sizeof(float) * level_of_detail_count };
+            const UINT64 lod_offsets_size{ sizeof(level_of_detail_offset_count) * level_of_detail_count };
+            const UINT64 gpu_ids_size{ sizeof(UINT) * gpu_ids.size() };
+            UINT8* const hierarchy_buffer{ (UINT8* const)malloc(sizeof(UINT) + thresholds_size + lod_offsets_size + gpu_ids_size) };
+            assert(hierarchy_buffer);
 
-            assert(ptr->header.sub_mesh_count);
-            return ptr->header.sub_mesh_count == 1;
+            *(UINT*)hierarchy_buffer = level_of_detail_count;
+            memcpy(&hierarchy_buffer[sizeof(UINT)], thresholds.data(), thresholds_size);
+            memcpy(&hierarchy_buffer[sizeof(UINT) + thresholds_size], lod_offset_counts.data(), lod_offsets_size);
+            memcpy(&hierarchy_buffer[sizeof(UINT) + thresholds_size + lod_offsets_size], gpu_ids.data(), gpu_ids_size);
+
+            std::lock_guard lock{ geometry_mutex };
+            return geometry_hierarchies.add(hierarchy_buffer);
         }
 
         constexpr UINT gpu_id_from_fake_pointer(UINT8* const pointer)
@@ -768,24 +491,62 @@ namespace content
         //
         // Output format
         //
-        // If geometry has more than one LOD or sub_mesh:
-        // struct {
-        //     u32 lod_count,
-        //     f32 thresholds[lod_count]
-        //     struct {
-        //         u16 offset,
-        //         u16 count
-        //     } lod_offsets[lod_count],
-        //     id::id_type gpu_ids[total_number_of_sub_meshes]
-        // } geometry_hierarchy
-        // 
+        // If geometry has more than one LOD or sub_mesh: see create_mesh_hierarchy().
+        //
         // If geometry has a single LOD and sub_mesh:
         //
         // (gpu_id << 32) | 0x01
         //
+        UINT create_geometry_resource(utl::blob_stream_reader& blob)
+        {
+            const UINT level_of_detail_count{ blob.read<UINT>() };
+            assert(level_of_detail_count);
+
+            // NOTE: the LOD headers are read in one piece each. The sub-mesh data isn't copied here,
+            //       sub_mesh::add() uploads it straight from the blob.
+            utl::vector<float> thresholds{};
+            utl::vector<level_of_detail_offset_count> lod_offset_counts{};
+            utl::vector<UINT> gpu_ids{};
+            thresholds.reserve(level_of_detail_count);
+            lod_offset_counts.reserve(level_of_detail_count);
+
+            for (UINT level_of_detail_idx{ 0 }; level_of_detail_idx < level_of_detail_count && !blob.overrun(); ++level_of_detail_idx)
+            {
+                geometry_header header{};
+                blob.read(&header, 1);
+                assert(blob.overrun() || (header.sub_mesh_count && header.sub_mesh_count < (1 << 16)));
+
+                thresholds.emplace_back(header.level_of_detail_threshold);
+                lod_offset_counts.emplace_back(level_of_detail_offset_count{ (UINT16)gpu_ids.size(), (UINT16)header.sub_mesh_count });
+                gpu_ids.reserve(gpu_ids.size() + header.sub_mesh_count);
+
+                const UINT64 level_of_detail_end{ blob.offset() + header.size_of_sub_meshes };
+                for (UINT i{ 0 }; i < header.sub_mesh_count && !blob.overrun(); ++i)
+                {
+                    gpu_ids.emplace_back(sub_mesh::add(blob));
+                }
+                assert(blob.overrun() || blob.offset() == level_of_detail_end);
+            }
+
+            if (blob.overrun() || gpu_ids.empty())
+            {
+                assert(false); // the geometry data is truncated.
+                for (UINT id : gpu_ids)
+                {
+                    if (id != Invalid_Index) sub_mesh::remove(id);
+                }
+                return Invalid_Index;
+            }
+
+            return (level_of_detail_count == 1 && gpu_ids.size() == 1) ?
+                create_single_sub_mesh(gpu_ids[0]) : create_mesh_hierarchy(thresholds, lod_offset_counts, gpu_ids);
+        }
+
         UINT create_geometry_resource(const void* const data)
         {
-            return is_single_mesh(data) ? create_single_sub_mesh(data) : create_mesh_hierarchy(data);
+            assert(data);
+            utl::blob_stream_reader blob{ (const UINT8*)data };
+            return create_geometry_resource(blob);
         }
 
         UINT create_texture_resource(const void* const data)
@@ -882,12 +643,21 @@ namespace content
         UINT add(const UINT8*& data)
         {
             assert(data);
-            geometry_sub_mesh_header* header = (geometry_sub_mesh_header*)data;
-            const UINT element_size{ header->element_size };
-            const UINT vertex_count{ header->vertex_count };
-            const UINT index_count{ header->index_count };
-            const UINT element_type{ header->elements_type };
-            const UINT primitive_topology{ header->primitive_topology };
+            utl::blob_stream_reader blob{ data };
+            const UINT id{ add(blob) };
+            data = blob.position();
+            return id;
+        }
+
+        UINT add(utl::blob_stream_reader& blob)
+        {
+            geometry_sub_mesh_header header{};
+            blob.read(&header, 1);
+            const UINT element_size{ header.element_size };
+            const UINT vertex_count{ header.vertex_count };
+            const UINT index_count{ header.index_count };
+            const UINT element_type{ header.elements_type };
+            const UINT primitive_topology{ header.primitive_topology };
 
             const UINT index_size{ (vertex_count < (1 << 16)) ? sizeof(UINT16) : sizeof(UINT) };
 
@@ -901,50 +671,53 @@ namespace content
             const UINT aligned_element_buffer_size{ (UINT)math::align_size_up<alignment>(element_buffer_size) };
             const UINT total_buffer_size{ aligned_position_buffer_size + aligned_element_buffer_size + index_buffer_size };
 
-            ID3D12Resource* resource{ buffers::create_buffer_default_with_upload((const void*)&data[sizeof(geometry_sub_mesh_header)], total_buffer_size) };
-            data += total_buffer_size;
+            // NOTE: positions, elements and indices are uploaded with one copy, straight from the blob.
+            const std::span<const UINT8> buffers{ blob.read_span<UINT8>(total_buffer_size) };
+            if (blob.overrun()) return Invalid_Index;
+
+            const gpu::buffer buffer{ gpu::current().create_buffer((const void*)buffers.data(), total_buffer_size) };
 
             sub_mesh_view view{};
-            view.position_buffer_view.BufferLocation = resource->GetGPUVirtualAddress();
+            view.position_buffer_view.BufferLocation = buffer.gpu_address;
             view.position_buffer_view.SizeInBytes = position_buffer_size;
             view.position_buffer_view.StrideInBytes = sizeof(XMFLOAT3);
 
             if (element_size)
             {
-                view.element_buffer_view.BufferLocation = resource->GetGPUVirtualAddress() + aligned_position_buffer_size;
+                view.element_buffer_view.BufferLocation = buffer.gpu_address + aligned_position_buffer_size;
                 view.element_buffer_view.SizeInBytes = element_buffer_size;
                 view.element_buffer_view.StrideInBytes = element_size;
             }
 
-            view.index_buffer_view.BufferLocation = resource->GetGPUVirtualAddress() + aligned_position_buffer_size + aligned_element_buffer_size;
+            view.index_buffer_view.BufferLocation = buffer.gpu_address + aligned_position_buffer_size + aligned_element_buffer_size;
             view.index_buffer_view.SizeInBytes = index_buffer_size;
             view.index_buffer_view.Format = (index_size == sizeof(UINT16)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 
             view.primitive_topology = get_d3d_primitive_topology((primitive_topology::type)primitive_topology);
             view.element_type = element_type;
 
-            std::lock_guard lock{ sub_mesh_mutex };
-            sub_mesh_buffers.add(resource);
-            return sub_mesh_views.add(view);
+            return sub_meshes.add(sub_mesh_entry{ buffer, view });
         }
 
         void remove(UINT id)
         {
-            std::lock_guard lock{ sub_mesh_mutex };
-            sub_mesh_views.remove(id);
+            // NOTE: checked in release builds too. Removing a stale id again would put its slot in the free chain twice.
+            sub_mesh_entry* const sub_mesh{ sub_meshes.get(id) };
+            assert(sub_mesh);
+            if (!sub_mesh) return;
 
-            core::deferred_release(sub_mesh_buffers[id]);
-            sub_mesh_buffers.remove(id);
+            gpu::current().release_buffer(sub_mesh->buffer);
+            sub_meshes.remove(id);
         }
 
         D3D_PRIMITIVE_TOPOLOGY get_primitive_topology(UINT id)
         {
-            return sub_mesh_views[id].primitive_topology;
+            return sub_meshes[id].view.primitive_topology;
         }
 
         UINT get_views_element_type(UINT id)
         {
-            return sub_mesh_views[id].element_type;
+            return sub_meshes[id].view.element_type;
         }
 
         void get_views(const UINT id_count, const graphic_pass::graphic_cache& cache)
@@ -953,16 +726,17 @@ namespace content
             assert(cache.position_buffers && cache.element_buffers && cache.index_buffer_views &&
                 cache.primitive_topologies && cache.elements_types);
 
-            std::lock_guard lock{ sub_mesh_mutex };
-            for (UINT i{ 0 }; i < id_count; ++i)
-            {
-                const sub_mesh_view& view{ sub_mesh_views[cache.sub_mesh_gpu_ids[i]] };
-                cache.position_buffers[i] = view.position_buffer_view.BufferLocation;
-                cache.element_buffers[i] = view.element_buffer_view.BufferLocation;
-                cache.index_buffer_views[i] = view.index_buffer_view;
-                cache.primitive_topologies[i] = view.primitive_topology;
-                cache.elements_types[i] = view.element_type;
-            }
+            jobs::parallel_for(id_count, 256, [&cache](UINT begin, UINT end) {
+                for (UINT i{ begin }; i < end; ++i)
+                {
+                    const sub_mesh_view& view{ sub_meshes[cache.sub_mesh_gpu_ids[i]].view };
+                    cache.position_buffers[i] = view.position_buffer_view.BufferLocation;
+                    cache.element_buffers[i] = view.element_buffer_view.BufferLocation;
+                    cache.index_buffer_views[i] = view.index_buffer_view;
+                    cache.primitive_topologies[i] = view.primitive_topology;
+                    cache.elements_types[i] = view.element_type;
+                }
+                });
         }
     } // namespace sub_mesh
 
@@ -978,30 +752,37 @@ namespace content
         UINT add(const UINT8* const data)
         {
             assert(data);
-            resource::Texture_Buffer texture{ create_resource_from_texture_data(data) };
+            utl::blob_stream_reader blob{ data };
+            return add(blob);
+        }
 
-            std::lock_guard lock{ texture_mutex };
-            const UINT id{ textures.add(std::move(texture)) };
-            descriptor_indices.add(textures[id].srv().index);
-            return id;
+        UINT add(utl::blob_stream_reader& blob)
+        {
+            const gpu::texture texture{ create_resource_from_texture_data(blob) };
+            if (!texture.handle) return Invalid_Index;
+
+            return textures.add(texture);
         }
 
         void remove(UINT id)
         {
-            std::lock_guard lock{ texture_mutex };
+            // NOTE: checked in release builds too, see sub_mesh::remove().
+            gpu::texture* const texture{ textures.get(id) };
+            assert(texture);
+            if (!texture) return;
+
+            gpu::current().release_texture(*texture);
             textures.remove(id);
-            descriptor_indices.remove(id);
         }
 
         void get_descriptor_indices(const UINT* const texture_ids, UINT id_count, UINT* const indices)
         {
             assert(texture_ids && id_count && indices);
-            std::lock_guard lock{ texture_mutex };
 
             for (UINT i{ 0 }; i < id_count; ++i)
             {
                 assert(texture_ids[i] != Invalid_Index);
-                indices[i] = descriptor_indices[texture_ids[i]];
+                indices[i] = textures[texture_ids[i]].descriptor_index;
             }
         }
     } // namespace texture
@@ -1020,16 +801,20 @@ namespace content
         // } d3d12_material
         UINT add(content::material_init_info info)
         {
-            std::unique_ptr<UINT8[]> buffer;
-            std::lock_guard lock{ material_mutex };
-            Material_Stream stream{ buffer, info };
-            assert(buffer);
+            material_buffer buffer;
+            {
+                // NOTE: writing the stream may create the material's root signature.
+                std::lock_guard lock{ root_signature_mutex };
+                Material_Stream stream{ buffer, info };
+            }
+            assert(!buffer.empty());
             return materials.add(std::move(buffer));
         }
 
         void remove(UINT id)
         {
-            std::lock_guard lock{ material_mutex };
+            assert(materials.is_valid(id));
+            if (!materials.is_valid(id)) return;
             materials.remove(id);
         }
 
@@ -1060,22 +845,33 @@ namespace content
             assert(cache.material_ids);
             assert(cache.root_signatures && cache.material_types);
 
-            std::lock_guard lock{ material_mutex };
-
-            UINT total_index_count{ 0 };
-
-            for (UINT i{ 0 }; i < id_count; ++i)
+            // NOTE: the jobs read a copy of root_signatures, so the lock isn't held across parallel_for(). This
+            //       thread runs queued jobs while it waits, and a loader job may take the same lock.
+            utl::frame_vector<ID3D12RootSignature*> signatures;
             {
-                const Material_Stream stream{ materials[cache.material_ids[i]].get() };
-
-                cache.root_signatures[i] = root_signatures[stream.root_signature_id()];
-                cache.material_types[i] = stream.material_type();
-                cache.descriptor_indices[i] = stream.descriptor_indices();
-                cache.texture_counts[i] = stream.texture_count();
-                cache.material_surfaces[i] = stream.surface();
-                total_index_count += stream.texture_count();
+                std::lock_guard lock{ root_signature_mutex };
+                signatures.reserve(root_signatures.size());
+                for (ID3D12RootSignature* const signature : root_signatures) signatures.emplace_back(signature);
             }
 
+            std::atomic<UINT> total_index_count{ 0 };
+
+            jobs::parallel_for(id_count, 256, [&cache, &signatures, &total_index_count](UINT begin, UINT end) {
+                UINT index_count{ 0 };
+                for (UINT i{ begin }; i < end; ++i)
+                {
+                    const Material_Stream stream{ materials[cache.material_ids[i]].data() };
+
+                    cache.root_signatures[i] = signatures[stream.root_signature_id()];
+                    cache.material_types[i] = stream.material_type();
+                    cache.descriptor_indices[i] = stream.descriptor_indices();
+                    cache.texture_counts[i] = stream.texture_count();
+                    cache.material_surfaces[i] = stream.surface();
+                    index_count += stream.texture_count();
+                }
+                total_index_count += index_count;
+                });
+
             cache.descriptor_index_count = total_index_count;
         }
 
@@ -1088,8 +884,8 @@ namespace content
             assert(entity_id != Invalid_Index && geometry_content_id != Invalid_Index);
             assert(material_count && material_ids);
 
-            UINT* const gpu_ids{ (UINT* const)_malloca(material_count * sizeof(UINT)) };
-            content::get_sub_mesh_gpu_ids(geometry_content_id, material_count, gpu_ids);
+            utl::small_vector<UINT, 8> gpu_ids(material_count);
+            content::get_sub_mesh_gpu_ids(geometry_content_id, material_count, gpu_ids.data());
 
             //sub_mesh::  views_cache
             //{
@@ -1102,12 +898,12 @@ namespace content
 
             //content::sub_mesh::get_views(material_count,  );
 
-            std::unique_ptr<UINT[]>items{ std::make_unique<UINT[]>(sizeof(UINT) * (1 + (UINT64)material_count + 1)) };
+            render_item_id_list items(1 + (UINT64)material_count + 1);
 
             items[0] = geometry_content_id;
             UINT* const item_ids{ &items[1] };
 
-            d3d12_render_item* const d3d12_items{ (d3d12_render_item* const)_malloca(material_count * sizeof(d3d12_render_item)) };
+            utl::small_vector<d3d12_render_item, 8> d3d12_items(material_count);
 
             for (UINT i{ 0 }; i < material_count; ++i)
             {
@@ -1125,7 +921,6 @@ namespace content
                 item.depth_pso_id = create_depth_pso(item.material_id, primitive_topology, element_type);
             }
 
-            std::lock_guard lock{ render_item_mutex };
             for (UINT i{ 0 }; i < material_count; ++i)
             {
                 item_ids[i] = render_items.add(d3d12_items[i]);
@@ -1134,66 +929,85 @@ namespace content
             // mark the end of ids list.
             item_ids[material_count] = Invalid_Index;
 
-            _freea(d3d12_items);
-            _freea(gpu_ids);
             UINT item_id = render_item_ids.add(std::move(items));
             return item_id;
         }
 
         void remove(UINT id)
         {
-            std::lock_guard lock{ render_item_mutex };
-            const UINT* const item_ids{ &render_item_ids[id][1] };
+            // NOTE: checked in release builds too, see sub_mesh::remove().
+            const render_item_id_list* const list{ render_item_ids.get(id) };
+            assert(list);
+            if (!list) return;
+            const UINT* const item_ids{ &(*list)[1] };
 
             // NOTE: the last element in the list of ids is always an invalid id.
             for (UINT i{ 0 }; item_ids[i] != Invalid_Index; ++i)
             {
-                render_items.remove(item_ids[i]);
+                assert(render_items.is_valid(item_ids[i]));
+                if (render_items.is_valid(item_ids[i])) render_items.remove(item_ids[i]);
             }
 
             render_item_ids.remove(id);
         }
 
-        void get_d3d12_render_item_ids(const core::frame_info& info, utl::vector<UINT>& d3d12_render_item_ids)
+        void get_d3d12_render_item_ids(const UINT* const item_ids, const float* const thresholds, UINT render_item_count,
+            utl::frame_vector<UINT>& d3d12_render_item_ids)
         {
-            assert(info.render_item_ids && info.render_item_count);
+            assert(item_ids && render_item_count);
             assert(d3d12_render_item_ids.empty());
 
-            frame_cache.lod_offsets_counts.clear();
-            frame_cache.geometry_ids.clear();
-            const UINT count{ info.render_item_count };
-
-            std::lock_guard lock{ render_item_mutex };
+            const UINT count{ render_item_count };
+            utl::frame_vector<UINT> geometry_ids(count);
+            utl::frame_vector<level_of_detail_offset_count> lod_offsets_counts(count);
+            utl::frame_vector<UINT> item_offsets(count);
 
-            for (UINT i{ 0 }; i < count; ++i)
-            {
-                const UINT* const buffer{ render_item_ids[info.render_item_ids[i]].get() };
-                frame_cache.geometry_ids.emplace_back(buffer[0]);
-            }
+            jobs::parallel_for(count, 256, [item_ids, &geometry_ids](UINT begin, UINT end) {
+                for (UINT i{ begin }; i < end; ++i)
+                {
+                    const UINT* const buffer{ render_item_ids[item_ids[i]].data() };
+                    geometry_ids[i] = buffer[0];
+                }
+                });
 
-            get_lod_offsets_counts(frame_cache.geometry_ids.data(), info.thresholds, count, frame_cache.lod_offsets_counts);
-            assert(frame_cache.lod_offsets_counts.size() == count);
+            get_lod_offsets_counts(geometry_ids.data(), thresholds, count, lod_offsets_counts.data());
 
+            // Prefix sum of the counts gives each render item the index where its ids are copied to.
             UINT d3d12_render_item_count{ 0 };
             for (UINT i{ 0 }; i < count; ++i)
             {
-                d3d12_render_item_count += frame_cache.lod_offsets_counts[i].count;
+                item_offsets[i] = d3d12_render_item_count;
+                d3d12_render_item_count += lod_offsets_counts[i].count;
             }
 
             assert(d3d12_render_item_count);
             d3d12_render_item_ids.resize(d3d12_render_item_count);
 
-            UINT item_index{ 0 };
-            for (UINT i{ 0 }; i < count; ++i)
+            jobs::parallel_for(count, 256, [item_ids, &lod_offsets_counts, &item_offsets, &d3d12_render_item_ids](UINT begin, UINT end) {
+                for (UINT i{ begin }; i < end; ++i)
+                {
+                    const UINT* const lod_item_ids{ &render_item_ids[item_ids[i]][1] };
+                    const level_of_detail_offset_count& lod_offset_count{ lod_offsets_counts[i] };
+                    assert(item_offsets[i] + lod_offset_count.count <= d3d12_render_item_ids.size());
+                    memcpy(&d3d12_render_item_ids[item_offsets[i]], &lod_item_ids[lod_offset_count.offset], sizeof(UINT) * lod_offset_count.count);
+                }
+                });
+
+            // Drop the items whose render item, sub mesh or material was removed. The gathers that follow
+            // (get_items, sub_mesh::get_views, material::get_materials) only check their ids in debug builds,
+            // so in release a stale id costs one missing draw here instead of reading a reused slot.
+            UINT valid_count{ 0 };
+            for (UINT i{ 0 }; i < d3d12_render_item_count; ++i)
             {
-                const UINT* const item_ids{ &render_item_ids[info.render_item_ids[i]][1] };
-                const level_of_detail_offset_count& lod_offset_count{ frame_cache.lod_offsets_counts[i] };
-                memcpy(&d3d12_render_item_ids[item_index], &item_ids[lod_offset_count.offset], sizeof(UINT) * lod_offset_count.count);
-                item_index += lod_offset_count.count;
-                assert(item_index <= d3d12_render_item_count);
+                const UINT id{ d3d12_render_item_ids[i] };
+                const d3d12_render_item* const item{ render_items.get(id) };
+                if (item && sub_meshes.is_valid(item->sub_mesh_gpu_id) && materials.is_valid(item->material_id))
+                {
+                    d3d12_render_item_ids[valid_count++] = id;
+                }
             }
-
-            assert(item_index == d3d12_render_item_count);
+            assert(valid_count == d3d12_render_item_count);
+            d3d12_render_item_ids.resize(valid_count);
         }
 
         void get_items(const UINT* const d3d12_render_item_ids, UINT id_count, const graphic_pass::graphic_cache& cache)
@@ -1202,19 +1016,26 @@ namespace content
             assert(cache.entity_ids && cache.sub_mesh_gpu_ids && cache.material_ids &&
                 cache.graphic_pipeline_states && cache.depth_pipeline_states);
 
-            std::lock_guard lock1{ render_item_mutex };
-            std::lock_guard lock2{ pso_mutex };
-
-            for (UINT i{ 0 }; i < id_count; ++i)
+            // NOTE: as in material::get_materials(), the jobs read a copy so pso_mutex isn't held while waiting.
+            utl::frame_vector<ID3D12PipelineState*> states;
             {
-                UINT id = d3d12_render_item_ids[i];
-                const d3d12_render_item& item{ render_items[id] };
-                cache.entity_ids[i] = item.entity_id;
-                cache.sub_mesh_gpu_ids[i] = item.sub_mesh_gpu_id;
-                cache.material_ids[i] = item.material_id;
-                cache.graphic_pipeline_states[i] = pipeline_states[item.graphic_pass_pso_id];
-                cache.depth_pipeline_states[i] = pipeline_states[item.depth_pso_id];
+                std::lock_guard lock{ pso_mutex };
+                states.reserve(pipeline_states.size());
+                for (ID3D12PipelineState* const state : pipeline_states) states.emplace_back(state);
             }
+
+            jobs::parallel_for(id_count, 256, [d3d12_render_item_ids, &cache, &states](UINT begin, UINT end) {
+                for (UINT i{ begin }; i < end; ++i)
+                {
+                    UINT id = d3d12_render_item_ids[i];
+                    const d3d12_render_item& item{ render_items[id] };
+                    cache.entity_ids[i] = item.entity_id;
+                    cache.sub_mesh_gpu_ids[i] = item.sub_mesh_gpu_id;
+                    cache.material_ids[i] = item.material_id;
+                    cache.graphic_pipeline_states[i] = states[item.graphic_pass_pso_id];
+                    cache.depth_pipeline_states[i] = states[item.depth_pso_id];
+                }
+                });
         }
     } // namespace render_item
 
@@ -1226,9 +1047,10 @@ namespace content
 
     void shutdown()
     {
+        gpu::device& device{ gpu::current() };
         for (auto& item : root_signatures)
         {
-            core::release(item);
+            device.release_root_signature(item);
         }
 
         material_root_signature_map.clear();
@@ -1237,10 +1059,12 @@ namespace content
 
         for (auto& item : pipeline_states)
         {
-            core::release(item);
+            device.release_pipeline_state(item);
         }
 
         pso_map.clear();
+        pso_same_hash_next.clear();
+        pipeline_state_descs.clear();
         pipeline_states.clear();
     }
 
@@ -1261,6 +1085,25 @@ namespace content
         return id;
     }
 
+    UINT create_resource(std::span<const UINT8> data, asset_type::type type)
+    {
+        assert(data.data() && data.size());
+        // NOTE: the reader stops at the end of 'data', so truncated files fail instead of reading past it.
+        //       Geometry and textures are copied to upload buffers before this returns.
+        utl::blob_stream_reader blob{ data };
+        UINT id = Invalid_Index;
+
+        switch (type)
+        {
+        case asset_type::material: id = create_material_resource(data.data()); break;
+        case asset_type::mesh: id = create_geometry_resource(blob); break;
+        case asset_type::texture: id = content::texture::add(blob); break;
+        }
+
+        assert(id != Invalid_Index);
+        return id;
+    }
+
     void destroy_resource(const UINT id, asset_type::type type)
     {
         assert(id != Invalid_Index);
@@ -1300,29 +1143,31 @@ namespace content
 
     }
 
-    void get_lod_offsets_counts(const UINT* const geometry_ids, const float* thresholds, UINT id_count, utl::vector<level_of_detail_offset_count>& offsets_counts)
+    void get_lod_offsets_counts(const UINT* const geometry_ids, const float* thresholds, UINT id_count, level_of_detail_offset_count* const offsets_counts)
     {
-        assert(geometry_ids && id_count);
-        assert(offsets_counts.empty());
+        assert(geometry_ids && id_count && offsets_counts);
 
         std::lock_guard lock{ geometry_mutex };
 
-        for (UINT i{ 0 }; i < id_count; ++i)
-        {
-            UINT8* const pointer{ geometry_hierarchies[geometry_ids[i]] };
-            if ((uintptr_t)pointer & single_mesh_marker)
+        jobs::parallel_for(id_count, 256, [geometry_ids, thresholds, offsets_counts](UINT begin, UINT end) {
+            for (UINT i{ begin }; i < end; ++i)
             {
-                offsets_counts.emplace_back(level_of_detail_offset_count{ 0, 1 });
-            }
-            else
-            {
-                struct geometry_data* ptr = (geometry_data*)pointer;
-                const UINT level_of_detail_count{ ptr->level_of_detail_count };
-                float* const thresholds{ (float*)&pointer[sizeof(UINT)] };
-                level_of_detail_offset_count* lod_offset_count{ (level_of_detail_offset_count*)&pointer[sizeof(UINT) + (sizeof(float) * level_of_detail_count)] };
-                UINT lod{ lod_from_threshold(thresholds[i], thresholds, level_of_detail_count) };
-                offsets_counts.emplace_back(lod_offset_count[lod]);
+                UINT8* const pointer{ geometry_hierarchies[geometry_ids[i]] };
+                if ((uintptr_t)pointer & single_mesh_marker)
+                {
+                    offsets_counts[i] = level_of_detail_offset_count{ 0, 1 };
+                }
+                else
+                {
+                    struct geometry_data* ptr = (geometry_data*)pointer;
+                    const UINT level_of_detail_count{ ptr->level_of_detail_count };
+                    // NOTE: 'thresholds' has one threshold per render item, 'lod_thresholds' one per LOD of this geometry.
+                    float* const lod_thresholds{ (float*)&pointer[sizeof(UINT)] };
+                    level_of_detail_offset_count* lod_offset_count{ (level_of_detail_offset_count*)&pointer[sizeof(UINT) + (sizeof(float) * level_of_detail_count)] };
+                    UINT lod{ lod_from_threshold(thresholds[i], lod_thresholds, level_of_detail_count) };
+                    offsets_counts[i] = lod_offset_count[lod];
+                }
             }
-        }
+            });
     }
 }
@@ -1,7 +1,10 @@
 #pragma once
 #include "stdafx.h"
-#include "Shaders.h"
-#include "Core.h"
+#include "ShaderTypes.h"
+#include "Arena.h"
+#include "Utilities.h"
+#include "DrawList.h"
+#include <span>
 
 namespace graphic_pass {
     struct graphic_cache;
@@ -9,22 +12,6 @@ namespace graphic_pass {
 
 namespace content
 {
-    struct opaque_root_parameter {
-        enum parameter : UINT {
-            global_shader_data,
-            per_object_data,
-            position_buffer,
-            element_buffer,
-            srv_indices,
-            directional_lights,
-            cullable_lights,
-            light_grid,
-            light_index_list,
-
-            count
-        };
-    };
-
     struct texture_flags {
         enum flags : UINT {
             is_hdr = 0x01,
@@ -89,14 +76,6 @@ namespace content
         UINT16 count;
     };
 
-    struct material_type {
-        enum type : UINT {
-            opaque,
-
-            count
-        };
-    };
-
     struct material_surface
     {
         XMFLOAT4 base_color{ 1.f, 1.f, 1.f, 1.f };
@@ -127,6 +106,7 @@ namespace content
         //};
 
         UINT add(const UINT8*& data);
+        UINT add(utl::blob_stream_reader& blob);
         void remove(UINT id);
         D3D_PRIMITIVE_TOPOLOGY get_primitive_topology(UINT id);
         UINT get_views_element_type(UINT id);
@@ -136,6 +116,7 @@ namespace content
 
     namespace texture {
         UINT add(const UINT8* const data);
+        UINT add(utl::blob_stream_reader& blob);
         void remove(UINT id);
         void get_descriptor_indices(const UINT *const texture_ids, UINT id_count, UINT* const indices);
     } // namespace texture
@@ -159,20 +140,26 @@ namespace content
 
         UINT add(UINT entity_id, UINT geometry_content_id, UINT material_count, const UINT* const material_ids);
         void remove(UINT id);
-        void get_d3d12_render_item_ids(const core::frame_info& info, utl::vector<UINT>& d3d12_render_item_ids);
+        // The ids of the LOD that each render item's threshold picks, see core::frame_info.
+        void get_d3d12_render_item_ids(const UINT* const render_item_ids, const float* const thresholds, UINT render_item_count,
+            utl::frame_vector<UINT>& d3d12_render_item_ids);
         //void get_items(const UINT* const d3d12_render_item_ids, UINT id_count, const items_cache& cache);
         void get_items(const UINT* const d3d12_render_item_ids, UINT id_count, const graphic_pass::graphic_cache& cache);
 
     }
 
+    // NOTE: the buffers, textures, root signatures and pipeline states are created with gpu::current(),
+    //       which must be set before initialize() and stay set until after shutdown().
     bool initialize();
     void shutdown();
 
     // ContentToEngine.cpp
     UINT create_resource(const void* const data, asset_type::type type);
+    // For asset files that are read in place (see utl::mapped_file). 'data' is not kept after the call.
+    UINT create_resource(std::span<const UINT8> data, asset_type::type type);
     void destroy_resource(const UINT id, asset_type::type type);
 
     void get_sub_mesh_gpu_ids(UINT geometry_context_id, UINT id_count, UINT* const gpu_ids);
-    void get_lod_offsets_counts(const UINT* const geometry_ids, const float* thresholds, UINT id_count, utl::vector<level_of_detail_offset_count>& offsets_counts);
+    void get_lod_offsets_counts(const UINT* const geometry_ids, const float* thresholds, UINT id_count, level_of_detail_offset_count* const offsets_counts);
 
 }
@@ -11,8 +11,12 @@
 #include "SharedTypes.h"
 #include "FreeList.h"
 #include "RainDrop.h"
-#include "Lights.h"
+#include "LightCulling.h"
+#include "D3D12Device.h"
 #include "PostProcess.h"
+#include "Jobs.h"
+#include "Arena.h"
+#include "Queue.h"
 
 // InterlockedCompareExchange returns the object's value if the 
 // comparison fails.  If it is already 0, then its value won't 
@@ -50,10 +54,21 @@ namespace core {
         resource::Descriptor_Heap m_uav_desc_heap{ D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV };
 
         resource::constant_buffer m_constant_buffers[Frame_Count];
+        // What content and lights create their resources with (see gpu::current()).
+        gpu::d3d12_device m_gpu_device{};
+
+        // CPU scratch memory for data that is rebuilt every frame (render item lists, per-object caches, ...).
+        // One arena per frame in flight, reset once the GPU is done with that frame.
+        constexpr UINT64 frame_arena_size{ 1024 * 1024 };
+        utl::linear_arena m_frame_arenas[Frame_Count];
 
         std::mutex m_deferred_releases_mutux{};
         UINT m_deferred_releasees_flags[Frame_Count]{};
         utl::vector<IUnknown*> m_deferred_releases[Frame_Count]{};
+        // Any thread can queue a release without taking the mutex. The vectors above
+        // only take what doesn't fit in the queue.
+        constexpr UINT deferred_release_queue_size{ 1024 };
+        utl::mpsc_queue<IUnknown*, deferred_release_queue_size> m_deferred_release_queues[Frame_Count]{};
 
         // rain_drop::RainDrop m_rain_drop;
 
@@ -62,6 +77,24 @@ namespace core {
         UINT64 m_render_context_fence_value{ 0 };
         HANDLE m_render_context_fence_event{ nullptr };
 
+        // CPU cost of each part of render(). Waiting for the GPU is measured on its own
+        // so it doesn't hide the time spent preparing and recording the frame.
+        struct render_stage {
+            enum stage : UINT {
+                wait_for_gpu,
+                begin_frame,
+                depth_prepass,
+                light_update,
+                light_culling,
+                graphic_pass,
+                post_process,
+                end_frame,
+
+                count
+            };
+        };
+        stage_timer m_stage_timer{};
+
         d3d12_frame_info get_d3d12_frame_info(const frame_info& info, resource::constant_buffer& cbuffer, const surface::Surface& surface, UINT frame_index, float delta_time)
         {
             camera::Camera& camera{ camera::get(info.camera_id) };
@@ -156,6 +189,13 @@ namespace core {
             m_srv_desc_heap.process_deferred_free(frame_index);
             m_uav_desc_heap.process_deferred_free(frame_index);
 
+            // NOTE: the mutex also makes this the only consumer of the queue.
+            IUnknown* queued{ nullptr };
+            while (m_deferred_release_queues[frame_index].try_pop(queued))
+            {
+                release(queued);
+            }
+
             utl::vector<IUnknown*>& resources{ m_deferred_releases[frame_index] };
             if (!resources.empty())
             {
@@ -212,8 +252,12 @@ namespace core {
         void deferred_release(IUnknown* resource)
         {
             const UINT frame_index{ current_frame_index() };
-            std::lock_guard lock{ m_deferred_releases_mutux };
-            m_deferred_releases[frame_index].push_back(resource);
+            if (!m_deferred_release_queues[frame_index].try_push(resource))
+            {
+                // The queue is full, fall back to the locked vector.
+                std::lock_guard lock{ m_deferred_releases_mutux };
+                m_deferred_releases[frame_index].push_back(resource);
+            }
             set_deferred_releases_flag();
         }
     }
@@ -326,16 +370,20 @@ namespace core {
         {
             new (&m_constant_buffers[i]) resource::constant_buffer{ info };
             NAME_D3D12_OBJECT_INDEXED(m_constant_buffers[i].buffer(), i, L"Global Constant Buffer");
+            m_frame_arenas[i].initialize(frame_arena_size);
         }
 
         // m_rain_drop.create_descriptor_heap();
 
-        if (!(shaders::initialize() &&
+        gpu::set_current(&m_gpu_device);
+
+        if (!(jobs::initialize() &&
+            shaders::initialize() &&
             graphic_pass::initialize() &&
             post_process::initialize() &&
             upload::initialize() &&
             content::initialize() &&
-            lights::initialize()))
+            lights::initialize_culling()))
         {
             return failed_init();
         }
@@ -368,12 +416,15 @@ namespace core {
             process_deferred_releases(i);
         }
 
+        lights::shutdown_culling();
         lights::shutdown();
         content::shutdown();
+        gpu::set_current(nullptr);
         upload::shutdown();
         post_process::shutdown();
         graphic_pass::shutdown();
         shaders::shutdown();
+        jobs::shutdown();
 
         release(m_dxgi_factory);
         //m_render_target.release();
@@ -385,7 +436,9 @@ namespace core {
         for (UINT i{ 0 }; i < Frame_Count; ++i)
         {
             m_constant_buffers[i].release();
+            m_frame_arenas[i].release();
         }
+        utl::set_frame_arena(nullptr);
 
         // NOTE: some modules free their descriptors when they shutdown.
         //       We process those by calling process_deferred_free once more.
@@ -486,8 +539,15 @@ namespace core {
 
     void render(UINT id, frame_info info)
     {
+        // NOTE: the camera may have been removed with its scene. Skip the frame before anything is recorded.
+        assert(camera::is_valid(info.camera_id));
+        if (!camera::is_valid(info.camera_id)) return;
+
+        m_stage_timer.begin_frame();
+
         // Wait for GPU
         m_command.begin_frame();
+        m_stage_timer.mark(render_stage::wait_for_gpu, "wait_for_gpu");
         id3d12_graphics_command_list* const cmd_list{ m_command.command_list() };
 
         const UINT frame_index{ current_frame_index() };
@@ -496,6 +556,9 @@ namespace core {
         resource::constant_buffer& cbuffer{ m_constant_buffers[frame_index] };
         cbuffer.clear();
 
+        m_frame_arenas[frame_index].reset();
+        utl::set_frame_arena(&m_frame_arenas[frame_index]);
+
         if (m_deferred_releasees_flags[frame_index])
         {
             process_deferred_releases(frame_index);
@@ -516,12 +579,18 @@ namespace core {
 
         barriers.add(current_back_buffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
 
+        m_stage_timer.mark(render_stage::begin_frame, "begin_frame");
+
         graphic_pass::depth_process(cmd_list, d3d12_info, barriers);
+        m_stage_timer.mark(render_stage::depth_prepass, "depth_prepass");
 
-        lights::update_light_buffers(d3d12_info);
+        lights::update_light_buffers(info.light_set_key, frame_index);
+        m_stage_timer.mark(render_stage::light_update, "light_update");
         lights::cull_lights(cmd_list, d3d12_info, barriers);
+        m_stage_timer.mark(render_stage::light_culling, "light_culling");
 
         graphic_pass::render_targets(cmd_list, d3d12_info, barriers);
+        m_stage_timer.mark(render_stage::graphic_pass, "graphic_pass");
 
         // Post-process
         barriers.add(current_back_buffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
@@ -531,8 +600,11 @@ namespace core {
         post_process::post_process(cmd_list, d3d12_info, surface.rtv());
         // after post process
         barriers::transition_resource(cmd_list, current_back_buffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        m_stage_timer.mark(render_stage::post_process, "post_process");
 
         m_command.end_frame(surface);
+        m_stage_timer.mark(render_stage::end_frame, "end_frame");
+        m_stage_timer.end_frame();
     }
 
     void flush()
@@ -0,0 +1,111 @@
+#include "CpuFeatures.h"
+#include <intrin.h>
+#include <atomic>
+
+namespace core::cpu {
+    namespace {
+
+        constexpr const char* isa_names[isa::count]{ "scalar", "sse4.2", "avx2", "avx512", "neon" };
+
+        std::atomic<UINT> forced_level{ isa::count };
+
+        UINT detect_features()
+        {
+            UINT flags{ 0 };
+#if defined(_M_X64)
+            INT32 info[4]{};
+            __cpuid(info, 0);
+            const INT32 max_leaf{ info[0] };
+
+            __cpuid(info, 1);
+            const bool has_sse4_2{ (info[2] & (1 << 20)) != 0 };
+            const bool has_fma{ (info[2] & (1 << 12)) != 0 };
+            const bool has_osxsave{ (info[2] & (1 << 27)) != 0 };
+            const bool has_avx{ (info[2] & (1 << 28)) != 0 };
+
+            if (has_sse4_2) flags |= feature::sse4_2 | feature::crc32c;
+
+            // NOTE: AVX registers can only be used if the OS saves them on context switches.
+            const UINT64 xcr0{ has_osxsave ? _xgetbv(0) : 0 };
+            const bool os_saves_ymm{ (xcr0 & 0x06) == 0x06 };
+            const bool os_saves_zmm{ (xcr0 & 0xe6) == 0xe6 };
+
+            if (has_avx && os_saves_ymm)
+            {
+                flags |= feature::avx;
+                if (has_fma) flags |= feature::fma;
+
+                if (max_leaf >= 7)
+                {
+                    __cpuidex(info, 7, 0);
+                    if (info[1] & (1 << 5)) flags |= feature::avx2;
+
+                    constexpr INT32 avx512_bits{ (1 << 16) | (1 << 17) | (1 << 30) | (INT32)(1u << 31) }; // F, DQ, BW, VL
+                    if (os_saves_zmm && (info[1] & avx512_bits) == avx512_bits) flags |= feature::avx512;
+                }
+            }
+#elif defined(_M_ARM64)
+            flags |= feature::neon;
+            if (IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE)) flags |= feature::crc32c;
+#endif
+            return flags;
+        }
+
+        isa::level highest_level(UINT flags)
+        {
+            if (flags & feature::neon) return isa::neon;
+            if ((flags & feature::avx512) && (flags & feature::avx2) && (flags & feature::fma)) return isa::avx512;
+            if ((flags & feature::avx2) && (flags & feature::fma)) return isa::avx2;
+            if (flags & feature::sse4_2) return isa::sse4_2;
+            return isa::scalar;
+        }
+
+    } // anonymous namespace
+
+    UINT features()
+    {
+        static const UINT flags{ detect_features() };
+        return flags;
+    }
+
+    bool has(feature::flags flag)
+    {
+        return (features() & flag) != 0;
+    }
+
+    isa::level isa_level()
+    {
+        const isa::level supported{ highest_level(features()) };
+        const UINT forced{ forced_level.load(std::memory_order_relaxed) };
+        if (forced == isa::count) return supported;
+
+        // NOTE: a level of the other architecture (an x64 level on ARM64, or neon on x64) isn't below
+        //       or above the supported one, so it falls back to scalar. Scalar runs everywhere.
+        const bool forced_arm64{ forced == isa::neon };
+        const bool supported_arm64{ supported == isa::neon };
+        if (forced != isa::scalar && forced_arm64 != supported_arm64) return isa::scalar;
+        return forced < supported ? (isa::level)forced : supported;
+    }
+
+    void force_isa(isa::level level)
+    {
+        assert(level <= isa::count);
+        forced_level.store(level, std::memory_order_relaxed);
+    }
+
+    const char* isa_name(isa::level level)
+    {
+        assert(level < isa::count);
+        return level < isa::count ? isa_names[level] : "unknown";
+    }
+
+    isa::level isa_from_name(const char* name)
+    {
+        assert(name);
+        for (UINT i{ 0 }; i < isa::count; ++i)
+        {
+            if (!strcmp(name, isa_names[i])) return (isa::level)i;
+        }
+        return isa::count;
+    }
+}
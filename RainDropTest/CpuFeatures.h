@@ -0,0 +1,60 @@
+#pragma once
+#include "stdafx.h"
+
+namespace core::cpu {
+
+    struct feature {
+        enum flags : UINT {
+            sse4_2 = 0x01,
+            avx = 0x02,
+            avx2 = 0x04,
+            fma = 0x08,
+            avx512 = 0x10,      // F, DQ, BW and VL
+            neon = 0x20,
+            crc32c = 0x40,      // SSE4.2 crc32 or ARMv8 crc32c instructions
+        };
+    };
+
+    // Instruction set levels that kernels ship variants for, from lowest to highest.
+    // A level includes everything below it on the same architecture.
+    struct isa {
+        enum level : UINT {
+            scalar,
+            sse4_2,
+            avx2,               // with FMA
+            avx512,
+            neon,               // ARM64
+
+            count
+        };
+    };
+
+    // Features of the CPU the program runs on. Detected once, on the first call.
+    [[nodiscard]] UINT features();
+    [[nodiscard]] bool has(feature::flags flag);
+
+    // Highest level the CPU supports, or the level passed to force_isa() if that is lower.
+    // A forced level of the other architecture gives scalar.
+    [[nodiscard]] isa::level isa_level();
+
+    // Caps the level kernels select, so the variants can be compared (see --force-isa).
+    // NOTE: call it at startup. Kernels keep the variant they selected on their first call.
+    void force_isa(isa::level level);
+
+    [[nodiscard]] const char* isa_name(isa::level level);
+    // Accepts the names returned by isa_name(). Returns isa::count for unknown names.
+    [[nodiscard]] isa::level isa_from_name(const char* name);
+
+    // Picks the variant of a kernel for isa_level(): the variant for the highest level at or below it.
+    // Variants may be null for levels a kernel doesn't have, but the scalar one is required.
+    template<typename F>
+    [[nodiscard]] F select(const F(&variants)[isa::count])
+    {
+        assert(variants[isa::scalar]);
+        for (UINT level{ isa_level() }; level > isa::scalar; --level)
+        {
+            if (variants[level]) return variants[level];
+        }
+        return variants[isa::scalar];
+    }
+}
@@ -0,0 +1,323 @@
+#include "D3D12Device.h"
+#include "Buffers.h"
+#include "Core.h"
+#include "DXSampleHelper.h"
+#include "GraphicPass.h"
+#include "Helpers.h"
+#include "Resources.h"
+#include "Shaders.h"
+#include "Upload.h"
+
+namespace gpu {
+
+    namespace {
+
+        static_assert(max_texture_mips == resource::Texture_Buffer::max_mips);
+
+        constexpr D3D12_PRIMITIVE_TOPOLOGY_TYPE get_d3d_primitive_topology_type(D3D_PRIMITIVE_TOPOLOGY topology)
+        {
+            switch (topology)
+            {
+            case D3D_PRIMITIVE_TOPOLOGY_POINTLIST: return D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
+            case D3D_PRIMITIVE_TOPOLOGY_LINELIST:
+            case D3D_PRIMITIVE_TOPOLOGY_LINESTRIP: return D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
+            case D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+            case D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP: return D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            }
+
+            return D3D12_PRIMITIVE_TOPOLOGY_TYPE_UNDEFINED;
+        }
+
+        constexpr D3D12_ROOT_SIGNATURE_FLAGS
+            get_root_signature_flags(shaders::shader_flags::flags flags)
+        {
+            D3D12_ROOT_SIGNATURE_FLAGS default_flags{ d3dx::d3d12_root_signature_desc::default_flags };
+            if (flags & shaders::shader_flags::vertex)           default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS;
+            if (flags & shaders::shader_flags::hull)             default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS;
+            if (flags & shaders::shader_flags::domain)           default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS;
+            if (flags & shaders::shader_flags::geometry)         default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+            if (flags & shaders::shader_flags::pixel)            default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
+            if (flags & shaders::shader_flags::amplification)    default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS;
+            if (flags & shaders::shader_flags::mesh)             default_flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS;
+            return default_flags;
+        }
+
+        // Copies the subresources to an upload buffer and from there to 'resource'.
+        void upload_subresources(ID3D12Resource* const resource, const D3D12_RESOURCE_DESC& desc, const texture_desc& info, UINT subresource_count)
+        {
+            // struct footprints_data
+            // {
+            //     D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint[subresource_count];
+            //     UINT num_rows[subresource_count];
+            //     UINT64 row_sizes[subresource_count];
+            // }
+            const UINT footprints_data_size{ (sizeof(D3D12_PLACED_SUBRESOURCE_FOOTPRINT) + sizeof(UINT) + sizeof(UINT64)) * subresource_count };
+            std::unique_ptr<UINT8[]> footprints_data{ std::make_unique<UINT8[]>(footprints_data_size) };
+
+            D3D12_PLACED_SUBRESOURCE_FOOTPRINT* const footprints_data_layouts{ (D3D12_PLACED_SUBRESOURCE_FOOTPRINT* const)footprints_data.get() };
+            UINT* const num_rows{ (UINT* const)&footprints_data_layouts[subresource_count] };
+            UINT64* const row_sizes{ (UINT64* const)&num_rows[subresource_count] };
+            UINT64 required_size{ 0 };
+
+            core::device()->GetCopyableFootprints(&desc, 0, subresource_count, 0, footprints_data_layouts, num_rows, row_sizes, &required_size);
+            assert(required_size);
+
+            // put the data in the gpu
+            upload::Upload_Context context{ (UINT)required_size };
+            UINT8* const cpu_address{ (UINT8* const)context.cpu_address() };
+
+            // Copy each of the subresource to CPU
+            for (UINT subresource_index{ 0 }; subresource_index < subresource_count; ++subresource_index)
+            {
+                const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint_layout{ footprints_data_layouts[subresource_index] };
+                const UINT rows{ num_rows[subresource_index] };
+                const UINT depth{ footprint_layout.Footprint.Depth };
+                const subresource_data& subresource{ info.subresources[subresource_index] };
+
+                const D3D12_MEMCPY_DEST copy_dst
+                {
+                    cpu_address + footprint_layout.Offset,
+                    footprint_layout.Footprint.RowPitch,
+                    footprint_layout.Footprint.RowPitch * info.height
+                };
+
+                for (UINT depth_index{ 0 }; depth_index < depth; ++depth_index)
+                {
+                    const UINT8* const src_slice{ (const UINT8*)subresource.data + subresource.slice_pitch * depth_index };
+                    UINT8* const dst_slice{ (UINT8* const)copy_dst.pData + copy_dst.SlicePitch * depth_index };
+
+                    // Rows with the same pitch in the blob and the upload buffer are copied with one memcpy.
+                    if (rows && subresource.row_pitch == copy_dst.RowPitch)
+                    {
+                        memcpy(dst_slice, src_slice, copy_dst.RowPitch * (rows - 1) + row_sizes[subresource_index]);
+                        continue;
+                    }
+
+                    for (UINT row_index{ 0 }; row_index < rows; ++row_index)
+                    {
+                        memcpy(dst_slice + copy_dst.RowPitch * row_index, src_slice + subresource.row_pitch * row_index, row_sizes[subresource_index]);
+                    }
+                }
+            }
+
+            ID3D12Resource* upload_buffer{ context.upload_buffer() };
+            for (UINT i{ 0 }; i < subresource_count; ++i)
+            {
+                D3D12_TEXTURE_COPY_LOCATION src
+                {
+                    upload_buffer,
+                    D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+                    footprints_data_layouts[i]
+                };
+
+                D3D12_TEXTURE_COPY_LOCATION dst
+                {
+                    resource,
+                    D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+                    i
+                };
+                context.command_list()->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+            }
+
+            context.end_upload();
+        }
+
+    } // anonymous namespace
+
+    buffer d3d12_device::create_buffer(const void* const data, UINT size)
+    {
+        ID3D12Resource* const resource{ buffers::create_buffer_default_with_upload(data, size) };
+        return buffer{ resource, resource->GetGPUVirtualAddress(), nullptr, size };
+    }
+
+    buffer d3d12_device::create_upload_buffer(UINT size)
+    {
+        const UINT aligned_size{ (UINT)buffers::align_size_for_constant_buffer(size) };
+        ID3D12Resource* const resource{ buffers::create_buffer_default_without_upload(aligned_size) };
+        NAME_D3D12_OBJECT_INDEXED(resource, aligned_size, L"Upload Buffer - size");
+
+        UINT8* cpu_address{ nullptr };
+        D3D12_RANGE range{};
+        ThrowIfFailed(resource->Map(0, &range, (void**)(&cpu_address)));
+        assert(cpu_address);
+        return buffer{ resource, resource->GetGPUVirtualAddress(), cpu_address, aligned_size };
+    }
+
+    void d3d12_device::release_buffer(buffer& b)
+    {
+        ID3D12Resource* resource{ (ID3D12Resource*)b.handle };
+        core::deferred_release(resource);
+        b = {};
+    }
+
+    texture d3d12_device::create_texture(const texture_desc& info)
+    {
+        assert(info.subresources && info.mip_levels <= max_texture_mips);
+        assert(!(info.is_cube_map && (info.array_size % 6)));
+
+        D3D12_RESOURCE_DESC desc{};
+        desc.Dimension = info.is_volume_map ? D3D12_RESOURCE_DIMENSION_TEXTURE3D : D3D12_RESOURCE_DIMENSION_TEXTURE2D;  //  D3D12_RESOURCE_DIMENSION Dimension;
+        desc.Alignment = 0;                                                                    //  UINT64 Alignment;
+        desc.Width = info.width;                                                               //  UINT64 Width;
+        desc.Height = info.height;                                                             //  UINT Height;
+        desc.DepthOrArraySize = info.is_volume_map ? (UINT16)info.depth : (UINT16)info.array_size; //  UINT16 DepthOrArraySize;
+        desc.MipLevels = (UINT16)info.mip_levels;                                              //  UINT16 MipLevels;
+        desc.Format = info.format;                                                             //  DXGI_FORMAT Format;
+        desc.SampleDesc = { 1, 0 };                                                            //  DXGI_SAMPLE_DESC SampleDesc;
+        desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;                                            //  D3D12_TEXTURE_LAYOUT Layout;
+        desc.Flags = D3D12_RESOURCE_FLAG_NONE;                                                 //  D3D12_RESOURCE_FLAGS Flags;
+
+        const UINT subresource_count{ info.array_size * info.mip_levels };
+        assert(subresource_count);
+
+        // Create the default buffer on the gpu for the data
+        ID3D12Resource* resource{ nullptr };
+        ThrowIfFailed(core::device()->CreateCommittedResource(&d3dx::heap_properties.default_heap, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&resource)));
+        upload_subresources(resource, desc, info, subresource_count);
+
+        // Create the shader view
+        D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc{};
+        resource::texture_init_info init_info{};
+        init_info.resource = resource;
+
+        if (info.is_cube_map)
+        {
+            srv_desc.Format = info.format;
+            srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+            if (info.array_size > 6)
+            {
+                srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+                srv_desc.TextureCubeArray.MostDetailedMip = 0;
+                srv_desc.TextureCubeArray.MipLevels = info.mip_levels;
+                srv_desc.TextureCubeArray.NumCubes = info.array_size / 6;
+            }
+            else
+            {
+                srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+                srv_desc.TextureCubeArray.MostDetailedMip = 0;
+                srv_desc.TextureCubeArray.MipLevels = info.mip_levels;
+                srv_desc.TextureCubeArray.ResourceMinLODClamp = 0.f;
+            }
+
+            init_info.srv_desc = &srv_desc;
+        }
+
+        // NOTE: the texture keeps its descriptor, so it's kept on the heap until release_texture().
+        resource::Texture_Buffer* const texture_buffer{ new resource::Texture_Buffer{ init_info } };
+        return texture{ texture_buffer, texture_buffer->srv().index };
+    }
+
+    void d3d12_device::release_texture(texture& t)
+    {
+        // NOTE: frees the descriptor and defers the release of the resource, see resource::Texture_Buffer::release().
+        delete (resource::Texture_Buffer*)t.handle;
+        t = {};
+    }
+
+    ID3D12RootSignature* d3d12_device::create_root_signature(content::material_type::type type, UINT shader_flags)
+    {
+        assert(type < content::material_type::count);
+        ID3D12RootSignature* root_signature{ nullptr };
+
+        switch (type)
+        {
+        case content::material_type::opaque:
+        {
+            using params = content::opaque_root_parameter;
+            d3dx::d3d12_root_parameter parameters[params::count]{};
+
+            D3D12_SHADER_VISIBILITY buffer_visibility{ D3D12_SHADER_VISIBILITY_VERTEX };
+            D3D12_SHADER_VISIBILITY data_visibility{ D3D12_SHADER_VISIBILITY_ALL };
+
+            parameters[params::global_shader_data].as_cbv(D3D12_SHADER_VISIBILITY_ALL, 0);
+            parameters[params::per_object_data].as_cbv(data_visibility, 1);
+            parameters[params::position_buffer].as_srv(buffer_visibility, 0);
+            parameters[params::element_buffer].as_srv(buffer_visibility, 1);
+            parameters[params::srv_indices].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 2); // TODO: needs to be visible to any stages that need to sample textures.
+            parameters[params::directional_lights].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 3);
+            parameters[params::cullable_lights].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 4);
+            parameters[params::light_grid].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 5);
+            parameters[params::light_index_list].as_srv(D3D12_SHADER_VISIBILITY_PIXEL, 6);
+
+            const D3D12_STATIC_SAMPLER_DESC samplers[]
+            {
+                d3dx::static_sampler(d3dx::sampler_state.static_point, 0, 0, D3D12_SHADER_VISIBILITY_PIXEL),
+                d3dx::static_sampler(d3dx::sampler_state.static_linear, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL),
+                d3dx::static_sampler(d3dx::sampler_state.static_anisotropic, 2, 0, D3D12_SHADER_VISIBILITY_PIXEL),
+            };
+
+            D3D12_ROOT_SIGNATURE_FLAGS flags{ d3dx::d3d12_root_signature_desc::default_flags };
+            flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS;
+            flags &= ~D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
+
+            root_signature = d3dx::d3d12_root_signature_desc
+            {
+                &parameters[0],
+                _countof(parameters),
+                flags,
+                &samplers[0], _countof(samplers)
+            }.create();
+        }
+        break;
+        }
+
+        assert(root_signature);
+        NAME_D3D12_OBJECT_INDEXED(root_signature, (UINT64)type << 32 | shader_flags, L"Main Root Signature - key");
+        return root_signature;
+    }
+
+    ID3D12PipelineState* d3d12_device::create_pipeline_state(const pipeline_state_desc& desc)
+    {
+        assert(desc.root_signature && desc.pass < pipeline_pass::count);
+        d3dx::d3d12_pipeline_state_subobject_stream stream{};
+
+        D3D12_RT_FORMAT_ARRAY rt_array{};
+        rt_array.NumRenderTargets = 1;
+        rt_array.RTFormats[0] = graphic_pass::main_buffer_format;
+
+        stream.render_target_formats = rt_array;
+        stream.root_signature = desc.root_signature;
+        stream.primitive_topology = get_d3d_primitive_topology_type(desc.primitive_topology);
+        stream.depth_stencil_format = graphic_pass::depth_buffer_format;
+        stream.rasterizer = d3dx::rasterizer_state.face_cull;
+        stream.blend = d3dx::blend_state.disabled;
+        stream.vs = shaders::get_engine_shader(shaders::element_type_to_shader_id(desc.elements_type));
+
+        if (desc.pass == pipeline_pass::depth)
+        {
+            stream.depth_stencil1 = d3dx::depth_state.reversed;
+        }
+        else
+        {
+            //stream.ps = shaders::get_engine_shader(shaders::engine_shader::pixel_shader_ps);
+            stream.ps = shaders::get_engine_shader(shaders::engine_shader::texture_shader_ps);
+            stream.depth_stencil1 = d3dx::depth_state.reversed_readonly;
+        }
+
+        ID3D12PipelineState* const pipeline_state{ d3dx::create_pipeline_state(&stream, sizeof(stream)) };
+        assert(pipeline_state);
+        NAME_D3D12_OBJECT_INDEXED(pipeline_state, desc.pass, L"Pipeline State Object - pass");
+        return pipeline_state;
+    }
+
+    void d3d12_device::release_root_signature(ID3D12RootSignature* root_signature)
+    {
+        core::release(root_signature);
+    }
+
+    void d3d12_device::release_pipeline_state(ID3D12PipelineState* pipeline_state)
+    {
+        core::release(pipeline_state);
+    }
+
+    UINT8* d3d12_device::allocate_constants(UINT size)
+    {
+        return core::cbuffer().allocate(size);
+    }
+
+    D3D12_GPU_VIRTUAL_ADDRESS d3d12_device::constants_gpu_address(const void* const allocation)
+    {
+        return core::cbuffer().gpu_address(allocation);
+    }
+}
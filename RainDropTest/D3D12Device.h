@@ -0,0 +1,27 @@
+#pragma once
+#include "stdafx.h"
+#include "GpuDevice.h"
+
+namespace gpu {
+
+    // Creates the renderer's resources with core::device(). Buffers and textures are released with
+    // core::deferred_release(), and the constants go to core::cbuffer().
+    class d3d12_device final : public device
+    {
+    public:
+        [[nodiscard]] buffer create_buffer(const void* const data, UINT size) override;
+        [[nodiscard]] buffer create_upload_buffer(UINT size) override;
+        void release_buffer(buffer& b) override;
+
+        [[nodiscard]] texture create_texture(const texture_desc& desc) override;
+        void release_texture(texture& t) override;
+
+        [[nodiscard]] ID3D12RootSignature* create_root_signature(content::material_type::type type, UINT shader_flags) override;
+        [[nodiscard]] ID3D12PipelineState* create_pipeline_state(const pipeline_state_desc& desc) override;
+        void release_root_signature(ID3D12RootSignature* root_signature) override;
+        void release_pipeline_state(ID3D12PipelineState* pipeline_state) override;
+
+        [[nodiscard]] UINT8* allocate_constants(UINT size) override;
+        [[nodiscard]] D3D12_GPU_VIRTUAL_ADDRESS constants_gpu_address(const void* const allocation) override;
+    };
+}
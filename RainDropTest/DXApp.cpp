@@ -10,10 +10,10 @@
 #include "Scripts.h"
 #include "Geometry.h"
 #include "Utilities.h"
+#include "MappedFile.h"
 #include "Content.h"
 #include "AppItems.h"
 #include "TimeProcess.h"
-#include "Lights.h"
 
 using namespace Microsoft::WRL;
 namespace app {
@@ -35,16 +35,16 @@ namespace app {
         Scene m_scenes[1];
         time_process timer{};
 
+        // Gathered from the geometry chunks every frame, see geometry::get_render_item_ids().
         utl::vector<UINT> render_item_id_cache;
+        utl::vector<float> threshold_cache;
 
         [[nodiscard]] UINT load_model(const char* path)
         {
-            std::unique_ptr<UINT8[]> model;
-            UINT64 size{ 0 };
+            const utl::mapped_file model{ path };
+            assert(model.is_open());
 
-            utl::read_file(path, model, size);
-
-            const UINT model_id{ content::create_resource(model.get(), content::asset_type::mesh) };
+            const UINT model_id{ content::create_resource(model.span(), content::asset_type::mesh) };
             assert(model_id != Invalid_Index);
             return model_id;
         }
@@ -164,7 +164,7 @@ namespace app {
         scene.surface_id = surface::create(scene.window);
 
         // x in(-) / out(+), y up(+) / down(-), z left(-) / right(+)
-        scene.entity = create_entity_item({ 5.f, 0.f, 0.f }, { 0.f, 1.5f * math::pi, 0.f }, { 1.f, 1.f, 1.f }, nullptr, "camera_script");
+        scene.entity = create_entity_item({ 5.f, 0.f, 0.f }, { 0.f, 1.5f * math::pi, 0.f }, { 1.f, 1.f, 1.f }, nullptr, utl::hashed_name{ "camera_script" });
         scene.camera_id = camera::create(camera::perspective_camera_init_info(scene.entity.get_id()));
         const surface::Surface& surface{ surface::get_surface(scene.surface_id) };
 
@@ -230,13 +230,10 @@ namespace app {
 
         app::create_render_items();
 
-        lights::generate_lights();
-
-        render_item_id_cache.resize(1);
-        geometry::get_geometry_item_ids(render_item_id_cache.data(), (UINT)render_item_id_cache.size());
+        app::generate_lights();
 
         input::input_source source{};
-        source.binding = std::hash<std::string>()("move");
+        source.binding = utl::hashed_name{ "move" };
         source.source_type = input::input_source::keyboard;
 
         for (int i{ 0 }; i < _countof(m_input_data); ++i)
@@ -252,8 +249,8 @@ namespace app {
 
     void app_shutdown()
     {
-        input::unbind(std::hash<std::string>()("move"));
-        lights::remove_lights();
+        input::unbind(utl::hashed_name{ "move" });
+        app::remove_lights();
         app::destroy_render_items();
 
         for (UINT i{ 0 }; i < _countof(m_scenes); ++i)
@@ -277,19 +274,19 @@ namespace app {
 
         script::update(dt);
 
+        geometry::get_render_item_ids(render_item_id_cache);
+        threshold_cache.resize(render_item_id_cache.size(), 0.f);
+
         for (UINT i{ 0 }; i < _countof(m_scenes); ++i)
         {
             if (m_scenes[i].surface_id != Invalid_Index)
             {
-                float thresholds[1]{};
-
                 core::frame_info info{};
                 info.render_item_ids = render_item_id_cache.data();
-                info.render_item_count = 1;
-                info.thresholds = &thresholds[0];
+                info.render_item_count = (UINT)render_item_id_cache.size();
+                info.thresholds = threshold_cache.data();
                 info.camera_id = m_scenes[i].camera_id;
 
-                assert(_countof(thresholds) >= info.render_item_count);
                 const surface::Surface& surface{ surface::get_surface(m_scenes[i].surface_id) };
                 surface.render(info);
             }
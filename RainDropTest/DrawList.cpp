@@ -0,0 +1,85 @@
+#include "DrawList.h"
+
+namespace graphic_pass
+{
+    namespace {
+
+        void set_root_parameters(command::command_list& cmd_list, const draw_list& list, UINT index)
+        {
+            assert(index < list.count);
+
+            const content::material_type::type mtl_type{ list.material_types[index] };
+            switch (mtl_type)
+            {
+            case content::material_type::opaque:
+            {
+                using params = content::opaque_root_parameter;
+                cmd_list.set_root_shader_resource_view(params::position_buffer, list.position_buffers[index]);
+                cmd_list.set_root_shader_resource_view(params::element_buffer, list.element_buffers[index]);
+                cmd_list.set_root_constant_buffer_view(params::per_object_data, list.per_object_data[index]);
+                if (list.texture_counts[index])
+                {
+                    cmd_list.set_root_shader_resource_view(params::srv_indices, list.srv_indices[index]);
+                }
+            }
+            break;
+            default:
+                assert(false);
+                break;
+            }
+        }
+
+        // 'bind_pass_views()' binds the pass' own buffers after each root signature change.
+        template<typename bind_func>
+        void record_draws(command::command_list& cmd_list, const draw_list& list, bind_func&& bind_pass_views)
+        {
+            ID3D12RootSignature* current_root_signature{ nullptr };
+            ID3D12PipelineState* current_pipeline_state{ nullptr };
+
+            for (UINT i{ 0 }; i < list.count; ++i)
+            {
+                if (current_root_signature != list.root_signatures[i])
+                {
+                    current_root_signature = list.root_signatures[i];
+                    cmd_list.set_root_signature(current_root_signature);
+                    bind_pass_views();
+                }
+
+                if (current_pipeline_state != list.pipeline_states[i])
+                {
+                    current_pipeline_state = list.pipeline_states[i];
+                    cmd_list.set_pipeline_state(current_pipeline_state);
+                }
+
+                set_root_parameters(cmd_list, list, i);
+
+                const D3D12_INDEX_BUFFER_VIEW& ibv{ list.index_buffer_views[i] };
+                const UINT index_count{ ibv.SizeInBytes >> (ibv.Format == DXGI_FORMAT_R16_UINT ? 1 : 2) };
+
+                cmd_list.set_index_buffer(ibv);
+                cmd_list.set_primitive_topology(list.primitive_topologies[i]);
+                cmd_list.draw_indexed(index_count);
+            }
+        }
+
+    } // anonymous namespace
+
+    void record_depth_prepass(command::command_list& cmd_list, const draw_list& list, D3D12_GPU_VIRTUAL_ADDRESS global_shader_data)
+    {
+        record_draws(cmd_list, list, [&cmd_list, global_shader_data] {
+            cmd_list.set_root_constant_buffer_view(content::opaque_root_parameter::global_shader_data, global_shader_data);
+            });
+    }
+
+    void record_graphic_pass(command::command_list& cmd_list, const draw_list& list, D3D12_GPU_VIRTUAL_ADDRESS global_shader_data, const light_views& lights)
+    {
+        record_draws(cmd_list, list, [&cmd_list, global_shader_data, &lights] {
+            using idx = content::opaque_root_parameter;
+            cmd_list.set_root_constant_buffer_view(idx::global_shader_data, global_shader_data);
+            cmd_list.set_root_shader_resource_view(idx::directional_lights, lights.directional_lights);
+            cmd_list.set_root_shader_resource_view(idx::cullable_lights, lights.cullable_lights);
+            cmd_list.set_root_shader_resource_view(idx::light_grid, lights.light_grid);
+            cmd_list.set_root_shader_resource_view(idx::light_index_list, lights.light_index_list);
+            });
+    }
+}
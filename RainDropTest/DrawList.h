@@ -0,0 +1,63 @@
+#pragma once
+#include "stdafx.h"
+#include "CommandList.h"
+
+// NOTE: these two are here rather than in Content.h so the draw loops build without D3D12 (see DrawList.cpp).
+namespace content
+{
+    struct opaque_root_parameter {
+        enum parameter : UINT {
+            global_shader_data,
+            per_object_data,
+            position_buffer,
+            element_buffer,
+            srv_indices,
+            directional_lights,
+            cullable_lights,
+            light_grid,
+            light_index_list,
+
+            count
+        };
+    };
+
+    struct material_type {
+        enum type : UINT {
+            opaque,
+
+            count
+        };
+    };
+}
+
+namespace graphic_pass {
+
+    // The columns of graphic_cache that a pass reads to record its draws.
+    struct draw_list
+    {
+        UINT count{ 0 };
+        ID3D12PipelineState* const* pipeline_states{ nullptr };     // depth or graphic, depending on the pass
+        ID3D12RootSignature* const* root_signatures{ nullptr };
+        const content::material_type::type* material_types{ nullptr };
+        const UINT* texture_counts{ nullptr };
+        const D3D12_GPU_VIRTUAL_ADDRESS* position_buffers{ nullptr };
+        const D3D12_GPU_VIRTUAL_ADDRESS* element_buffers{ nullptr };
+        const D3D12_INDEX_BUFFER_VIEW* index_buffer_views{ nullptr };
+        const D3D_PRIMITIVE_TOPOLOGY* primitive_topologies{ nullptr };
+        const D3D12_GPU_VIRTUAL_ADDRESS* per_object_data{ nullptr };
+        const D3D12_GPU_VIRTUAL_ADDRESS* srv_indices{ nullptr };
+    };
+
+    // Buffers the graphic pass binds whenever the root signature changes.
+    struct light_views
+    {
+        D3D12_GPU_VIRTUAL_ADDRESS directional_lights;
+        D3D12_GPU_VIRTUAL_ADDRESS cullable_lights;
+        D3D12_GPU_VIRTUAL_ADDRESS light_grid;
+        D3D12_GPU_VIRTUAL_ADDRESS light_index_list;
+    };
+
+    // One draw per item. Root signatures and pipeline states are only set when they change from the previous item.
+    void record_depth_prepass(command::command_list& cmd_list, const draw_list& list, D3D12_GPU_VIRTUAL_ADDRESS global_shader_data);
+    void record_graphic_pass(command::command_list& cmd_list, const draw_list& list, D3D12_GPU_VIRTUAL_ADDRESS global_shader_data, const light_views& lights);
+}
@@ -3,17 +3,388 @@
 #include "Scripts.h"
 #include "Geometry.h"
 #include "Vector.h"
-#include <deque>
+#include "VmVector.h"
+#include <algorithm>
 
 namespace game_entity {
     namespace {
-        utl::vector<transform::component> transforms;
-        utl::vector<script::component> scripts;
-        utl::vector<geometry::component> geometries;
+        struct column {
+            enum type : UINT {
+                entity_id,
+                transform,
+                script,
+                geometry,
 
-        utl::vector<UINT> ids;
-        std::deque<UINT> free_ids;
-        bool min_deleted_set{ false };
+                // The components' data, see chunk_view.
+                rotation,
+                orientation,
+                position,
+                scale,
+                to_world,
+                inverse_world,
+                render_item_id,
+                active_lod,
+
+                count
+            };
+        };
+
+        // The size of a column's items, and the component the column belongs to (0 if every entity has it).
+        constexpr UINT column_sizes[column::count]{
+            sizeof(UINT), sizeof(UINT), sizeof(UINT), sizeof(UINT),
+            sizeof(XMFLOAT4), sizeof(XMFLOAT3), sizeof(XMFLOAT3), sizeof(XMFLOAT3), sizeof(XMFLOAT4X4), sizeof(XMFLOAT4X4),
+            sizeof(UINT), sizeof(UINT) };
+        constexpr UINT column_components[column::count]{
+            0, component_type::transform, component_type::script, component_type::geometry,
+            component_type::transform, component_type::transform, component_type::transform, component_type::transform,
+            component_type::transform, component_type::transform,
+            component_type::geometry, component_type::geometry };
+
+        // Entities with the same signature, stored in chunks of chunk_size bytes. A chunk has one column (SoA)
+        // for the entity ids, one for the id of each component in the signature, and one for each array of
+        // the components' data. So, systems that use several components read them side by side, and a column
+        // only exists where entities have the component.
+        // NOTE: rows are kept packed. Removing a row moves the last row into its place.
+        class archetype
+        {
+        public:
+            archetype() = default;
+            DISABLE_COPY_AND_MOVE(archetype);
+
+            ~archetype()
+            {
+                for (UINT8* const chunk : _chunks) free_chunk(chunk);
+            }
+
+            void initialize(UINT signature)
+            {
+                assert(!is_initialized() && (signature & component_type::transform));
+                _signature = signature;
+
+                bool has_column[column::count]{};
+                UINT row_size{ 0 };
+                for (UINT i{ 0 }; i < column::count; ++i)
+                {
+                    has_column[i] = !column_components[i] || (signature & column_components[i]);
+                    row_size += has_column[i] ? column_sizes[i] : 0;
+                }
+
+                // NOTE: a multiple of 16 rows, so every column starts on a cache line (items are multiples of 4 bytes).
+                _rows_per_chunk = (chunk_size / row_size) & ~15u;
+                assert(_rows_per_chunk);
+
+                UINT offset{ 0 };
+                for (UINT i{ 0 }; i < column::count; ++i)
+                {
+                    _column_offsets[i] = has_column[i] ? offset : Invalid_Index;
+                    offset += has_column[i] ? _rows_per_chunk * column_sizes[i] : 0;
+                }
+            }
+
+            [[nodiscard]] constexpr bool is_initialized() const { return _rows_per_chunk != 0; }
+            [[nodiscard]] constexpr UINT signature() const { return _signature; }
+            [[nodiscard]] constexpr UINT count() const { return _count; }
+            [[nodiscard]] constexpr UINT rows_per_chunk() const { return _rows_per_chunk; }
+            [[nodiscard]] constexpr UINT chunk_count() const { return (_count + _rows_per_chunk - 1) / _rows_per_chunk; }
+            [[nodiscard]] constexpr bool has(column::type c) const { return _column_offsets[c] != Invalid_Index; }
+
+            // Allocates the chunks for 'count' rows in total, so adding them doesn't allocate one by one.
+            void reserve(UINT count)
+            {
+                while ((UINT64)_chunks.size() * _rows_per_chunk < count)
+                {
+                    _chunks.emplace_back(allocate_chunk());
+                }
+            }
+
+            // Adds a row for the entity, with no components yet. Returns the row.
+            // NOTE: the data columns aren't initialized, the components write them when they're created.
+            [[nodiscard]] UINT add(UINT entity_id)
+            {
+                reserve(_count + 1);
+                const UINT row{ _count++ };
+                for (UINT i{ column::transform }; i <= column::geometry; ++i)
+                {
+                    if (has((column::type)i)) at(row, (column::type)i) = Invalid_Index;
+                }
+                at(row, column::entity_id) = entity_id;
+                return row;
+            }
+
+            // Moves the last row into 'row'. Returns the id of the entity that moved, or Invalid_Index if none did.
+            [[nodiscard]] UINT remove(UINT row)
+            {
+                assert(row < _count);
+                const UINT last{ _count - 1 };
+                UINT moved_entity_id{ Invalid_Index };
+                if (row != last)
+                {
+                    copy_row(row, *this, last);
+                    moved_entity_id = at(row, column::entity_id);
+                }
+                _count = last;
+
+                // NOTE: keep one empty chunk around, so adding and removing at a chunk boundary doesn't allocate every time.
+                while (_chunks.size() > chunk_count() + 1)
+                {
+                    free_chunk(_chunks.back());
+                    _chunks.erase_unordered(_chunks.size() - 1);
+                }
+
+                return moved_entity_id;
+            }
+
+            // The item of one of the id columns (entity_id to geometry).
+            [[nodiscard]] UINT& at(UINT row, column::type c)
+            {
+                assert(row < _count && has(c) && c <= column::geometry);
+                return *(UINT*)data(row, c);
+            }
+
+            // Returns Invalid_Index if the signature doesn't have the component.
+            [[nodiscard]] UINT get(UINT row, column::type c) const
+            {
+                assert(row < _count && c <= column::geometry);
+                return has(c) ? *(const UINT*)data(row, c) : Invalid_Index;
+            }
+
+            [[nodiscard]] UINT8* data(UINT row, column::type c) const
+            {
+                assert(row < _count && has(c));
+                return column_data(row / _rows_per_chunk, c) + (row % _rows_per_chunk) * column_sizes[c];
+            }
+
+            // Copies the columns that both archetypes have from row 'from_row' of 'from' to 'row'.
+            void copy_row(UINT row, const archetype& from, UINT from_row)
+            {
+                assert(row < _count && from_row < from._count);
+                UINT8* const chunk{ _chunks[row / _rows_per_chunk] };
+                const UINT8* const from_chunk{ from._chunks[from_row / from._rows_per_chunk] };
+                row %= _rows_per_chunk;
+                from_row %= from._rows_per_chunk;
+                for (UINT i{ 0 }; i < column::count; ++i)
+                {
+                    if (!has((column::type)i) || !from.has((column::type)i)) continue;
+                    const UINT size{ column_sizes[i] };
+                    memcpy(chunk + _column_offsets[i] + row * size, from_chunk + from._column_offsets[i] + from_row * size, size);
+                }
+            }
+
+            [[nodiscard]] chunk_view view(UINT chunk) const
+            {
+                assert(chunk < chunk_count());
+                const auto column_or_null = [&](column::type c) { return has(c) ? column_data(chunk, c) : nullptr; };
+
+                chunk_view view{};
+                view.signature = _signature;
+                view.count = std::min(_rows_per_chunk, _count - chunk * _rows_per_chunk);
+                view.entity_ids = (const UINT*)column_or_null(column::entity_id);
+                view.transform_ids = (const UINT*)column_or_null(column::transform);
+                view.script_ids = (const UINT*)column_or_null(column::script);
+                view.geometry_ids = (const UINT*)column_or_null(column::geometry);
+                view.rotations = (XMFLOAT4*)column_or_null(column::rotation);
+                view.orientations = (XMFLOAT3*)column_or_null(column::orientation);
+                view.positions = (XMFLOAT3*)column_or_null(column::position);
+                view.scales = (XMFLOAT3*)column_or_null(column::scale);
+                view.to_worlds = (XMFLOAT4X4*)column_or_null(column::to_world);
+                view.inverse_worlds = (XMFLOAT4X4*)column_or_null(column::inverse_world);
+                view.render_item_ids = (UINT*)column_or_null(column::render_item_id);
+                view.active_lods = (UINT*)column_or_null(column::active_lod);
+                return view;
+            }
+
+        private:
+            static constexpr UINT64 chunk_alignment{ 64 };
+
+            [[nodiscard]] static UINT8* allocate_chunk()
+            {
+                return (UINT8*)::operator new(chunk_size, std::align_val_t{ chunk_alignment });
+            }
+
+            static void free_chunk(UINT8* const chunk)
+            {
+                ::operator delete(chunk, std::align_val_t{ chunk_alignment });
+            }
+
+            [[nodiscard]] UINT8* column_data(UINT chunk, column::type c) const
+            {
+                return _chunks[chunk] + _column_offsets[c];
+            }
+
+            utl::vector<UINT8*> _chunks;
+            UINT                _signature{ 0 };
+            UINT                _count{ 0 };
+            UINT                _rows_per_chunk{ 0 };
+            UINT                _column_offsets[column::count]{};
+        };
+
+        struct entity_location
+        {
+            UINT signature;
+            UINT row;       // Invalid_Index if the slot is free.
+        };
+
+        // One archetype for each signature. They're initialized the first time they're used.
+        archetype archetypes[component_type::all + 1];
+        utl::vm_vector<entity_location> locations{ max_entity_count };
+
+        // Current generation of each slot.
+        utl::vm_vector<UINT8> generations{ max_entity_count };
+        // NOTE: free slots are queued through this array, oldest first. Freeing or reusing an id never allocates,
+        //       and a slot goes through all of its generations only after every other free slot was reused as often.
+        utl::vm_vector<UINT> next_free_index{ max_entity_count };
+        UINT free_head{ Invalid_Index };
+        UINT free_tail{ Invalid_Index };
+
+        [[nodiscard]] archetype& get_archetype(UINT signature)
+        {
+            assert(signature <= component_type::all);
+            archetype& a{ archetypes[signature] };
+            if (!a.is_initialized()) a.initialize(signature);
+            return a;
+        }
+
+        [[nodiscard]] constexpr UINT get_signature(const entity_info& info)
+        {
+            UINT signature{ component_type::transform };
+            if (info.script && info.script->script_creator) signature |= component_type::script;
+            if (info.geometry) signature |= component_type::geometry;
+            return signature;
+        }
+
+        [[nodiscard]] UINT get_component(UINT id, column::type c)
+        {
+            const entity_location& location{ locations[id::index(id)] };
+            return archetypes[location.signature].get(location.row, c);
+        }
+
+        // Takes 'count' ids, reusing free slots first. The arrays grow once for the rest.
+        void allocate_ids(UINT* const ids, UINT count)
+        {
+            UINT i{ 0 };
+            for (; i < count && free_head != Invalid_Index; ++i)
+            {
+                const UINT index{ free_head };
+                free_head = next_free_index[index];
+                if (free_head == Invalid_Index) free_tail = Invalid_Index;
+
+                assert(locations[index].row == Invalid_Index);
+                ids[i] = id::make(index, generations[index]);
+            }
+
+            if (i < count)
+            {
+                const UINT first_index{ (UINT)generations.size() };
+                const UINT new_size{ first_index + (count - i) };
+                assert(new_size <= max_entity_count);
+
+                // NOTE: we call resize() once instead of emplace_back() for each entity.
+                generations.resize(new_size, 0);
+                next_free_index.resize(new_size, Invalid_Index);
+                locations.resize(new_size, entity_location{ 0, Invalid_Index });
+
+                for (UINT index{ first_index }; i < count; ++i, ++index)
+                {
+                    ids[i] = id::make(index, 0);
+                }
+            }
+        }
+
+        void free_id(UINT index)
+        {
+            // NOTE: id::max_index keeps every id apart from Invalid_Index, so all generations can be used.
+            generations[index] = (UINT8)((generations[index] + 1) & id::generation_mask);
+
+            next_free_index[index] = Invalid_Index;
+            if (free_tail != Invalid_Index) next_free_index[free_tail] = index;
+            else free_head = index;
+            free_tail = index;
+        }
+
+        // Adds the entity to the archetype of its signature.
+        void add_to_archetype(UINT id, UINT signature)
+        {
+            entity_location& location{ locations[id::index(id)] };
+            assert(location.row == Invalid_Index);
+            location = { signature, get_archetype(signature).add(id) };
+        }
+
+        void remove_from_archetype(UINT id)
+        {
+            entity_location& location{ locations[id::index(id)] };
+            const UINT moved_entity_id{ archetypes[location.signature].remove(location.row) };
+            if (moved_entity_id != Invalid_Index)
+            {
+                locations[id::index(moved_entity_id)].row = location.row;
+            }
+            location = { 0, Invalid_Index };
+        }
+
+        // Moves the entity's components, and their data, to the archetype of the new signature (a structural change).
+        void change_signature(UINT id, UINT signature)
+        {
+            const entity_location location{ locations[id::index(id)] };
+            assert(location.signature != signature);
+            archetype& from{ archetypes[location.signature] };
+            archetype& to{ get_archetype(signature) };
+
+            const UINT row{ to.add(id) };
+            to.copy_row(row, from, location.row);
+
+            remove_from_archetype(id);
+            locations[id::index(id)] = { signature, row };
+        }
+
+        // Creates the script and geometry components. The transform must already exist.
+        void create_components(entity new_entity, const entity_info& info)
+        {
+            const UINT id{ new_entity.get_id() };
+            assert(get_component(id, column::transform) != Invalid_Index);
+
+            // create script component
+            if (info.script && info.script->script_creator)
+            {
+                assert(get_component(id, column::script) == Invalid_Index);
+                // NOTE: the script may create entities, which can add chunks. Look up the row after creating it.
+                const script::component c{ script::create(*info.script, new_entity) };
+                assert(c.is_valid());
+                const entity_location& location{ locations[id::index(id)] };
+                archetypes[location.signature].at(location.row, column::script) = c.get_id();
+            }
+
+            // Create geometry component
+            if (info.geometry)
+            {
+                assert(get_component(id, column::geometry) == Invalid_Index);
+                const geometry::component c{ geometry::create(*info.geometry, new_entity) };
+                assert(c.is_valid());
+                const entity_location& location{ locations[id::index(id)] };
+                archetypes[location.signature].at(location.row, column::geometry) = c.get_id();
+            }
+        }
+
+        // Removes the components, the entity stays in its archetype.
+        void remove_components(UINT id)
+        {
+            const entity_location& location{ locations[id::index(id)] };
+            archetype& a{ archetypes[location.signature] };
+
+            if (const geometry::component c{ a.get(location.row, column::geometry) }; c.is_valid())
+            {
+                geometry::remove(c);
+                a.at(location.row, column::geometry) = Invalid_Index;
+            }
+
+            if (const script::component c{ a.get(location.row, column::script) }; c.is_valid())
+            {
+                script::remove(c);
+                a.at(location.row, column::script) = Invalid_Index;
+            }
+
+            // NOTE: without a transform the entity isn't alive anymore, see is_alive().
+            transform::remove(transform::component{ a.get(location.row, column::transform) });
+            a.at(location.row, column::transform) = Invalid_Index;
+        }
 
     } // anonymous namespace
 
@@ -42,96 +413,162 @@ namespace game_entity {
         assert(info.transform);
 
         UINT id;
+        allocate_ids(&id, 1);
+        const entity new_entity{ id };
+        add_to_archetype(id, get_signature(info));
 
-        if (free_ids.size() && (free_ids.size() > min_deleted_elements || min_deleted_set))
-        {
-            id = free_ids.front();
-            free_ids.pop_front();
-            ids[id] = id;
-            min_deleted_set = true;
-        }
-        else
-        {
-            id = (UINT)ids.size();
-            ids.push_back(id);
+        // Create transform component
+        const transform::component c{ transform::create(*info.transform, new_entity) };
+        const entity_location& location{ locations[id::index(id)] };
+        archetypes[location.signature].at(location.row, column::transform) = c.get_id();
 
-            // Resize components
-            // NOTE: we don't call resize(), so the number of memory allocations stays low
-            transforms.emplace_back();
-            scripts.emplace_back();
-            geometries.emplace_back();
-        }
+        create_components(new_entity, info);
+        return new_entity;
+    }
 
-        const entity new_entity{ id };
+    void create_batch(std::span<const entity_info> infos, entity* const entities)
+    {
+        const UINT count{ (UINT)infos.size() };
+        assert(entities || !count);
+        if (!count) return;
 
-        // Create transform component
-        assert(!transforms[id].is_valid());
-        transforms[id] = transform::create(*info.transform, new_entity);
+        utl::vector<UINT> ids(count);
+        utl::vector<const transform::init_info*> transform_infos(count);
+        utl::vector<transform::component> transform_components(count);
+        allocate_ids(ids.data(), count);
 
-        // create script component
-        if (info.script && info.script->script_creator)
+        // Make room in each archetype once.
+        UINT signature_counts[component_type::all + 1]{};
+        for (const entity_info& info : infos) ++signature_counts[get_signature(info)];
+        for (UINT signature{ 0 }; signature <= component_type::all; ++signature)
         {
-            assert(!scripts[id].is_valid());
-            scripts[id] = script::create(*info.script, new_entity);
-            assert(scripts[id].is_valid());
+            if (!signature_counts[signature]) continue;
+            archetype& a{ get_archetype(signature) };
+            a.reserve(a.count() + signature_counts[signature]);
         }
 
-        // Create geometry component
-        if (info.geometry)
+        for (UINT i{ 0 }; i < count; ++i)
         {
-            assert(!geometries[id].is_valid());
-            geometries[id] = geometry::create(*info.geometry, new_entity);
-            assert(geometries[id].is_valid());
+            assert(infos[i].transform);
+            entities[i] = entity{ ids[i] };
+            transform_infos[i] = infos[i].transform;
+            add_to_archetype(ids[i], get_signature(infos[i]));
         }
 
-        return new_entity;
+        // Create transform components, all at once.
+        transform::create_batch(transform_infos.data(), entities, count, transform_components.data());
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            const entity_location& location{ locations[id::index(ids[i])] };
+            archetypes[location.signature].at(location.row, column::transform) = transform_components[i].get_id();
+        }
+
+        // NOTE: scripts and geometries are created one by one, a script's constructor may already use its entity.
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            create_components(entities[i], infos[i]);
+        }
     }
 
     void remove(UINT id)
     {
-        assert(id != Invalid_Index);
+        assert(is_alive(id));
+        remove_components(id);
+        remove_from_archetype(id);
+        free_id(id::index(id));
+    }
 
-        if (geometries[id].is_valid())
+    void remove_batch(std::span<const UINT> ids)
+    {
+        // NOTE: all components go first. Removing a script may look up another entity in the batch,
+        //       which must still be alive then.
+        for (const UINT id : ids)
         {
-            geometry::remove(geometries[id]);
-            geometries[id] = {};
+            assert(is_alive(id)); // removed twice?
+            remove_components(id);
         }
 
-        if (scripts[id].is_valid())
+        for (const UINT id : ids)
         {
-            script::remove(scripts[id]);
-            scripts[id] = {};
+            remove_from_archetype(id);
+            free_id(id::index(id));
         }
+    }
 
-        transform::remove(transforms[id]);
-        transforms[id] = {};
+    bool is_alive(UINT id)
+    {
+        assert(id != Invalid_Index);
+        const UINT index{ id::index(id) };
+        assert(index < generations.size());
+        return generations[index] == id::generation(id) && locations[index].row != Invalid_Index &&
+            get_component(id, column::transform) != Invalid_Index;
+    }
+
+    void add_geometry(UINT id, geometry::init_info info)
+    {
+        assert(is_alive(id));
+        const UINT signature{ locations[id::index(id)].signature };
+        assert(!(signature & component_type::geometry));
+        change_signature(id, signature | component_type::geometry);
 
-        ids[id] = Invalid_Index;
-        free_ids.push_back(id);
+        const geometry::component c{ geometry::create(info, entity{ id }) };
+        assert(c.is_valid());
+        const entity_location& location{ locations[id::index(id)] };
+        archetypes[location.signature].at(location.row, column::geometry) = c.get_id();
     }
 
-    bool is_alive(UINT id)
+    void remove_geometry(UINT id)
     {
-        assert(id < ids.size());
-        return (ids[id] != Invalid_Index);
+        assert(is_alive(id));
+        const UINT signature{ locations[id::index(id)].signature };
+        assert(signature & component_type::geometry);
+        geometry::remove(geometry::component{ get_component(id, column::geometry) });
+        change_signature(id, signature & ~component_type::geometry);
+    }
+
+    namespace detail {
+        void for_each_chunk(UINT signature, void(*function)(const chunk_view& chunk, void* context), void* context)
+        {
+            assert(function);
+            for (const archetype& a : archetypes)
+            {
+                if (!a.is_initialized() || (a.signature() & signature) != signature) continue;
+
+                const UINT chunk_count{ a.chunk_count() };
+                for (UINT i{ 0 }; i < chunk_count; ++i)
+                {
+                    function(a.view(i), context);
+                }
+            }
+        }
+
+        chunk_view find_row(UINT index, UINT& row)
+        {
+            assert(index < locations.size());
+            const entity_location& location{ locations[index] };
+            assert(location.row != Invalid_Index);
+            const archetype& a{ archetypes[location.signature] };
+            row = location.row % a.rows_per_chunk();
+            return a.view(location.row / a.rows_per_chunk());
+        }
     }
 
     transform::component entity::transform() const
     {
         assert(is_alive(_id));
-        return transforms[_id];
+        return transform::component{ get_component(_id, column::transform) };
     }
 
     script::component entity::script() const
     {
         assert(is_alive(_id));
-        return scripts[_id];
+        return script::component{ get_component(_id, column::script) };
     }
 
     geometry::component entity::geometry() const
     {
         assert(is_alive(_id));
-        return geometries[_id];
+        return geometry::component{ get_component(_id, column::geometry) };
     }
 
 }
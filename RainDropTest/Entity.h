@@ -1,5 +1,7 @@
 #pragma once
 #include "stdafx.h"
+#include "Id.h"
+#include <span>
 
 namespace transform {
     class component;
@@ -16,9 +18,65 @@ namespace geometry {
     struct init_info;
 }
 
+#ifndef MAX_ENTITY_COUNT
+#define MAX_ENTITY_COUNT (1u << 22)
+#endif
+
 namespace game_entity {
-    constexpr UINT min_deleted_elements{ 4 };
-    //constexpr UINT min_deleted_elements{ 1024 };
+    // Arrays indexed by entity id reserve address space for this many entities up front (see utl::vm_vector).
+    // NOTE: that's 14 bytes of address space per entity (entities 13, transform change flags 1), so 4M entities
+    //       reserve ~56MB. Only the pages of entities that were created use memory. The components' data is in
+    //       the chunks (see chunk_view).
+    //       Define MAX_ENTITY_COUNT to change it, up to (1 << 24) - 1 (see id::max_index), which reserves ~235MB.
+    constexpr UINT max_entity_count{ MAX_ENTITY_COUNT };
+
+    // An entity id is the index of the entity's slot, with the slot's generation in the high bits.
+    // The generation changes when the entity is removed, so an id that is kept around after that
+    // (by a script or a light) is no longer alive, instead of naming the next entity in the slot.
+    // NOTE: components that are indexed by entity (e.g. transforms) use id::index().
+    namespace id = utl::id;
+    static_assert(max_entity_count <= id::max_index + 1);
+
+    // The components an entity can have. The set of components of an entity is its signature.
+    struct component_type {
+        enum type : UINT {
+            transform = 0x01,
+            script = 0x02,
+            geometry = 0x04,
+
+            all = transform | script | geometry
+        };
+    };
+
+    // Entities with the same signature are stored together, in chunks of this many bytes.
+    constexpr UINT chunk_size{ 16 * 1024 };
+
+    // One chunk of entities that share a signature. Each array (column) has 'count' items, row i of
+    // every column belongs to the same entity. Columns of components that aren't in the signature are null.
+    // The components keep their data in the chunk, so a system reads (and writes) its columns one after the other.
+    // NOTE: the data moves with the entity when it changes chunk, pointers into a chunk are only valid until
+    //       entities are created or removed, or components are added or removed.
+    struct chunk_view
+    {
+        UINT signature{ 0 };
+        UINT count{ 0 };
+        const UINT* entity_ids{ nullptr };
+        const UINT* transform_ids{ nullptr };
+        const UINT* script_ids{ nullptr };
+        const UINT* geometry_ids{ nullptr };
+
+        // transform (Transform.cpp)
+        XMFLOAT4* rotations{ nullptr };
+        XMFLOAT3* orientations{ nullptr };
+        XMFLOAT3* positions{ nullptr };
+        XMFLOAT3* scales{ nullptr };
+        XMFLOAT4X4* to_worlds{ nullptr };
+        XMFLOAT4X4* inverse_worlds{ nullptr };
+
+        // geometry (Geometry.cpp)
+        UINT* render_item_ids{ nullptr };
+        UINT* active_lods{ nullptr };
+    };
 
     struct entity_info
     {
@@ -52,4 +110,31 @@ namespace game_entity {
     entity create(entity_info info);
     void remove(UINT id);
     bool is_alive(UINT id);
+
+    // Same as calling create() for each info, but the arrays grow once for all of them and the
+    // transforms are initialized together. 'entities' must have room for infos.size() entities.
+    void create_batch(std::span<const entity_info> infos, entity* const entities);
+    // Same as calling remove() for each id. The ids can't repeat.
+    void remove_batch(std::span<const UINT> ids);
+
+    // Adding or removing a component changes the signature, which moves the entity to another chunk.
+    void add_geometry(UINT id, geometry::init_info info);
+    void remove_geometry(UINT id);
+
+    namespace detail {
+        void for_each_chunk(UINT signature, void(*function)(const chunk_view& chunk, void* context), void* context);
+        // The chunk of the entity at 'index' (see id::index()) and the entity's row in it, for the components
+        // that keep their data in the chunks. The entity must be in a chunk (from create() until remove()).
+        [[nodiscard]] chunk_view find_row(UINT index, UINT& row);
+    }
+
+    // Calls func(const chunk_view&) for every chunk of entities that have (at least) the components in 'signature'.
+    // NOTE: entities can't be created or removed, and components can't be added or removed, during the iteration.
+    template<typename F>
+    void for_each_chunk(UINT signature, F&& func)
+    {
+        using func_type = std::remove_reference_t<F>;
+        detail::for_each_chunk(signature, [](const chunk_view& chunk, void* context) { (*(func_type*)context)(chunk); },
+            (void*)std::addressof(func));
+    }
 } // namespace game_entity
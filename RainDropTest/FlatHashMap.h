@@ -0,0 +1,358 @@
+#pragma once
+#include "stdafx.h"
+#include <utility>
+#include <functional>
+
+namespace utl {
+
+    namespace detail {
+        // Final mix of MurmurHash3. Spreads all input bits over the result, so keys that only differ
+        // in their high bits (like type << 32 | code) don't end up in the same bucket. std::hash of
+        // an integer is the integer itself on some standard libraries, so every hash goes through this.
+        [[nodiscard]] constexpr UINT64 mix64(UINT64 x)
+        {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdull;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ull;
+            x ^= x >> 33;
+            return x;
+        }
+    } // namespace detail
+
+    // Hash map with open addressing (Robin Hood, linear probing) in one contiguous allocation.
+    // Each slot has a one byte probe distance next to it: 0 means empty, otherwise it's the distance
+    // from the slot the key hashes to, plus one. Lookups stop as soon as they meet a slot that is
+    // closer to its home than the key would be, so misses are as cheap as hits.
+    // NOTE: unlike std::unordered_map, inserting or erasing moves other items. Pointers and
+    //       iterators into the map are only valid until the next insert or erase.
+    template<typename K, typename V, typename hasher = std::hash<K>>
+    class flat_hash_map
+    {
+    public:
+        using value_type = std::pair<K, V>;
+
+        template<bool is_const>
+        class iterator_base
+        {
+        public:
+            using map_type = std::conditional_t<is_const, const flat_hash_map, flat_hash_map>;
+            using reference = std::conditional_t<is_const, const value_type&, value_type&>;
+            using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
+
+            constexpr iterator_base(map_type* map, UINT64 index) : _map{ map }, _index{ index } {}
+
+            [[nodiscard]] constexpr reference operator*() const { return _map->m_slots[_index]; }
+            [[nodiscard]] constexpr pointer operator->() const { return &_map->m_slots[_index]; }
+
+            constexpr iterator_base& operator++()
+            {
+                _index = _map->next_used(_index + 1);
+                return *this;
+            }
+
+            [[nodiscard]] constexpr bool operator==(const iterator_base& o) const { return _index == o._index; }
+            [[nodiscard]] constexpr bool operator!=(const iterator_base& o) const { return _index != o._index; }
+
+        private:
+            map_type*   _map;
+            UINT64      _index;
+            friend class flat_hash_map;
+        };
+
+        using iterator = iterator_base<false>;
+        using const_iterator = iterator_base<true>;
+
+        flat_hash_map() = default;
+        DISABLE_COPY(flat_hash_map);
+
+        constexpr flat_hash_map(flat_hash_map&& o)
+        {
+            move(o);
+        }
+
+        constexpr flat_hash_map& operator=(flat_hash_map&& o)
+        {
+            assert(this != std::addressof(o));
+            if (this != std::addressof(o))
+            {
+                destroy();
+                move(o);
+            }
+            return *this;
+        }
+
+        ~flat_hash_map() { destroy(); }
+
+        // Looks up 'key'. It can be of any type that 'hasher' accepts and that compares to K.
+        template<typename key_like>
+        [[nodiscard]] constexpr iterator find(const key_like& key)
+        {
+            return { this, find_index(key) };
+        }
+
+        template<typename key_like>
+        [[nodiscard]] constexpr const_iterator find(const key_like& key) const
+        {
+            return { this, find_index(key) };
+        }
+
+        template<typename key_like>
+        [[nodiscard]] constexpr bool contains(const key_like& key) const
+        {
+            return find_index(key) != m_capacity;
+        }
+
+        template<typename key_like>
+        [[nodiscard]] constexpr UINT64 count(const key_like& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        // Constructs V from 'p' if 'key' isn't in the map yet. Returns the item and whether it was inserted.
+        template<typename... params>
+        constexpr std::pair<iterator, bool> try_emplace(const K& key, params&&... p)
+        {
+            const UINT64 hash{ hash_of(key) };
+            const UINT64 index{ find_index(key, hash) };
+            if (index != m_capacity)
+            {
+                return { iterator{ this, index }, false };
+            }
+
+            return { iterator{ this, insert_new(hash, key, std::forward<params>(p)...) }, true };
+        }
+
+        constexpr std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return try_emplace(value.first, value.second);
+        }
+
+        constexpr std::pair<iterator, bool> insert(value_type&& value)
+        {
+            return try_emplace(value.first, std::move(value.second));
+        }
+
+        // Returns the value for 'key', default-constructing it if it isn't in the map yet.
+        constexpr V& operator[](const K& key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        // Returns the number of items removed (0 or 1).
+        template<typename key_like>
+        constexpr UINT64 erase(const key_like& key)
+        {
+            const UINT64 index{ find_index(key) };
+            if (index == m_capacity) return 0;
+            erase_at(index);
+            return 1;
+        }
+
+        // Removes all items but keeps the memory.
+        constexpr void clear()
+        {
+            for (UINT64 i{ 0 }; i < m_capacity; ++i)
+            {
+                if (m_distances[i])
+                {
+                    m_slots[i].~value_type();
+                    m_distances[i] = 0;
+                }
+            }
+            m_size = 0;
+        }
+
+        // Makes room for 'count' items without rehashing.
+        constexpr void reserve(UINT64 count)
+        {
+            UINT64 new_capacity{ m_capacity ? m_capacity : min_capacity };
+            while (count * 5 > new_capacity * 4) new_capacity <<= 1;
+            if (new_capacity > m_capacity) rehash(new_capacity);
+        }
+
+        [[nodiscard]] constexpr UINT64 size() const { return m_size; }
+        [[nodiscard]] constexpr bool empty() const { return m_size == 0; }
+        [[nodiscard]] constexpr UINT64 capacity() const { return m_capacity; }
+
+        [[nodiscard]] constexpr iterator begin() { return { this, next_used(0) }; }
+        [[nodiscard]] constexpr const_iterator begin() const { return { this, next_used(0) }; }
+        [[nodiscard]] constexpr iterator end() { return { this, m_capacity }; }
+        [[nodiscard]] constexpr const_iterator end() const { return { this, m_capacity }; }
+
+    private:
+        static constexpr UINT64 min_capacity{ 16 };
+        static constexpr UINT8 max_distance{ 0xff };
+        static constexpr UINT64 alignment{ alignof(value_type) > 16 ? alignof(value_type) : 16 };
+
+        template<typename key_like>
+        [[nodiscard]] static constexpr UINT64 hash_of(const key_like& key)
+        {
+            return detail::mix64((UINT64)hasher{}(key));
+        }
+
+        template<typename key_like>
+        [[nodiscard]] constexpr UINT64 find_index(const key_like& key) const
+        {
+            return find_index(key, hash_of(key));
+        }
+
+        // Returns m_capacity if the key isn't found.
+        template<typename key_like>
+        [[nodiscard]] constexpr UINT64 find_index(const key_like& key, UINT64 hash) const
+        {
+            if (!m_size) return m_capacity;
+
+            const UINT64 mask{ m_capacity - 1 };
+            UINT64 index{ hash & mask };
+            for (UINT distance{ 1 }; distance <= max_distance; ++distance)
+            {
+                const UINT8 slot_distance{ m_distances[index] };
+                // An empty slot, or one closer to its home than we would be: the key isn't here.
+                if (slot_distance < distance) break;
+                if (slot_distance == distance && m_slots[index].first == key) return index;
+                index = (index + 1) & mask;
+            }
+
+            return m_capacity;
+        }
+
+        [[nodiscard]] constexpr UINT64 next_used(UINT64 index) const
+        {
+            while (index < m_capacity && !m_distances[index]) ++index;
+            return index;
+        }
+
+        // Inserts a key that isn't in the map yet. Returns its slot index.
+        template<typename... params>
+        UINT64 insert_new(UINT64 hash, const K& key, params&&... p)
+        {
+            if ((m_size + 1) * 5 > m_capacity * 4) // keep the load factor under 80%
+            {
+                rehash(m_capacity ? m_capacity << 1 : min_capacity);
+            }
+
+            while (true)
+            {
+                const UINT64 mask{ m_capacity - 1 };
+                UINT64 index{ hash & mask };
+                UINT distance{ 1 };
+
+                // Skip the items that are further from their home than we are.
+                while (distance <= max_distance && m_distances[index] >= distance)
+                {
+                    index = (index + 1) & mask;
+                    ++distance;
+                }
+
+                // Find the end of the cluster. Every item in [index, empty) moves one slot up.
+                UINT64 empty{ index };
+                bool overflow{ distance > max_distance };
+                while (!overflow && m_distances[empty])
+                {
+                    overflow = m_distances[empty] == max_distance;
+                    empty = (empty + 1) & mask;
+                }
+
+                if (overflow)
+                {
+                    // Very long probe. Only happens with a poor hash, growing spreads the keys again.
+                    assert(m_size * 16 >= m_capacity); // the hash gives the same value for too many keys.
+                    rehash(m_capacity << 1);
+                    continue;
+                }
+
+                while (empty != index)
+                {
+                    const UINT64 previous{ (empty - 1) & mask };
+                    new (std::addressof(m_slots[empty])) value_type(std::move(m_slots[previous]));
+                    m_slots[previous].~value_type();
+                    m_distances[empty] = m_distances[previous] + 1;
+                    empty = previous;
+                }
+
+                new (std::addressof(m_slots[index])) value_type(std::piecewise_construct,
+                    std::forward_as_tuple(key), std::forward_as_tuple(std::forward<params>(p)...));
+                m_distances[index] = (UINT8)distance;
+                ++m_size;
+                return index;
+            }
+        }
+
+        // Backward shift deletion: the items after the erased one move back towards their home,
+        // so no tombstones are needed.
+        constexpr void erase_at(UINT64 index)
+        {
+            assert(index < m_capacity && m_distances[index]);
+            const UINT64 mask{ m_capacity - 1 };
+            m_slots[index].~value_type();
+
+            UINT64 next{ (index + 1) & mask };
+            while (m_distances[next] > 1)
+            {
+                new (std::addressof(m_slots[index])) value_type(std::move(m_slots[next]));
+                m_slots[next].~value_type();
+                m_distances[index] = m_distances[next] - 1;
+                index = next;
+                next = (next + 1) & mask;
+            }
+
+            m_distances[index] = 0;
+            --m_size;
+        }
+
+        void rehash(UINT64 new_capacity)
+        {
+            assert(new_capacity && !(new_capacity & (new_capacity - 1)));
+            value_type* const old_slots{ m_slots };
+            UINT8* const old_distances{ m_distances };
+            const UINT64 old_capacity{ m_capacity };
+
+            // Slots and distances share one allocation.
+            void* const memory{ ::operator new(new_capacity * (sizeof(value_type) + 1), std::align_val_t{ alignment }) };
+            m_slots = (value_type*)memory;
+            m_distances = (UINT8*)&m_slots[new_capacity];
+            memset(m_distances, 0, new_capacity);
+            m_capacity = new_capacity;
+            m_size = 0;
+
+            for (UINT64 i{ 0 }; i < old_capacity; ++i)
+            {
+                if (old_distances[i])
+                {
+                    value_type& item{ old_slots[i] };
+                    insert_new(hash_of(item.first), item.first, std::move(item.second));
+                    item.~value_type();
+                }
+            }
+
+            if (old_slots) ::operator delete(old_slots, std::align_val_t{ alignment });
+        }
+
+        constexpr void move(flat_hash_map& o)
+        {
+            m_slots = o.m_slots;
+            m_distances = o.m_distances;
+            m_capacity = o.m_capacity;
+            m_size = o.m_size;
+            o.m_slots = nullptr;
+            o.m_distances = nullptr;
+            o.m_capacity = 0;
+            o.m_size = 0;
+        }
+
+        constexpr void destroy()
+        {
+            clear();
+            if (m_slots) ::operator delete(m_slots, std::align_val_t{ alignment });
+            m_slots = nullptr;
+            m_distances = nullptr;
+            m_capacity = 0;
+        }
+
+        value_type*     m_slots{ nullptr };
+        UINT8*          m_distances{ nullptr };   // NOTE: stored right after the slots.
+        UINT64          m_capacity{ 0 };          // always a power of 2
+        UINT64          m_size{ 0 };
+    };
+}
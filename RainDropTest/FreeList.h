@@ -3,6 +3,7 @@
 #pragma once
 #include "stdafx.h"
 #include "Vector.h"
+#include "Id.h"
 
 namespace utl {
 
@@ -10,7 +11,83 @@ namespace utl {
 #pragma message("WARNING: using utl::free_list with std::vector result in duplicate calls to class destructor!")
 #endif
 
-    template<typename T>
+    namespace detail {
+        // Backing store for paged free lists. Items are placed in fixed-size pages that are never
+        // reallocated, so their addresses stay valid until they're removed. Growing only adds a page.
+        // Like utl::vector<T, false>, it never calls the items' destructors.
+        template<typename T>
+        class paged_storage
+        {
+        public:
+            static constexpr UINT page_shift{ 8 };
+            static constexpr UINT page_size{ 1u << page_shift };
+            static constexpr UINT page_mask{ page_size - 1 };
+
+            paged_storage() = default;
+            DISABLE_COPY_AND_MOVE(paged_storage);
+
+            ~paged_storage()
+            {
+                for (T* const page : _pages)
+                {
+                    ::operator delete(page, std::align_val_t{ alignof(T) });
+                }
+            }
+
+            // Allocates pages until at least 'count' items fit.
+            constexpr void reserve(UINT64 count)
+            {
+                while (capacity() < count)
+                {
+                    add_page();
+                }
+            }
+
+            template<typename... params>
+            constexpr T& emplace_back(params&&... p)
+            {
+                if (_size == capacity())
+                {
+                    add_page();
+                }
+                T* const item{ new (std::addressof((*this)[_size])) T(std::forward<params>(p)...) };
+                ++_size;
+                return *item;
+            }
+
+            [[nodiscard]] constexpr UINT64 size() const { return _size; }
+            [[nodiscard]] constexpr UINT64 capacity() const { return _pages.size() << page_shift; }
+
+            [[nodiscard]] constexpr T& operator[](UINT64 index)
+            {
+                assert(index < capacity());
+                return _pages[index >> page_shift][index & page_mask];
+            }
+
+            [[nodiscard]] constexpr const T& operator[](UINT64 index) const
+            {
+                assert(index < capacity());
+                return _pages[index >> page_shift][index & page_mask];
+            }
+
+        private:
+            void add_page()
+            {
+                _pages.emplace_back((T*)::operator new(sizeof(T) * page_size, std::align_val_t{ alignof(T) }));
+            }
+
+            utl::vector<T*>     _pages;
+            UINT64              _size{ 0 };
+        };
+    } // namespace detail
+
+    // NOTE: with 'generational' set, ids returned by add() carry a generation tag (see utl::id) and
+    //       stale ids are caught by is_valid() in release builds too. Lists that share ids (adding and
+    //       removing in lockstep) must all use the same mode.
+    //       with 'paged' set, items are stored in fixed-size pages instead of one contiguous array.
+    //       Their addresses never change, so pointers to items stay valid while other items are
+    //       added, and growing the list doesn't copy the existing items.
+    template<typename T, bool generational = false, bool paged = false>
     class free_list
     {
         static_assert(sizeof(T) >= sizeof(UINT));
@@ -23,6 +100,35 @@ namespace utl {
             m_array.reserve(count);
         }
 
+        DISABLE_COPY(free_list);
+
+        // NOTE: containers that move their items (utl::vector, utl::flat_hash_map) need this. Without it the
+        //       list would be copied, and the destructor of the non-empty original would assert.
+        constexpr free_list(free_list&& o)
+            : m_array{ std::move(o.m_array) }, m_generations{ std::move(o.m_generations) },
+            m_next_free_index{ o.m_next_free_index }, m_size{ o.m_size }, m_list_index{ o.m_list_index }
+        {
+            o.m_next_free_index = Invalid_Index;
+            o.m_size = 0;
+        }
+
+        constexpr free_list& operator=(free_list&& o)
+        {
+            assert(this != std::addressof(o));
+            if (this != std::addressof(o))
+            {
+                assert(!m_size); // the items in this list would be lost.
+                m_array = std::move(o.m_array);
+                m_generations = std::move(o.m_generations);
+                m_next_free_index = o.m_next_free_index;
+                m_size = o.m_size;
+                m_list_index = o.m_list_index;
+                o.m_next_free_index = Invalid_Index;
+                o.m_size = 0;
+            }
+            return *this;
+        }
+
         ~free_list()
         {
             if (m_size)
@@ -42,20 +148,53 @@ namespace utl {
             {
                 id = (UINT)m_array.size();
                 m_array.emplace_back(std::forward<params>(p)...);
+                if constexpr (generational)
+                {
+                    m_generations.emplace_back(0);
+                }
             }
             else
             {
                 id = m_next_free_index;
-                assert(id < m_array.size() && already_removed(id, true));
+                if constexpr (generational)
+                {
+                    // NOTE: the generations already tell live slots from free ones, see is_valid().
+                    assert(id < m_array.size());
+                }
+                else
+                {
+                    assert(id < m_array.size() && already_removed(id, true));
+                }
                 m_next_free_index = *(const UINT* const)std::addressof(m_array[id]);
                 new (std::addressof(m_array[id])) T(std::forward<params>(p)...);
             }
             ++m_size;
-            return id;
+
+            if constexpr (generational)
+            {
+                return id::make(id, m_generations[id]);
+            }
+            else
+            {
+                return id;
+            }
         }
 
         constexpr void remove(UINT id)
         {
+            if constexpr (generational)
+            {
+                assert(is_valid(id));
+                const UINT index{ id::index(id) };
+                m_array[index].~T();
+                // Retire the slot's current generation so every id handed out for it becomes stale.
+                m_generations[index] = (UINT8)((m_generations[index] + 1) & id::generation_mask);
+                *(UINT* const)std::addressof(m_array[index]) = m_next_free_index;
+                m_next_free_index = index;
+                --m_size;
+                return;
+            }
+
             assert(id < m_array.size() && !already_removed(id, false));
             T& item{ m_array[id] };
             item.~T();
@@ -80,19 +219,54 @@ namespace utl {
             return m_size == 0;
         }
 
+        // O(1) check that 'id' refers to a live item. Only available for generational lists.
+        [[nodiscard]] constexpr bool is_valid(UINT id) const
+        {
+            static_assert(generational, "is_valid() needs generation-tagged ids.");
+            const UINT index{ id::index(id) };
+            return index < m_generations.size() && m_generations[index] == id::generation(id);
+        }
+
+        // Returns the item, or nullptr if 'id' is stale. Unlike operator[], this is checked in release builds too.
+        [[nodiscard]] constexpr T* get(UINT id)
+        {
+            return is_valid(id) ? std::addressof(m_array[id::index(id)]) : nullptr;
+        }
+
+        [[nodiscard]] constexpr const T* get(UINT id) const
+        {
+            return is_valid(id) ? std::addressof(m_array[id::index(id)]) : nullptr;
+        }
+
         [[nodiscard]] constexpr T& operator[](UINT id)
         {
-            if (id >= m_array.size() || already_removed(id, false))
+            if constexpr (generational)
             {
-                assert(id < m_array.size() && !already_removed(id, false));
+                assert(is_valid(id));
+                return m_array[id::index(id)];
+            }
+            else
+            {
+                if (id >= m_array.size() || already_removed(id, false))
+                {
+                    assert(id < m_array.size() && !already_removed(id, false));
+                }
+                return m_array[id];
             }
-            return m_array[id];
         }
 
         [[nodiscard]] constexpr const T& operator[](UINT id) const
         {
-            assert(id < m_array.size() && !already_removed(id, false));
-            return m_array[id];
+            if constexpr (generational)
+            {
+                assert(is_valid(id));
+                return m_array[id::index(id)];
+            }
+            else
+            {
+                assert(id < m_array.size() && !already_removed(id, false));
+                return m_array[id];
+            }
         }
 
     private:
@@ -103,7 +277,7 @@ namespace utl {
             {
                 UINT i{ sizeof(UINT) }; //skip the first 4 bytes.
                 const UINT8* const p{ (const UINT8* const)std::addressof(m_array[id]) };
-                while ((p[i] == 0xcc) && (i < sizeof(T))) ++i;
+                while ((i < sizeof(T)) && (p[i] == 0xcc)) ++i;
                 return i == sizeof(T);
             }
             else
@@ -114,10 +288,199 @@ namespace utl {
 #if USE_STL_VECTOR
         utl::vector<T>          m_array;
 #else
-        utl::vector<T, false>   m_array;
+        std::conditional_t<paged, detail::paged_storage<T>, utl::vector<T, false>> m_array;
 #endif
+        utl::vector<UINT8>       m_generations; // NOTE: only used by generational lists.
         UINT                     m_next_free_index{ Invalid_Index };
         UINT                     m_size{ 0 };
-        UINT                     m_list_index;
+        UINT                     m_list_index{ Invalid_Index };
+    };
+
+    // Free list in sparse-set layout. Items are kept packed in a dense array and ids map to dense
+    // indices through a sparse array, so all live items can be iterated without skipping holes.
+    // remove() moves the last item into the freed spot.
+    // NOTE: unlike free_list, items move when others are removed. Don't keep pointers to them.
+    //       with 'generational' set, ids carry a generation tag as in free_list and contains() rejects stale ids.
+    template<typename T, bool generational = false>
+    class sparse_free_list
+    {
+    public:
+        sparse_free_list() = default;
+        sparse_free_list(UINT list_index) : m_list_index{ list_index } {}
+        explicit sparse_free_list(UINT count, UINT list_index)
+        {
+            m_list_index = list_index;
+            m_dense.reserve(count);
+            m_dense_ids.reserve(count);
+            m_sparse.reserve(count);
+        }
+
+        DISABLE_COPY(sparse_free_list);
+
+        // NOTE: see free_list. Lists that live in containers are moved, not copied.
+        constexpr sparse_free_list(sparse_free_list&& o)
+            : m_dense{ std::move(o.m_dense) }, m_dense_ids{ std::move(o.m_dense_ids) }, m_sparse{ std::move(o.m_sparse) },
+            m_generations{ std::move(o.m_generations) }, m_next_free_id{ o.m_next_free_id }, m_list_index{ o.m_list_index }
+        {
+            o.m_next_free_id = Invalid_Index;
+        }
+
+        constexpr sparse_free_list& operator=(sparse_free_list&& o)
+        {
+            assert(this != std::addressof(o));
+            if (this != std::addressof(o))
+            {
+                assert(empty()); // the items in this list would be lost.
+                m_dense = std::move(o.m_dense);
+                m_dense_ids = std::move(o.m_dense_ids);
+                m_sparse = std::move(o.m_sparse);
+                m_generations = std::move(o.m_generations);
+                m_next_free_id = o.m_next_free_id;
+                m_list_index = o.m_list_index;
+                o.m_next_free_id = Invalid_Index;
+            }
+            return *this;
+        }
+
+        ~sparse_free_list()
+        {
+            assert(!size());
+        }
+
+        template<class... params>
+        constexpr UINT add(params&&... p)
+        {
+            UINT index{ m_next_free_id };
+            if (index == Invalid_Index)
+            {
+                index = (UINT)m_sparse.size();
+                assert(index < free_bit);
+                m_sparse.emplace_back();
+                if constexpr (generational)
+                {
+                    m_generations.emplace_back(0);
+                }
+            }
+            else
+            {
+                assert(index < m_sparse.size() && (m_sparse[index] & free_bit));
+                const UINT next{ m_sparse[index] & ~free_bit };
+                m_next_free_id = (next == end_of_chain) ? Invalid_Index : next;
+            }
+
+            UINT id{ index };
+            if constexpr (generational)
+            {
+                id = id::make(index, m_generations[index]);
+            }
+
+            m_sparse[index] = (UINT)m_dense.size();
+            m_dense.emplace_back(std::forward<params>(p)...);
+            m_dense_ids.emplace_back(id);
+            return id;
+        }
+
+        constexpr void remove(UINT id)
+        {
+            assert(contains(id));
+            const UINT index{ slot_index(id) };
+            const UINT dense_index{ m_sparse[index] };
+            const UINT last_id{ m_dense_ids.back() };
+
+            m_dense.erase_unordered(dense_index);
+            m_dense_ids.erase_unordered(dense_index);
+            m_sparse[slot_index(last_id)] = dense_index;
+
+            if constexpr (generational)
+            {
+                m_generations[index] = (UINT8)((m_generations[index] + 1) & id::generation_mask);
+            }
+            m_sparse[index] = free_bit | ((m_next_free_id == Invalid_Index) ? end_of_chain : m_next_free_id);
+            m_next_free_id = index;
+        }
+
+        // O(1) check that 'id' refers to a live item.
+        [[nodiscard]] constexpr bool contains(UINT id) const
+        {
+            const UINT index{ slot_index(id) };
+            if (index >= m_sparse.size() || (m_sparse[index] & free_bit)) return false;
+            if constexpr (generational)
+            {
+                return m_generations[index] == id::generation(id);
+            }
+            else
+            {
+                return true;
+            }
+        }
+
+        // Returns the item, or nullptr if 'id' isn't live. Checked in release builds too.
+        [[nodiscard]] constexpr T* get(UINT id)
+        {
+            return contains(id) ? std::addressof(m_dense[m_sparse[slot_index(id)]]) : nullptr;
+        }
+
+        [[nodiscard]] constexpr const T* get(UINT id) const
+        {
+            return contains(id) ? std::addressof(m_dense[m_sparse[slot_index(id)]]) : nullptr;
+        }
+
+        constexpr UINT size() const
+        {
+            return (UINT)m_dense.size();
+        }
+
+        constexpr UINT capacity() const
+        {
+            return (UINT)m_sparse.size();
+        }
+
+        constexpr bool empty() const
+        {
+            return m_dense.empty();
+        }
+
+        [[nodiscard]] constexpr T& operator[](UINT id)
+        {
+            assert(contains(id));
+            return m_dense[m_sparse[slot_index(id)]];
+        }
+
+        [[nodiscard]] constexpr const T& operator[](UINT id) const
+        {
+            assert(contains(id));
+            return m_dense[m_sparse[slot_index(id)]];
+        }
+
+        // Id of the item at 'index' in the dense array, i.e. the id of *(begin() + index).
+        [[nodiscard]] constexpr UINT id_at(UINT index) const
+        {
+            assert(index < m_dense_ids.size());
+            return m_dense_ids[index];
+        }
+
+        // Iterates over the live items only.
+        [[nodiscard]] constexpr T* begin() { return m_dense.begin(); }
+        [[nodiscard]] constexpr const T* begin() const { return m_dense.begin(); }
+        [[nodiscard]] constexpr T* end() { return m_dense.end(); }
+        [[nodiscard]] constexpr const T* end() const { return m_dense.end(); }
+
+    private:
+        // Set in the sparse entry of a free id. The rest of the bits link to the next free id.
+        static constexpr UINT free_bit{ 0x80000000 };
+        static constexpr UINT end_of_chain{ ~free_bit };
+
+        [[nodiscard]] static constexpr UINT slot_index(UINT id)
+        {
+            if constexpr (generational) return id::index(id);
+            else return id;
+        }
+
+        utl::vector<T>          m_dense;
+        utl::vector<UINT>       m_dense_ids;
+        utl::vector<UINT>       m_sparse;
+        utl::vector<UINT8>      m_generations; // NOTE: only used by generational lists.
+        UINT                    m_next_free_id{ Invalid_Index };
+        UINT                    m_list_index{ Invalid_Index };
     };
 }
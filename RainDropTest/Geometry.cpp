@@ -2,66 +2,44 @@
 #include "Geometry.h"
 #include "Entity.h"
 #include "Vector.h"
-#include "AppItems.h"
 #include "Content.h"
-#include <deque>
 
 namespace geometry {
-    namespace {
-        utl::vector<UINT> active_lod;
-        utl::vector<UINT> geometry_item_ids;
-        utl::vector<UINT> owner_ids;
-        utl::vector<UINT> id_mapping;
-
-        //utl::vector<UINT> generations;
-        std::deque<UINT> free_ids;
-
-    } // anonymous namespace
 
+    // NOTE: the render item and LOD of a geometry are in its entity's chunk (see game_entity::chunk_view).
+    //       At most one geometry per entity, so the component's id is the entity's index.
     component create(init_info info, game_entity::entity entity)
     {
         assert(entity.get_id() != Invalid_Index);
         assert(info.geometry_content_id != Invalid_Index && info.material_count && info.material_ids);
 
-        UINT id{};
-        if (free_ids.size() > app::min_deleted_elements)
-        {
-            id = free_ids.front();
-            free_ids.pop_front();
-        }
-        else
-        {
-            id = (UINT)id_mapping.size();
-            id_mapping.emplace_back();
-        }
-
-        assert(id != Invalid_Index);
-        UINT index{ (UINT)geometry_item_ids.size() };
-        active_lod.emplace_back(0);
-        geometry_item_ids.emplace_back(content::render_item::add(entity.get_id(), info.geometry_content_id, info.material_count, info.material_ids));
-        owner_ids.emplace_back(id);
-        id_mapping[id] = index;
+        const UINT id{ game_entity::id::index(entity.get_id()) };
+        UINT row;
+        const game_entity::chunk_view chunk{ game_entity::detail::find_row(id, row) };
+        assert(chunk.render_item_ids);
+        chunk.active_lods[row] = 0;
+        chunk.render_item_ids[row] = content::render_item::add(entity.get_id(), info.geometry_content_id, info.material_count, info.material_ids);
         return component{ id };
     }
 
     void remove(component c)
     {
         assert(c.is_valid());
-        const UINT id{ c.get_id() };
-        const UINT index{ id_mapping[id] };
-        const UINT last_id{ owner_ids.back() };
-        content::render_item::remove(geometry_item_ids[index]);
-        active_lod.erase_unordered(index);
-        geometry_item_ids.erase_unordered(index);
-        owner_ids.erase_unordered(index);
-        id_mapping[last_id] = index;
-        id_mapping[id] = Invalid_Index;
-        free_ids.push_back(id);
+        UINT row;
+        const game_entity::chunk_view chunk{ game_entity::detail::find_row(c.get_id(), row) };
+        assert(chunk.render_item_ids);
+        content::render_item::remove(chunk.render_item_ids[row]);
+        chunk.render_item_ids[row] = Invalid_Index;
     }
 
-    void get_geometry_item_ids(UINT* const item_ids, UINT count)
+    void get_render_item_ids(utl::vector<UINT>& item_ids)
     {
-        assert(geometry_item_ids.size() >= count);
-        memcpy(item_ids, geometry_item_ids.data(), count * sizeof(UINT));
+        item_ids.clear();
+        game_entity::for_each_chunk(game_entity::component_type::geometry, [&item_ids](const game_entity::chunk_view& chunk) {
+            assert(chunk.render_item_ids);
+            const UINT first{ (UINT)item_ids.size() };
+            item_ids.resize_uninitialized(first + chunk.count);
+            memcpy(&item_ids[first], chunk.render_item_ids, chunk.count * sizeof(UINT));
+            });
     }
 }
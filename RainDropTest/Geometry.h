@@ -1,5 +1,6 @@
 #pragma once
 #include "stdafx.h"
+#include "Vector.h"
 
 namespace game_entity {
     class entity;
@@ -27,5 +28,7 @@ namespace geometry {
 
     component create(init_info info, game_entity::entity entity);
     void remove(component c);
-    void get_geometry_item_ids(UINT* const item_ids, UINT count);
+    // Replaces 'item_ids' with the render item ids of every entity that has a geometry, chunk by chunk
+    // (see game_entity::for_each_chunk()). Call it once per frame, when no entities are being created or removed.
+    void get_render_item_ids(utl::vector<UINT>& item_ids);
 }
@@ -0,0 +1,115 @@
+#pragma once
+#include "stdafx.h"
+#include "DrawList.h"
+
+namespace gpu {
+
+    // Same as resource::Texture_Buffer::max_mips.
+    constexpr UINT max_texture_mips{ 14 };
+
+    // A buffer the GPU reads. 'cpu_address' is only set for upload buffers, which stay mapped.
+    struct buffer
+    {
+        void* handle{ nullptr };
+        D3D12_GPU_VIRTUAL_ADDRESS gpu_address{ 0 };
+        UINT8* cpu_address{ nullptr };
+        UINT size{ 0 };
+    };
+
+    // A texture with its shader resource view in the shader visible descriptor heap.
+    struct texture
+    {
+        void* handle{ nullptr };
+        UINT descriptor_index{ Invalid_Index };
+    };
+
+    struct subresource_data
+    {
+        const void* data;
+        UINT64 row_pitch;
+        UINT64 slice_pitch;
+    };
+
+    struct texture_desc
+    {
+        // array_size * mip_levels subresources, all mips of the first array slice first.
+        const subresource_data* subresources{ nullptr };
+        UINT width{ 0 };
+        UINT height{ 0 };
+        UINT depth{ 1 };
+        UINT array_size{ 1 };
+        UINT mip_levels{ 1 };
+        DXGI_FORMAT format{ DXGI_FORMAT_UNKNOWN };
+        bool is_volume_map{ false };
+        bool is_cube_map{ false };
+    };
+
+    struct pipeline_pass {
+        enum pass : UINT {
+            depth,
+            graphic,
+
+            count
+        };
+    };
+
+    // What the pipeline state of a render item depends on.
+    // NOTE: hashed and compared byte for byte, so there's no padding.
+    struct pipeline_state_desc
+    {
+        ID3D12RootSignature* root_signature{ nullptr };
+        UINT elements_type{ 0 };
+        UINT shader_flags{ 0 };
+        D3D_PRIMITIVE_TOPOLOGY primitive_topology{};
+        pipeline_pass::pass pass{ pipeline_pass::graphic };
+    };
+    static_assert(sizeof(pipeline_state_desc) == sizeof(void*) + 4 * sizeof(UINT));
+
+    // The buffers, textures, pipeline states and descriptors that content, lights and graphic_pass create.
+    // Like command::command_list, the renderer goes through this interface so the same code runs without a
+    // GPU: D3D12Device.h creates them with D3D12, and NullDevice.h only hands out handles and addresses
+    // (see bench/FrameBench.cpp).
+    // NOTE: only takes the D3D12 types that the bench's stdafx.h also declares. All functions are thread-safe.
+    class device
+    {
+    public:
+        virtual ~device() = default;
+
+        // A default heap buffer with 'data' uploaded to it.
+        [[nodiscard]] virtual buffer create_buffer(const void* const data, UINT size) = 0;
+        // A buffer in the upload heap, mapped until it's released. The size is aligned to 256 bytes.
+        [[nodiscard]] virtual buffer create_upload_buffer(UINT size) = 0;
+        // NOTE: the GPU may still use the buffer in the frames in flight, so it's released once they're done.
+        virtual void release_buffer(buffer& b) = 0;
+
+        [[nodiscard]] virtual texture create_texture(const texture_desc& desc) = 0;
+        virtual void release_texture(texture& t) = 0;
+
+        [[nodiscard]] virtual ID3D12RootSignature* create_root_signature(content::material_type::type type, UINT shader_flags) = 0;
+        [[nodiscard]] virtual ID3D12PipelineState* create_pipeline_state(const pipeline_state_desc& desc) = 0;
+        // NOTE: released right away, so only when no frame uses them anymore.
+        virtual void release_root_signature(ID3D12RootSignature* root_signature) = 0;
+        virtual void release_pipeline_state(ID3D12PipelineState* pipeline_state) = 0;
+
+        // The current frame's constant buffer, which is cleared at the start of each frame.
+        // Allocations are aligned to 256 bytes.
+        [[nodiscard]] virtual UINT8* allocate_constants(UINT size) = 0;
+        [[nodiscard]] virtual D3D12_GPU_VIRTUAL_ADDRESS constants_gpu_address(const void* const allocation) = 0;
+
+        template<typename T>
+        [[nodiscard]] T* allocate_constants() { return (T*)allocate_constants(sizeof(T)); }
+    };
+
+    namespace detail {
+        inline device* current_device{ nullptr };
+    }
+
+    // core::initialize() makes the D3D12 device current, and frame_bench a null_device.
+    inline void set_current(device* const d) { detail::current_device = d; }
+
+    [[nodiscard]] inline device& current()
+    {
+        assert(detail::current_device);
+        return *detail::current_device;
+    }
+}
@@ -0,0 +1,163 @@
+#include "GraphicCache.h"
+#include "GpuDevice.h"
+#include "SharedTypes.h"
+#include "Transform.h"
+#include "Jobs.h"
+
+namespace graphic_pass
+{
+    namespace {
+
+        // First render item of each run of items that share an entity, and where its per object data goes.
+        struct entity_run
+        {
+            UINT first_item;
+            hlsl::PerObjectData* data;
+        };
+
+    } // anonymous namespace
+
+    void graphic_cache::clear()
+    {
+        // NOTE: the ids and items were allocated from an arena that has been reset since, so only drop them.
+        d3d12_render_item_ids = {};
+        m_items = {};
+        descriptor_index_count = 0;
+    }
+
+    void graphic_cache::resize()
+    {
+        // One block for all the arrays, each array aligned to 16 bytes. It comes from the frame arena,
+        // so there's nothing to free. All arrays are filled by get_items() and process_items().
+        m_items.resize_uninitialized(d3d12_render_item_ids.size());
+
+        entity_ids = m_items.data<0>();
+        sub_mesh_gpu_ids = m_items.data<1>();
+        material_ids = m_items.data<2>();
+        graphic_pipeline_states = m_items.data<3>();
+        depth_pipeline_states = m_items.data<4>();
+        root_signatures = m_items.data<5>();
+        material_types = m_items.data<6>();
+        descriptor_indices = m_items.data<7>();
+        texture_counts = m_items.data<8>();
+        material_surfaces = m_items.data<9>();
+        position_buffers = m_items.data<10>();
+        element_buffers = m_items.data<11>();
+        index_buffer_views = m_items.data<12>();
+        primitive_topologies = m_items.data<13>();
+        elements_types = m_items.data<14>();
+        per_object_data = m_items.data<15>();
+        srv_indices = m_items.data<16>();
+    }
+
+    void gather_render_items(const UINT* const render_item_ids, const float* const thresholds, UINT render_item_count, graphic_cache& cache)
+    {
+        assert(render_item_ids && render_item_count);
+        cache.clear();
+
+        content::render_item::get_d3d12_render_item_ids(render_item_ids, thresholds, render_item_count, cache.d3d12_render_item_ids);
+        cache.resize();
+
+        const UINT items_count{ cache.size() };
+        content::render_item::get_items(cache.d3d12_render_item_ids.data(), items_count, cache);
+
+        content::sub_mesh::get_views(items_count, cache);
+
+        content::material::get_materials(items_count, cache);
+    }
+
+    void fill_per_object_data(graphic_cache& cache, const XMFLOAT4X4& view_projection)
+    {
+        const UINT render_items_count{ (UINT)cache.size() };
+        UINT current_entity_id{ Invalid_Index };
+        hlsl::PerObjectData* current_data_pointer{ nullptr };
+
+        gpu::device& device{ gpu::current() };
+
+        // Allocating from the constant buffer is cheap but serial, so hand out the
+        // blocks first and leave the matrix math to the job threads.
+        utl::frame_vector<entity_run> entity_runs;
+        entity_runs.reserve(render_items_count);
+        for (UINT i{ 0 }; i < render_items_count; ++i)
+        {
+            if (current_entity_id != cache.entity_ids[i])
+            {
+                current_entity_id = cache.entity_ids[i];
+                current_data_pointer = device.allocate_constants<hlsl::PerObjectData>();
+                entity_runs.emplace_back(entity_run{ i, current_data_pointer });
+            }
+            assert(current_data_pointer);
+            cache.per_object_data[i] = device.constants_gpu_address(current_data_pointer);
+        }
+
+        // The jobs below only read the matrices, so the ones that are missing are computed first.
+        transform::calculate_missing_matrices(cache.entity_ids, render_items_count);
+
+        const XMMATRIX view_projection_matrix{ XMLoadFloat4x4(&view_projection) };
+        jobs::parallel_for((UINT)entity_runs.size(), 64, [&cache, &entity_runs, &view_projection_matrix](UINT begin, UINT end) {
+            for (UINT run{ begin }; run < end; ++run)
+            {
+                const UINT i{ entity_runs[run].first_item };
+                hlsl::PerObjectData data{};
+                transform::get_transform_matrices(cache.entity_ids[i], data.World, data.InvWorld);
+                XMMATRIX world{ XMLoadFloat4x4(&data.World) };
+                XMMATRIX wvp{ XMMatrixMultiply(world, view_projection_matrix) };
+                XMStoreFloat4x4(&data.WorldViewProjection, wvp);
+
+                const content::material_surface* const surface{ cache.material_surfaces[i] };
+                memcpy(&data.BaseColor, surface, sizeof(content::material_surface));
+
+                memcpy(entity_runs[run].data, &data, sizeof(hlsl::PerObjectData));
+            }
+            });
+    }
+
+    void fill_srv_indices(graphic_cache& cache)
+    {
+        if (!cache.descriptor_index_count) return;
+
+        gpu::device& device{ gpu::current() };
+        const UINT items_count{ cache.size() };
+        const UINT size{ cache.descriptor_index_count * sizeof(UINT) };
+        UINT* const srv_indices{ (UINT* const)device.allocate_constants(size) };
+        UINT srv_index_offset{ 0 };
+
+        for (UINT i{ 0 }; i < items_count; ++i)
+        {
+            const UINT texture_count{ cache.texture_counts[i] };
+            cache.srv_indices[i] = 0;
+
+            if (texture_count)
+            {
+                memcpy(&srv_indices[srv_index_offset], cache.descriptor_indices[i], texture_count * sizeof(UINT));
+                cache.srv_indices[i] = device.constants_gpu_address(srv_indices + srv_index_offset);
+                srv_index_offset += texture_count;
+            }
+        }
+    }
+
+    void prepare_render_frame(const UINT* const render_item_ids, const float* const thresholds, UINT render_item_count,
+        const XMFLOAT4X4& view_projection, graphic_cache& cache)
+    {
+        gather_render_items(render_item_ids, thresholds, render_item_count, cache);
+        fill_per_object_data(cache, view_projection);
+        fill_srv_indices(cache);
+    }
+
+    draw_list get_draw_list(const graphic_cache& cache, ID3D12PipelineState* const* const pipeline_states)
+    {
+        draw_list list{};
+        list.count = cache.size();
+        list.pipeline_states = pipeline_states;
+        list.root_signatures = cache.root_signatures;
+        list.material_types = cache.material_types;
+        list.texture_counts = cache.texture_counts;
+        list.position_buffers = cache.position_buffers;
+        list.element_buffers = cache.element_buffers;
+        list.index_buffer_views = cache.index_buffer_views;
+        list.primitive_topologies = cache.primitive_topologies;
+        list.per_object_data = cache.per_object_data;
+        list.srv_indices = cache.srv_indices;
+        return list;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "stdafx.h"
+#include "Arena.h"
+#include "SoaVector.h"
+#include "Content.h"
+#include "DrawList.h"
+
+namespace graphic_pass {
+
+    // Rebuilt every frame from the current frame arena (see utl::frame_arena()).
+    struct graphic_cache
+    {
+        utl::frame_vector<UINT> d3d12_render_item_ids;
+        UINT descriptor_index_count{ 0 };
+
+        // allocated items
+        // TODO: add const
+        // items_cache
+        UINT* entity_ids{ nullptr };
+        UINT* sub_mesh_gpu_ids{ nullptr };
+        UINT* material_ids{ nullptr };
+        ID3D12PipelineState** graphic_pipeline_states{ nullptr };
+        ID3D12PipelineState** depth_pipeline_states{ nullptr };
+        // material_cache
+        ID3D12RootSignature** root_signatures{ nullptr };
+        content::material_type::type* material_types{ nullptr };
+        UINT** descriptor_indices{ nullptr };
+        UINT* texture_counts{ nullptr };
+        content::material_surface** material_surfaces{ nullptr };
+        // views_cache
+        D3D12_GPU_VIRTUAL_ADDRESS* position_buffers{ nullptr };
+        D3D12_GPU_VIRTUAL_ADDRESS* element_buffers{ nullptr };
+        D3D12_INDEX_BUFFER_VIEW* index_buffer_views{ nullptr };
+        D3D_PRIMITIVE_TOPOLOGY* primitive_topologies{ nullptr };
+        UINT* elements_types{ nullptr };
+
+        D3D12_GPU_VIRTUAL_ADDRESS* per_object_data{ nullptr };
+        D3D12_GPU_VIRTUAL_ADDRESS* srv_indices{ nullptr };
+
+        [[nodiscard]] UINT size() const { return (UINT)d3d12_render_item_ids.size(); }
+        void clear();
+        void resize();
+
+    private:
+        // One column per array above, in the same order. resize() points the arrays at the columns.
+        utl::basic_soa_vector<utl::frame_allocator,
+            UINT,                                   // entity_ids
+            UINT,                                   // sub_mesh_gpu_ids
+            UINT,                                   // material_ids
+            ID3D12PipelineState*,                   // graphic_pipeline_states
+            ID3D12PipelineState*,                   // depth_pipeline_states
+            ID3D12RootSignature*,                   // root_signatures
+            content::material_type::type,           // material_types
+            UINT*,                                  // descriptor_indices
+            UINT,                                   // texture_counts
+            content::material_surface*,             // material_surfaces
+            D3D12_GPU_VIRTUAL_ADDRESS,              // position_buffers
+            D3D12_GPU_VIRTUAL_ADDRESS,              // element_buffers
+            D3D12_INDEX_BUFFER_VIEW,                // index_buffer_views
+            D3D_PRIMITIVE_TOPOLOGY,                 // primitive_topologies
+            UINT,                                   // elements_types
+            D3D12_GPU_VIRTUAL_ADDRESS,              // per_object_data
+            D3D12_GPU_VIRTUAL_ADDRESS               // srv_indices
+        > m_items;
+    };
+
+    // NOTE: prepare_render_frame() is the three steps below, in order. depth_process() calls it every frame.
+    //       The per object data and srv indices go to gpu::current()'s constant buffer.
+
+    // Gathers the columns of the frame's render items, for the LOD of each item's threshold.
+    void gather_render_items(const UINT* const render_item_ids, const float* const thresholds, UINT render_item_count, graphic_cache& cache);
+    // One hlsl::PerObjectData per entity, shared by the entity's items.
+    void fill_per_object_data(graphic_cache& cache, const XMFLOAT4X4& view_projection);
+    // Copies the descriptor indices of the items' textures to one array.
+    void fill_srv_indices(graphic_cache& cache);
+    void prepare_render_frame(const UINT* const render_item_ids, const float* const thresholds, UINT render_item_count,
+        const XMFLOAT4X4& view_projection, graphic_cache& cache);
+
+    [[nodiscard]] draw_list get_draw_list(const graphic_cache& cache, ID3D12PipelineState* const* const pipeline_states);
+}
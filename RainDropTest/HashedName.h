@@ -0,0 +1,56 @@
+#pragma once
+#include "stdafx.h"
+#include <string_view>
+#include <functional>
+
+namespace utl {
+
+    // 64-bit FNV-1a. constexpr so names known at compile time cost nothing at run time.
+    [[nodiscard]] constexpr UINT64 fnv1a_64(std::string_view text)
+    {
+        UINT64 hash{ 0xcbf29ce484222325ull };
+        for (const char c : text)
+        {
+            hash ^= (UINT8)c;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Identifier made from a name, compared and hashed as a single 64-bit value.
+    // Built from a string literal it's always computed by the compiler (consteval), so code like
+    // bind(utl::hashed_name{ "move" }) doesn't touch the string at run time.
+    // A default-constructed name is invalid.
+    class hashed_name
+    {
+    public:
+        constexpr hashed_name() = default;
+
+        template<UINT64 N>
+        consteval hashed_name(const char(&name)[N]) : _hash{ fnv1a_64({ name, N - 1 }) }
+        {
+            assert(_hash);
+        }
+
+        // For names only known at run time.
+        constexpr explicit hashed_name(std::string_view name) : _hash{ fnv1a_64(name) } {}
+
+        [[nodiscard]] constexpr UINT64 value() const { return _hash; }
+        [[nodiscard]] constexpr bool is_valid() const { return _hash != 0; }
+
+        [[nodiscard]] constexpr bool operator==(const hashed_name& o) const { return _hash == o._hash; }
+        [[nodiscard]] constexpr bool operator!=(const hashed_name& o) const { return _hash != o._hash; }
+
+    private:
+        UINT64 _hash{ 0 };
+    };
+}
+
+template<>
+struct std::hash<utl::hashed_name>
+{
+    [[nodiscard]] constexpr size_t operator()(const utl::hashed_name& name) const
+    {
+        return (size_t)name.value();
+    }
+};
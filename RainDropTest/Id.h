@@ -0,0 +1,24 @@
+#pragma once
+#include "stdafx.h"
+
+namespace utl {
+
+    // Generation-tagged ids. The low bits are the slot index and the high bits count how many times
+    // the slot has been reused, so an id that outlived its item can be detected in O(1).
+    // NOTE: used by the generational free lists and by game entities (game_entity::id).
+    namespace id {
+        constexpr UINT generation_bits{ 8 };
+        constexpr UINT index_bits{ sizeof(UINT) * 8 - generation_bits };
+        constexpr UINT index_mask{ (1u << index_bits) - 1 };
+        constexpr UINT generation_mask{ (1u << generation_bits) - 1 };
+        constexpr UINT max_index{ index_mask - 1 }; // NOTE: all index bits set is reserved for Invalid_Index.
+
+        [[nodiscard]] constexpr UINT index(UINT id) { return id & index_mask; }
+        [[nodiscard]] constexpr UINT generation(UINT id) { return (id >> index_bits) & generation_mask; }
+        [[nodiscard]] constexpr UINT make(UINT index, UINT generation)
+        {
+            assert(index <= max_index);
+            return index | ((generation & generation_mask) << index_bits);
+        }
+    }
+}
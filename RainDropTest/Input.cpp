@@ -1,5 +1,5 @@
 #include "Input.h"
-#include <unordered_map>
+#include "FlatHashMap.h"
 
 namespace input {
 
@@ -12,9 +12,9 @@ namespace input {
             bool is_dirty{ true };
         };
 
-        std::unordered_map<UINT64, input_value> input_values;
-        std::unordered_map<UINT64, input_binding> input_bindings;
-        std::unordered_map<UINT64, UINT64> source_binding_map;
+        utl::flat_hash_map<UINT64, input_value> input_values;
+        utl::flat_hash_map<utl::hashed_name, input_binding> input_bindings;
+        utl::flat_hash_map<UINT64, utl::hashed_name> source_binding_map;
         utl::vector<detail::input_system_base*> input_callbacks;
 
         UINT8 modifier_keys_state{ 0 };
@@ -32,12 +32,13 @@ namespace input {
             input.previous = input.current;
             input.current = value;
 
-            if (source_binding_map.count(key))
+            const auto binding_pair{ source_binding_map.find(key) };
+            if (binding_pair != source_binding_map.end())
             {
-                const UINT64 binding_key{ source_binding_map[key] };
-                assert(input_bindings.count(binding_key));
-                input_binding& binding{ input_bindings[binding_key] };
-                binding.is_dirty = true;
+                const utl::hashed_name binding_key{ binding_pair->second };
+                const auto binding{ input_bindings.find(binding_key) };
+                assert(binding != input_bindings.end());
+                binding->second.is_dirty = true;
 
                 input_value binding_value;
                 get(binding_key, binding_value);
@@ -185,17 +186,20 @@ namespace input {
     {
         assert(type < input_source::count);
         const UINT64 key{ get_key(type, code) };
-        value = input_values[key];
+        // NOTE: don't insert here. set() holds a reference into input_values while it calls get().
+        const auto pair{ input_values.find(key) };
+        value = pair != input_values.end() ? pair->second : input_value{};
     }
 
-    void get(UINT64 binding, input_value& value)
+    void get(utl::hashed_name binding, input_value& value)
     {
-        if (!input_bindings.count(binding))
+        const auto pair{ input_bindings.find(binding) };
+        if (pair == input_bindings.end())
         {
             return;
         }
 
-        input_binding& input_binding{ input_bindings[binding] };
+        input_binding& input_binding{ pair->second };
 
         if (!input_binding.is_dirty)
         {
@@ -249,7 +253,7 @@ namespace input {
             return;
         }
 
-        const UINT64 binding_key{ source_binding_map[key] };
+        const utl::hashed_name binding_key{ source_binding_map[key] };
         assert(input_bindings.count(binding_key));
         input_binding& binding{ input_bindings[binding_key] };
         utl::vector<input_source>& sources{ binding.sources };
@@ -271,8 +275,7 @@ namespace input {
         }
     }
 
-    void
-        unbind(UINT64 binding)
+    void unbind(utl::hashed_name binding)
     {
         if (!input_bindings.count(binding))
         {
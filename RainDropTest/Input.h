@@ -1,6 +1,7 @@
 #pragma once
 #include "stdafx.h"
 #include "Vector.h"
+#include "HashedName.h"
 
 namespace input {
 
@@ -178,7 +179,7 @@ namespace input {
             count
         };
 
-        UINT64 binding{ 0 };
+        utl::hashed_name binding{};
         type source_type{};
         UINT code{ 0 };
         float multiplier{ 0 };
@@ -469,7 +470,7 @@ namespace input {
             input_system_base();
             ~input_system_base();
             virtual void on_event(input_source::type, input_code::code, const input_value&) = 0;
-            virtual void on_event(UINT64 binding, const input_value&) = 0;
+            virtual void on_event(utl::hashed_name binding, const input_value&) = 0;
         private:
             //~input_system_base();
         };
@@ -481,7 +482,7 @@ namespace input {
     public:
         ~input_system() {};
         using input_callback_t = void(T::*)(input_source::type, input_code::code, const input_value&);
-        using binding_callback_t = void(T::*)(UINT64, const input_value&);
+        using binding_callback_t = void(T::*)(utl::hashed_name, const input_value&);
 
         void add_handler(input_source::type type, T* instance, input_callback_t callback)
         {
@@ -496,7 +497,7 @@ namespace input {
             collection.emplace_back(input_callback{ instance, callback });
         }
 
-        void add_handler(UINT64 binding, T* instance, binding_callback_t callback)
+        void add_handler(utl::hashed_name binding, T* instance, binding_callback_t callback)
         {
             assert(instance && callback);
             for (const auto& func : m_binding_callbacks)
@@ -519,7 +520,7 @@ namespace input {
             }
         }
 
-        void on_event(UINT64 binding, const input_value& value) override
+        void on_event(utl::hashed_name binding, const input_value& value) override
         {
             for (const auto& item : m_binding_callbacks)
             {
@@ -539,7 +540,7 @@ namespace input {
 
         struct binding_callback
         {
-            UINT64 binding;
+            utl::hashed_name binding;
             T* instance;
             binding_callback_t callback;
         };
@@ -550,9 +551,9 @@ namespace input {
 
     HRESULT process_input_message(HWND h_wnd, UINT msg, WPARAM w_param, LPARAM l_param);
     void get(input_source::type type, input_code::code code, input_value& value);
-    void get(UINT64 binding, input_value& value);
+    void get(utl::hashed_name binding, input_value& value);
     void bind(input_source source);
     void unbind(input_source::type type, input_code::code code);
-    void unbind(UINT64 binding);
+    void unbind(utl::hashed_name binding);
 
 }
@@ -0,0 +1,276 @@
+#include "Jobs.h"
+#include <thread>
+#include <condition_variable>
+
+namespace jobs {
+    namespace {
+
+        struct job
+        {
+            job_decl decl{};
+            counter* job_counter{ nullptr };
+        };
+
+        // Chase-Lev work-stealing deque with a fixed capacity. The owner pushes and pops at the bottom
+        // (LIFO, cache warm), other threads steal from the top. Only the last item and steals need a CAS.
+        // NOTE: the slots are atomics because a thief may read a slot the owner is about to reuse. It then
+        //       loses the CAS on 'top' and drops what it read.
+        class work_deque
+        {
+        public:
+            static constexpr INT64 capacity{ 1024 };
+
+            // Owner only. Returns false if the deque is full.
+            bool push(const job& j)
+            {
+                const INT64 b{ _bottom.load(std::memory_order_relaxed) };
+                const INT64 t{ _top.load(std::memory_order_acquire) };
+                if (b - t >= capacity) return false;
+
+                store(b, j);
+                std::atomic_thread_fence(std::memory_order_release);
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // Owner only.
+            bool pop(job& out)
+            {
+                const INT64 b{ _bottom.load(std::memory_order_relaxed) - 1 };
+                _bottom.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                INT64 t{ _top.load(std::memory_order_relaxed) };
+
+                if (t > b)
+                {
+                    // Empty.
+                    _bottom.store(b + 1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                out = load(b);
+                if (t < b) return true;
+
+                // Last item: race the thieves for it.
+                const bool won{ _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) };
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+
+            // Any thread. May fail while the deque isn't empty, if another thread took the item first.
+            bool steal(job& out)
+            {
+                INT64 t{ _top.load(std::memory_order_acquire) };
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const INT64 b{ _bottom.load(std::memory_order_acquire) };
+                if (t >= b) return false;
+
+                out = load(t);
+                return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            }
+
+        private:
+            struct slot
+            {
+                std::atomic<void(*)(void*)> function{ nullptr };
+                std::atomic<void*> data{ nullptr };
+                std::atomic<counter*> job_counter{ nullptr };
+            };
+
+            void store(INT64 index, const job& j)
+            {
+                slot& s{ _slots[index & (capacity - 1)] };
+                s.function.store(j.decl.function, std::memory_order_relaxed);
+                s.data.store(j.decl.data, std::memory_order_relaxed);
+                s.job_counter.store(j.job_counter, std::memory_order_relaxed);
+            }
+
+            [[nodiscard]] job load(INT64 index) const
+            {
+                const slot& s{ _slots[index & (capacity - 1)] };
+                return { { s.function.load(std::memory_order_relaxed), s.data.load(std::memory_order_relaxed) },
+                    s.job_counter.load(std::memory_order_relaxed) };
+            }
+
+            alignas(64) std::atomic<INT64> _top{ 0 };
+            alignas(64) std::atomic<INT64> _bottom{ 0 };
+            slot _slots[capacity];
+        };
+        static_assert((work_deque::capacity & (work_deque::capacity - 1)) == 0);
+
+        work_deque queues[max_thread_count];
+        std::thread workers[max_thread_count];
+        UINT total_thread_count{ 1 };
+
+        // Jobs pushed and not yet taken by a thread. Workers sleep while it's zero.
+        std::atomic<UINT> pending_jobs{ 0 };
+        std::atomic<bool> running{ false };
+        std::mutex sleep_mutex;
+        std::condition_variable wake_up;
+
+        thread_local UINT current_thread_index{ 0 };
+        // Only the owner of a deque may push to it and pop from it.
+        thread_local bool owns_queue{ false };
+
+        bool steal(UINT thief, job& out)
+        {
+            for (UINT i{ 1 }; i < total_thread_count; ++i)
+            {
+                if (queues[(thief + i) % total_thread_count].steal(out)) return true;
+            }
+            return false;
+        }
+
+        void execute(const job& j)
+        {
+            j.decl.function(j.decl.data);
+            if (j.job_counter)
+            {
+                j.job_counter->value.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        // Returns false if there was nothing to do.
+        bool try_execute_one(UINT index)
+        {
+            job j{};
+            if (!queues[index].pop(j) && !steal(index, j)) return false;
+
+            pending_jobs.fetch_sub(1, std::memory_order_acq_rel);
+            execute(j);
+            return true;
+        }
+
+        void worker_thread(UINT index)
+        {
+            current_thread_index = index;
+            owns_queue = true;
+
+            while (running.load(std::memory_order_acquire))
+            {
+                if (try_execute_one(index)) continue;
+
+                std::unique_lock lock{ sleep_mutex };
+                wake_up.wait(lock, [] {
+                    return pending_jobs.load(std::memory_order_acquire) > 0 || !running.load(std::memory_order_acquire);
+                    });
+            }
+        }
+
+    } // anonymous namespace
+
+    bool initialize()
+    {
+        assert(!running);
+        const UINT hardware_threads{ std::thread::hardware_concurrency() };
+        total_thread_count = hardware_threads ? hardware_threads : 1;
+        if (total_thread_count > max_thread_count) total_thread_count = max_thread_count;
+
+        current_thread_index = 0;
+        owns_queue = true;
+        running = true;
+
+        for (UINT i{ 1 }; i < total_thread_count; ++i)
+        {
+            workers[i] = std::thread{ worker_thread, i };
+        }
+
+        return true;
+    }
+
+    void shutdown()
+    {
+        if (!running) return;
+
+        // Drain what is left before stopping the workers.
+        while (try_execute_one(0)) {}
+
+        {
+            std::lock_guard lock{ sleep_mutex };
+            running = false;
+        }
+        wake_up.notify_all();
+
+        for (UINT i{ 1 }; i < total_thread_count; ++i)
+        {
+            if (workers[i].joinable()) workers[i].join();
+        }
+
+        total_thread_count = 1;
+    }
+
+    UINT thread_count()
+    {
+        return total_thread_count;
+    }
+
+    UINT thread_index()
+    {
+        return current_thread_index;
+    }
+
+    void run(const job_decl* const decls, UINT count, counter* const job_counter, const counter* const dependency /* = nullptr */)
+    {
+        assert(decls || !count);
+        if (!count) return;
+
+        if (job_counter)
+        {
+            job_counter->value.fetch_add(count, std::memory_order_acq_rel);
+        }
+
+        // NOTE: jobs are only queued once they can run, so a thread never takes a job it has to put back.
+        if (dependency && !dependency->is_done())
+        {
+            if (running) wait(dependency);
+            assert(dependency->is_done());
+        }
+
+        // Without workers, just do the work here.
+        if (!running)
+        {
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                execute({ decls[i], job_counter });
+            }
+            return;
+        }
+
+        assert(owns_queue);
+        const UINT index{ current_thread_index };
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            assert(decls[i].function);
+            // Counted before the push, so a thief can't take the job before it's counted.
+            pending_jobs.fetch_add(1, std::memory_order_release);
+            if (!queues[index].push({ decls[i], job_counter }))
+            {
+                // The deque is full. Do the work here, it's as far as the job would get anyway.
+                pending_jobs.fetch_sub(1, std::memory_order_acq_rel);
+                execute({ decls[i], job_counter });
+            }
+        }
+
+        {
+            // Taking the lock makes sure a worker can't miss the wake up between its check and its wait.
+            std::lock_guard lock{ sleep_mutex };
+        }
+        if (count == 1) wake_up.notify_one();
+        else wake_up.notify_all();
+    }
+
+    void wait(const counter* const job_counter)
+    {
+        assert(job_counter);
+        assert(owns_queue || !running);
+        const UINT index{ current_thread_index };
+
+        while (!job_counter->is_done())
+        {
+            if (!try_execute_one(index))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
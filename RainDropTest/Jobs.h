@@ -0,0 +1,105 @@
+#pragma once
+#include "stdafx.h"
+#include <atomic>
+
+namespace jobs {
+
+    // Upper bound for the number of threads taking part in the job system (main thread included).
+    constexpr UINT max_thread_count{ 64 };
+
+    // parallel_for() never splits a range into more jobs than this.
+    constexpr UINT max_parallel_jobs{ 64 };
+
+    // A counter is decremented each time one of the jobs it was handed to finishes.
+    // It can be waited on, or used as a dependency for other jobs.
+    struct counter
+    {
+        std::atomic<UINT> value{ 0 };
+
+        [[nodiscard]] bool is_done() const { return value.load(std::memory_order_acquire) == 0; }
+    };
+
+    struct job_decl
+    {
+        void(*function)(void* data){ nullptr };
+        void* data{ nullptr };
+    };
+
+    bool initialize();
+    void shutdown();
+
+    // Number of threads that execute jobs, including the main thread.
+    [[nodiscard]] UINT thread_count();
+    // Index of the calling thread in [0, thread_count()). The main thread is always 0.
+    [[nodiscard]] UINT thread_index();
+
+    // Queues 'count' jobs on the calling thread's deque. 'job_counter' (optional) is incremented by 'count'
+    // and decremented as the jobs complete. If 'dependency' is set and not done yet, the calling thread first
+    // executes queued jobs until it reaches zero (like wait()), so only runnable jobs are ever queued.
+    // NOTE: call it from the thread that called initialize() or from a job. Other threads have no deque.
+    void run(const job_decl* const decls, UINT count, counter* const job_counter, const counter* const dependency = nullptr);
+
+    // Executes queued jobs until 'job_counter' reaches zero, so the waiting thread is never idle.
+    // NOTE: the waiting thread may pick up any queued job. Don't wait while holding a lock that
+    //       another queued job might try to take.
+    void wait(const counter* const job_counter);
+
+    namespace detail {
+        template<typename F>
+        struct range
+        {
+            F* function;
+            UINT begin;
+            UINT end;
+        };
+
+        template<typename F>
+        void execute_range(void* data)
+        {
+            const range<F>& r{ *(const range<F>*)data };
+            (*r.function)(r.begin, r.end);
+        }
+    }
+
+    // Splits [0, count) into ranges of at least 'grain_size' items and calls func(begin, end)
+    // for each of them on the job threads. Returns when all ranges are processed.
+    template<typename F>
+    void parallel_for(UINT count, UINT grain_size, F&& func)
+    {
+        if (!count) return;
+        grain_size = grain_size ? grain_size : 1;
+
+        UINT job_count{ (count + grain_size - 1) / grain_size };
+        if (job_count > max_parallel_jobs)
+        {
+            job_count = max_parallel_jobs;
+            grain_size = (count + job_count - 1) / job_count;
+            job_count = (count + grain_size - 1) / grain_size;
+        }
+
+        // Not worth the overhead, run it here.
+        if (job_count == 1 || thread_count() == 1)
+        {
+            func(0, count);
+            return;
+        }
+
+        using func_type = std::remove_reference_t<F>;
+        detail::range<func_type> ranges[max_parallel_jobs];
+        job_decl decls[max_parallel_jobs];
+
+        for (UINT i{ 0 }; i < job_count; ++i)
+        {
+            const UINT begin{ i * grain_size };
+            const UINT end{ (begin + grain_size < count) ? begin + grain_size : count };
+            ranges[i] = { std::addressof(func), begin, end };
+            decls[i] = { &detail::execute_range<func_type>, &ranges[i] };
+        }
+
+        // Keep the first range for the calling thread.
+        counter job_counter{};
+        run(&decls[1], job_count - 1, &job_counter);
+        detail::execute_range<func_type>(&ranges[0]);
+        wait(&job_counter);
+    }
+}
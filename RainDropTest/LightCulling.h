@@ -0,0 +1,24 @@
+#pragma once
+#include "stdafx.h"
+#include "Lights.h"
+#include "Core.h"
+#include "Barriers.h"
+
+// D3D12LightCulling.cpp
+// Tiled light culling on the GPU. The light sets and their buffers are in Lights.h.
+namespace lights
+{
+    constexpr UINT light_culling_tile_size{ 32 };
+
+    bool initialize_culling();
+    void shutdown_culling();
+
+    [[nodiscard]] UINT add_cull_light();
+    void remove_cull_light(UINT id);
+
+    void cull_lights(id3d12_graphics_command_list* cmd_list, core::d3d12_frame_info d3d12_info, barriers::resource_barrier& barriers);
+
+    D3D12_GPU_VIRTUAL_ADDRESS frustums(UINT light_culling_id, UINT frame_index);
+    D3D12_GPU_VIRTUAL_ADDRESS light_grid_opaque(UINT light_culling_id, UINT frame_index);
+    D3D12_GPU_VIRTUAL_ADDRESS light_index_list_opaque(UINT light_culling_id, UINT frame_index);
+}
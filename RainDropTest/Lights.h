@@ -3,14 +3,9 @@
 #include "Entity.h"
 #include "FreeList.h"
 #include "SharedTypes.h"
-#include "Core.h"
-#include "Barriers.h"
-#include "Resources.h"
 
 namespace lights
 {
-    constexpr UINT light_culling_tile_size{ 32 };
-
     struct light_type {
         enum type : UINT32
         {
@@ -81,17 +76,16 @@ namespace lights
     };
 
 
-    bool initialize();
+    // NOTE: the light buffers are created with gpu::current(), see content::initialize().
     void shutdown();
 
-    void generate_lights();
-    void remove_lights();
-
-    [[nodiscard]] UINT add_cull_light();
-    void remove_cull_light(UINT id);
+    void create_light_set(UINT64 light_set_key);
+    void remove_light_set(UINT64 light_set_key);
+    [[nodiscard]] Light create_light(light_init_info info);
+    void remove_light(Light light);
 
-    void update_light_buffers(core::d3d12_frame_info d3d12_info);
-    void cull_lights(id3d12_graphics_command_list* cmd_list, core::d3d12_frame_info d3d12_info, barriers::resource_barrier& barriers);
+    // Copies the lights of the set that changed to the frame's buffers.
+    void update_light_buffers(UINT64 light_set_key, UINT frame_index);
 
     D3D12_GPU_VIRTUAL_ADDRESS non_cullable_light_buffer(UINT frame_index);
     D3D12_GPU_VIRTUAL_ADDRESS cullable_light_buffer(UINT frame_index);
@@ -99,8 +93,4 @@ namespace lights
     D3D12_GPU_VIRTUAL_ADDRESS bounding_sphere_buffer(UINT frame_index);
     UINT non_cullable_light_count(UINT64 key);
     UINT cullable_light_count(UINT64 key);
-
-    D3D12_GPU_VIRTUAL_ADDRESS frustums(UINT light_culling_id, UINT frame_index);
-    D3D12_GPU_VIRTUAL_ADDRESS light_grid_opaque(UINT light_culling_id, UINT frame_index);
-    D3D12_GPU_VIRTUAL_ADDRESS light_index_list_opaque(UINT light_culling_id, UINT frame_index);
 }
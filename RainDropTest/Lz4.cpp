@@ -0,0 +1,205 @@
+#include "Lz4.h"
+
+namespace utl::lz4 {
+    namespace {
+        constexpr UINT min_match{ 4 };
+        // The block format requires the last 5 bytes to be literals and the last match to start
+        // at least 12 bytes before the end of the block.
+        constexpr UINT last_literals{ 5 };
+        constexpr UINT match_find_limit{ 12 };
+        constexpr UINT max_offset{ 65535 };
+        constexpr UINT run_mask{ 15 };
+        constexpr UINT wild_copy_size{ 16 };
+        // 16K entries, 64KB of stack. Enough for 64-256KB blocks.
+        constexpr UINT hash_log{ 14 };
+
+        [[nodiscard]] UINT read32(const UINT8* const p)
+        {
+            UINT value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        [[nodiscard]] constexpr UINT hash(UINT sequence)
+        {
+            return (sequence * 2654435761u) >> (32 - hash_log);
+        }
+
+        [[nodiscard]] constexpr UINT64 length_bytes(UINT64 length)
+        {
+            return length < run_mask ? 0 : (length - run_mask) / 255 + 1;
+        }
+
+        UINT8* write_length(UINT8* op, UINT64 length)
+        {
+            assert(length >= run_mask);
+            length -= run_mask;
+            for (; length >= 255; length -= 255) *op++ = 255;
+            *op++ = (UINT8)length;
+            return op;
+        }
+
+        // Writes one sequence. 'match_length' is 0 for the last sequence, which only has literals.
+        // Returns false if it doesn't fit.
+        [[nodiscard]] bool write_sequence(UINT8*& op, const UINT8* const op_end, const UINT8* const literals, UINT64 literal_length,
+            UINT offset, UINT64 match_length)
+        {
+            const UINT64 match_code{ match_length ? match_length - min_match : 0 };
+            const UINT64 size{ 1 + length_bytes(literal_length) + literal_length + (match_length ? sizeof(UINT16) + length_bytes(match_code) : 0) };
+            if (size > (UINT64)(op_end - op)) return false;
+
+            UINT8* const token{ op++ };
+            *token = (UINT8)((literal_length < run_mask ? literal_length : run_mask) << 4);
+            if (literal_length >= run_mask) op = write_length(op, literal_length);
+            if (literal_length) memcpy(op, literals, literal_length);
+            op += literal_length;
+
+            if (match_length)
+            {
+                *op++ = (UINT8)offset;
+                *op++ = (UINT8)(offset >> 8);
+                *token |= (UINT8)(match_code < run_mask ? match_code : run_mask);
+                if (match_code >= run_mask) op = write_length(op, match_code);
+            }
+
+            return true;
+        }
+
+        [[nodiscard]] bool read_length(const UINT8*& ip, const UINT8* const ip_end, UINT64& length)
+        {
+            UINT8 value;
+            do
+            {
+                if (ip == ip_end) return false;
+                value = *ip++;
+                length += value;
+            } while (value == 255);
+            return true;
+        }
+    } // anonymous namespace
+
+    UINT64 compress(const UINT8* const source, UINT64 size, UINT8* const destination, UINT64 capacity)
+    {
+        assert((source || !size) && destination);
+        assert(size <= UINT_MAX);
+
+        const UINT8* const ip_end{ source + size };
+        UINT8* op{ destination };
+        UINT8* const op_end{ destination + capacity };
+        const UINT8* anchor{ source };
+
+        if (size > match_find_limit)
+        {
+            // Positions of the last 4-byte sequences seen, relative to 'source'.
+            UINT table[1 << hash_log]{};
+            const UINT8* const match_limit{ ip_end - last_literals };
+            const UINT8* const find_limit{ ip_end - match_find_limit };
+            const UINT8* ip{ source + 1 };
+            UINT misses{ 0 };
+
+            while (ip <= find_limit)
+            {
+                const UINT sequence{ read32(ip) };
+                const UINT h{ hash(sequence) };
+                const UINT8* match{ source + table[h] };
+                table[h] = (UINT)(ip - source);
+
+                if (match >= ip || ip - match > max_offset || read32(match) != sequence)
+                {
+                    // Skip ahead faster the longer nothing matches, so incompressible data is cheap.
+                    ip += (misses++ >> 6) + 1;
+                    continue;
+                }
+                misses = 0;
+
+                while (ip > anchor && match > source && ip[-1] == match[-1])
+                {
+                    --ip;
+                    --match;
+                }
+
+                const UINT8* match_end{ ip + min_match };
+                for (const UINT8* m{ match + min_match }; match_end < match_limit && *match_end == *m; ++m) ++match_end;
+
+                if (!write_sequence(op, op_end, anchor, ip - anchor, (UINT)(ip - match), match_end - ip)) return 0;
+
+                ip = match_end;
+                anchor = ip;
+                if (ip <= find_limit)
+                {
+                    table[hash(read32(ip - 2))] = (UINT)(ip - 2 - source);
+                }
+            }
+        }
+
+        if (!write_sequence(op, op_end, anchor, ip_end - anchor, 0, 0)) return 0;
+        return op - destination;
+    }
+
+    bool decompress(const UINT8* const source, UINT64 size, UINT8* const destination, UINT64 destination_size)
+    {
+        if (!source || !destination) return false;
+
+        const UINT8* ip{ source };
+        const UINT8* const ip_end{ source + size };
+        UINT8* op{ destination };
+        UINT8* const op_end{ destination + destination_size };
+
+        while (ip < ip_end)
+        {
+            const UINT token{ *ip++ };
+
+            UINT64 literal_length{ token >> 4 };
+            if (literal_length == run_mask && !read_length(ip, ip_end, literal_length)) return false;
+            if (literal_length > (UINT64)(ip_end - ip) || literal_length > (UINT64)(op_end - op)) return false;
+            // Most literal runs are short. A fixed size copy is a couple of moves instead of a call.
+            if (literal_length <= wild_copy_size && ip_end - ip >= wild_copy_size && op_end - op >= wild_copy_size) memcpy(op, ip, wild_copy_size);
+            else memcpy(op, ip, literal_length);
+            ip += literal_length;
+            op += literal_length;
+
+            // The last sequence has no match.
+            if (ip == ip_end) break;
+
+            if (ip_end - ip < 2) return false;
+            const UINT offset{ (UINT)ip[0] | ((UINT)ip[1] << 8) };
+            ip += 2;
+            if (!offset || offset > (UINT64)(op - destination)) return false;
+
+            UINT64 match_length{ token & run_mask };
+            if (match_length == run_mask && !read_length(ip, ip_end, match_length)) return false;
+            match_length += min_match;
+            if (match_length > (UINT64)(op_end - op)) return false;
+
+            const UINT8* match{ op - offset };
+            UINT8* const match_end{ op + match_length };
+            if (offset >= wild_copy_size && match_length + wild_copy_size <= (UINT64)(op_end - op))
+            {
+                // 16 bytes at a time, may write up to 15 bytes past the match. They're overwritten later.
+                do
+                {
+                    memcpy(op, match, wild_copy_size);
+                    op += wild_copy_size;
+                    match += wild_copy_size;
+                } while (op < match_end);
+            }
+            else if (offset >= 8 && match_length + 8 <= (UINT64)(op_end - op))
+            {
+                do
+                {
+                    memcpy(op, match, 8);
+                    op += 8;
+                    match += 8;
+                } while (op < match_end);
+            }
+            else
+            {
+                // Overlapping copy, repeats the last 'offset' bytes.
+                while (op < match_end) *op++ = *match++;
+            }
+            op = match_end;
+        }
+
+        return ip == ip_end && op == op_end;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "stdafx.h"
+
+namespace utl::lz4 {
+
+    // LZ4 block format (no frame): sequences of literals followed by a match of at least 4 bytes
+    // with a 16-bit offset. Fast to decompress, so asset blocks can be unpacked at load time.
+    // See https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+
+    // Largest possible compressed size for 'size' bytes of input (incompressible data grows a little).
+    [[nodiscard]] constexpr UINT64 compress_bound(UINT64 size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    // Compresses 'size' bytes of 'source' into 'destination'. Returns the compressed size,
+    // or 0 if it doesn't fit in 'capacity'. Give compress_bound(size) bytes to be sure it fits.
+    // NOTE: blocks larger than 4GB aren't supported.
+    [[nodiscard]] UINT64 compress(const UINT8* const source, UINT64 size, UINT8* const destination, UINT64 capacity);
+
+    // Decompresses a whole block. 'destination_size' must be the exact uncompressed size.
+    // Returns false if the data is corrupt, without ever reading or writing out of bounds.
+    [[nodiscard]] bool decompress(const UINT8* const source, UINT64 size, UINT8* const destination, UINT64 destination_size);
+}
@@ -1,5 +1,10 @@
 #include "Main.h"
+#include "AppItems.h"
 #include "Core.h"
+#include "CpuFeatures.h"
+#include "AssetPack.h"
+#include "Jobs.h"
+#include "Vector.h"
 #include <filesystem>
 #include "DXApp.h"
 
@@ -15,12 +20,91 @@ std::filesystem::path set_current_directory_to_executable_path()
     return std::filesystem::current_path();
 }
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
+// Copies the value of '<option><value>' in the command line to 'value'. Returns false if the option isn't there
+// or its value doesn't fit. NOTE: values end at the first space or tab.
+bool find_option(const char* command_line, const char* option_name, char* const value, size_t value_size)
+{
+    const char* const option{ strstr(command_line, option_name) };
+    if (!option) return false;
+
+    const char* const option_value{ option + strlen(option_name) };
+    const size_t length{ strcspn(option_value, " \t") };
+    if (length >= value_size) return false;
+    memcpy(value, option_value, length);
+    value[length] = 0;
+    return true;
+}
+
+// Handles
+//  --force-isa=<scalar|sse4.2|avx2|avx512|neon>, which caps the SIMD kernels at a lower instruction set so
+//                                                the variants can be compared on one machine.
+//  --asset-pack=<path>, which loads the assets from an asset pack instead of the loose files. Like theirs,
+//                       the path is relative to the executable, e.g. ../assets.pack. Packs are made with
+//                       --pack (below) or the asset_packer tool (see bench/CMakeLists.txt).
+void parse_command_line(const char* command_line)
+{
+    if (!command_line) return;
+
+    char name[16]{};
+    if (find_option(command_line, "--force-isa=", &name[0], sizeof(name)))
+    {
+        const core::cpu::isa::level level{ core::cpu::isa_from_name(name) };
+        assert(level != core::cpu::isa::count); // unknown instruction set name.
+        if (level != core::cpu::isa::count)
+        {
+            core::cpu::force_isa(level);
+        }
+    }
+
+    char pack_path[MAX_PATH]{};
+    if (find_option(command_line, "--asset-pack=", &pack_path[0], sizeof(pack_path)))
+    {
+        app::set_asset_pack(pack_path);
+    }
+}
+
+// Handles --pack=<output.pack> <file or directory>..., which writes the files (and the files in the
+// directories, without going into sub-directories) to an asset pack instead of starting the app.
+// Returns the exit code, or -1 if the option isn't there.
+int pack_assets()
+{
+    int argc{ 0 };
+    LPWSTR* const argv{ CommandLineToArgvW(GetCommandLineW(), &argc) };
+    if (!argv) return -1;
+
+    constexpr wchar_t pack_option[]{ L"--pack=" };
+    constexpr size_t pack_option_length{ _countof(pack_option) - 1 };
+    if (argc < 2 || wcsncmp(argv[1], pack_option, pack_option_length))
+    {
+        LocalFree(argv);
+        return -1;
+    }
+
+    const std::filesystem::path output{ argv[1] + pack_option_length };
+    utl::vector<std::filesystem::path> inputs{};
+    for (int i{ 2 }; i < argc; ++i) inputs.emplace_back(argv[i]);
+    LocalFree(argv);
+
+    const utl::vector<std::filesystem::path> files{ content::list_files_to_pack(inputs.data(), (UINT)inputs.size()) };
+    bool succeeded{ !files.empty() && jobs::initialize() };
+    if (succeeded)
+    {
+        succeeded = content::create_asset_pack(output, files.data(), (UINT)files.size());
+        jobs::shutdown();
+    }
+    return succeeded ? 0 : 1;
+}
+
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow)
 {
 #if _DEBUG
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
+    // NOTE: before the working directory changes, so relative paths are relative to where it was started.
+    if (const int exit_code{ pack_assets() }; exit_code >= 0) return exit_code;
+
     set_current_directory_to_executable_path();
+    parse_command_line(lpCmdLine);
 
     app::dx_app app{};
     if (app.initialize())
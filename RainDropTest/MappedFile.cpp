@@ -0,0 +1,112 @@
+#include "MappedFile.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace utl {
+
+#if defined(_WIN32)
+    bool mapped_file::open(const std::filesystem::path& path, access::hint hint)
+    {
+        close();
+
+        const DWORD flags{ hint == access::sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS };
+        const HANDLE file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr) };
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER file_size{};
+        if (!GetFileSizeEx(file, &file_size) || !file_size.QuadPart)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        // NOTE: the view keeps the mapping (and the file) open, so both handles can be closed right away.
+        const HANDLE mapping{ CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+        CloseHandle(file);
+        if (!mapping) return false;
+
+        void* const view{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+        CloseHandle(mapping);
+        if (!view) return false;
+
+        _data = (const UINT8*)view;
+        _size = (UINT64)file_size.QuadPart;
+
+        if (hint == access::sequential)
+        {
+            prefetch(0, _size);
+        }
+        return true;
+    }
+
+    void mapped_file::close()
+    {
+        if (_data) UnmapViewOfFile(_data);
+        _data = nullptr;
+        _size = 0;
+    }
+
+    void mapped_file::prefetch(UINT64 offset, UINT64 size) const
+    {
+        assert(offset + size <= _size);
+        if (!_data || !size) return;
+
+        WIN32_MEMORY_RANGE_ENTRY range{ (void*)(_data + offset), (SIZE_T)size };
+        // NOTE: only a hint. Failing just means the pages are read when they're touched.
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    bool mapped_file::open(const std::filesystem::path& path, access::hint hint)
+    {
+        close();
+
+        const int file{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+        if (file < 0) return false;
+
+        struct stat file_info {};
+        if (fstat(file, &file_info) || file_info.st_size <= 0)
+        {
+            ::close(file);
+            return false;
+        }
+
+        // NOTE: the mapping keeps its own reference to the file.
+        void* const view{ mmap(nullptr, (size_t)file_info.st_size, PROT_READ, MAP_PRIVATE, file, 0) };
+        ::close(file);
+        if (view == MAP_FAILED) return false;
+
+        _data = (const UINT8*)view;
+        _size = (UINT64)file_info.st_size;
+
+        madvise(view, (size_t)_size, hint == access::sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        if (hint == access::sequential)
+        {
+            prefetch(0, _size);
+        }
+        return true;
+    }
+
+    void mapped_file::close()
+    {
+        if (_data) munmap((void*)_data, (size_t)_size);
+        _data = nullptr;
+        _size = 0;
+    }
+
+    void mapped_file::prefetch(UINT64 offset, UINT64 size) const
+    {
+        assert(offset + size <= _size);
+        if (!_data || !size) return;
+
+        // madvise() wants a page aligned address.
+        const UINT64 page_size{ (UINT64)sysconf(_SC_PAGESIZE) };
+        const UINT64 begin{ offset & ~(page_size - 1) };
+        madvise((void*)(_data + begin), (size_t)(offset + size - begin), MADV_WILLNEED);
+    }
+#endif
+}
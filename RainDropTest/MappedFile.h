@@ -0,0 +1,74 @@
+#pragma once
+#include "stdafx.h"
+#include <filesystem>
+#include <span>
+
+namespace utl {
+
+    // Read-only view of a whole file, mapped into memory instead of copied.
+    // Pages are read from disk (or the OS file cache) the first time they're touched, and the
+    // OS can drop them again under memory pressure since they're backed by the file.
+    // NOTE: the data is only valid while the mapped_file is open. Resources made from it must copy
+    //       what they keep (see content::create_resource()).
+    class mapped_file
+    {
+    public:
+        struct access {
+            enum hint : UINT {
+                sequential,     // read front to back, once. The whole file is prefetched when opened.
+                random,         // read in no particular order. Nothing is prefetched.
+            };
+        };
+
+        mapped_file() = default;
+
+        explicit mapped_file(const std::filesystem::path& path, access::hint hint = access::sequential)
+        {
+            open(path, hint);
+        }
+
+        DISABLE_COPY(mapped_file);
+
+        constexpr mapped_file(mapped_file&& o)
+        {
+            move(o);
+        }
+
+        mapped_file& operator=(mapped_file&& o)
+        {
+            assert(this != std::addressof(o));
+            if (this != std::addressof(o))
+            {
+                close();
+                move(o);
+            }
+            return *this;
+        }
+
+        ~mapped_file() { close(); }
+
+        // Maps the file. Returns false if it doesn't exist, is empty or can't be mapped.
+        bool open(const std::filesystem::path& path, access::hint hint = access::sequential);
+        void close();
+
+        // Asks the OS to start reading a range of the file in the background.
+        void prefetch(UINT64 offset, UINT64 size) const;
+
+        [[nodiscard]] constexpr bool is_open() const { return _data != nullptr; }
+        [[nodiscard]] constexpr const UINT8* data() const { return _data; }
+        [[nodiscard]] constexpr UINT64 size() const { return _size; }
+        [[nodiscard]] constexpr std::span<const UINT8> span() const { return { _data, (size_t)_size }; }
+
+    private:
+        constexpr void move(mapped_file& o)
+        {
+            _data = o._data;
+            _size = o._size;
+            o._data = nullptr;
+            o._size = 0;
+        }
+
+        const UINT8*    _data{ nullptr };
+        UINT64          _size{ 0 };
+    };
+}
@@ -0,0 +1,129 @@
+#include "Math.h"
+#include "CpuFeatures.h"
+#include <intrin.h>
+
+namespace math {
+    namespace {
+
+        // CRC32C (Castagnoli) lookup table for CPUs without the instruction.
+        struct crc32c_table
+        {
+            UINT32 values[256];
+
+            constexpr crc32c_table() : values{}
+            {
+                constexpr UINT32 polynomial{ 0x82f63b78 }; // reversed 0x1edc6f41
+                for (UINT32 i{ 0 }; i < 256; ++i)
+                {
+                    UINT32 crc{ i };
+                    for (UINT bit{ 0 }; bit < 8; ++bit)
+                    {
+                        crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+                    }
+                    values[i] = crc;
+                }
+            }
+        };
+
+        constexpr crc32c_table crc32c_lookup{};
+
+        UINT32 crc32c_u64_table(UINT32 crc, UINT64 value)
+        {
+            for (UINT i{ 0 }; i < sizeof(UINT64); ++i)
+            {
+                crc = crc32c_lookup.values[(crc ^ (UINT32)value) & 0xff] ^ (crc >> 8);
+                value >>= 8;
+            }
+            return crc;
+        }
+
+#if defined(_M_X64)
+        UINT32 crc32c_u64_hardware(UINT32 crc, UINT64 value)
+        {
+            return (UINT32)_mm_crc32_u64(crc, value);
+        }
+#elif defined(_M_ARM64)
+        UINT32 crc32c_u64_hardware(UINT32 crc, UINT64 value)
+        {
+            return __crc32cd(crc, value);
+        }
+#endif
+
+        // Final mix of MurmurHash3, see utl::detail::mix64().
+        [[nodiscard]] constexpr UINT64 mix64(UINT64 x)
+        {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdull;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ull;
+            x ^= x >> 33;
+            return x;
+        }
+
+        [[nodiscard]] UINT64 load_u64(const UINT8* const at)
+        {
+            UINT64 value;
+            memcpy(&value, at, sizeof(UINT64));
+            return value;
+        }
+
+        // Two CRC lanes over alternating 8-byte words give 64 bits of state, and they don't
+        // wait on each other, so the hardware path runs at about twice the speed of one lane.
+        // The last 1 to 7 bytes are zero-padded, the size mixed in at the end tells them apart.
+        template<UINT32(*crc32c_u64)(UINT32, UINT64)>
+        UINT64 hash64_crc32c(const UINT8* const data, UINT64 size)
+        {
+            UINT32 lane0{ 0xffffffff };
+            UINT32 lane1{ 0x9e3779b9 };
+            const UINT8* at{ data };
+            const UINT8* const end{ data + size };
+            const UINT8* const end16{ data + align_size_down<16>(size) };
+
+            while (at < end16)
+            {
+                lane0 = crc32c_u64(lane0, load_u64(at));
+                lane1 = crc32c_u64(lane1, load_u64(at + 8));
+                at += 16;
+            }
+
+            if (end - at >= 8)
+            {
+                lane0 = crc32c_u64(lane0, load_u64(at));
+                at += 8;
+            }
+
+            if (at < end)
+            {
+                UINT64 tail{ 0 };
+                memcpy(&tail, at, end - at);
+                lane1 = crc32c_u64(lane1, tail);
+            }
+
+            return mix64((((UINT64)lane0 << 32) | lane1) ^ mix64(size));
+        }
+
+        using hash64_function = UINT64(*)(const UINT8* const, UINT64);
+
+        hash64_function select_hash64()
+        {
+            using core::cpu::isa;
+            hash64_function variants[isa::count]{ hash64_crc32c<crc32c_u64_table> };
+#if defined(_M_X64)
+            variants[isa::sse4_2] = hash64_crc32c<crc32c_u64_hardware>;
+#elif defined(_M_ARM64)
+            // NOTE: the CRC32 instructions are optional in ARMv8.0.
+            if (core::cpu::has(core::cpu::feature::crc32c)) variants[isa::neon] = hash64_crc32c<crc32c_u64_hardware>;
+#endif
+            return core::cpu::select(variants);
+        }
+
+    } // anonymous namespace
+
+    UINT64 hash64(const void* const data, UINT64 size)
+    {
+        assert(data || !size);
+        // NOTE: the variant is selected once, on the first call.
+        static const hash64_function hash{ select_hash64() };
+        return hash((const UINT8*)data, size);
+    }
+}
@@ -50,20 +50,11 @@ namespace math {
         return ((size + mask) & ~mask);
     }
 
-    [[nodiscard]] constexpr UINT64 calc_crc32_u64(const UINT8* const data, UINT64 size)
-    {
-        assert(size >= sizeof(UINT64));
-        UINT64 crc{ 0 };
-        const UINT8* at{ data };
-        const UINT8* const end{ data + align_size_down<sizeof(UINT64)>(size) };
-        while (at < end)
-        {
-            crc = _mm_crc32_u64(crc, *((const UINT64*)at));
-            at += sizeof(UINT64);
-        }
-
-        return crc;
-    }
+    // 64-bit hash of 'size' bytes, every byte counts. Built on CRC32C: the hardware instruction
+    // (SSE4.2 on x64, CRC32 on ARMv8) is picked at run time, with a table-driven fallback for CPUs
+    // without it. All paths give the same result.
+    // NOTE: a good key for hash maps, but not collision-free. Compare the data when it matters.
+    [[nodiscard]] UINT64 hash64(const void* const data, UINT64 size);
 
     template<typename T>
     [[nodiscard]] constexpr T
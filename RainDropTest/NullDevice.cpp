@@ -0,0 +1,120 @@
+#include "NullDevice.h"
+#include "Math.h"
+
+namespace gpu {
+
+    namespace {
+        constexpr UINT constants_alignment{ 256 };
+        // Made up, above the addresses of the buffers.
+        constexpr D3D12_GPU_VIRTUAL_ADDRESS constants_gpu_address_base{ 0x8000'0000'0000ull };
+    } // anonymous namespace
+
+    null_device::null_device(UINT constant_buffer_size)
+        : _constants{ std::make_unique<UINT8[]>(constant_buffer_size) }, _constants_size{ constant_buffer_size }
+    {
+        assert(constant_buffer_size);
+    }
+
+    null_device::~null_device()
+    {
+        // NOTE: the textures, root signatures and pipeline states are only handles. Content and lights
+        //       release theirs when they shut down, so this checks nothing is left of them.
+        assert(!_pipeline_state_count && !_root_signature_count);
+    }
+
+    buffer null_device::create_buffer(const void* const data, UINT size)
+    {
+        assert(data && size);
+        return buffer{ next_handle(), next_gpu_address(size), nullptr, size };
+    }
+
+    buffer null_device::create_upload_buffer(UINT size)
+    {
+        assert(size);
+        const UINT aligned_size{ (UINT)math::align_size_up<constants_alignment>(size) };
+        UINT8* const memory{ new UINT8[aligned_size]{} };
+        return buffer{ memory, next_gpu_address(aligned_size), memory, aligned_size };
+    }
+
+    void null_device::release_buffer(buffer& b)
+    {
+        // NOTE: upload buffers are the only ones with memory behind them, and their handle is the memory.
+        if (b.cpu_address) delete[] b.cpu_address;
+        b = {};
+    }
+
+    texture null_device::create_texture(const texture_desc& desc)
+    {
+        assert(desc.subresources && desc.width && desc.height && desc.mip_levels <= max_texture_mips);
+        return texture{ next_handle(), _descriptor_count++ };
+    }
+
+    void null_device::release_texture(texture& t)
+    {
+        t = {};
+    }
+
+    ID3D12RootSignature* null_device::create_root_signature(content::material_type::type type, UINT shader_flags)
+    {
+        assert(type < content::material_type::count && shader_flags);
+        ++_root_signature_count;
+        return (ID3D12RootSignature*)next_handle();
+    }
+
+    ID3D12PipelineState* null_device::create_pipeline_state(const pipeline_state_desc& desc)
+    {
+        assert(desc.root_signature && desc.pass < pipeline_pass::count);
+        ++_pipeline_state_count;
+        return (ID3D12PipelineState*)next_handle();
+    }
+
+    void null_device::release_root_signature(ID3D12RootSignature* root_signature)
+    {
+        assert(root_signature && _root_signature_count);
+        --_root_signature_count;
+    }
+
+    void null_device::release_pipeline_state(ID3D12PipelineState* pipeline_state)
+    {
+        assert(pipeline_state && _pipeline_state_count);
+        --_pipeline_state_count;
+    }
+
+    // NOTE: takes a lock like resource::constant_buffer, so the costs of the job threads that fill the
+    //       per object data are the same.
+    UINT8* null_device::allocate_constants(UINT size)
+    {
+        std::lock_guard lock{ _constants_mutex };
+        const UINT aligned_size{ (UINT)math::align_size_up<constants_alignment>(size) };
+        assert(_constants_offset + aligned_size <= _constants_size);
+        if (_constants_offset + aligned_size > _constants_size) return nullptr;
+
+        UINT8* const address{ &_constants[_constants_offset] };
+        _constants_offset += aligned_size;
+        return address;
+    }
+
+    D3D12_GPU_VIRTUAL_ADDRESS null_device::constants_gpu_address(const void* const allocation)
+    {
+        std::lock_guard lock{ _constants_mutex };
+        const UINT8* const address{ (const UINT8*)allocation };
+        assert(address >= _constants.get() && address < _constants.get() + _constants_offset);
+        return constants_gpu_address_base + (D3D12_GPU_VIRTUAL_ADDRESS)(address - _constants.get());
+    }
+
+    void null_device::begin_frame()
+    {
+        std::lock_guard lock{ _constants_mutex };
+        _constants_offset = 0;
+    }
+
+    void* null_device::next_handle()
+    {
+        return (void*)(_next_handle += 0x100);
+    }
+
+    D3D12_GPU_VIRTUAL_ADDRESS null_device::next_gpu_address(UINT size)
+    {
+        return _next_gpu_address.fetch_add(math::align_size_up<constants_alignment>(size));
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "stdafx.h"
+#include "GpuDevice.h"
+#include <atomic>
+
+namespace gpu {
+
+    // A device without a GPU, for running the renderer's CPU side headless (see bench/FrameBench.cpp).
+    // Handles, GPU addresses and descriptor indices are only distinct, nothing is created. Upload buffers
+    // and the constant buffer are CPU memory, so what the CPU writes to them can be read back.
+    class null_device final : public device
+    {
+    public:
+        explicit null_device(UINT constant_buffer_size);
+        ~null_device() override;
+        DISABLE_COPY_AND_MOVE(null_device);
+
+        [[nodiscard]] buffer create_buffer(const void* const data, UINT size) override;
+        [[nodiscard]] buffer create_upload_buffer(UINT size) override;
+        void release_buffer(buffer& b) override;
+
+        [[nodiscard]] texture create_texture(const texture_desc& desc) override;
+        void release_texture(texture& t) override;
+
+        [[nodiscard]] ID3D12RootSignature* create_root_signature(content::material_type::type type, UINT shader_flags) override;
+        [[nodiscard]] ID3D12PipelineState* create_pipeline_state(const pipeline_state_desc& desc) override;
+        void release_root_signature(ID3D12RootSignature* root_signature) override;
+        void release_pipeline_state(ID3D12PipelineState* pipeline_state) override;
+
+        [[nodiscard]] UINT8* allocate_constants(UINT size) override;
+        [[nodiscard]] D3D12_GPU_VIRTUAL_ADDRESS constants_gpu_address(const void* const allocation) override;
+
+        // What core::render() does with its constant buffer at the start of a frame.
+        void begin_frame();
+
+        [[nodiscard]] UINT pipeline_state_count() const { return _pipeline_state_count; }
+        [[nodiscard]] UINT root_signature_count() const { return _root_signature_count; }
+
+    private:
+        [[nodiscard]] void* next_handle();
+        [[nodiscard]] D3D12_GPU_VIRTUAL_ADDRESS next_gpu_address(UINT size);
+
+        std::unique_ptr<UINT8[]>                _constants;
+        std::mutex                              _constants_mutex;
+        UINT                                    _constants_size;
+        UINT                                    _constants_offset{ 0 };
+
+        std::atomic<uintptr_t>                  _next_handle{ 0x1000 };
+        std::atomic<D3D12_GPU_VIRTUAL_ADDRESS>  _next_gpu_address{ 0x1'0000'0000ull };
+        std::atomic<UINT>                       _descriptor_count{ 0 };
+        std::atomic<UINT>                       _pipeline_state_count{ 0 };
+        std::atomic<UINT>                       _root_signature_count{ 0 };
+    };
+}
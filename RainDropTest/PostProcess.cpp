@@ -3,7 +3,7 @@
 #include "Helpers.h"
 #include "Shaders.h"
 #include "GraphicPass.h"
-#include "Lights.h"
+#include "LightCulling.h"
 
 namespace post_process {
 
@@ -0,0 +1,273 @@
+#pragma once
+#include "stdafx.h"
+#include <atomic>
+
+namespace utl {
+
+    constexpr UINT64 cache_line_size{ 64 };
+
+    namespace detail {
+
+        // Bounded ring queue after Dmitry Vyukov's MPMC queue. Every cell carries a sequence number
+        // that says whether it's the turn of a producer or of a consumer for that cell, so a push or a pop
+        // is one CAS on the shared position (a plain store when only one thread uses that side)
+        // followed by one store of the sequence number. No locks, and no allocation after construction.
+        template<typename T, UINT capacity, bool multi_producer, bool multi_consumer>
+        class bounded_queue
+        {
+            static_assert(capacity >= 2 && !(capacity & (capacity - 1)), "Capacity must be a power of 2.");
+        public:
+            using value_type = T;
+
+            bounded_queue()
+            {
+                for (UINT64 i{ 0 }; i < capacity; ++i)
+                {
+                    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            DISABLE_COPY_AND_MOVE(bounded_queue);
+
+            ~bounded_queue()
+            {
+                // Destroy whatever was never popped.
+                UINT64 position{ m_dequeue_position.value.load(std::memory_order_relaxed) };
+                const UINT64 end{ m_enqueue_position.value.load(std::memory_order_relaxed) };
+                for (; position != end; ++position)
+                {
+                    cell& c{ m_cells[position & mask] };
+                    if (c.sequence.load(std::memory_order_relaxed) == position + 1)
+                    {
+                        ((T*)c.storage)->~T();
+                    }
+                }
+            }
+
+            // Returns false if the queue is full. 'p' is only used when the push succeeds.
+            template<typename... params>
+            [[nodiscard]] bool try_push(params&&... p)
+            {
+                UINT64 position{ m_enqueue_position.value.load(std::memory_order_relaxed) };
+                cell* c{ nullptr };
+                while (true)
+                {
+                    c = &m_cells[position & mask];
+                    const UINT64 sequence{ c->sequence.load(std::memory_order_acquire) };
+                    const INT64 difference{ (INT64)sequence - (INT64)position };
+                    if (difference == 0)
+                    {
+                        if constexpr (multi_producer)
+                        {
+                            if (m_enqueue_position.value.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                        }
+                        else
+                        {
+                            m_enqueue_position.value.store(position + 1, std::memory_order_relaxed);
+                            break;
+                        }
+                    }
+                    else if (difference < 0)
+                    {
+                        // The consumer hasn't freed this cell yet, the queue is full.
+                        return false;
+                    }
+                    else
+                    {
+                        // Another producer took this cell.
+                        position = m_enqueue_position.value.load(std::memory_order_relaxed);
+                    }
+                }
+
+                new (c->storage) T(std::forward<params>(p)...);
+                c->sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Returns false if the queue is empty.
+            [[nodiscard]] bool try_pop(T& item)
+            {
+                UINT64 position{ m_dequeue_position.value.load(std::memory_order_relaxed) };
+                cell* c{ nullptr };
+                while (true)
+                {
+                    c = &m_cells[position & mask];
+                    const UINT64 sequence{ c->sequence.load(std::memory_order_acquire) };
+                    const INT64 difference{ (INT64)sequence - (INT64)(position + 1) };
+                    if (difference == 0)
+                    {
+                        if constexpr (multi_consumer)
+                        {
+                            if (m_dequeue_position.value.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                        }
+                        else
+                        {
+                            m_dequeue_position.value.store(position + 1, std::memory_order_relaxed);
+                            break;
+                        }
+                    }
+                    else if (difference < 0)
+                    {
+                        // Nothing was pushed to this cell yet, the queue is empty.
+                        return false;
+                    }
+                    else
+                    {
+                        // Another consumer took this cell.
+                        position = m_dequeue_position.value.load(std::memory_order_relaxed);
+                    }
+                }
+
+                T* const stored{ (T*)c->storage };
+                item = std::move(*stored);
+                stored->~T();
+                // Hand the cell to the producer that wraps around to it.
+                c->sequence.store(position + capacity, std::memory_order_release);
+                return true;
+            }
+
+            // Only a hint while other threads push or pop.
+            [[nodiscard]] UINT64 size_approx() const
+            {
+                const UINT64 dequeue_position{ m_dequeue_position.value.load(std::memory_order_relaxed) };
+                const UINT64 enqueue_position{ m_enqueue_position.value.load(std::memory_order_relaxed) };
+                return enqueue_position > dequeue_position ? enqueue_position - dequeue_position : 0;
+            }
+
+            [[nodiscard]] static constexpr UINT max_size() { return capacity; }
+
+        private:
+            static constexpr UINT64 mask{ capacity - 1 };
+
+            struct cell
+            {
+                std::atomic<UINT64> sequence;
+                alignas(T) UINT8 storage[sizeof(T)];
+            };
+
+            // Producers and consumers each get their own cache line.
+            struct alignas(cache_line_size) padded_position
+            {
+                std::atomic<UINT64> value{ 0 };
+            };
+
+            padded_position                 m_enqueue_position;
+            padded_position                 m_dequeue_position;
+            alignas(cache_line_size) cell   m_cells[capacity];
+        };
+    } // namespace detail
+
+    // One producer thread, one consumer thread.
+    template<typename T, UINT capacity>
+    using spsc_queue = detail::bounded_queue<T, capacity, false, false>;
+
+    // Any number of producer threads, one consumer thread.
+    template<typename T, UINT capacity>
+    using mpsc_queue = detail::bounded_queue<T, capacity, true, false>;
+
+    // Any number of producer and consumer threads.
+    template<typename T, UINT capacity>
+    using mpmc_queue = detail::bounded_queue<T, capacity, true, true>;
+
+    // Wraps one of the queues above with push() and pop() that sleep instead of spinning when
+    // the queue is full or empty. The fast path stays lock-free. Waiting uses std::atomic::wait,
+    // which is a futex on Linux and WaitOnAddress on Windows. Sleepers are counted, so push and pop
+    // only wake other threads when someone actually waits.
+    template<typename queue>
+    class blocking_queue
+    {
+    public:
+        using value_type = typename queue::value_type;
+
+        blocking_queue() = default;
+        DISABLE_COPY_AND_MOVE(blocking_queue);
+
+        // Waits while the queue is full. Returns false if the queue was closed.
+        template<typename... params>
+        bool push(params&&... p)
+        {
+            while (true)
+            {
+                const UINT pop_count{ m_pop_count.load(std::memory_order_acquire) };
+                if (m_closed.load(std::memory_order_acquire)) return false;
+                if (try_push(std::forward<params>(p)...)) return true;
+                wait(m_pop_count, pop_count, m_waiting_producers);
+            }
+        }
+
+        template<typename... params>
+        [[nodiscard]] bool try_push(params&&... p)
+        {
+            if (!m_queue.try_push(std::forward<params>(p)...)) return false;
+            signal(m_push_count, m_waiting_consumers);
+            return true;
+        }
+
+        // Waits until there's an item. Returns false if the queue was closed and is empty.
+        bool pop(value_type& item)
+        {
+            while (true)
+            {
+                const UINT push_count{ m_push_count.load(std::memory_order_acquire) };
+                if (try_pop(item)) return true;
+                if (m_closed.load(std::memory_order_acquire)) return false;
+                wait(m_push_count, push_count, m_waiting_consumers);
+            }
+        }
+
+        [[nodiscard]] bool try_pop(value_type& item)
+        {
+            if (!m_queue.try_pop(item)) return false;
+            signal(m_pop_count, m_waiting_producers);
+            return true;
+        }
+
+        // Wakes up every waiting thread. Items still in the queue can be popped after closing.
+        void close()
+        {
+            m_closed.store(true, std::memory_order_release);
+            m_push_count.fetch_add(1, std::memory_order_seq_cst);
+            m_pop_count.fetch_add(1, std::memory_order_seq_cst);
+            m_push_count.notify_all();
+            m_pop_count.notify_all();
+        }
+
+        // Allows pushing again after close(). Nobody may be waiting on the queue.
+        void reopen()
+        {
+            m_closed.store(false, std::memory_order_release);
+        }
+
+        [[nodiscard]] bool is_closed() const { return m_closed.load(std::memory_order_acquire); }
+        [[nodiscard]] UINT64 size_approx() const { return m_queue.size_approx(); }
+
+    private:
+        static void signal(std::atomic<UINT>& counter, const std::atomic<UINT>& waiting)
+        {
+            // NOTE: seq_cst on both sides. Either the waiter sees the new count and doesn't sleep,
+            //       or we see the waiter and wake it up.
+            counter.fetch_add(1, std::memory_order_seq_cst);
+            if (waiting.load(std::memory_order_seq_cst))
+            {
+                counter.notify_all();
+            }
+        }
+
+        static void wait(std::atomic<UINT>& counter, UINT seen, std::atomic<UINT>& waiting)
+        {
+            waiting.fetch_add(1, std::memory_order_seq_cst);
+            if (counter.load(std::memory_order_seq_cst) == seen)
+            {
+                counter.wait(seen, std::memory_order_acquire);
+            }
+            waiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        queue                   m_queue;
+        std::atomic<UINT>       m_push_count{ 0 };
+        std::atomic<UINT>       m_pop_count{ 0 };
+        std::atomic<UINT>       m_waiting_producers{ 0 };
+        std::atomic<UINT>       m_waiting_consumers{ 0 };
+        std::atomic<bool>       m_closed{ false };
+    };
+}
@@ -327,6 +327,7 @@ namespace rain_drop {
 
     void RainDrop::update(UINT camera_id, UINT frame_index)
     {
+        if (!camera::is_valid(camera_id)) return;
         camera::Camera& camera{ camera::get(camera_id) };
 
         hlsl::GlobalShaderData constant_buffer_gs = {};
@@ -462,7 +463,9 @@ namespace rain_drop {
             }
             else
             {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                // Sleep until set_rain_state() or shutdown() sends a message.
+                thread_message message{};
+                m_thread_messages.pop(message);
             }
         }
 
@@ -541,6 +544,7 @@ namespace rain_drop {
     {
         // Notify the compute threads that the app is shutting down.
         InterlockedExchange(&m_terminating, 1);
+        m_thread_messages.close();
         WaitForMultipleObjects(1, &m_thread_handle, TRUE, INFINITE);
     }
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "Surface.h"
 #include "Command.h"
 #include "Camera.h"
+#include "Queue.h"
 
 // InterlockedCompareExchange returns the object's value if the 
 // comparison fails.  If it is already 0, then its value won't 
@@ -32,7 +33,13 @@ namespace rain_drop {
 
         void shutdown();
 
-        void set_rain_state(bool state) { m_rain_on = state; }
+        void set_rain_state(bool state)
+        {
+            m_rain_on = state;
+            // Wakes up the compute thread if it's waiting. If the queue is full the thread has
+            // messages to read anyway, so a failed push can be ignored.
+            (void)m_thread_messages.try_push(thread_message::state_changed);
+        }
 
     private:
         static const float Particle_Spread;
@@ -95,6 +102,13 @@ namespace rain_drop {
 
         // Thread state.
         LONG volatile m_terminating{ 0 };
+
+        // Sent from the main thread to the compute thread, which waits on them while the rain is off.
+        enum class thread_message : UINT
+        {
+            state_changed,
+        };
+        utl::blocking_queue<utl::spsc_queue<thread_message, 16>> m_thread_messages{};
         // TODO: why 2 m_render_context_fence_value?
         UINT64 volatile m_render_context_fence_value2{ 0 };
         UINT64 volatile m_thread_fence_value{ 0 };
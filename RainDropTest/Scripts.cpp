@@ -1,9 +1,10 @@
-#include <unordered_map>
 #include "Scripts.h"
 #include "Math.h"
 #include "Entity.h"
-#include "Input.h"
 #include "Transform.h"
+#include "Jobs.h"
+#include "FlatHashMap.h"
+#include "Vector.h"
 #include <deque>
 
 #define USE_TRANSFORM_CACHE_MAP 0
@@ -12,18 +13,22 @@ namespace script {
 
     namespace {
 
+        // Freed ids are only reused once there are more than this many.
+        constexpr UINT min_deleted_elements{ 4 };
+
         utl::vector<detail::script_ptr> entity_scripts;
         utl::vector<UINT> id_mapping;
 
         utl::vector<UINT> ids;
         std::deque<UINT> free_ids;
 
-        utl::vector<transform::component_cache> transform_cache;
+        // NOTE: scripts are updated in parallel, so every job thread writes to its own cache.
+        utl::vector<transform::component_cache> transform_caches[jobs::max_thread_count];
 #if USE_TRANSFORM_CACHE_MAP
-        std::unordered_map<UINT, UINT>    cache_map;
+        utl::flat_hash_map<UINT, UINT>    cache_maps[jobs::max_thread_count];
 #endif
 
-        using script_registry = std::unordered_map<size_t, detail::script_creator>;
+        using script_registry = utl::flat_hash_map<utl::hashed_name, detail::script_creator>;
         script_registry& registry()
         {
             // NOTE: we put this static variable in a function because of
@@ -45,6 +50,8 @@ namespace script {
         {
             assert(game_entity::is_alive((*entity).get_id()));
             const UINT id{ (*entity).transform().get_id() };
+            utl::vector<transform::component_cache>& transform_cache{ transform_caches[jobs::thread_index()] };
+            utl::flat_hash_map<UINT, UINT>& cache_map{ cache_maps[jobs::thread_index()] };
 
             UINT index{ Invalid_Index };
             auto pair = cache_map.try_emplace(id, Invalid_Index);
@@ -70,6 +77,7 @@ namespace script {
         {
             assert(game_entity::is_alive((*entity).get_id()));
             const UINT id{ (*entity).transform().get_id() };
+            utl::vector<transform::component_cache>& transform_cache{ transform_caches[jobs::thread_index()] };
 
             for (auto& cache : transform_cache)
             {
@@ -90,14 +98,14 @@ namespace script {
     } // anonymous namespace
 
     namespace detail {
-        UINT8 register_script(size_t tag, script_creator func)
+        UINT8 register_script(utl::hashed_name tag, script_creator func)
         {
             bool result{ registry().insert(script_registry::value_type{tag, func}).second };
             assert(result);
             return result;
         }
 
-        script_creator get_script_creator(size_t tag)
+        script_creator get_script_creator(utl::hashed_name tag)
         {
             auto script = registry().find(tag);
             assert(script != registry().end() && script->first == tag);
@@ -105,117 +113,6 @@ namespace script {
         }
     }
 
-    class camera_script;
-    REGISTER_SCRIPT(camera_script);
-    camera_script::camera_script(game_entity::entity entity)
-        : script::entity_script{ entity }
-    {
-        _input_system.add_handler(input::input_source::mouse, this, &camera_script::mouse_move);
-
-        const UINT64 binding{ std::hash<std::string>()("move") };
-        _input_system.add_handler(binding, this, &camera_script::on_move);
-
-        XMFLOAT3 pos{ position() };
-        _desired_position = _position = DirectX::XMLoadFloat3(&pos);
-
-        XMFLOAT3 dir{ orientation() };
-        float theta{ DirectX::XMScalarACos(dir.y) };
-        float phi{ std::atan2(-dir.z, dir.x) };
-        XMFLOAT3 rot{ theta - math::half_pi, phi + math::half_pi, 0.f };
-        _desired_spherical = _spherical = DirectX::XMLoadFloat3(&rot);
-    }
-
-    void camera_script::update(float dt)
-    {
-        using namespace DirectX;
-
-        if (_move_magnitude > math::epsilon)
-        {
-            const float fps_scale{ dt / 0.016667f };
-            XMFLOAT4 rot{ rotation() };
-            XMVECTOR d{ XMVector3Rotate(_move * 0.05f * fps_scale, XMLoadFloat4(&rot)) };
-            if (_position_acceleration < 1.f) _position_acceleration += (0.02f * fps_scale);
-            _desired_position += (d * _position_acceleration);
-            _move_position = true;
-        }
-        else if (_move_position)
-        {
-            _position_acceleration = 0.f;
-        }
-
-        if (_move_position || _move_rotation)
-        {
-            camera_seek(dt);
-        }
-    }
-
-    void camera_script::on_move(UINT64 binding, const input::input_value& value)
-    {
-        using namespace DirectX;
-
-        _move = XMLoadFloat3(&value.current);
-        _move_magnitude = XMVectorGetX(XMVector3LengthSq(_move));
-    }
-
-    void camera_script::mouse_move(input::input_source::type type, input::input_code::code code, const input::input_value& mouse_pos)
-    {
-        using namespace DirectX;
-
-        if (code == input::input_code::mouse_position)
-        {
-            input::input_value value;
-            input::get(input::input_source::mouse, input::input_code::mouse_left, value);
-            if (value.current.z == 0.f) return;
-
-            const float scale{ 0.005f };
-            const float dx{ (mouse_pos.current.x - mouse_pos.previous.x) * scale };
-            const float dy{ (mouse_pos.current.y - mouse_pos.previous.y) * scale };
-
-            XMFLOAT3 spherical;
-            DirectX::XMStoreFloat3(&spherical, _desired_spherical);
-            spherical.x += dy;
-            spherical.y -= dx;
-            spherical.x = math::clamp(spherical.x, 0.0001f - math::half_pi, math::half_pi - 0.0001f);
-
-            _desired_spherical = DirectX::XMLoadFloat3(&spherical);
-            _move_rotation = true;
-        }
-    }
-
-    void camera_script::camera_seek(float dt)
-    {
-        using namespace DirectX;
-        XMVECTOR p{ _desired_position - _position };
-        XMVECTOR o{ _desired_spherical - _spherical };
-
-        _move_position = (XMVectorGetX(XMVector3LengthSq(p)) > math::epsilon);
-        _move_rotation = (XMVectorGetX(XMVector3LengthSq(o)) > math::epsilon);
-
-        const float scale{ 0.2f * dt / 0.016667f };
-
-        if (_move_position)
-        {
-            _position += (p * scale);
-            XMFLOAT3 new_pos;
-            XMStoreFloat3(&new_pos, _position);
-            set_position(new_pos);
-        }
-
-        if (_move_rotation)
-        {
-            _spherical += (o * scale);
-            XMFLOAT3 new_rot;
-            XMStoreFloat3(&new_rot, _spherical);
-            new_rot.x = math::clamp(new_rot.x, 0.0001f - math::half_pi, math::half_pi - 0.0001f);
-            _spherical = DirectX::XMLoadFloat3(&new_rot);
-
-            DirectX::XMVECTOR quat{ DirectX::XMQuaternionRotationRollPitchYawFromVector(_spherical) };
-            XMFLOAT4 rot_quat;
-            DirectX::XMStoreFloat4(&rot_quat, quat);
-            set_rotation(rot_quat);
-        }
-    }
-
     void entity_script::set_rotation(const game_entity::entity* const entity, XMFLOAT4 rotation_quaternion)
     {
         transform::component_cache& cache{ *get_cache_ptr(entity) };
@@ -250,7 +147,7 @@ namespace script {
         assert(info.script_creator);
         UINT id;
 
-        if (free_ids.size() > game_entity::min_deleted_elements)
+        if (free_ids.size() > min_deleted_elements)
         {
             id = free_ids.front();
             assert(!exists(id));
@@ -264,8 +161,8 @@ namespace script {
             ids.push_back(id);
         }
 
+        id_mapping[id] = (UINT)entity_scripts.size();
         entity_scripts.emplace_back(info.script_creator(entity));
-        id_mapping[id] = id;
 
         // NOTE: each entity has a transform component. Therefor, id's for transform components
         //       are exactly the same as entity ids.
@@ -285,18 +182,25 @@ namespace script {
 
     void update(float dt)
     {
-        for (auto& ptr : entity_scripts)
-        {
-            ptr->update(dt);
-        }
+        jobs::parallel_for((UINT)entity_scripts.size(), 16, [dt](UINT begin, UINT end) {
+            for (UINT i{ begin }; i < end; ++i)
+            {
+                entity_scripts[i]->update(dt);
+            }
+            });
 
-        if (transform_cache.size())
+        // NOTE: an entity only has one script, so the caches never share an id and the order they are applied in doesn't matter.
+        for (UINT i{ 0 }; i < jobs::thread_count(); ++i)
         {
-            transform::update(transform_cache.data(), (UINT)transform_cache.size());
-            transform_cache.clear();
+            utl::vector<transform::component_cache>& transform_cache{ transform_caches[i] };
+            if (transform_cache.size())
+            {
+                transform::update(transform_cache.data(), (UINT)transform_cache.size());
+                transform_cache.clear();
 #if USE_TRANSFORM_CACHE_MAP
-            cache_map.clear();
+                cache_maps[i].clear();
 #endif
+            }
         }
     }
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 #pragma once
-#include "Input.h"
 #include "Entity.h"
+#include "HashedName.h"
 
 namespace script
 {
@@ -40,8 +40,8 @@ namespace script
         using script_ptr = std::unique_ptr<entity_script>;
         using script_creator = script_ptr(*)(game_entity::entity entity);
 
-        UINT8 register_script(size_t, script_creator);
-        script_creator get_script_creator(size_t tap);
+        UINT8 register_script(utl::hashed_name, script_creator);
+        script_creator get_script_creator(utl::hashed_name tag);
 
         template<class script_class>
         script_ptr create_script(game_entity::entity entity)
@@ -51,34 +51,6 @@ namespace script
         }
     }
 
-    class camera_script : public script::entity_script
-    {
-    public:
-        camera_script() = default;
-        ~camera_script() = default;
-        explicit camera_script(game_entity::entity entity);
-        void begin_play() override {}
-        void update(float dt) override;
-
-    private:
-
-        void on_move(UINT64 binding, const input::input_value& value);
-        void mouse_move(input::input_source::type type, input::input_code::code code, const input::input_value& mouse_pos);
-        void camera_seek(float dt);
-
-        input::input_system<camera_script>  _input_system{};
-
-        DirectX::XMVECTOR                   _desired_position;
-        DirectX::XMVECTOR                   _desired_spherical;
-        DirectX::XMVECTOR                   _position;
-        DirectX::XMVECTOR                   _spherical;
-        DirectX::XMVECTOR                   _move{};
-        float                               _move_magnitude{ 0.f };
-        float                               _position_acceleration{ 0.f };
-        bool                                _move_position{ false };
-        bool                                _move_rotation{ false };
-    };
-
     struct init_info
     {
         detail::script_creator script_creator;
@@ -91,6 +63,6 @@ namespace script
 #define REGISTER_SCRIPT(TYPE) \
     namespace { \
        const UINT8 _reg_##TYPE { \
-           script::detail::register_script( std::hash<std::string>()(#TYPE), script::detail::create_script<TYPE>) }; \
+           script::detail::register_script( utl::hashed_name{ #TYPE }, script::detail::create_script<TYPE>) }; \
     }
 }
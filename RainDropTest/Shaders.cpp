@@ -4,6 +4,8 @@
 
 #include "Shaders.h"
 #include "Utilities.h"
+#include "MappedFile.h"
+#include "SmallVector.h"
 
 // NOTE: we wouldn't need to do this if DXC had a NuGet package.
 #pragma comment(lib, "../packages/DirectXShaderCompiler/lib/x64/dxcompiler.lib")
@@ -51,7 +53,8 @@ namespace shaders {
         // This is a chunk of memory that contains all compiled engine shaders.
         // The blob is an array of shader byte code consisting of a u64 size and 
         // an array of bytes.
-        std::unique_ptr<UINT8[]> engine_shaders_blob{};
+        // NOTE: the file stays mapped until shutdown, engine_shaders point into it.
+        utl::mapped_file engine_shaders_blob{};
 
         shader_file_info shader_files[]
         {
@@ -127,10 +130,10 @@ namespace shaders {
 
         bool load_engine_shaders()
         {
-            assert(!engine_shaders_blob);
-            UINT64 size{ 0 };
-            bool result{ utl::read_file(engine_shader_file, engine_shaders_blob, size) };
-            assert(engine_shaders_blob && size);
+            assert(!engine_shaders_blob.is_open());
+            bool result{ engine_shaders_blob.open(engine_shader_file) };
+            const UINT64 size{ engine_shaders_blob.size() };
+            assert(result && size);
 
             UINT64 offset{ 0 };
             UINT index{ 0 };
@@ -141,7 +144,7 @@ namespace shaders {
                 assert(!shader);
                 result &= index < engine_shader::count && !shader;
                 if (!result) break;
-                shader = reinterpret_cast<const compiled_shader_ptr>(&engine_shaders_blob[offset]);
+                shader = reinterpret_cast<const compiled_shader_ptr>(&engine_shaders_blob.data()[offset]);
                 offset += shader->buffer_size();
                 ++index;
             }
@@ -193,7 +196,7 @@ namespace shaders {
         buffer.Ptr = source_blob->GetBufferPointer();
         buffer.Size = source_blob->GetBufferSize();
 
-        utl::vector<LPCWSTR> args;
+        utl::small_vector<LPCWSTR, 32> args;
         for (const auto& arg : compiler_args)
         {
             args.emplace_back(arg.c_str());
@@ -300,7 +303,7 @@ namespace shaders {
         {
             engine_shaders[i] = {};
         }
-        engine_shaders_blob.reset();
+        engine_shaders_blob.close();
     }
 
     UINT element_type_to_shader_id(UINT key)
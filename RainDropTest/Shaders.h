@@ -1,58 +1,11 @@
 #pragma once
 #include "stdafx.h"
 #include "Vector.h"
+#include "ShaderTypes.h"
 #include "../packages/DirectXShaderCompiler/inc/d3d12shader.h"
 #include "../packages/DirectXShaderCompiler/inc/dxcapi.h"
 
 namespace shaders {
-    struct shader_type {
-        enum type : UINT {
-            vertex = 0,
-            hull,
-            domain,
-            geometry,
-            pixel,
-            compute,
-            amplification,
-            mesh,
-
-            count
-        };
-    };
-
-    struct shader_flags {
-        enum flags : UINT {
-            none          = 0x00,
-            vertex        = 0x01,
-            hull          = 0x02,
-            domain        = 0x04,
-            geometry      = 0x08,
-            pixel         = 0x10,
-            compute       = 0x20,
-            amplification = 0x40,
-            mesh          = 0x80,
-        };
-    };
-
-    struct engine_shader {
-        enum index : UINT {
-            full_screen_triangle_vs,
-            post_process_ps,
-            grid_frustums_cs,
-            light_culling_cs,
-            n_body_gravity_cs,
-            particle_draw_vs,
-            particle_draw_gs,
-            particle_draw_ps,
-            pixel_shader_ps,
-            texture_shader_ps,
-            normal_shader_vs,
-            normal_texture_shader_vs,
-
-            count
-        };
-    };
-
     struct shader_file_info
     {
         UINT shader_index;
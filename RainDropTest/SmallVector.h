@@ -0,0 +1,427 @@
+#pragma once
+#include "stdafx.h"
+#include "Vector.h"
+
+namespace utl {
+
+    // Same interface as utl::vector, but the first N items are stored inside the
+    // object itself. Nothing is allocated until the vector grows beyond N items,
+    // then the items are moved to the heap and it behaves like utl::vector.
+    // NOTE: the data pointer isn't stored while items are inline, so a small_vector
+    //       can be relocated with memcpy (e.g. by utl::vector) like any other item.
+    //       items are moved with memcpy and realloc() only, so T must be trivially relocatable.
+    template<typename T, UINT N, bool destruct = true>
+    class small_vector
+    {
+        static_assert(N > 0);
+        static_assert(is_trivially_relocatable_v<T>, "small_vector moves its items as bytes. Use utl::vector for this type.");
+    public:
+        // Default constructor. Doesn't allocate memory.
+        small_vector() = default;
+
+        // Constructor resizes the vector and initializes 'count' items.
+        constexpr explicit small_vector(UINT64 count)
+        {
+            resize(count);
+        }
+
+        // Constructor resizes the vector and initializes 'count' items using 'value'.
+        constexpr explicit small_vector(UINT64 count, const T& value)
+        {
+            resize(count, value);
+        }
+
+        // Copy-constructor. Constructs by copying another vector. The items
+        // in the copied vector must be copyable.
+        constexpr small_vector(const small_vector& o)
+        {
+            *this = o;
+        }
+
+        // Move-constructor. Constructs by moving another vector.
+        // The original vector will be empty after move.
+        constexpr small_vector(small_vector&& o)
+        {
+            move(o);
+        }
+
+        // Copy-assignment operator. Clears this vector and copies items
+        // from another vector. The items must be copyable.
+        constexpr small_vector& operator=(const small_vector& o)
+        {
+            assert(this != std::addressof(o));
+            if (this != std::addressof(o))
+            {
+                clear();
+                reserve(o._size);
+                for (auto& item : o)
+                {
+                    emplace_back(item);
+                }
+                assert(_size == o._size);
+            }
+
+            return *this;
+        }
+
+        // Move-assignment operator. Frees all resources in this vector and
+        // moves the other vector into this one.
+        constexpr small_vector& operator=(small_vector&& o)
+        {
+            assert(this != std::addressof(o));
+            if (this != std::addressof(o))
+            {
+                destroy();
+                move(o);
+            }
+
+            return *this;
+        }
+
+        // Destructs the vector and its items as specified in template argument
+        ~small_vector() { destroy(); }
+
+        // Inserts an item at the end of the vector by copying 'value'.
+        constexpr void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        // Inserts an item at the end of the vector by moving 'value'.
+        constexpr void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        // Copy- or move-constructs an item at the end of the vector.
+        template<typename... params>
+        constexpr decltype(auto) emplace_back(params&&... p)
+        {
+            if (_size == _capacity)
+            {
+                reserve(((_capacity + 1) * 3) >> 1); // reserve 50% more
+            }
+            assert(_size < _capacity);
+
+            T* const item{ new (std::addressof(data()[_size])) T(std::forward<params>(p)...) };
+            ++_size;
+            return *item;
+        }
+
+        // Resizes the vector and initializes new items with their default value.
+        constexpr void resize(UINT64 new_size)
+        {
+            static_assert(std::is_default_constructible<T>::value,
+                "Type must be default-constructible.");
+
+            if (new_size > _size)
+            {
+                reserve(new_size);
+                while (_size < new_size)
+                {
+                    emplace_back();
+                }
+            }
+            else if (new_size < _size)
+            {
+                if constexpr (destruct)
+                {
+                    destruct_range(new_size, _size);
+                }
+
+                _size = new_size;
+            }
+
+            // Do nothing if new_size == _size.
+            assert(new_size == _size);
+        }
+
+        // Resizes the vector and initializes new items by copying 'value'.
+        constexpr void resize(UINT64 new_size, const T& value)
+        {
+            static_assert(std::is_copy_constructible<T>::value,
+                "Type must be copy-constructible.");
+
+            if (new_size > _size)
+            {
+                reserve(new_size);
+                while (_size < new_size)
+                {
+                    emplace_back(value);
+                }
+            }
+            else if (new_size < _size)
+            {
+                if constexpr (destruct)
+                {
+                    destruct_range(new_size, _size);
+                }
+
+                _size = new_size;
+            }
+
+            // Do nothing if new_size == _size.
+            assert(new_size == _size);
+        }
+
+        // Allocates memory to contain the specified number of items.
+        // Does nothing while the items fit in the inline storage.
+        constexpr void reserve(UINT64 new_capacity)
+        {
+            if (new_capacity > _capacity)
+            {
+                if (_heap)
+                {
+                    // NOTE: realloc() will automatically copy the data in the buffer
+                    //       if a new region of memory is allocated.
+                    void* new_buffer{ realloc(_heap, new_capacity * sizeof(T)) };
+                    assert(new_buffer);
+                    if (new_buffer)
+                    {
+                        _heap = static_cast<T*>(new_buffer);
+                        _capacity = new_capacity;
+                    }
+                }
+                else
+                {
+                    // Spill the inline items to the heap.
+                    void* new_buffer{ malloc(new_capacity * sizeof(T)) };
+                    assert(new_buffer);
+                    if (new_buffer)
+                    {
+                        memcpy(new_buffer, _buffer, _size * sizeof(T));
+                        _heap = static_cast<T*>(new_buffer);
+                        _capacity = new_capacity;
+                    }
+                }
+            }
+        }
+
+        // Removes the item at specified index.
+        constexpr T* const erase(UINT64 index)
+        {
+            assert(index < _size);
+            return erase(std::addressof(data()[index]));
+        }
+
+        // Removes the item at specified location.
+        constexpr T* const erase(T* const item)
+        {
+            T* const items{ data() };
+            assert(item >= std::addressof(items[0]) &&
+                item < std::addressof(items[_size]));
+            if constexpr (destruct) item->~T();
+            --_size;
+            if (item < std::addressof(items[_size]))
+            {
+                memmove(item, item + 1, (std::addressof(items[_size]) - item) * sizeof(T));
+            }
+
+            return item;
+        }
+
+        // Same as erase() but faster because it just copies the last item.
+        constexpr T* const erase_unordered(UINT64 index)
+        {
+            assert(index < _size);
+            return erase_unordered(std::addressof(data()[index]));
+        }
+
+        // Same as erase() but faster because it just copies the last item.
+        constexpr T* const erase_unordered(T* const item)
+        {
+            T* const items{ data() };
+            assert(item >= std::addressof(items[0]) &&
+                item < std::addressof(items[_size]));
+            if constexpr (destruct) item->~T();
+            --_size;
+            if (item < std::addressof(items[_size]))
+            {
+                memcpy(item, std::addressof(items[_size]), sizeof(T));
+            }
+
+            return item;
+        }
+
+        // Clears the vector and destructs items as specified in template argument.
+        // Heap memory, if any, is kept for reuse.
+        constexpr void clear()
+        {
+            if constexpr (destruct)
+            {
+                destruct_range(0, _size);
+            }
+            _size = 0;
+        }
+
+        // Swaps two vectors
+        constexpr void swap(small_vector& o)
+        {
+            if (this != std::addressof(o))
+            {
+                auto temp(std::move(o));
+                o.move(*this);
+                move(temp);
+            }
+        }
+
+        // Pointer to the start of data. Never null.
+        [[nodiscard]] constexpr T* data()
+        {
+            return _heap ? _heap : (T*)_buffer;
+        }
+
+        // Pointer to the start of data. Never null.
+        [[nodiscard]] constexpr T* const data() const
+        {
+            return _heap ? _heap : (T*)_buffer;
+        }
+
+        // Returns true if vector is empty.
+        [[nodiscard]] constexpr bool empty() const
+        {
+            return _size == 0;
+        }
+
+        // Return the number of items in the vector.
+        [[nodiscard]] constexpr UINT64 size() const
+        {
+            return _size;
+        }
+
+        // Returns the current capacity of the vector.
+        [[nodiscard]] constexpr UINT64 capacity() const
+        {
+            return _capacity;
+        }
+
+        // Returns true while the items are stored inside the object.
+        [[nodiscard]] constexpr bool is_inline() const
+        {
+            return _heap == nullptr;
+        }
+
+        // Indexing operator. Returns a reference to the item at specified index.
+        [[nodiscard]] constexpr T& operator[](UINT64 index)
+        {
+            assert(index < _size);
+            return data()[index];
+        }
+
+        // Indexing operator. Returns a constant reference to the item at specified index.
+        [[nodiscard]] constexpr const T& operator[](UINT64 index) const
+        {
+            assert(index < _size);
+            return data()[index];
+        }
+
+        // Returns a reference to the first item. Will fault the application if called
+        // when the vector is empty.
+        [[nodiscard]] constexpr T& front()
+        {
+            assert(_size);
+            return data()[0];
+        }
+
+        // Returns a constant reference to the first item. Will fault the application
+        //  if called when the vector is empty.
+        [[nodiscard]] constexpr const T& front() const
+        {
+            assert(_size);
+            return data()[0];
+        }
+
+        // Returns a reference to the last item. Will fault the application if called
+        // when the vector is empty.
+        [[nodiscard]] constexpr T& back()
+        {
+            assert(_size);
+            return data()[_size - 1];
+        }
+
+        // Returns a constant reference to the last item. Will fault the application
+        //  if called when the vector is empty.
+        [[nodiscard]] constexpr const T& back() const
+        {
+            assert(_size);
+            return data()[_size - 1];
+        }
+
+        // Returns a pointer to the first item.
+        [[nodiscard]] constexpr T* begin()
+        {
+            return data();
+        }
+
+        // Returns a constant pointer to the first item.
+        [[nodiscard]] constexpr const T* begin() const
+        {
+            return data();
+        }
+
+        // Returns a pointer to the last item.
+        [[nodiscard]] constexpr T* end()
+        {
+            return data() + _size;
+        }
+
+        // Returns a constant pointer to the last item.
+        [[nodiscard]] constexpr const T* end() const
+        {
+            return data() + _size;
+        }
+
+    private:
+        constexpr void move(small_vector& o)
+        {
+            if (o._heap)
+            {
+                _heap = o._heap;
+                _capacity = o._capacity;
+            }
+            else
+            {
+                // Inline items are moved by copying their bytes, like utl::vector relocates items.
+                memcpy(_buffer, o._buffer, o._size * sizeof(T));
+                _heap = nullptr;
+                _capacity = N;
+            }
+            _size = o._size;
+            o.reset();
+        }
+
+        constexpr void reset()
+        {
+            _capacity = N;
+            _size = 0;
+            _heap = nullptr;
+        }
+
+        constexpr void destruct_range(UINT64 first, UINT64 last)
+        {
+            assert(destruct);
+            assert(first <= _size && last <= _size && first <= last);
+            T* const items{ data() };
+            for (; first != last; ++first)
+            {
+                items[first].~T();
+            }
+        }
+
+        constexpr void destroy()
+        {
+            clear();
+            if (_heap) free(_heap);
+            reset();
+        }
+
+        UINT64 _capacity{ N };
+        UINT64 _size{ 0 };
+        T* _heap{ nullptr };
+        alignas(T) UINT8 _buffer[N * sizeof(T)];
+    };
+
+    // Inline items are moved as bytes too (see move()), so utl::vector can keep using memcpy.
+    template<typename T, UINT N, bool destruct>
+    struct is_trivially_relocatable<small_vector<T, N, destruct>> : std::true_type {};
+}
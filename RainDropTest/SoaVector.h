@@ -0,0 +1,263 @@
+#pragma once
+#include "stdafx.h"
+#include "Vector.h"
+#include <algorithm>
+#include <span>
+#include <tuple>
+
+namespace utl {
+
+    // Structure-of-arrays container: one array ("column") per type in Ts, all with the same size.
+    // The columns share one allocation and each column starts on a 16 byte boundary, so every column
+    // can be handed to memcpy or SIMD code as is.
+    // Columns are accessed by index: data<0>(), column_span<1>(), get<2>(index).
+    // NOTE: only meant for plain data. Items are copied with memcpy and never destructed.
+    template<typename allocator, typename... Ts>
+    class basic_soa_vector
+    {
+        static_assert(sizeof...(Ts) > 0);
+        static_assert((std::is_trivially_copyable_v<Ts> && ...), "Column types must be trivially copyable.");
+        // NOTE: both heap_allocator and frame_allocator return memory aligned to 16 bytes.
+        static_assert(((alignof(Ts) <= 16) && ...), "Column types can't be aligned to more than 16 bytes.");
+    public:
+        static constexpr UINT column_count{ sizeof...(Ts) };
+
+        template<UINT column>
+        using column_type = std::tuple_element_t<column, std::tuple<Ts...>>;
+
+        basic_soa_vector() = default;
+
+        constexpr explicit basic_soa_vector(UINT64 count)
+        {
+            resize(count);
+        }
+
+        DISABLE_COPY(basic_soa_vector);
+
+        constexpr basic_soa_vector(basic_soa_vector&& o)
+        {
+            move(o);
+        }
+
+        constexpr basic_soa_vector& operator=(basic_soa_vector&& o)
+        {
+            assert(this != std::addressof(o));
+            if (this != std::addressof(o))
+            {
+                destroy();
+                move(o);
+            }
+            return *this;
+        }
+
+        ~basic_soa_vector() { destroy(); }
+
+        // Adds a row with value-initialized items. Returns its index.
+        constexpr UINT64 emplace_back()
+        {
+            grow_for_one();
+            const UINT64 index{ _size++ };
+            clear_rows(index, _size, std::index_sequence_for<Ts...>{});
+            return index;
+        }
+
+        // Adds a row with one value per column. Returns its index.
+        constexpr UINT64 emplace_back(const Ts&... values)
+        {
+            grow_for_one();
+            const UINT64 index{ _size++ };
+            set_row(index, std::index_sequence_for<Ts...>{}, values...);
+            return index;
+        }
+
+        // Resizes all columns. New rows are value-initialized.
+        constexpr void resize(UINT64 new_size)
+        {
+            const UINT64 old_size{ _size };
+            resize_uninitialized(new_size);
+            if (new_size > old_size)
+            {
+                clear_rows(old_size, new_size, std::index_sequence_for<Ts...>{});
+            }
+        }
+
+        // Same as resize(), but new rows are left uninitialized. For columns that are filled right after.
+        constexpr void resize_uninitialized(UINT64 new_size)
+        {
+            reserve(new_size);
+            _size = new_size;
+        }
+
+        // Allocates one block with room for 'new_capacity' rows in every column.
+        constexpr void reserve(UINT64 new_capacity)
+        {
+            if (new_capacity <= _capacity) return;
+
+            UINT64 offsets[column_count]{};
+            const UINT64 total_size{ layout(new_capacity, offsets) };
+            UINT8* const memory{ (UINT8*)allocator::reallocate(nullptr, 0, total_size) };
+            assert(memory && ((UINT64)memory & (alignment - 1)) == 0);
+
+            for (UINT i{ 0 }; i < column_count; ++i)
+            {
+                UINT8* const column{ memory + offsets[i] };
+                if (_size)
+                {
+                    memcpy(column, _columns[i], _size * column_sizes[i]);
+                }
+                _columns[i] = column;
+            }
+
+            if (_memory) allocator::release(_memory);
+            _memory = memory;
+            _capacity = new_capacity;
+        }
+
+        // Removes a row by moving the last row into its place. Returns the index of the removed row,
+        // which now holds what was the last row (or is the end if the last row was removed).
+        constexpr UINT64 swap_remove(UINT64 index)
+        {
+            assert(index < _size);
+            --_size;
+            if (index < _size)
+            {
+                for (UINT i{ 0 }; i < column_count; ++i)
+                {
+                    const UINT64 size{ column_sizes[i] };
+                    memcpy(_columns[i] + index * size, _columns[i] + _size * size, size);
+                }
+            }
+            return index;
+        }
+
+        // Swaps two rows in every column.
+        constexpr void swap(UINT64 index1, UINT64 index2)
+        {
+            assert(index1 < _size && index2 < _size);
+            if (index1 != index2)
+            {
+                swap_rows(index1, index2, std::index_sequence_for<Ts...>{});
+            }
+        }
+
+        // Removes all rows but keeps the memory.
+        constexpr void clear() { _size = 0; }
+
+        [[nodiscard]] constexpr UINT64 size() const { return _size; }
+        [[nodiscard]] constexpr UINT64 capacity() const { return _capacity; }
+        [[nodiscard]] constexpr bool empty() const { return _size == 0; }
+
+        template<UINT column>
+        [[nodiscard]] constexpr column_type<column>* data()
+        {
+            return (column_type<column>*)_columns[column];
+        }
+
+        template<UINT column>
+        [[nodiscard]] constexpr const column_type<column>* data() const
+        {
+            return (const column_type<column>*)_columns[column];
+        }
+
+        template<UINT column>
+        [[nodiscard]] constexpr std::span<column_type<column>> column_span()
+        {
+            return { data<column>(), _size };
+        }
+
+        template<UINT column>
+        [[nodiscard]] constexpr std::span<const column_type<column>> column_span() const
+        {
+            return { data<column>(), _size };
+        }
+
+        template<UINT column>
+        [[nodiscard]] constexpr column_type<column>& get(UINT64 index)
+        {
+            assert(index < _size);
+            return data<column>()[index];
+        }
+
+        template<UINT column>
+        [[nodiscard]] constexpr const column_type<column>& get(UINT64 index) const
+        {
+            assert(index < _size);
+            return data<column>()[index];
+        }
+
+    private:
+        static constexpr UINT64 alignment{ 16 };
+        static constexpr UINT64 column_sizes[column_count]{ sizeof(Ts)... };
+
+        // Writes where each column starts and returns the total size of the block.
+        [[nodiscard]] static constexpr UINT64 layout(UINT64 capacity, UINT64(&offsets)[column_count])
+        {
+            UINT64 offset{ 0 };
+            for (UINT i{ 0 }; i < column_count; ++i)
+            {
+                offset = (offset + alignment - 1) & ~(alignment - 1);
+                offsets[i] = offset;
+                offset += capacity * column_sizes[i];
+            }
+            return offset;
+        }
+
+        constexpr void grow_for_one()
+        {
+            if (_size == _capacity)
+            {
+                reserve(((_capacity + 1) * 3) >> 1); // reserve 50% more
+            }
+        }
+
+        template<size_t... columns>
+        constexpr void set_row(UINT64 index, std::index_sequence<columns...>, const Ts&... values)
+        {
+            ((data<columns>()[index] = values), ...);
+        }
+
+        template<size_t... columns>
+        constexpr void clear_rows(UINT64 first, UINT64 last, std::index_sequence<columns...>)
+        {
+            (std::fill(data<columns>() + first, data<columns>() + last, column_type<columns>{}), ...);
+        }
+
+        template<size_t... columns>
+        constexpr void swap_rows(UINT64 index1, UINT64 index2, std::index_sequence<columns...>)
+        {
+            (std::swap(data<columns>()[index1], data<columns>()[index2]), ...);
+        }
+
+        constexpr void move(basic_soa_vector& o)
+        {
+            _memory = o._memory;
+            _size = o._size;
+            _capacity = o._capacity;
+            for (UINT i{ 0 }; i < column_count; ++i)
+            {
+                _columns[i] = o._columns[i];
+                o._columns[i] = nullptr;
+            }
+            o._memory = nullptr;
+            o._size = 0;
+            o._capacity = 0;
+        }
+
+        constexpr void destroy()
+        {
+            if (_memory) allocator::release(_memory);
+            _memory = nullptr;
+            _size = 0;
+            _capacity = 0;
+            for (UINT8*& column : _columns) column = nullptr;
+        }
+
+        UINT8*  _columns[column_count]{};
+        void*   _memory{ nullptr };
+        UINT64  _size{ 0 };
+        UINT64  _capacity{ 0 };
+    };
+
+    template<typename... Ts>
+    using soa_vector = basic_soa_vector<heap_allocator, Ts...>;
+}
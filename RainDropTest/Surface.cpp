@@ -4,7 +4,7 @@
 #include "Resources.h"
 #include "Window.h"
 #include "Core.h"
-#include "Lights.h"
+#include "LightCulling.h"
 
 namespace surface {
     
@@ -45,3 +45,59 @@ private:
     time_stamp  _start;
     time_stamp  _seconds{ clock::now() };
 };
+
+// Accumulates the CPU time spent between consecutive mark() calls of a frame
+// and reports the per stage average once every second.
+class stage_timer
+{
+public:
+    static constexpr UINT max_stages{ 16 };
+
+    void begin_frame()
+    {
+        _last = clock::now();
+    }
+
+    void mark(UINT stage, const char* const name)
+    {
+        assert(stage < max_stages);
+        const time_stamp now{ clock::now() };
+        _us_totals[stage] += (float)std::chrono::duration_cast<std::chrono::microseconds>(now - _last).count();
+        _names[stage] = name;
+        if (stage >= _stage_count) _stage_count = stage + 1;
+        _last = now;
+    }
+
+    void end_frame()
+    {
+        ++_counter;
+
+        if (std::chrono::duration_cast<std::chrono::seconds>(clock::now() - _seconds).count() >= 1)
+        {
+            OutputDebugStringA("Avg. CPU stage (ms):");
+            for (UINT i{ 0 }; i < _stage_count; ++i)
+            {
+                if (!_names[i]) continue;
+                OutputDebugStringA(" ");
+                OutputDebugStringA(_names[i]);
+                OutputDebugStringA(" ");
+                OutputDebugStringA(std::to_string(_us_totals[i] * 0.001f / (float)_counter).c_str());
+                _us_totals[i] = 0.f;
+            }
+            OutputDebugStringA("\n");
+            _counter = 0;
+            _seconds = clock::now();
+        }
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+    using time_stamp = clock::time_point;
+
+    float       _us_totals[max_stages]{};
+    const char* _names[max_stages]{};
+    UINT        _stage_count{ 0 };
+    int         _counter{ 0 };
+    time_stamp  _last;
+    time_stamp  _seconds{ clock::now() };
+};
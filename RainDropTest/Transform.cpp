@@ -1,37 +1,71 @@
 #include "Transform.h"
+#include "TransformKernels.h"
 #include "Entity.h"
 #include "Vector.h"
+#include "VmVector.h"
+#include "Bitset.h"
+#include "Jobs.h"
+#include <algorithm>
 
 namespace transform
 {
     namespace {
 
-        utl::vector<XMFLOAT4X4> m_to_worlds;
-        utl::vector<XMFLOAT4X4> m_inverse_worlds;
-        utl::vector<XMFLOAT4> m_rotations;
-        utl::vector<XMFLOAT3> m_orientations;
-        utl::vector<XMFLOAT3> m_positions;
-        utl::vector<XMFLOAT3> m_scales;
-        utl::vector<UINT> m_has_transform;
-        utl::vector<UINT> m_changes_from_previous_frame;
+        // NOTE: the rotations, positions, scales and matrices are in the entities' chunks (see game_entity::chunk_view),
+        //       these are indexed by entity index. They grow without copying when many entities are created at once.
+        utl::bitset m_has_transform;
+        utl::vm_vector<UINT8> m_changes_from_previous_frame{ game_entity::max_entity_count };
+        // Entities with non-zero change flags, so clearing the flags only touches what changed.
+        utl::bitset m_changed_entities;
         UINT m_write_flag;
 
-        void calculate_transform_matrices(UINT id)
+        // The most ids calculate_transform_matrices() takes at once.
+        constexpr UINT matrix_batch_size{ 64 };
+
+        // NOTE: the inverse world matrix leaves out the translation, see (F. Luna) Intro to DirectX 12, section 8.2.2
+        // https://terrorgum.com/tfox/books/introductionto3dgameprogrammingwithdirectx12.pdf
+        void calculate_chunk_matrices(const game_entity::chunk_view& chunk, const UINT* const rows, UINT count)
+        {
+            const kernels::transform_arrays arrays{
+                chunk.rotations, chunk.positions, chunk.scales, chunk.to_worlds, chunk.inverse_worlds };
+            kernels::calculate_matrices(arrays, rows, count);
+        }
+
+        void calculate_transform_matrices(const UINT* const ids, UINT count)
         {
-            XMVECTOR r{ XMLoadFloat4(&m_rotations[id]) };
-            XMVECTOR t{ XMLoadFloat3(&m_positions[id]) };
-            XMVECTOR s{ XMLoadFloat3(&m_scales[id]) };
+            assert(count <= matrix_batch_size);
 
-            XMMATRIX world{ XMMatrixAffineTransformation(s, XMQuaternionIdentity(), r, t) };
-            XMStoreFloat4x4(&m_to_worlds[id], world);
+            // The kernel takes the rows of one chunk, so runs of ids in the same chunk are computed together.
+            UINT rows[matrix_batch_size];
+            UINT row_count{ 0 };
+            game_entity::chunk_view chunk{};
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                UINT row;
+                const game_entity::chunk_view id_chunk{ game_entity::detail::find_row(ids[i], row) };
+                if (id_chunk.to_worlds != chunk.to_worlds)
+                {
+                    if (row_count) calculate_chunk_matrices(chunk, &rows[0], row_count);
+                    chunk = id_chunk;
+                    row_count = 0;
+                }
+                rows[row_count++] = row;
+            }
+            if (row_count) calculate_chunk_matrices(chunk, &rows[0], row_count);
 
-            // NOTE: (F. Luna) Intro to DirectX 12, section 8.2.2
-            // https://terrorgum.com/tfox/books/introductionto3dgameprogrammingwithdirectx12.pdf
-            world.r[3] = XMVectorSet(0.f, 0.f, 0.f, 1.f);
-            XMMATRIX inverse_world{ XMMatrixInverse(nullptr, world) };
-            XMStoreFloat4x4(&m_inverse_worlds[id], inverse_world);
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                m_has_transform.set_atomic(ids[i]);
+            }
+        }
 
-            m_has_transform[id] = 1;
+        // NOTE: transform::update() calls the setters from several job threads. Each id is only
+        //       changed by one thread, but neighbouring ids share the words of the bitsets.
+        void set_changed(UINT id, component_flags::flags flag)
+        {
+            m_has_transform.reset_atomic(id);
+            m_changes_from_previous_frame[id] |= flag;
+            m_changed_entities.set_atomic(id);
         }
 
         XMFLOAT3 calculate_orientation(XMFLOAT4 rotation)
@@ -43,71 +77,88 @@ namespace transform
             return orientation;
         }
 
-        void set_rotation(UINT id, const XMFLOAT4& rotation_quaternion)
+        // Applies the changes in the cache to the entity's row of its chunk.
+        void apply_cache(const component_cache& c)
         {
-            m_rotations[id] = rotation_quaternion;
-            m_orientations[id] = calculate_orientation(rotation_quaternion);
-            m_has_transform[id] = 0;
-            m_changes_from_previous_frame[id] |= component_flags::rotation;
-        }
+            UINT row;
+            const game_entity::chunk_view chunk{ game_entity::detail::find_row(c.id, row) };
 
-        void set_orientation(UINT id, const XMFLOAT3& orientation)
-        {
-            m_orientations[id] = orientation;
-            m_has_transform[id] = 0;
-            m_changes_from_previous_frame[id] |= component_flags::orientation;
-        }
+            if (c.flags & component_flags::rotation)
+            {
+                chunk.rotations[row] = c.rotation;
+                chunk.orientations[row] = calculate_orientation(c.rotation);
+                set_changed(c.id, component_flags::rotation);
+            }
 
-        void set_position(UINT id, const XMFLOAT3& position)
-        {
-            m_positions[id] = position;
-            m_has_transform[id] = 0;
-            m_changes_from_previous_frame[id] |= component_flags::position;
-        }
+            if (c.flags & component_flags::orientation)
+            {
+                chunk.orientations[row] = c.orientation;
+                set_changed(c.id, component_flags::orientation);
+            }
 
-        void set_scale(UINT id, const XMFLOAT3& scale)
-        {
-            m_scales[id] = scale;
-            m_has_transform[id] = 0;
-            m_changes_from_previous_frame[id] |= component_flags::scale;
+            if (c.flags & component_flags::position)
+            {
+                chunk.positions[row] = c.position;
+                set_changed(c.id, component_flags::position);
+            }
+
+            if (c.flags & component_flags::scale)
+            {
+                chunk.scales[row] = c.scale;
+                set_changed(c.id, component_flags::scale);
+            }
         }
 
     } // anonymous namespace
 
     component create(init_info info, game_entity::entity entity)
     {
-        assert(entity.is_valid());
-        const UINT entity_id{ entity.get_id() };
+        const init_info* const info_ptr{ &info };
+        component c{};
+        create_batch(&info_ptr, &entity, 1, &c);
+        return c;
+    }
+
+    void create_batch(const init_info* const* const infos, const game_entity::entity* const entities, UINT count, component* const components)
+    {
+        assert(infos && entities && components);
 
-        if (m_positions.size() > entity_id)
+        UINT64 new_size{ m_changes_from_previous_frame.size() };
+        for (UINT i{ 0 }; i < count; ++i)
         {
-            // Reuse this id
-            XMFLOAT4 rotation{ info.rotation };
-            m_rotations[entity_id] = rotation;
-            m_orientations[entity_id] = calculate_orientation(rotation);
-            m_positions[entity_id] = XMFLOAT3{ info.position };
-            m_scales[entity_id] = XMFLOAT3{ info.scale };
-            m_has_transform[entity_id] = 0;
-            m_changes_from_previous_frame[entity_id] = component_flags::all;
+            assert(entities[i].is_valid());
+            new_size = std::max<UINT64>(new_size, game_entity::id::index(entities[i].get_id()) + 1);
         }
-        else
+
+        if (new_size > m_changes_from_previous_frame.size())
         {
-            // Need to add a new entity
-            assert(m_positions.size() == entity_id);
-
-            m_to_worlds.emplace_back();
-            m_inverse_worlds.emplace_back();
-            m_rotations.emplace_back(info.rotation);
-            m_orientations.emplace_back(calculate_orientation(XMFLOAT4{ info.rotation }));
-            m_positions.emplace_back(info.position);
-            m_scales.emplace_back(info.scale);
-            m_has_transform.emplace_back(0);
-            m_changes_from_previous_frame.emplace_back(component_flags::all);
+            // Need to add new entities
+            // NOTE: we call resize() once instead of emplace_back() for each entity.
+            m_has_transform.resize(new_size);
+            m_changes_from_previous_frame.resize(new_size);
+            m_changed_entities.resize(new_size);
         }
 
-        // NOTE: each entity has a transform component. Therefor, id's for transform components
-        //       are exactly the same as entity ids.
-        return component{ entity_id };
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            const init_info& info{ *infos[i] };
+            // NOTE: each entity has a transform component. Therefor, id's for transform components
+            //       are exactly the same as entity indices.
+            const UINT id{ game_entity::id::index(entities[i].get_id()) };
+
+            // NOTE: the entity already has its row, see game_entity::create().
+            UINT row;
+            const game_entity::chunk_view chunk{ game_entity::detail::find_row(id, row) };
+            const XMFLOAT4 rotation{ info.rotation };
+            chunk.rotations[row] = rotation;
+            chunk.orientations[row] = calculate_orientation(rotation);
+            chunk.positions[row] = XMFLOAT3{ info.position };
+            chunk.scales[row] = XMFLOAT3{ info.scale };
+            m_has_transform.reset(id);
+            m_changes_from_previous_frame[id] = component_flags::all;
+            m_changed_entities.set(id);
+            components[i] = component{ id };
+        }
     }
 
     void remove(component c)
@@ -115,17 +166,48 @@ namespace transform
         assert(c.is_valid());
     }
 
-    void get_transform_matrices(UINT id, XMFLOAT4X4& world, XMFLOAT4X4& inverse_world)
+    void calculate_missing_matrices(const UINT* const ids, UINT count)
     {
-        assert(id != Invalid_Index);
+        assert(ids || !count);
+
+        // NOTE: ids can repeat (one per render item), but a matrix is only computed for the first of them,
+        //       because its bit is set before the next batch is collected.
+        UINT batch[matrix_batch_size];
+        UINT batch_count{ 0 };
 
-        if (!m_has_transform[id])
+        for (UINT i{ 0 }; i < count; ++i)
         {
-            calculate_transform_matrices(id);
+            assert(game_entity::is_alive(ids[i]));
+            const UINT id{ game_entity::id::index(ids[i]) };
+            if (m_has_transform.test(id)) continue;
+            if (std::find(&batch[0], &batch[batch_count], id) != &batch[batch_count]) continue;
+
+            batch[batch_count++] = id;
+            if (batch_count == matrix_batch_size)
+            {
+                calculate_transform_matrices(&batch[0], batch_count);
+                batch_count = 0;
+            }
         }
 
-        world = m_to_worlds[id];
-        inverse_world = m_inverse_worlds[id];
+        if (batch_count) calculate_transform_matrices(&batch[0], batch_count);
+    }
+
+    void get_transform_matrices(UINT id, XMFLOAT4X4& world, XMFLOAT4X4& inverse_world)
+    {
+        assert(id != Invalid_Index);
+        // NOTE: only the index is used below, so a stale id would read the matrices of the slot's next entity.
+        assert(game_entity::is_alive(id));
+        id = game_entity::id::index(id);
+
+        // NOTE: read-only, so the job threads can call it while rendering. The matrices were computed by
+        //       update() or calculate_missing_matrices().
+        assert(m_has_transform.test_atomic(id));
+
+        UINT row;
+        const game_entity::chunk_view chunk{ game_entity::detail::find_row(id, row) };
+        world = chunk.to_worlds[row];
+        inverse_world = chunk.inverse_worlds[row];
     }
 
     void get_updated_components_flags(const UINT* const ids, UINT count, UINT8* const flags)
@@ -136,7 +218,7 @@ namespace transform
         for (UINT i{ 0 }; i < count; ++i)
         {
             assert(ids[i] != Invalid_Index);
-            flags[i] = m_changes_from_previous_frame[ids[i]];
+            flags[i] = m_changes_from_previous_frame[game_entity::id::index(ids[i])];
         }
     }
 
@@ -148,54 +230,57 @@ namespace transform
         //       about to be applied by calling this function (i.e. the rest of the current frame will only have writes).
         if (m_write_flag)
         {
-            memset(m_changes_from_previous_frame.data(), 0, m_changes_from_previous_frame.size());
+            m_changed_entities.for_each_set_bit([](UINT64 id) { m_changes_from_previous_frame[id] = 0; });
+            m_changed_entities.reset();
             m_write_flag = 0;
         }
 
-        for (UINT i{ 0 }; i < count; ++i)
-        {
-            const component_cache& c{ cache[i] };
-            assert(component{ c.id }.is_valid());
-
-            if (c.flags & component_flags::rotation)
-            {
-                set_rotation(c.id, c.rotation);
-            }
-
-            if (c.flags & component_flags::orientation)
-            {
-                set_orientation(c.id, c.orientation);
-            }
+        // NOTE: every id shows up once per cache, so the entries can be applied in parallel.
+        jobs::parallel_for(count, 64, [cache](UINT begin, UINT end) {
+            // Ids of the entries whose matrices haven't been computed yet.
+            UINT ids[matrix_batch_size];
+            UINT id_count{ 0 };
 
-            if (c.flags & component_flags::position)
+            for (UINT i{ begin }; i < end; ++i)
             {
-                set_position(c.id, c.position);
+                const component_cache& c{ cache[i] };
+                assert(component{ c.id }.is_valid());
+                apply_cache(c);
+
+                // Compute the matrices here, while we're on a job thread, instead of lazily during rendering.
+                ids[id_count++] = c.id;
+                if (id_count == matrix_batch_size)
+                {
+                    calculate_transform_matrices(&ids[0], id_count);
+                    id_count = 0;
+                }
             }
 
-            if (c.flags & component_flags::scale)
-            {
-                set_scale(c.id, c.scale);
-            }
-        }
+            if (id_count) calculate_transform_matrices(&ids[0], id_count);
+            });
     }
 
     XMFLOAT4 component::rotation() const
     {
-        return m_rotations[_id];
+        UINT row;
+        return game_entity::detail::find_row(_id, row).rotations[row];
     }
 
     XMFLOAT3 component::orientation() const
     {
-        return m_orientations[_id];
+        UINT row;
+        return game_entity::detail::find_row(_id, row).orientations[row];
     }
 
     XMFLOAT3 component::position() const
     {
-        return m_positions[_id];
+        UINT row;
+        return game_entity::detail::find_row(_id, row).positions[row];
     }
 
     XMFLOAT3 component::scale() const
     {
-        return m_scales[_id];
+        UINT row;
+        return game_entity::detail::find_row(_id, row).scales[row];
     }
 }
\ No newline at end of file
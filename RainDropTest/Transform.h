@@ -53,8 +53,15 @@ namespace transform {
     };
 
     component create(init_info info, game_entity::entity entity);
+    // Creates the transforms of 'count' entities. The arrays grow once for all of them.
+    void create_batch(const init_info* const* const infos, const game_entity::entity* const entities, UINT count, component* const components);
     void remove(component c);
+    // Computes the matrices that weren't computed since the entities were created or last changed.
+    // Takes ids of live entities. Call it before reading the matrices from several threads.
+    void calculate_missing_matrices(const UINT* const ids, UINT count);
+    // Takes the id of a live entity whose matrices are computed, see calculate_missing_matrices().
     void get_transform_matrices(UINT id, XMFLOAT4X4& world, XMFLOAT4X4& inverse_world);
+    // NOTE: the functions below take transform ids, or entity ids (only the entity's index is used, see game_entity::id).
     void get_updated_components_flags(const UINT* const ids, UINT count, UINT8* const flags);
     void update(const component_cache* const cache, UINT count);
 
@@ -0,0 +1,290 @@
+#include "TransformKernels.h"
+#include "CpuFeatures.h"
+#include <intrin.h>
+
+namespace transform::kernels {
+    namespace {
+
+        // Each simd type processes 'width' entities per iteration. The components of the entities are
+        // loaded into one register per component (x of all entities, y of all entities...), computed
+        // like scalar code, then transposed back into matrix rows.
+
+        struct simd_scalar
+        {
+            using type = float;
+            static constexpr UINT width{ 1 };
+
+            static type set(float f) { return f; }
+            static type add(type a, type b) { return a + b; }
+            static type sub(type a, type b) { return a - b; }
+            static type mul(type a, type b) { return a * b; }
+            static type div(type a, type b) { return a / b; }
+            static type fmadd(type a, type b, type c) { return a * b + c; }
+            static type fmsub(type a, type b, type c) { return a * b - c; }
+
+            static void load(const XMFLOAT4* const items, const UINT* const ids, type& x, type& y, type& z, type& w)
+            {
+                const XMFLOAT4& item{ items[ids[0]] };
+                x = item.x; y = item.y; z = item.z; w = item.w;
+            }
+
+            static void load(const XMFLOAT3* const items, const UINT* const ids, type& x, type& y, type& z)
+            {
+                const XMFLOAT3& item{ items[ids[0]] };
+                x = item.x; y = item.y; z = item.z;
+            }
+
+            static void store_row(XMFLOAT4X4* const matrices, const UINT* const ids, UINT row, type x, type y, type z, type w)
+            {
+                float* const m{ matrices[ids[0]].m[row] };
+                m[0] = x; m[1] = y; m[2] = z; m[3] = w;
+            }
+
+            static void store_rows(XMFLOAT4X4* const matrices, const UINT* const ids, UINT row,
+                type x0, type y0, type z0, type w0, type x1, type y1, type z1, type w1)
+            {
+                store_row(matrices, ids, row, x0, y0, z0, w0);
+                store_row(matrices, ids, row + 1, x1, y1, z1, w1);
+            }
+
+            static void end() {}
+        };
+
+#if defined(_M_X64)
+        struct simd_sse4
+        {
+            using type = __m128;
+            static constexpr UINT width{ 4 };
+
+            static type set(float f) { return _mm_set1_ps(f); }
+            static type add(type a, type b) { return _mm_add_ps(a, b); }
+            static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+            static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+            static type div(type a, type b) { return _mm_div_ps(a, b); }
+            static type fmadd(type a, type b, type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+            static type fmsub(type a, type b, type c) { return _mm_sub_ps(_mm_mul_ps(a, b), c); }
+
+            // NOTE: reads exactly 12 bytes, like XMLoadFloat3(), so the last item of an array can be loaded.
+            //       _mm_loadl_epi64() because the floats are only 4-byte aligned (GCC's _mm_load_sd() is a double load).
+            static __m128 load_float3(const XMFLOAT3& item)
+            {
+                const __m128 xy{ _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)&item.x)) };
+                return _mm_movelh_ps(xy, _mm_load_ss(&item.z));
+            }
+
+            static void load(const XMFLOAT4* const items, const UINT* const ids, type& x, type& y, type& z, type& w)
+            {
+                x = _mm_loadu_ps(&items[ids[0]].x);
+                y = _mm_loadu_ps(&items[ids[1]].x);
+                z = _mm_loadu_ps(&items[ids[2]].x);
+                w = _mm_loadu_ps(&items[ids[3]].x);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+            }
+
+            static void load(const XMFLOAT3* const items, const UINT* const ids, type& x, type& y, type& z)
+            {
+                x = load_float3(items[ids[0]]);
+                y = load_float3(items[ids[1]]);
+                z = load_float3(items[ids[2]]);
+                type w{ load_float3(items[ids[3]]) };
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+            }
+
+            static void store_row(XMFLOAT4X4* const matrices, const UINT* const ids, UINT row, type x, type y, type z, type w)
+            {
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+                _mm_storeu_ps(matrices[ids[0]].m[row], x);
+                _mm_storeu_ps(matrices[ids[1]].m[row], y);
+                _mm_storeu_ps(matrices[ids[2]].m[row], z);
+                _mm_storeu_ps(matrices[ids[3]].m[row], w);
+            }
+
+            static void store_rows(XMFLOAT4X4* const matrices, const UINT* const ids, UINT row,
+                type x0, type y0, type z0, type w0, type x1, type y1, type z1, type w1)
+            {
+                store_row(matrices, ids, row, x0, y0, z0, w0);
+                store_row(matrices, ids, row + 1, x1, y1, z1, w1);
+            }
+
+            static void end() {}
+        };
+
+        // NOTE: only selected when the CPU has AVX2 and FMA, see core::cpu::isa::avx2.
+        struct simd_avx2
+        {
+            using type = __m256;
+            static constexpr UINT width{ 8 };
+
+            static type set(float f) { return _mm256_set1_ps(f); }
+            static type add(type a, type b) { return _mm256_add_ps(a, b); }
+            static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+            static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+            static type div(type a, type b) { return _mm256_div_ps(a, b); }
+            static type fmadd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+            static type fmsub(type a, type b, type c) { return _mm256_fmsub_ps(a, b, c); }
+
+            // Transposes the 4x4 blocks in each 128-bit half. With rows as input, the low halves hold
+            // entities 0-3 and the high halves entities 4-7.
+            static void transpose(type& x, type& y, type& z, type& w)
+            {
+                const type xy_lo{ _mm256_unpacklo_ps(x, y) };
+                const type xy_hi{ _mm256_unpackhi_ps(x, y) };
+                const type zw_lo{ _mm256_unpacklo_ps(z, w) };
+                const type zw_hi{ _mm256_unpackhi_ps(z, w) };
+                x = _mm256_shuffle_ps(xy_lo, zw_lo, _MM_SHUFFLE(1, 0, 1, 0));
+                y = _mm256_shuffle_ps(xy_lo, zw_lo, _MM_SHUFFLE(3, 2, 3, 2));
+                z = _mm256_shuffle_ps(xy_hi, zw_hi, _MM_SHUFFLE(1, 0, 1, 0));
+                w = _mm256_shuffle_ps(xy_hi, zw_hi, _MM_SHUFFLE(3, 2, 3, 2));
+            }
+
+            static type combine(__m128 low, __m128 high)
+            {
+                return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+            }
+
+            // NOTE: row loads and transposes are faster than 8-wide gathers for 3 and 4 component items.
+            static void load(const XMFLOAT4* const items, const UINT* const ids, type& x, type& y, type& z, type& w)
+            {
+                type rows[4];
+                for (UINT i{ 0 }; i < 4; ++i)
+                {
+                    rows[i] = combine(_mm_loadu_ps(&items[ids[i]].x), _mm_loadu_ps(&items[ids[i + 4]].x));
+                }
+                transpose(rows[0], rows[1], rows[2], rows[3]);
+                x = rows[0]; y = rows[1]; z = rows[2]; w = rows[3];
+            }
+
+            static void load(const XMFLOAT3* const items, const UINT* const ids, type& x, type& y, type& z)
+            {
+                type rows[4];
+                for (UINT i{ 0 }; i < 4; ++i)
+                {
+                    rows[i] = combine(simd_sse4::load_float3(items[ids[i]]), simd_sse4::load_float3(items[ids[i + 4]]));
+                }
+                transpose(rows[0], rows[1], rows[2], rows[3]);
+                x = rows[0]; y = rows[1]; z = rows[2];
+            }
+
+            // NOTE: two neighbouring rows of a matrix are written with one 32 byte store.
+            static void store_rows(XMFLOAT4X4* const matrices, const UINT* const ids, UINT row,
+                type x0, type y0, type z0, type w0, type x1, type y1, type z1, type w1)
+            {
+                transpose(x0, y0, z0, w0);
+                transpose(x1, y1, z1, w1);
+                const type rows0[4]{ x0, y0, z0, w0 };
+                const type rows1[4]{ x1, y1, z1, w1 };
+                for (UINT i{ 0 }; i < 4; ++i)
+                {
+                    _mm256_storeu_ps(matrices[ids[i]].m[row], _mm256_permute2f128_ps(rows0[i], rows1[i], 0x20));
+                    _mm256_storeu_ps(matrices[ids[i + 4]].m[row], _mm256_permute2f128_ps(rows0[i], rows1[i], 0x31));
+                }
+            }
+
+            // Avoids the penalty of switching from 256-bit AVX to SSE code.
+            static void end() { _mm256_zeroupper(); }
+        };
+#endif
+
+        template<typename simd>
+        void calculate_batch(const transform_arrays& arrays, const UINT* const ids)
+        {
+            using v = typename simd::type;
+
+            for (UINT i{ 0 }; i < simd::width; ++i)
+            {
+                assert(ids[i] != Invalid_Index);
+            }
+
+            v qx, qy, qz, qw, sx, sy, sz, tx, ty, tz;
+            simd::load(arrays.rotations, ids, qx, qy, qz, qw);
+            simd::load(arrays.scales, ids, sx, sy, sz);
+            simd::load(arrays.positions, ids, tx, ty, tz);
+
+            const v zero{ simd::set(0.f) };
+            const v one{ simd::set(1.f) };
+
+            // Rotation matrix of the quaternion, same as XMMatrixRotationQuaternion().
+            const v x2{ simd::add(qx, qx) };
+            const v y2{ simd::add(qy, qy) };
+            const v z2{ simd::add(qz, qz) };
+            const v wx{ simd::mul(qw, x2) };
+            const v wy{ simd::mul(qw, y2) };
+            const v wz{ simd::mul(qw, z2) };
+            const v xx{ simd::mul(qx, x2) };
+            const v yy{ simd::mul(qy, y2) };
+            const v zz{ simd::mul(qz, z2) };
+
+            const v r00{ simd::sub(simd::sub(one, yy), zz) };
+            const v r01{ simd::fmadd(qx, y2, wz) };
+            const v r02{ simd::fmsub(qx, z2, wy) };
+            const v r10{ simd::fmsub(qx, y2, wz) };
+            const v r11{ simd::sub(simd::sub(one, xx), zz) };
+            const v r12{ simd::fmadd(qy, z2, wx) };
+            const v r20{ simd::fmadd(qx, z2, wy) };
+            const v r21{ simd::fmsub(qy, z2, wx) };
+            const v r22{ simd::sub(simd::sub(one, xx), yy) };
+
+            // World = S * R * T, so row i of the rotation is scaled by the i-th scale.
+            simd::store_rows(arrays.to_worlds, ids, 0,
+                simd::mul(sx, r00), simd::mul(sx, r01), simd::mul(sx, r02), zero,
+                simd::mul(sy, r10), simd::mul(sy, r11), simd::mul(sy, r12), zero);
+            simd::store_rows(arrays.to_worlds, ids, 2,
+                simd::mul(sz, r20), simd::mul(sz, r21), simd::mul(sz, r22), zero,
+                tx, ty, tz, one);
+
+            // Inverse of S * R (the translation is left out) = R^T * S^-1, so column j of the
+            // transposed rotation is divided by the j-th scale.
+            const v inv_sx{ simd::div(one, sx) };
+            const v inv_sy{ simd::div(one, sy) };
+            const v inv_sz{ simd::div(one, sz) };
+            simd::store_rows(arrays.inverse_worlds, ids, 0,
+                simd::mul(r00, inv_sx), simd::mul(r10, inv_sy), simd::mul(r20, inv_sz), zero,
+                simd::mul(r01, inv_sx), simd::mul(r11, inv_sy), simd::mul(r21, inv_sz), zero);
+            simd::store_rows(arrays.inverse_worlds, ids, 2,
+                simd::mul(r02, inv_sx), simd::mul(r12, inv_sy), simd::mul(r22, inv_sz), zero,
+                zero, zero, zero, one);
+        }
+
+        template<typename simd>
+        void calculate_matrices_simd(const transform_arrays& arrays, const UINT* const ids, UINT count)
+        {
+            UINT i{ 0 };
+            if constexpr (simd::width > 1)
+            {
+                for (; i + simd::width <= count; i += simd::width)
+                {
+                    calculate_batch<simd>(arrays, &ids[i]);
+                }
+                simd::end();
+            }
+
+            // The last few entities that don't fill a batch.
+            for (; i < count; ++i)
+            {
+                calculate_batch<simd_scalar>(arrays, &ids[i]);
+            }
+        }
+
+        using calculate_matrices_function = void(*)(const transform_arrays&, const UINT* const, UINT);
+
+        calculate_matrices_function select_calculate_matrices()
+        {
+            using core::cpu::isa;
+            calculate_matrices_function variants[isa::count]{ calculate_matrices_simd<simd_scalar> };
+#if defined(_M_X64)
+            variants[isa::sse4_2] = calculate_matrices_simd<simd_sse4>;
+            variants[isa::avx2] = calculate_matrices_simd<simd_avx2>;
+#endif
+            return core::cpu::select(variants);
+        }
+
+    } // anonymous namespace
+
+    void calculate_matrices(const transform_arrays& arrays, const UINT* const ids, UINT count)
+    {
+        assert(arrays.rotations && arrays.positions && arrays.scales && arrays.to_worlds && arrays.inverse_worlds);
+        assert(ids || !count);
+        static const calculate_matrices_function calculate{ select_calculate_matrices() };
+        calculate(arrays, ids, count);
+    }
+}
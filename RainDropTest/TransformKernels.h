@@ -0,0 +1,23 @@
+#pragma once
+#include "stdafx.h"
+
+namespace transform::kernels {
+
+    // Per-entity transform arrays, indexed by the ids passed to calculate_matrices() (in the engine, the
+    // columns of one chunk and rows in it, see game_entity::chunk_view).
+    struct transform_arrays
+    {
+        const XMFLOAT4*     rotations;
+        const XMFLOAT3*     positions;
+        const XMFLOAT3*     scales;
+        XMFLOAT4X4*         to_worlds;
+        XMFLOAT4X4*         inverse_worlds;
+    };
+
+    // Computes the world matrix (scale, then rotation, then translation) and the inverse world matrix
+    // (without translation) of the entities in 'ids', several entities at a time.
+    // Same result as XMMatrixAffineTransformation() and XMMatrixInverse() for unit quaternions,
+    // but the inverse is built from the rotation and scale instead of a general 4x4 inverse.
+    // NOTE: the SIMD variant is selected on the first call, see core::cpu::select().
+    void calculate_matrices(const transform_arrays& arrays, const UINT* const ids, UINT count);
+}
@@ -3,6 +3,7 @@
 #include "Main.h"
 #include "Helpers.h"
 #include "Core.h"
+#include "Queue.h"
 
 namespace upload {
 
@@ -18,8 +19,6 @@ namespace upload {
             void wait_and_reset();
 
             void release();
-
-            constexpr bool is_ready() const { return upload_buffer == nullptr; }
         };
 
         constexpr UINT upload_frame_count{ 4 };
@@ -28,7 +27,9 @@ namespace upload {
         ID3D12Fence1* upload_fence{ nullptr };
         UINT64 upload_fence_value{ 0 };
         HANDLE fence_event{};
-        std::mutex frame_mutex{};
+        // Indices of the upload frames that aren't in use. A context pops one and end_upload() pushes
+        // it back, so threads wait for a free frame instead of spinning over all of them.
+        utl::blocking_queue<utl::mpmc_queue<UINT, upload_frame_count>> free_frames{};
         std::mutex queue_mutex{};
 
         void upload_frame::wait_and_reset()
@@ -51,28 +52,6 @@ namespace upload {
             core::release(command_list);
         }
 
-        // NOTE: frames should be locked before this function is called.
-        UINT get_available_upload_frame()
-        {
-            UINT index{ Invalid_Index };
-            while (index == Invalid_Index)
-            {
-                // check for open upload frames
-                for (UINT i{ 0 }; i < upload_frame_count; ++i)
-                {
-                    if (upload_frames[i].is_ready())
-                    {
-                        index = i;
-                        return index;
-                    }
-                }
-
-                // All upload frames are busy, yield the cpu
-                std::this_thread::yield();
-            }
-            return index;
-        }
-
         bool init_failed()
         {
             shutdown();
@@ -86,15 +65,9 @@ namespace upload {
     {
         assert(upload_command_queue);
 
-        {
-            // We don't want to lock this function for longer than necessary. So, we scope this lock.
-            std::lock_guard lock{ frame_mutex };
-            m_frame_index = get_available_upload_frame();
-            assert(m_frame_index != Invalid_Index);
-            // Before unlocking, we prevent other threads from picking
-            // this frame by making is_ready return false.
-            upload_frames[m_frame_index].upload_buffer = (ID3D12Resource*)1;
-        }
+        // Waits until one of the frames is free.
+        [[maybe_unused]] const bool popped{ free_frames.pop(m_frame_index) };
+        assert(popped && m_frame_index < upload_frame_count);
 
         upload_frame& frame{ upload_frames[m_frame_index] };
         assert(aligned_size);
@@ -152,6 +125,8 @@ namespace upload {
 
         // Wait for copy queue to finish. Then release the upload buffer.
         frame.wait_and_reset();
+        [[maybe_unused]] const bool pushed{ free_frames.try_push(m_frame_index) };
+        assert(pushed);
         m_frame_index = Invalid_Index;
     }
 
@@ -169,6 +144,9 @@ namespace upload {
             ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, frame.command_allocator, nullptr, IID_PPV_ARGS(&frame.command_list)));
             NAME_D3D12_OBJECT_INDEXED(frame.command_list, i, L"Upload Command List");
             frame.command_list->Close();
+
+            [[maybe_unused]] const bool pushed{ free_frames.try_push(i) };
+            assert(pushed);
         }
 
         D3D12_COMMAND_QUEUE_DESC desc{};
@@ -197,6 +175,9 @@ namespace upload {
             upload_frames[i].release();
         }
 
+        UINT index{};
+        while (free_frames.try_pop(index)) {}
+
         if (fence_event)
         {
             CloseHandle(fence_event);
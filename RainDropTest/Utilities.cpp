@@ -1,7 +1,18 @@
-#pragma once
 #include "Utilities.h"
+#include "Jobs.h"
 #include <fstream>
 
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#endif
+
 namespace utl {
 
     bool read_file(std::filesystem::path path, std::unique_ptr<UINT8[]>& data, UINT64& size)
@@ -29,6 +40,414 @@ namespace utl {
         return true;
     }
 
+    namespace {
+
+        struct pending_read
+        {
+            const file_read*            request{ nullptr };
+            std::unique_ptr<UINT8[]>    data{};
+            UINT64                      size{ 0 };
+            bool                        succeeded{ false };
+#if defined(_WIN32)
+            HANDLE                      file{ INVALID_HANDLE_VALUE };
+            OVERLAPPED                  overlapped{};
+#elif defined(__linux__)
+            int                         file{ -1 };
+            UINT64                      bytes_read{ 0 };
+#endif
+        };
+
+        // Reads in flight, sampled each time read_files() waits for completions.
+        struct in_flight_samples
+        {
+            UINT64  sum{ 0 };
+            UINT64  count{ 0 };
+            UINT    peak{ 0 };
+
+            void add(UINT in_flight)
+            {
+                sum += in_flight;
+                ++count;
+                peak = std::max(peak, in_flight);
+            }
+
+            void write(file_read_stats* const stats) const
+            {
+                if (!stats) return;
+                stats->peak_in_flight = peak;
+                stats->mean_in_flight = count ? (double)sum / (double)count : 0.0;
+            }
+        };
+
+        // Job that hands a finished read to its callback, then frees the data.
+        void complete_read(void* data)
+        {
+            pending_read& read{ *(pending_read*)data };
+            const std::span<const UINT8> file_data{ read.succeeded ? std::span<const UINT8>{ read.data.get(), (size_t)read.size } : std::span<const UINT8>{} };
+            read.request->on_read(file_data, read.request->context);
+            read.data.reset();
+        }
+
+#if defined(_WIN32)
+        // Opens the file and starts reading it. Returns false if the read couldn't be started.
+        bool start_read(pending_read& read, HANDLE port, ULONG_PTR key)
+        {
+            const std::filesystem::path path{ read.request->path };
+            read.file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (read.file == INVALID_HANDLE_VALUE) return false;
+
+            LARGE_INTEGER file_size{};
+            // NOTE: one ReadFile() reads at most 4GB, assets are much smaller than that.
+            if (!GetFileSizeEx(read.file, &file_size) || !file_size.QuadPart || file_size.QuadPart > MAXDWORD) return false;
+            if (!CreateIoCompletionPort(read.file, port, key, 0)) return false;
+
+            read.size = (UINT64)file_size.QuadPart;
+            read.data = std::make_unique_for_overwrite<UINT8[]>(read.size);
+
+            // NOTE: even reads that finish right away post a completion packet to the port.
+            return ReadFile(read.file, read.data.get(), (DWORD)read.size, nullptr, &read.overlapped) ||
+                GetLastError() == ERROR_IO_PENDING;
+        }
+
+        void finish_read(pending_read& read, bool succeeded, jobs::counter& callbacks)
+        {
+            if (read.file != INVALID_HANDLE_VALUE) CloseHandle(read.file);
+            read.file = INVALID_HANDLE_VALUE;
+            read.succeeded = succeeded;
+
+            const jobs::job_decl decl{ &complete_read, &read };
+            jobs::run(&decl, 1, &callbacks);
+        }
+
+        // Cancels the reads that were started but haven't finished, and waits until the OS is done with
+        // their buffers and OVERLAPPED structures before they're freed.
+        void cancel_reads(pending_read* const reads, UINT count, jobs::counter& callbacks)
+        {
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                pending_read& read{ reads[i] };
+                if (read.file == INVALID_HANDLE_VALUE) continue;
+
+                CancelIoEx(read.file, &read.overlapped);
+                // NOTE: waits on the file handle, which is signaled when its only read finishes or is cancelled.
+                DWORD bytes_read{ 0 };
+                const bool succeeded{ GetOverlappedResult(read.file, &read.overlapped, &bytes_read, TRUE) && bytes_read == read.size };
+                finish_read(read, succeeded, callbacks);
+            }
+        }
+#else
+#if defined(__linux__)
+        // The parts of an io_uring that read_files() uses, set up with the raw system calls.
+        // Only the thread that created it may queue reads and reap completions.
+        class io_ring
+        {
+        public:
+            explicit io_ring(UINT entries)
+            {
+                io_uring_params params{};
+                _fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+                if (_fd < 0) return;
+
+                _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(UINT);
+                _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                // NOTE: with IORING_FEAT_SINGLE_MMAP both rings are in one mapping.
+                const bool single_mmap{ (params.features & IORING_FEAT_SINGLE_MMAP) != 0 };
+                if (single_mmap) _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+
+                _sq_ring = (UINT8*)mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+                _cq_ring = single_mmap ? _sq_ring :
+                    (UINT8*)mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+                _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                _sqes = (io_uring_sqe*)mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+                if (_sq_ring == MAP_FAILED || _cq_ring == MAP_FAILED || _sqes == MAP_FAILED)
+                {
+                    close();
+                    return;
+                }
+
+                _sq_head = (UINT*)(_sq_ring + params.sq_off.head);
+                _sq_tail = (UINT*)(_sq_ring + params.sq_off.tail);
+                _sq_array = (UINT*)(_sq_ring + params.sq_off.array);
+                _sq_mask = *(const UINT*)(_sq_ring + params.sq_off.ring_mask);
+                _sq_entries = params.sq_entries;
+                _cq_head = (UINT*)(_cq_ring + params.cq_off.head);
+                _cq_tail = (UINT*)(_cq_ring + params.cq_off.tail);
+                _cqes = (const io_uring_cqe*)(_cq_ring + params.cq_off.cqes);
+                _cq_mask = *(const UINT*)(_cq_ring + params.cq_off.ring_mask);
+            }
+
+            DISABLE_COPY_AND_MOVE(io_ring);
+            ~io_ring() { close(); }
+
+            [[nodiscard]] bool is_open() const { return _fd >= 0; }
+
+            // Queues a read of 'size' bytes at 'offset'. It's submitted by the next submit_and_wait().
+            // Returns false if the submission queue is full.
+            bool queue_read(int file, void* buffer, UINT size, UINT64 offset, UINT64 user_data)
+            {
+                const UINT tail{ *_sq_tail };
+                if (tail - std::atomic_ref<UINT>{ *_sq_head }.load(std::memory_order_acquire) >= _sq_entries) return false;
+
+                const UINT index{ tail & _sq_mask };
+                io_uring_sqe& sqe{ _sqes[index] };
+                memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = file;
+                sqe.addr = (UINT64)buffer;
+                sqe.len = size;
+                sqe.off = offset;
+                sqe.user_data = user_data;
+                _sq_array[index] = index;
+
+                // NOTE: the kernel may read the entry as soon as it sees the new tail.
+                std::atomic_ref<UINT>{ *_sq_tail }.store(tail + 1, std::memory_order_release);
+                ++_queued;
+                return true;
+            }
+
+            // Submits the queued reads and waits until at least one read has completed.
+            // Returns false if the ring is broken.
+            [[nodiscard]] bool submit_and_wait()
+            {
+                for (;;)
+                {
+                    const int submitted{ (int)syscall(__NR_io_uring_enter, _fd, _queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0) };
+                    if (submitted >= 0)
+                    {
+                        _queued -= std::min((UINT)submitted, _queued);
+                        return true;
+                    }
+                    if (errno != EINTR) return false;
+                }
+            }
+
+            // Calls func(user_data, result) for each completed read. 'result' is the number of bytes read, or -errno.
+            template<typename F>
+            void for_each_completion(F&& func)
+            {
+                UINT head{ *_cq_head };
+                const UINT tail{ std::atomic_ref<UINT>{ *_cq_tail }.load(std::memory_order_acquire) };
+                for (; head != tail; ++head)
+                {
+                    const io_uring_cqe& cqe{ _cqes[head & _cq_mask] };
+                    func(cqe.user_data, cqe.res);
+                }
+                std::atomic_ref<UINT>{ *_cq_head }.store(head, std::memory_order_release);
+            }
+
+        private:
+            void close()
+            {
+                if (_sqes && _sqes != MAP_FAILED) munmap(_sqes, _sqes_size);
+                if (_cq_ring && _cq_ring != MAP_FAILED && _cq_ring != _sq_ring) munmap(_cq_ring, _cq_ring_size);
+                if (_sq_ring && _sq_ring != MAP_FAILED) munmap(_sq_ring, _sq_ring_size);
+                if (_fd >= 0) ::close(_fd);
+                _sqes = nullptr;
+                _cq_ring = _sq_ring = nullptr;
+                _fd = -1;
+            }
+
+            int                     _fd{ -1 };
+            UINT8*                  _sq_ring{ nullptr };
+            UINT8*                  _cq_ring{ nullptr };
+            io_uring_sqe*           _sqes{ nullptr };
+            size_t                  _sq_ring_size{ 0 };
+            size_t                  _cq_ring_size{ 0 };
+            size_t                  _sqes_size{ 0 };
+            UINT*                   _sq_head{ nullptr };
+            UINT*                   _sq_tail{ nullptr };
+            UINT*                   _sq_array{ nullptr };
+            UINT*                   _cq_head{ nullptr };
+            UINT*                   _cq_tail{ nullptr };
+            const io_uring_cqe*     _cqes{ nullptr };
+            UINT                    _sq_mask{ 0 };
+            UINT                    _sq_entries{ 0 };
+            UINT                    _cq_mask{ 0 };
+            UINT                    _queued{ 0 };
+        };
+
+        // One read asks for at most this much. Bigger files take more than one (and so does a short read).
+        constexpr UINT max_read_size{ 1u << 30 };
+
+        bool queue_next_read(pending_read& read, io_ring& ring, UINT64 index)
+        {
+            const UINT size{ (UINT)std::min(read.size - read.bytes_read, (UINT64)max_read_size) };
+            return ring.queue_read(read.file, read.data.get() + read.bytes_read, size, read.bytes_read, index);
+        }
+
+        // Opens the file and queues its first read. Returns false if the read couldn't be queued.
+        bool start_read(pending_read& read, io_ring& ring, UINT64 index)
+        {
+            read.file = open(read.request->path, O_RDONLY | O_CLOEXEC);
+            if (read.file < 0) return false;
+
+            struct stat file_info {};
+            if (fstat(read.file, &file_info) || file_info.st_size <= 0) return false;
+            posix_fadvise(read.file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            read.size = (UINT64)file_info.st_size;
+            read.data = std::make_unique_for_overwrite<UINT8[]>(read.size);
+            return queue_next_read(read, ring, index);
+        }
+
+        void finish_read(pending_read& read, bool succeeded, jobs::counter& callbacks)
+        {
+            if (read.file >= 0) close(read.file);
+            read.file = -1;
+            read.succeeded = succeeded;
+
+            const jobs::job_decl decl{ &complete_read, &read };
+            jobs::run(&decl, 1, &callbacks);
+        }
+
+        // Fails the reads that were started but haven't finished.
+        // NOTE: without a working ring there's no way to know when the kernel is done with their buffers, so
+        //       the buffers are leaked rather than freed under a read that may still be writing to them.
+        void abandon_reads(pending_read* const reads, UINT count, jobs::counter& callbacks)
+        {
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                pending_read& read{ reads[i] };
+                if (read.file < 0) continue;
+
+                (void)read.data.release();
+                finish_read(read, false, callbacks);
+            }
+        }
+#endif
+
+        void read_and_complete(void* data)
+        {
+            pending_read& read{ *(pending_read*)data };
+            read.succeeded = read_file(read.request->path, read.data, read.size);
+            complete_read(data);
+        }
+#endif
+    } // anonymous namespace
+
+    void read_files(const file_read* const reads, UINT count, UINT max_in_flight, file_read_stats* const stats)
+    {
+        assert(reads || !count);
+        assert(max_in_flight);
+        if (!count) return;
+        max_in_flight = std::max(max_in_flight, 1u);
+
+        std::unique_ptr<pending_read[]> pending{ std::make_unique<pending_read[]>(count) };
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            assert(reads[i].path && reads[i].on_read);
+            pending[i].request = &reads[i];
+        }
+
+        jobs::counter callbacks{};
+        in_flight_samples samples{};
+
+#if defined(_WIN32)
+        const HANDLE port{ CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1) };
+        assert(port);
+
+        UINT next{ 0 };
+        UINT in_flight{ 0 };
+        while (next < count || in_flight)
+        {
+            // Keep the queue full. Reads that can't start are completed right away.
+            while (next < count && in_flight < max_in_flight)
+            {
+                pending_read& read{ pending[next] };
+                if (port && start_read(read, port, next)) ++in_flight;
+                else finish_read(read, false, callbacks);
+                ++next;
+            }
+            if (!in_flight) break;
+            samples.add(in_flight);
+
+            OVERLAPPED_ENTRY entries[16];
+            ULONG entry_count{ 0 };
+            if (!GetQueuedCompletionStatusEx(port, &entries[0], _countof(entries), &entry_count, INFINITE, FALSE))
+            {
+                // NOTE: with no time-out this only fails if the port is broken, so waiting again won't help.
+                assert(false);
+                cancel_reads(&pending[0], next, callbacks);
+                for (; next < count; ++next) finish_read(pending[next], false, callbacks);
+                in_flight = 0;
+                break;
+            }
+
+            for (ULONG i{ 0 }; i < entry_count; ++i)
+            {
+                pending_read& read{ pending[entries[i].lpCompletionKey] };
+                DWORD bytes_read{ 0 };
+                const bool succeeded{ GetOverlappedResult(read.file, &read.overlapped, &bytes_read, FALSE) && bytes_read == read.size };
+                finish_read(read, succeeded, callbacks);
+                --in_flight;
+            }
+        }
+        assert(!in_flight);
+
+        if (port) CloseHandle(port);
+#else
+#if defined(__linux__)
+        io_ring ring{ max_in_flight };
+        if (ring.is_open())
+        {
+            UINT next{ 0 };
+            UINT in_flight{ 0 };
+            while (next < count || in_flight)
+            {
+                // Keep the queue full. Reads that can't start are completed right away.
+                while (next < count && in_flight < max_in_flight)
+                {
+                    pending_read& read{ pending[next] };
+                    if (start_read(read, ring, next)) ++in_flight;
+                    else finish_read(read, false, callbacks);
+                    ++next;
+                }
+                if (!in_flight) break;
+                samples.add(in_flight);
+
+                if (!ring.submit_and_wait())
+                {
+                    // NOTE: only fails if the ring is broken, so waiting again won't help.
+                    assert(false);
+                    abandon_reads(&pending[0], next, callbacks);
+                    for (; next < count; ++next) finish_read(pending[next], false, callbacks);
+                    in_flight = 0;
+                    break;
+                }
+
+                ring.for_each_completion([&](UINT64 index, int result) {
+                    pending_read& read{ pending[index] };
+                    if (result > 0)
+                    {
+                        read.bytes_read += (UINT64)result;
+                        // NOTE: a short read just continues where it stopped. Its slot was freed by this completion.
+                        if (read.bytes_read < read.size && queue_next_read(read, ring, index)) return;
+                    }
+                    finish_read(read, result >= 0 && read.bytes_read == read.size, callbacks);
+                    --in_flight;
+                    });
+            }
+            assert(!in_flight);
+
+            samples.write(stats);
+            jobs::wait(&callbacks);
+            return;
+        }
+#endif
+        // Without an OS queue, the job threads do the reading.
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            const jobs::job_decl decl{ &read_and_complete, &pending[i] };
+            jobs::run(&decl, 1, &callbacks);
+        }
+        samples.add(std::min(count, jobs::thread_count()));
+#endif
+
+        samples.write(stats);
+        jobs::wait(&callbacks);
+    }
+
     std::wstring
         to_wstring(const char* c)
     {
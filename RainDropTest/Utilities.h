@@ -1,13 +1,45 @@
 #pragma once
 #include "stdafx.h"
 #include <filesystem>
+#include <span>
+#include <bit>
+#include <algorithm>
 
 namespace utl {
 
     bool read_file(std::filesystem::path path, std::unique_ptr<UINT8[]>& data, UINT64& size);
 
+    // One file for read_files(). 'on_read' gets the whole file, or an empty span if it couldn't be read.
+    // NOTE: 'data' is only valid during the call. Keep a copy of anything that's needed later.
+    struct file_read
+    {
+        const char* path{ nullptr };
+        void(*on_read)(std::span<const UINT8> data, void* context){ nullptr };
+        void* context{ nullptr };
+    };
+
+    // How deep read_files() kept the OS queue. Optional, for tuning 'max_in_flight'.
+    struct file_read_stats
+    {
+        UINT    peak_in_flight{ 0 };
+        double  mean_in_flight{ 0 };    // reads in flight each time read_files() waited for completions.
+    };
+
+    // Reads all files at the same time and calls each 'on_read' as soon as its file is in memory, so
+    // processing one file overlaps with reading the others. The callbacks run on the job threads,
+    // in no particular order. Returns when all callbacks have returned.
+    // The reads are queued to the OS, up to 'max_in_flight' at a time: overlapped I/O on one completion port
+    // on Windows, an io_uring on Linux (raw system calls, no liburing). Where io_uring isn't available (old
+    // kernels, or blocked by a seccomp filter) each read is a blocking read in a job, and 'max_in_flight' is
+    // the number of job threads.
+    constexpr UINT max_file_reads_in_flight{ 64 };
+    void read_files(const file_read* const reads, UINT count, UINT max_in_flight = max_file_reads_in_flight, file_read_stats* const stats = nullptr);
+
     std::wstring to_wstring(const char* c);
 
+    // Reads the binary asset formats. Data is stored little-endian unless a read says otherwise.
+    // A reader made from a span is checked: a read past the end reads nothing, moves the position
+    // to the end and sets overrun(), so parsers can report truncated files instead of crashing.
     class blob_stream_reader
     {
     public:
@@ -18,35 +50,102 @@ namespace utl {
             assert(buffer);
         }
 
+        // Reads straight from memory the caller owns (e.g. a utl::mapped_file), nothing is copied.
+        explicit blob_stream_reader(std::span<const UINT8> buffer)
+            : m_buffer{ buffer.data() }, m_position{ buffer.data() }, m_end{ buffer.data() + buffer.size() }
+        {
+            assert(buffer.data() && buffer.size());
+        }
+
         // This template function is intended to read primitive types (e.g. int, float, bool)
-        template<typename T>
-        [[nodiscard]] constexpr T read()
+        template<typename T, std::endian order = std::endian::little>
+        [[nodiscard]] T read()
         {
             static_assert(std::is_arithmetic_v<T>, "Template argument should be a primitive type.");
-            T value{ *((T*)m_position) };
+            T value{};
+            if (!can_read(sizeof(T))) return value;
+            memcpy(&value, m_position, sizeof(T));
             m_position += sizeof(T);
+            if constexpr (order != std::endian::native) value = byte_swap(value);
             return value;
         }
 
-        // reads 'length' bytes into 'buffer'. The caller is responsible to allocate enough memory in buffer.
-        void read(UINT8* buffer, size_t length)
+        // Copies 'count' items to 'values' in one go. The caller is responsible to allocate enough memory.
+        template<typename T, std::endian order = std::endian::little>
+        void read(T* const values, UINT64 count)
         {
-            memcpy(buffer, m_position, length);
-            m_position += length;
+            static_assert(std::is_trivially_copyable_v<T>, "Template argument should be trivially copyable.");
+            static_assert(order == std::endian::native || std::is_arithmetic_v<T>, "Only primitive types can be byte swapped.");
+            assert(values || !count);
+            const UINT64 size{ count * sizeof(T) };
+            if (!can_read(size)) return;
+            memcpy(values, m_position, size);
+            m_position += size;
+
+            if constexpr (order != std::endian::native)
+            {
+                for (UINT64 i{ 0 }; i < count; ++i) values[i] = byte_swap(values[i]);
+            }
         }
 
-        constexpr void skip(size_t offset)
+        // Returns 'count' items where they are in the buffer, without copying, if the position is aligned for T.
+        // Otherwise they're copied to 'copy', which must then have room for 'count' items.
+        // NOTE: the span is only valid as long as the buffer (or 'copy'). It's empty after an overrun.
+        template<typename T>
+        [[nodiscard]] std::span<const T> read_span(UINT64 count, T* const copy = nullptr)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Template argument should be trivially copyable.");
+            const UINT64 size{ count * sizeof(T) };
+            if (!can_read(size)) return {};
+
+            const T* items{ (const T*)m_position };
+            if ((uintptr_t)m_position & (alignof(T) - 1))
+            {
+                assert(copy); // the data isn't aligned for T, pass a buffer for a copy.
+                if (!copy) return {};
+                memcpy(copy, m_position, size);
+                items = copy;
+            }
+            m_position += size;
+            return { items, (size_t)count };
+        }
+
+        void skip(size_t offset)
         {
+            if (!can_read(offset)) return;
             m_position += offset;
         }
 
         [[nodiscard]] constexpr const UINT8* const buffer_start() const { return m_buffer; }
         [[nodiscard]] constexpr const UINT8* const position() const { return m_position; }
         [[nodiscard]] constexpr size_t offset() const { return m_position - m_buffer; }
+        // True if a read went past the end. Only checked readers know where the end is.
+        [[nodiscard]] constexpr bool overrun() const { return m_overrun; }
 
     private:
+        [[nodiscard]] bool can_read(UINT64 size)
+        {
+            if (!m_end || size <= (UINT64)(m_end - m_position)) return true;
+            m_position = m_end;
+            m_overrun = true;
+            return false;
+        }
+
+        template<typename T>
+        [[nodiscard]] static T byte_swap(T value)
+        {
+            UINT8 bytes[sizeof(T)];
+            memcpy(&bytes[0], &value, sizeof(T));
+            std::reverse(&bytes[0], &bytes[sizeof(T)]);
+            memcpy(&value, &bytes[0], sizeof(T));
+            return value;
+        }
+
         const UINT8* const m_buffer;
         const UINT8* m_position;
+        // Only known when constructed from a span.
+        const UINT8* const m_end{ nullptr };
+        bool m_overrun{ false };
     };
 
 
@@ -64,11 +163,12 @@ namespace utl {
 
         // This template function is intended to write primitive types (e.g. int, float, bool)
         template<typename T>
-        constexpr void write(T value)
+        void write(T value)
         {
             static_assert(std::is_arithmetic_v<T>, "Template argument should be a primitive type.");
             assert(&m_position[sizeof(T)] <= &m_buffer[m_buffer_size]);
-            *((T*)m_position) = value;
+            // NOTE: the position isn't always aligned for T.
+            memcpy(m_position, &value, sizeof(T));
             m_position += sizeof(T);
         }
 
@@ -2,14 +2,42 @@
 // Distributed under the MIT license. See the LICENSE file in the project root for more information.
 #pragma once
 #include "stdafx.h"
+#include <iterator>
 
 namespace utl {
 
+    // True for types whose items can be moved to another address by copying their bytes.
+    // Specialize it for types that are safe to memcpy without being trivially copyable.
+    template<typename T>
+    struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+    template<typename T>
+    constexpr bool is_trivially_relocatable_v{ is_trivially_relocatable<T>::value };
+
+    // Default memory policy for utl::vector. An allocator only needs these two
+    // static functions, so containers don't have to carry any allocator state.
+    struct heap_allocator
+    {
+        // Grows (or allocates when 'memory' is null) a block to 'new_size' bytes,
+        // keeping the first 'old_size' bytes.
+        [[nodiscard]] static void* reallocate(void* memory, [[maybe_unused]] UINT64 old_size, UINT64 new_size)
+        {
+            // NOTE: realloc() will automatically copy the data in the buffer
+            //       if a new region of memory is allocated.
+            return realloc(memory, new_size);
+        }
+
+        static void release(void* memory)
+        {
+            free(memory);
+        }
+    };
+
     // A vector class similar to std::vector with basic functionality.
     // The user can specify in the template argument whether they want
     // elements' destructor to be called when being removed or while
-    // clearing/destructing the vector.
-    template<typename T, bool destruct = true>
+    // clearing/destructing the vector, and where the memory comes from.
+    template<typename T, bool destruct = true, typename allocator = heap_allocator>
     class vector
     {
     public:
@@ -50,12 +78,7 @@ namespace utl {
             assert(this != std::addressof(o));
             if (this != std::addressof(o))
             {
-                clear();
-                reserve(o._size);
-                for (auto& item : o)
-                {
-                    emplace_back(item);
-                }
+                assign(o.begin(), o.end());
                 assert(_size == o._size);
             }
 
@@ -115,10 +138,19 @@ namespace utl {
             if (new_size > _size)
             {
                 reserve(new_size);
-                while (_size < new_size)
+                if constexpr (std::is_trivially_default_constructible_v<T>)
+                {
+                    // Same result as value-initializing each item.
+                    memset(std::addressof(_data[_size]), 0, (new_size - _size) * sizeof(T));
+                }
+                else
                 {
-                    emplace_back();
+                    for (UINT64 i{ _size }; i < new_size; ++i)
+                    {
+                        new (std::addressof(_data[i])) T();
+                    }
                 }
+                _size = new_size;
             }
             else if (new_size < _size)
             {
@@ -143,10 +175,11 @@ namespace utl {
             if (new_size > _size)
             {
                 reserve(new_size);
-                while (_size < new_size)
+                for (UINT64 i{ _size }; i < new_size; ++i)
                 {
-                    emplace_back(value);
+                    new (std::addressof(_data[i])) T(value);
                 }
+                _size = new_size;
             }
             else if (new_size < _size)
             {
@@ -162,21 +195,108 @@ namespace utl {
             assert(new_size == _size);
         }
 
+        // Resizes the vector without initializing new items. Only for trivially copyable types,
+        // where the caller is going to overwrite the new items anyway.
+        constexpr void resize_uninitialized(UINT64 new_size)
+        {
+            static_assert(std::is_trivially_copyable<T>::value,
+                "Type must be trivially copyable.");
+
+            reserve(new_size);
+            _size = new_size;
+        }
+
         // Allocates memory to contain the specified number of items.
         constexpr void reserve(UINT64 new_capacity)
         {
             if (new_capacity > _capacity)
             {
-                // NOTE: realloc() will automatically copy the data in the buffer
-                //       if a new region of memory is allocated.
-                void* new_buffer{ realloc(_data, new_capacity * sizeof(T)) };
-                assert(new_buffer);
-                if (new_buffer)
+                if constexpr (relocate_with_memcpy)
+                {
+                    void* new_buffer{ allocator::reallocate(_data, _size * sizeof(T), new_capacity * sizeof(T)) };
+                    assert(new_buffer);
+                    if (new_buffer)
+                    {
+                        _data = static_cast<T*>(new_buffer);
+                        _capacity = new_capacity;
+                    }
+                }
+                else
+                {
+                    // The items can't be copied as bytes, move them one by one to the new buffer.
+                    void* new_buffer{ allocator::reallocate(nullptr, 0, new_capacity * sizeof(T)) };
+                    assert(new_buffer);
+                    if (new_buffer)
+                    {
+                        T* const new_data{ static_cast<T*>(new_buffer) };
+                        for (UINT64 i{ 0 }; i < _size; ++i)
+                        {
+                            new (std::addressof(new_data[i])) T(std::move(_data[i]));
+                            _data[i].~T();
+                        }
+
+                        if (_data) allocator::release(_data);
+                        _data = new_data;
+                        _capacity = new_capacity;
+                    }
+                }
+            }
+        }
+
+        // Copies the items in [first, last) to the end of the vector.
+        // NOTE: the range must not be inside this vector.
+        template<typename iterator>
+        constexpr void append(iterator first, iterator last)
+        {
+            const UINT64 count{ (UINT64)std::distance(first, last) };
+            if (!count) return;
+
+            grow(_size + count);
+            copy_construct(std::addressof(_data[_size]), first, count);
+            _size += count;
+        }
+
+        // Replaces the content of the vector with copies of the items in [first, last).
+        // NOTE: the range must not be inside this vector.
+        template<typename iterator>
+        constexpr void assign(iterator first, iterator last)
+        {
+            clear();
+            append(first, last);
+        }
+
+        // Copies the items in [first, last) before 'position'. Returns a pointer to the first inserted item.
+        // NOTE: the range must not be inside this vector.
+        template<typename iterator>
+        constexpr T* const insert(T* const position, iterator first, iterator last)
+        {
+            assert(position >= begin() && position <= end());
+            const UINT64 index{ (UINT64)(position - _data) };
+            const UINT64 count{ (UINT64)std::distance(first, last) };
+            if (!count) return position;
+
+            grow(_size + count);
+            T* const items{ std::addressof(_data[index]) };
+            const UINT64 tail_count{ _size - index };
+            if (tail_count)
+            {
+                if constexpr (relocate_with_memcpy)
                 {
-                    _data = static_cast<T*>(new_buffer);
-                    _capacity = new_capacity;
+                    memmove(items + count, items, tail_count * sizeof(T));
+                }
+                else
+                {
+                    for (UINT64 i{ tail_count }; i > 0; --i)
+                    {
+                        new (std::addressof(items[count + i - 1])) T(std::move(items[i - 1]));
+                        items[i - 1].~T();
+                    }
                 }
             }
+
+            copy_construct(items, first, count);
+            _size += count;
+            return items;
         }
 
         // Removes the item at specified index.
@@ -193,9 +313,22 @@ namespace utl {
                 item < std::addressof(_data[_size]));
             if constexpr (destruct) item->~T();
             --_size;
-            if (item < std::addressof(_data[_size]))
+            T* const last{ std::addressof(_data[_size]) };
+            if (item < last)
             {
-                memcpy(item, item + 1, (std::addressof(_data[_size]) - item) * sizeof(T));
+                if constexpr (relocate_with_memcpy)
+                {
+                    // NOTE: source and destination overlap.
+                    memmove(item, item + 1, (last - item) * sizeof(T));
+                }
+                else
+                {
+                    for (T* p{ item }; p < last; ++p)
+                    {
+                        new (p) T(std::move(p[1]));
+                        p[1].~T();
+                    }
+                }
             }
 
             return item;
@@ -217,7 +350,15 @@ namespace utl {
             --_size;
             if (item < std::addressof(_data[_size]))
             {
-                memcpy(item, std::addressof(_data[_size]), sizeof(T));
+                if constexpr (relocate_with_memcpy)
+                {
+                    memcpy(item, std::addressof(_data[_size]), sizeof(T));
+                }
+                else
+                {
+                    new (item) T(std::move(_data[_size]));
+                    _data[_size].~T();
+                }
             }
 
             return item;
@@ -327,30 +468,61 @@ namespace utl {
         // Returns a pointer to the first item. Returns null when vector is empty.
         [[nodiscard]] constexpr T* begin()
         {
-            return std::addressof(_data[0]);
+            return _data;
         }
 
         // Returns a constant pointer to the first item. Returns null when vector is empty.
         [[nodiscard]] constexpr const T* begin() const
         {
-            return std::addressof(_data[0]);
+            return _data;
         }
 
         // Returns a pointer to the last item. Returns null when vector is empty.
         [[nodiscard]] constexpr T* end()
         {
             assert(!(_data == nullptr && _size > 0));
-            return std::addressof(_data[_size]);
+            return _data + _size;
         }
 
         // Returns a constant pointer to the last item. Returns null when vector is empty.
         [[nodiscard]] constexpr const T* end() const
         {
             assert(!(_data == nullptr && _size > 0));
-            return std::addressof(_data[_size]);
+            return _data + _size;
         }
 
     private:
+        // Vectors that don't destruct their items (e.g. free_list storage) may hold dead slots,
+        // which can only be copied as bytes.
+        static constexpr bool relocate_with_memcpy{ is_trivially_relocatable_v<T> || !destruct };
+
+        // Like reserve(), but keeps the usual 50% growth so repeated appends stay amortized.
+        constexpr void grow(UINT64 min_capacity)
+        {
+            if (min_capacity > _capacity)
+            {
+                const UINT64 new_capacity{ ((_capacity + 1) * 3) >> 1 };
+                reserve(new_capacity > min_capacity ? new_capacity : min_capacity);
+            }
+        }
+
+        template<typename iterator>
+        static constexpr void copy_construct(T* const destination, iterator first, UINT64 count)
+        {
+            if constexpr (std::is_trivially_copyable_v<T> && std::is_pointer_v<iterator> &&
+                std::is_same_v<std::remove_cv_t<std::remove_pointer_t<iterator>>, T>)
+            {
+                memcpy(destination, first, count * sizeof(T));
+            }
+            else
+            {
+                for (UINT64 i{ 0 }; i < count; ++i, ++first)
+                {
+                    new (std::addressof(destination[i])) T(*first);
+                }
+            }
+        }
+
         constexpr void move(vector& o)
         {
             _capacity = o._capacity;
@@ -384,7 +556,7 @@ namespace utl {
             assert([&] {return _capacity ? _data != nullptr : _data == nullptr; }());
             clear();
             _capacity = 0;
-            if (_data) free(_data);
+            if (_data) allocator::release(_data);
             _data = nullptr;
         }
 
@@ -392,4 +564,8 @@ namespace utl {
         UINT64 _size{ 0 };
         T* _data{ nullptr };
     };
+
+    // A vector only holds a pointer to its items, so it can be relocated as bytes.
+    template<typename T, bool destruct, typename allocator>
+    struct is_trivially_relocatable<vector<T, destruct, allocator>> : std::true_type {};
 }
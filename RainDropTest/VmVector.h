@@ -0,0 +1,243 @@
+#pragma once
+#include "stdafx.h"
+
+namespace utl {
+
+    // Growable array for large id-indexed data (one item per entity and so on).
+    // The address range for 'max_count' items is reserved up front. Pages are committed only
+    // as the array grows. Growing never moves the items:
+    //  - there are no realloc copies when many entities are created at once
+    //  - pointers to items stay valid until the items are removed
+    // NOTE: reserving only uses address space. Memory is used by the committed pages only.
+    template<typename T, bool destruct = true>
+    class vm_vector
+    {
+    public:
+        vm_vector() = default;
+
+        // Nothing is reserved until the first item is added.
+        constexpr explicit vm_vector(UINT64 max_count) : _max_count{ max_count } {}
+
+        DISABLE_COPY(vm_vector);
+
+        constexpr vm_vector(vm_vector&& o)
+        {
+            move(o);
+        }
+
+        constexpr vm_vector& operator=(vm_vector&& o)
+        {
+            assert(this != std::addressof(o));
+            if (this != std::addressof(o))
+            {
+                destroy();
+                move(o);
+            }
+            return *this;
+        }
+
+        ~vm_vector() { destroy(); }
+
+        // Inserts an item at the end of the vector by copying 'value'.
+        constexpr void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        // Inserts an item at the end of the vector by moving 'value'.
+        constexpr void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        // Copy- or move-constructs an item at the end of the vector.
+        template<typename... params>
+        constexpr decltype(auto) emplace_back(params&&... p)
+        {
+            if (_size == _capacity)
+            {
+                reserve(_size + 1);
+            }
+            assert(_size < _capacity);
+
+            T* const item{ new (std::addressof(_data[_size])) T(std::forward<params>(p)...) };
+            ++_size;
+            return *item;
+        }
+
+        // Resizes the vector and initializes new items with their default value.
+        constexpr void resize(UINT64 new_size)
+        {
+            static_assert(std::is_default_constructible<T>::value,
+                "Type must be default-constructible.");
+
+            reserve(new_size);
+            while (_size < new_size)
+            {
+                new (std::addressof(_data[_size])) T();
+                ++_size;
+            }
+            shrink_to(new_size);
+        }
+
+        // Resizes the vector and initializes new items by copying 'value'.
+        constexpr void resize(UINT64 new_size, const T& value)
+        {
+            static_assert(std::is_copy_constructible<T>::value,
+                "Type must be copy-constructible.");
+
+            reserve(new_size);
+            while (_size < new_size)
+            {
+                new (std::addressof(_data[_size])) T(value);
+                ++_size;
+            }
+            shrink_to(new_size);
+        }
+
+        // Commits memory for at least 'new_capacity' items. The items never move.
+        void reserve(UINT64 new_capacity)
+        {
+            if (new_capacity <= _capacity) return;
+            assert(new_capacity <= _max_count); // increase the max count given to the constructor.
+
+            if (!_data)
+            {
+                _data = (T*)VirtualAlloc(nullptr, align_size(_max_count * sizeof(T)), MEM_RESERVE, PAGE_NOACCESS);
+                assert(_data);
+                if (!_data) return;
+            }
+
+            // NOTE: committing in 64KB steps keeps the number of VirtualAlloc calls low.
+            //       Committed pages take no physical memory until they're first written.
+            const UINT64 new_committed_size{ align_size(new_capacity * sizeof(T)) };
+            void* const memory{ VirtualAlloc((UINT8*)_data + _committed_size,
+                new_committed_size - _committed_size, MEM_COMMIT, PAGE_READWRITE) };
+            assert(memory);
+            if (memory)
+            {
+                _committed_size = new_committed_size;
+                _capacity = _committed_size / sizeof(T);
+            }
+        }
+
+        // Same as erase() in utl::vector but faster because it just moves the last item.
+        // NOTE: only the last item's address changes.
+        constexpr T* const erase_unordered(UINT64 index)
+        {
+            assert(index < _size);
+            T* const item{ std::addressof(_data[index]) };
+            --_size;
+            if (item < std::addressof(_data[_size]))
+            {
+                *item = std::move(_data[_size]);
+            }
+            if constexpr (destruct) _data[_size].~T();
+            return item;
+        }
+
+        // Clears the vector and destructs items as specified in template argument.
+        // The committed memory is kept.
+        constexpr void clear()
+        {
+            shrink_to(0);
+        }
+
+        [[nodiscard]] constexpr T* data() { return _data; }
+        [[nodiscard]] constexpr T* const data() const { return _data; }
+        [[nodiscard]] constexpr bool empty() const { return _size == 0; }
+        [[nodiscard]] constexpr UINT64 size() const { return _size; }
+        [[nodiscard]] constexpr UINT64 capacity() const { return _capacity; }
+        [[nodiscard]] constexpr UINT64 max_count() const { return _max_count; }
+
+        [[nodiscard]] constexpr T& operator[](UINT64 index)
+        {
+            assert(_data && index < _size);
+            return _data[index];
+        }
+
+        [[nodiscard]] constexpr const T& operator[](UINT64 index) const
+        {
+            assert(_data && index < _size);
+            return _data[index];
+        }
+
+        [[nodiscard]] constexpr T& front()
+        {
+            assert(_data && _size);
+            return _data[0];
+        }
+
+        [[nodiscard]] constexpr const T& front() const
+        {
+            assert(_data && _size);
+            return _data[0];
+        }
+
+        [[nodiscard]] constexpr T& back()
+        {
+            assert(_data && _size);
+            return _data[_size - 1];
+        }
+
+        [[nodiscard]] constexpr const T& back() const
+        {
+            assert(_data && _size);
+            return _data[_size - 1];
+        }
+
+        [[nodiscard]] constexpr T* begin() { return _data; }
+        [[nodiscard]] constexpr const T* begin() const { return _data; }
+        [[nodiscard]] constexpr T* end() { return _data + _size; }
+        [[nodiscard]] constexpr const T* end() const { return _data + _size; }
+
+    private:
+        // Granularity of VirtualAlloc reservations on Windows. Also used for commits.
+        static constexpr UINT64 granularity{ 64 * 1024 };
+
+        [[nodiscard]] static constexpr UINT64 align_size(UINT64 size)
+        {
+            return (size + granularity - 1) & ~(granularity - 1);
+        }
+
+        constexpr void shrink_to(UINT64 new_size)
+        {
+            if constexpr (destruct)
+            {
+                for (UINT64 i{ new_size }; i < _size; ++i)
+                {
+                    _data[i].~T();
+                }
+            }
+            if (new_size < _size) _size = new_size;
+        }
+
+        constexpr void move(vm_vector& o)
+        {
+            _data = o._data;
+            _size = o._size;
+            _capacity = o._capacity;
+            _max_count = o._max_count;
+            _committed_size = o._committed_size;
+            o._data = nullptr;
+            o._size = 0;
+            o._capacity = 0;
+            o._committed_size = 0;
+        }
+
+        void destroy()
+        {
+            clear();
+            if (_data) VirtualFree(_data, 0, MEM_RELEASE);
+            _data = nullptr;
+            _capacity = 0;
+            _committed_size = 0;
+        }
+
+        T*      _data{ nullptr };
+        UINT64  _size{ 0 };
+        UINT64  _capacity{ 0 };
+        UINT64  _max_count{ 0 };
+        UINT64  _committed_size{ 0 };
+    };
+}
@@ -0,0 +1,77 @@
+#include "Bench.h"
+#include <atomic>
+
+// Counts heap allocations by replacing the C allocation functions. glibc's operator new() calls malloc(),
+// so std containers and utl containers (which use realloc()) are counted the same way.
+// NOTE: only glibc exports the __libc_* functions the replacements forward to. The sanitizers replace them too.
+
+namespace bench {
+    namespace {
+        std::atomic<UINT64> allocated_bytes{ 0 };
+        std::atomic<UINT64> allocation_count{ 0 };
+
+        [[maybe_unused]] void count_allocation(size_t size)
+        {
+            allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    } // anonymous namespace
+
+    allocation_stats allocations()
+    {
+        return { allocated_bytes.load(std::memory_order_relaxed), allocation_count.load(std::memory_order_relaxed) };
+    }
+}
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* memory, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void* memory);
+
+    void* malloc(size_t size)
+    {
+        bench::count_allocation(size);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        bench::count_allocation(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    // NOTE: counts the new size. A realloc() that grows in place is still an allocation for the caller.
+    void* realloc(void* memory, size_t size)
+    {
+        bench::count_allocation(size);
+        return __libc_realloc(memory, size);
+    }
+
+    void* memalign(size_t alignment, size_t size)
+    {
+        bench::count_allocation(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size)
+    {
+        bench::count_allocation(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** memory, size_t alignment, size_t size)
+    {
+        bench::count_allocation(size);
+        *memory = __libc_memalign(alignment, size);
+        return *memory ? 0 : 12; // ENOMEM
+    }
+
+    void free(void* memory)
+    {
+        __libc_free(memory);
+    }
+}
+#endif
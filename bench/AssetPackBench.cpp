@@ -0,0 +1,155 @@
+#include "Bench.h"
+#include "AssetPack.h"
+#include "Jobs.h"
+#include <algorithm>
+#include <atomic>
+
+namespace bench {
+    namespace {
+
+        struct loaded_file
+        {
+            std::atomic<UINT64> checksum{ 0 };
+            std::atomic<UINT>   calls{ 0 };
+        };
+
+        [[nodiscard]] UINT64 checksum(std::span<const UINT8> data)
+        {
+            UINT64 total{ data.size() };
+            for (UINT64 offset{ 0 }; offset + sizeof(UINT64) <= data.size(); offset += sizeof(UINT64))
+            {
+                UINT64 word;
+                memcpy(&word, data.data() + offset, sizeof(UINT64));
+                total += word;
+            }
+            return total;
+        }
+
+        // Stands in for content::create_resource(), which reads all of the file once.
+        void load_file(std::span<const UINT8> data, void* context)
+        {
+            loaded_file& file{ *(loaded_file*)context };
+            file.checksum.store(checksum(data), std::memory_order_relaxed);
+            file.calls.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // About half compressible, like the engine's textures and models: runs of random bytes mixed with
+        // copies of earlier bytes that LZ4 finds.
+        [[nodiscard]] std::vector<UINT8> make_asset(random& rng, UINT size)
+        {
+            std::vector<UINT8> data(size);
+            UINT offset{ 0 };
+            while (offset < size)
+            {
+                const UINT run{ std::min(16 + rng.next(48), size - offset) };
+                if (offset >= 4096 && rng.next(2))
+                {
+                    const UINT source{ offset - 1 - rng.next(4095) };
+                    for (UINT i{ 0 }; i < run; ++i) data[offset + i] = data[source + i];
+                }
+                else
+                {
+                    for (UINT i{ 0 }; i < run; ++i) data[offset + i] = (UINT8)rng.next();
+                }
+                offset += run;
+            }
+            return data;
+        }
+
+        struct asset_set
+        {
+            std::vector<std::string>        paths;
+            std::vector<UINT64>             checksums;
+            std::filesystem::path           pack_path;
+            UINT64                          total_bytes{ 0 };
+        };
+
+        template<typename load_func>
+        void measure(runner& r, const std::string& name, const asset_set& assets, bool cold, load_func&& load)
+        {
+            if (!r.is_selected(name)) return;
+
+            const UINT count{ (UINT)assets.paths.size() };
+            std::vector<double> ns;
+            for (UINT run{ 0 }; run < (UINT)r.size(7, 3); ++run)
+            {
+                if (cold)
+                {
+                    for (const std::string& path : assets.paths) drop_from_cache(path);
+                    drop_from_cache(assets.pack_path);
+                }
+
+                std::unique_ptr<loaded_file[]> files{ std::make_unique<loaded_file[]>(count) };
+                std::vector<utl::file_read> reads(count);
+                for (UINT i{ 0 }; i < count; ++i) reads[i] = { assets.paths[i].c_str(), &load_file, &files[i] };
+
+                const auto start{ std::chrono::steady_clock::now() };
+                load(reads);
+                const auto stop{ std::chrono::steady_clock::now() };
+                ns.emplace_back(std::chrono::duration<double, std::nano>(stop - start).count());
+
+                bool same{ true };
+                for (UINT i{ 0 }; i < count; ++i) same &= files[i].calls == 1 && files[i].checksum == assets.checksums[i];
+                r.check(same, name + ": every file is loaded once, with the same bytes");
+            }
+            std::sort(ns.begin(), ns.end());
+
+            result res{};
+            res.name = name;
+            res.ops = 1;
+            res.ns_per_op = ns[ns.size() / 2];
+            res.min_ns_per_op = ns.front();
+            res.counters.emplace_back("MB/s", (double)assets.total_bytes / (1024.0 * 1024.0) / (ns[ns.size() / 2] * 1e-9));
+            r.add(std::move(res));
+        }
+
+    } // anonymous namespace
+
+    // Startup loading: all assets from the loose files (utl::read_files()) against the same files from an
+    // asset pack (content::asset_pack, opening the pack included). ns/op is the time to load all of them.
+    // Warm files are in the OS file cache, cold ones are dropped from it before each run.
+    // NOTE: decompression runs on the job threads, so the pack needs several cores to catch up.
+    void run_asset_pack_benchmarks(runner& r)
+    {
+        // A few big textures and many small files, like create_render_items() loads.
+        const UINT texture_count{ (UINT)r.size(8, 3) };
+        const UINT small_file_count{ (UINT)r.size(32, 8) };
+        const UINT texture_size{ (UINT)r.size(2 * 1024 * 1024, 512 * 1024) };
+
+        const temp_directory directory{};
+        random rng{};
+        asset_set assets{};
+        std::vector<std::filesystem::path> files{};
+        for (UINT i{ 0 }; i < texture_count + small_file_count; ++i)
+        {
+            const bool is_texture{ i < texture_count };
+            const std::vector<UINT8> data{ make_asset(rng, is_texture ? texture_size : 4096 + rng.next(252 * 1024)) };
+            files.emplace_back(directory.write((is_texture ? "texture_" : "model_") + std::to_string(i) + ".bin", data));
+            assets.paths.emplace_back(files.back().string());
+            assets.checksums.emplace_back(checksum(data));
+            assets.total_bytes += data.size();
+        }
+
+        jobs::initialize();
+        assets.pack_path = directory.path() / "assets.pack";
+        const bool packed{ content::create_asset_pack(assets.pack_path, files.data(), (UINT)files.size()) };
+        r.check(packed, "create_asset_pack()");
+        if (packed)
+        {
+            const std::string prefix{ "io/startup/" + std::to_string(files.size()) + "_files_" +
+                std::to_string(assets.total_bytes / (1024 * 1024)) + "MB/" };
+            for (const bool cold : { false, true })
+            {
+                const std::string state{ cold ? "cold/" : "warm/" };
+                measure(r, prefix + state + "loose", assets, cold, [](std::vector<utl::file_read>& reads) {
+                    utl::read_files(reads.data(), (UINT)reads.size());
+                    });
+                measure(r, prefix + state + "pack", assets, cold, [&assets](std::vector<utl::file_read>& reads) {
+                    content::asset_pack pack{};
+                    if (pack.open(assets.pack_path)) pack.read_files(reads.data(), (UINT)reads.size());
+                    });
+            }
+        }
+        jobs::shutdown();
+    }
+}
@@ -0,0 +1,99 @@
+#include "AssetPack.h"
+#include "Jobs.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <string_view>
+
+// Standalone asset packer, the same as the app's --pack option (see RainDropTest/Main.cpp):
+//
+//   asset_packer [--block-size=<bytes>] <output.pack> <file or directory>...
+//
+// Directories add the files in them, without going into sub-directories. The pack is read back and
+// compared with the files before the packer returns 0.
+namespace {
+
+    struct verified_file
+    {
+        const std::filesystem::path*    path{ nullptr };
+        std::atomic<bool>               same{ false };
+    };
+
+    void compare_with_file(std::span<const UINT8> data, void* context)
+    {
+        verified_file& file{ *(verified_file*)context };
+        const utl::mapped_file original{ *file.path };
+        file.same = original.is_open() && original.size() == data.size() && !memcmp(original.data(), data.data(), data.size());
+    }
+
+    [[nodiscard]] bool verify(const std::filesystem::path& output, const utl::vector<std::filesystem::path>& files)
+    {
+        content::asset_pack pack{};
+        if (!pack.open(output) || pack.entry_count() != files.size()) return false;
+
+        const UINT count{ (UINT)files.size() };
+        std::unique_ptr<verified_file[]> verified{ std::make_unique<verified_file[]>(count) };
+        std::vector<std::string> paths(count);
+        std::vector<utl::file_read> reads(count);
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            verified[i].path = &files[i];
+            paths[i] = files[i].string();
+            reads[i] = { paths[i].c_str(), &compare_with_file, &verified[i] };
+        }
+        pack.read_files(reads.data(), count);
+
+        bool same{ true };
+        for (UINT i{ 0 }; i < count; ++i)
+        {
+            if (verified[i].same) continue;
+            fprintf(stderr, "asset_packer: '%s' doesn't read back the same\n", paths[i].c_str());
+            same = false;
+        }
+        return same;
+    }
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    UINT block_size{ content::asset_pack_default_block_size };
+    int first{ 1 };
+    constexpr std::string_view block_size_option{ "--block-size=" };
+    if (argc > first && std::string_view{ argv[first] }.starts_with(block_size_option))
+    {
+        block_size = (UINT)strtoul(argv[first] + block_size_option.size(), nullptr, 10);
+        ++first;
+    }
+
+    if (argc - first < 2 || block_size < content::asset_pack_min_block_size || block_size > content::asset_pack_max_block_size)
+    {
+        fprintf(stderr, "usage: asset_packer [--block-size=<%u..%u>] <output.pack> <file or directory>...\n",
+            content::asset_pack_min_block_size, content::asset_pack_max_block_size);
+        return 2;
+    }
+
+    const std::filesystem::path output{ argv[first] };
+    utl::vector<std::filesystem::path> inputs{};
+    for (int i{ first + 1 }; i < argc; ++i) inputs.emplace_back(argv[i]);
+
+    const utl::vector<std::filesystem::path> files{ content::list_files_to_pack(inputs.data(), (UINT)inputs.size()) };
+    if (files.empty())
+    {
+        fprintf(stderr, "asset_packer: no files to pack\n");
+        return 1;
+    }
+
+    jobs::initialize();
+    bool succeeded{ content::create_asset_pack(output, files.data(), (UINT)files.size(), block_size) };
+    if (!succeeded) fprintf(stderr, "asset_packer: can't write '%s' (a file can't be read or two have the same name)\n", output.string().c_str());
+    succeeded = succeeded && verify(output, files);
+    jobs::shutdown();
+    if (!succeeded) return 1;
+
+    UINT64 input_size{ 0 };
+    std::error_code error{};
+    for (const std::filesystem::path& file : files) input_size += std::filesystem::file_size(file, error);
+    printf("asset_packer: %u files, %llu bytes packed to %llu bytes in '%s'\n", (UINT)files.size(),
+        (unsigned long long)input_size, (unsigned long long)std::filesystem::file_size(output, error), output.string().c_str());
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "Bench.h"
+#include "Content.h"
+#include "Utilities.h"
+#include "Math.h"
+
+namespace bench {
+    namespace {
+
+        // The vertex layout the engine's normal and texture shaders read (Shaders.cpp's static_normal_texture).
+        constexpr UINT elements_type{ 0x03 };
+        constexpr UINT element_size{ 20 };
+        constexpr UINT alignment{ D3D12_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_MULTIPLE };
+
+        [[nodiscard]] UINT sub_mesh_size(UINT vertex_count)
+        {
+            const UINT index_size{ vertex_count < (1 << 16) ? (UINT)sizeof(UINT16) : (UINT)sizeof(UINT) };
+            return (UINT)sizeof(content::geometry_sub_mesh_header) +
+                (UINT)math::align_size_up<alignment>(sizeof(XMFLOAT3) * vertex_count) +
+                (UINT)math::align_size_up<alignment>(element_size * vertex_count) +
+                index_size * vertex_count;
+        }
+
+    } // anonymous namespace
+
+    // struct {
+    //     u32 lod_count,
+    //     struct {
+    //         f32 lod_threshold, u32 sub_mesh_count, u32 size_of_sub_meshes,
+    //         struct {
+    //             u32 element_size, u32 vertex_count, u32 index_count, u32 elements_type, u32 primitive_topology,
+    //             u8 positions[sizeof(f32) * 3 * vertex_count],     // sizeof(positions) must be a multiple of 4 bytes.
+    //             u8 elements[element_size * vertex_count],         // sizeof(elements) must be a multiple of 4 bytes.
+    //             u8 indices[index_size * index_count]
+    //         } sub_meshes[sub_mesh_count]
+    //     } lods[lod_count]
+    // } geometry
+    // NOTE: one index per vertex, so each triangle has its own three vertices.
+    std::vector<UINT8> make_mesh_blob(UINT sub_mesh_count, UINT vertex_count)
+    {
+        assert(sub_mesh_count && vertex_count && !(vertex_count % 3));
+        const UINT size_of_sub_meshes{ sub_mesh_count * sub_mesh_size(vertex_count) };
+        std::vector<UINT8> data(sizeof(UINT) + sizeof(content::geometry_header) + size_of_sub_meshes);
+        utl::blob_stream_writer blob{ data.data(), data.size() };
+
+        blob.write<UINT>(1);
+        blob.write<float>(0.f);
+        blob.write<UINT>(sub_mesh_count);
+        blob.write<UINT>(size_of_sub_meshes);
+
+        const bool is_16_bit{ vertex_count < (1 << 16) };
+        for (UINT i{ 0 }; i < sub_mesh_count; ++i)
+        {
+            blob.write<UINT>(element_size);
+            blob.write<UINT>(vertex_count);
+            blob.write<UINT>(vertex_count);
+            blob.write<UINT>(elements_type);
+            blob.write<UINT>(content::primitive_topology::triangle_list);
+
+            for (UINT v{ 0 }; v < vertex_count; ++v)
+            {
+                blob.write<float>((float)(v % 3));
+                blob.write<float>((float)(v / 3));
+                blob.write<float>((float)i);
+            }
+            blob.skip(math::align_size_up<alignment>(sizeof(XMFLOAT3) * vertex_count) - sizeof(XMFLOAT3) * vertex_count);
+            // The elements stay zero, nothing reads them on the CPU.
+            blob.skip(math::align_size_up<alignment>(element_size * vertex_count));
+
+            for (UINT v{ 0 }; v < vertex_count; ++v)
+            {
+                if (is_16_bit) blob.write<UINT16>((UINT16)v);
+                else blob.write<UINT>(v);
+            }
+        }
+
+        assert(blob.offset() == data.size());
+        return data;
+    }
+
+    // struct {
+    //     u32 width, height, array_size (or depth), flags, mip_levels, format,
+    //     struct {
+    //         u32 row_pitch, slice_pitch,
+    //         u8 image[mip_level][slice_pitch * depth_per_mip],
+    //     } images[]
+    // } texture
+    std::vector<UINT8> make_texture_blob(UINT width, UINT height)
+    {
+        assert(width && height);
+        const UINT row_pitch{ width * 4 };
+        const UINT slice_pitch{ row_pitch * height };
+        std::vector<UINT8> data(8 * sizeof(UINT) + slice_pitch);
+        utl::blob_stream_writer blob{ data.data(), data.size() };
+
+        blob.write<UINT>(width);
+        blob.write<UINT>(height);
+        blob.write<UINT>(1);
+        blob.write<UINT>(0);
+        blob.write<UINT>(1);
+        blob.write<UINT>(DXGI_FORMAT_R8G8B8A8_UNORM);
+        blob.write<UINT>(row_pitch);
+        blob.write<UINT>(slice_pitch);
+        for (UINT i{ 0 }; i < slice_pitch; ++i) blob.write<UINT8>((UINT8)i);
+
+        assert(blob.offset() == data.size());
+        return data;
+    }
+}
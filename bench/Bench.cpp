@@ -0,0 +1,139 @@
+#include "Bench.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <fstream>
+
+namespace bench {
+    namespace {
+
+        constexpr UINT full_runs{ 15 };
+        constexpr UINT quick_runs{ 3 };
+
+        void write_json_string(std::ofstream& file, std::string_view text)
+        {
+            file << '"';
+            for (const char c : text)
+            {
+                if (c == '"' || c == '\\') file << '\\';
+                file << c;
+            }
+            file << '"';
+        }
+
+    } // anonymous namespace
+
+    runner::runner(int argc, char** argv, std::string_view program_name)
+        : _program_name{ program_name }, _json_path{ std::string{ program_name } + ".json" }
+    {
+        for (int i{ 1 }; i < argc; ++i)
+        {
+            const std::string_view arg{ argv[i] };
+            if (arg == "--quick") _quick = true;
+            else if (arg.starts_with("--filter=")) _filter = arg.substr(9);
+            else if (arg.starts_with("--json=")) _json_path = arg.substr(7);
+            else if (arg.starts_with("--force-isa=")) force_isa(std::string{ arg.substr(12) });
+            else fprintf(stderr, "%s: unknown argument '%s'\n", _program_name.c_str(), argv[i]);
+        }
+        _runs = _quick ? quick_runs : full_runs;
+    }
+
+    void runner::force_isa(const std::string& name)
+    {
+        const core::cpu::isa::level level{ core::cpu::isa_from_name(name.c_str()) };
+        if (level == core::cpu::isa::count)
+        {
+            fprintf(stderr, "%s: unknown instruction set '%s'\n", _program_name.c_str(), name.c_str());
+            ++_failures;
+            return;
+        }
+        core::cpu::force_isa(level);
+    }
+
+    void runner::add(result r)
+    {
+        printf("%-56s %12.2f ns/op %12llu B %8llu allocs", r.name.c_str(), r.ns_per_op,
+            (unsigned long long)r.bytes_allocated, (unsigned long long)r.allocations);
+        if (r.peak_rss) printf(" %10.1f MB peak RSS", (double)r.peak_rss / (1024.0 * 1024.0));
+        for (const auto& [name, value] : r.counters) printf(" %s=%.2f", name.c_str(), value);
+        printf("\n");
+        _results.emplace_back(std::move(r));
+    }
+
+    void runner::check(bool condition, std::string_view what)
+    {
+        if (condition) return;
+        fprintf(stderr, "FAILED: %.*s\n", (int)what.size(), what.data());
+        ++_failures;
+    }
+
+    bool runner::is_selected(std::string_view name) const
+    {
+        return _filter.empty() || name.find(_filter) != std::string_view::npos;
+    }
+
+    void runner::begin_runs()
+    {
+        _run_ns.clear();
+        _run_allocations = {};
+    }
+
+    void runner::add_run(double ns, allocation_stats before, allocation_stats after)
+    {
+        _run_ns.emplace_back(ns);
+        // NOTE: every run does the same work, so the last run's allocations are as good as any.
+        _run_allocations = { after.bytes - before.bytes, after.count - before.count };
+    }
+
+    void runner::end_runs(std::string_view name, UINT64 ops)
+    {
+        assert(!_run_ns.empty() && ops);
+        std::sort(_run_ns.begin(), _run_ns.end());
+
+        result r{};
+        r.name = name;
+        r.ops = ops;
+        r.ns_per_op = _run_ns[_run_ns.size() / 2] / (double)ops;
+        r.min_ns_per_op = _run_ns.front() / (double)ops;
+        r.bytes_allocated = _run_allocations.bytes;
+        r.allocations = _run_allocations.count;
+        add(std::move(r));
+    }
+
+    int runner::finish()
+    {
+        std::ofstream file{ _json_path, std::ios::trunc };
+        if (!file)
+        {
+            fprintf(stderr, "%s: can't write '%s'\n", _program_name.c_str(), _json_path.c_str());
+            return 1;
+        }
+
+        file << "{\n  \"benchmark\": ";
+        write_json_string(file, _program_name);
+        file << ",\n  \"quick\": " << (_quick ? "true" : "false") << ",\n  \"results\": [";
+        for (UINT64 i{ 0 }; i < _results.size(); ++i)
+        {
+            const result& r{ _results[i] };
+            file << (i ? ",\n" : "\n") << "    { \"name\": ";
+            write_json_string(file, r.name);
+            file << ", \"ops\": " << r.ops << ", \"ns_per_op\": " << r.ns_per_op << ", \"min_ns_per_op\": " << r.min_ns_per_op
+                << ", \"bytes_allocated\": " << r.bytes_allocated << ", \"allocations\": " << r.allocations << ", \"peak_rss\": " << r.peak_rss;
+            if (!r.counters.empty())
+            {
+                file << ", \"counters\": {";
+                for (UINT64 j{ 0 }; j < r.counters.size(); ++j)
+                {
+                    file << (j ? ", " : " ");
+                    write_json_string(file, r.counters[j].first);
+                    file << ": " << r.counters[j].second;
+                }
+                file << " }";
+            }
+            file << " }";
+        }
+        file << "\n  ]\n}\n";
+
+        printf("%llu results written to %s\n", (unsigned long long)_results.size(), _json_path.c_str());
+        return _failures ? 1 : 0;
+    }
+}
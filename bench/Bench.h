@@ -0,0 +1,189 @@
+#pragma once
+#include "stdafx.h"
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace bench {
+
+    // Bytes and calls of malloc(), realloc(), operator new() and so on since the program started.
+    // NOTE: only counted with glibc and without sanitizers, see Allocations.cpp. Otherwise both stay 0.
+    struct allocation_stats
+    {
+        UINT64 bytes{ 0 };
+        UINT64 count{ 0 };
+    };
+
+    [[nodiscard]] allocation_stats allocations();
+
+    struct result
+    {
+        std::string name;
+        UINT64      ops{ 0 };               // operations in one run.
+        double      ns_per_op{ 0 };         // median of the runs.
+        double      min_ns_per_op{ 0 };
+        UINT64      bytes_allocated{ 0 };   // in one run.
+        UINT64      allocations{ 0 };       // in one run.
+        UINT64      peak_rss{ 0 };          // bytes, only set by benchmarks that measure it (see io_bench).
+        // Other values a benchmark measured, e.g. throughput or queue depth. Printed and written as they are.
+        std::vector<std::pair<std::string, double>> counters;
+    };
+
+    struct empty_state {};
+
+    // Small, fast and deterministic, so every variant of a benchmark sees the same sequence.
+    class random
+    {
+    public:
+        constexpr explicit random(UINT64 seed = 0x9e3779b97f4a7c15ull) : _state{ seed } {}
+
+        // splitmix64
+        [[nodiscard]] constexpr UINT64 next()
+        {
+            UINT64 z{ _state += 0x9e3779b97f4a7c15ull };
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        // In [0, bound).
+        [[nodiscard]] constexpr UINT next(UINT bound)
+        {
+            return (UINT)(((next() >> 32) * bound) >> 32);
+        }
+
+    private:
+        UINT64 _state;
+    };
+
+    // Keeps the compiler from optimizing away 'value' or the code that computed it.
+    template<typename T>
+    inline void do_not_optimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Runs benchmarks, prints a table and writes the results as JSON.
+    // Command line:
+    //  --quick             fewer and shorter runs (used by ctest)
+    //  --filter=<text>     only runs benchmarks whose name contains <text>
+    //  --json=<path>       where to write the results, "<program>.json" by default
+    //  --force-isa=<name>  caps the instruction set kernels select, see core::cpu::force_isa()
+    class runner
+    {
+    public:
+        runner(int argc, char** argv, std::string_view program_name);
+        DISABLE_COPY_AND_MOVE(runner);
+
+        // Times 'body(state)' for a number of runs. 'setup()' returns a fresh state before each run and
+        // isn't timed, nor are its allocations counted. 'ops' is how many operations one run does.
+        template<typename setup_func, typename body_func>
+        void run(std::string_view name, UINT64 ops, setup_func&& setup, body_func&& body)
+        {
+            if (!is_selected(name)) return;
+
+            begin_runs();
+            for (UINT i{ 0 }; i < _runs; ++i)
+            {
+                auto state{ setup() };
+                const allocation_stats before{ allocations() };
+                const auto start{ std::chrono::steady_clock::now() };
+                body(state);
+                const auto stop{ std::chrono::steady_clock::now() };
+                add_run(std::chrono::duration<double, std::nano>(stop - start).count(), before, allocations());
+            }
+            end_runs(name, ops);
+        }
+
+        template<typename body_func>
+        void run(std::string_view name, UINT64 ops, body_func&& body)
+        {
+            run(name, ops, [] { return empty_state{}; }, [&](empty_state&) { body(); });
+        }
+
+        // Adds a result that was measured by the caller (e.g. with several threads).
+        void add(result r);
+
+        // Fails the program (but keeps running) if 'condition' is false. Used to check that all
+        // variants of a benchmark computed the same thing.
+        void check(bool condition, std::string_view what);
+
+        [[nodiscard]] bool is_selected(std::string_view name) const;
+        [[nodiscard]] constexpr bool quick() const { return _quick; }
+        // Returns 'full', or 'quick' with --quick.
+        [[nodiscard]] constexpr UINT64 size(UINT64 full, UINT64 quick) const { return _quick ? quick : full; }
+
+        // Prints the results and writes the JSON file. Returns the exit code.
+        [[nodiscard]] int finish();
+
+    private:
+        void force_isa(const std::string& name);
+        void begin_runs();
+        void add_run(double ns, allocation_stats before, allocation_stats after);
+        void end_runs(std::string_view name, UINT64 ops);
+
+        std::string         _program_name;
+        std::string         _filter;
+        std::string         _json_path;
+        std::vector<result> _results;
+        std::vector<double> _run_ns;
+        allocation_stats    _run_allocations{};
+        UINT                _runs{ 0 };
+        UINT                _failures{ 0 };
+        bool                _quick{ false };
+    };
+
+    // A directory of its own under the system's temp directory. It's removed, with everything in it, when the
+    // object is destroyed.
+    class temp_directory
+    {
+    public:
+        temp_directory();
+        ~temp_directory();
+        DISABLE_COPY_AND_MOVE(temp_directory);
+
+        // Writes 'data' to a file in the directory and flushes it to disk, so drop_from_cache() can evict it.
+        [[nodiscard]] std::filesystem::path write(std::string_view name, std::span<const UINT8> data) const;
+        [[nodiscard]] const std::filesystem::path& path() const { return _path; }
+
+    private:
+        std::filesystem::path _path;
+    };
+
+    // Asks the OS to forget the cached pages of a file, so the next read comes from the disk.
+    // NOTE: only a hint. Dirty pages and pages another process maps stay in the cache.
+    void drop_from_cache(const std::filesystem::path& path);
+
+    // Runs 'func' in a child process and returns how much its peak resident set grew, in bytes. File pages
+    // that are mapped and touched count as resident, same as heap memory.
+    // NOTE: the child only has the thread that forked it, so 'func' must not wait for other threads (e.g. jobs).
+    [[nodiscard]] UINT64 measure_peak_rss(const std::function<void()>& func);
+
+    // Content blobs in the formats that content::create_resource() reads, see Assets.cpp.
+    // A single LOD mesh of 'sub_mesh_count' triangle lists with 'vertex_count' vertices each.
+    [[nodiscard]] std::vector<UINT8> make_mesh_blob(UINT sub_mesh_count, UINT vertex_count);
+    // An RGBA8 texture with one mip level.
+    [[nodiscard]] std::vector<UINT8> make_texture_blob(UINT width, UINT height);
+
+    // Benchmark suites of engine_bench, one per file.
+    void run_vector_benchmarks(runner& r);
+    void run_free_list_benchmarks(runner& r);
+    void run_concurrent_free_list_benchmarks(runner& r);
+    void run_sparse_free_list_benchmarks(runner& r);
+    void run_hash_map_benchmarks(runner& r);
+    void run_soa_vector_benchmarks(runner& r);
+    void run_entity_spawn_benchmarks(runner& r);
+    void run_entity_batch_benchmarks(runner& r);
+    void run_entity_iteration_benchmarks(runner& r);
+    void run_hash_benchmarks(runner& r);
+    void run_transform_benchmarks(runner& r);
+    void run_queue_benchmarks(runner& r);
+
+    // Benchmark suites of io_bench.
+    void run_mapped_file_benchmarks(runner& r);
+    void run_read_files_benchmarks(runner& r);
+    void run_asset_pack_benchmarks(runner& r);
+}
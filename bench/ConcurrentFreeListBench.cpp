@@ -0,0 +1,175 @@
+#include "Bench.h"
+#include "ConcurrentFreeList.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace bench {
+    namespace {
+
+        struct item
+        {
+            UINT a, b, c, d;
+        };
+
+        // How content kept its lists before: a paged free list behind a mutex. Loaders lock for each
+        // add and remove, the render thread locks once for the whole frame.
+        class locked_list
+        {
+        public:
+            UINT add(const item& x)
+            {
+                std::lock_guard lock{ _mutex };
+                return _list.add(x);
+            }
+
+            void remove(UINT id)
+            {
+                std::lock_guard lock{ _mutex };
+                _list.remove(id);
+            }
+
+            [[nodiscard]] UINT64 read_frame(const std::vector<UINT>& ids)
+            {
+                std::lock_guard lock{ _mutex };
+                UINT64 sum{ 0 };
+                for (const UINT id : ids) sum += _list[id].a;
+                return sum;
+            }
+
+        private:
+            utl::free_list<item, true, true>    _list;
+            std::mutex                          _mutex;
+        };
+
+        class lock_free_list
+        {
+        public:
+            UINT add(const item& x) { return _list.add(x); }
+            void remove(UINT id) { _list.remove(id); }
+
+            [[nodiscard]] UINT64 read_frame(const std::vector<UINT>& ids)
+            {
+                UINT64 sum{ 0 };
+                for (const UINT id : ids) sum += _list[id].a;
+                return sum;
+            }
+
+        private:
+            utl::concurrent_free_list<item, true> _list;
+        };
+
+        struct contention_run
+        {
+            double  load_ns{ 0 };       // per add or remove, over all loaders.
+            double  read_ns{ 0 };       // per item read by the render thread.
+            bool    sums_match{ true };
+        };
+
+        // 'loader_count' threads add and remove items (each keeps its last 64 items alive) while one thread
+        // reads the same 'frame_ids' over and over, like the render thread gathering a frame.
+        template<typename list>
+        [[nodiscard]] contention_run run_contention(UINT loader_count, UINT ops_per_loader, UINT frame_size)
+        {
+            list l{};
+            std::vector<UINT> frame_ids(frame_size);
+            for (UINT i{ 0 }; i < frame_size; ++i) frame_ids[i] = l.add(item{ i, 0, 0, 0 });
+            const UINT64 expected_sum{ (UINT64)frame_size * (frame_size - 1) / 2 };
+
+            std::atomic<bool> go{ false };
+            std::atomic<UINT> loaders_done{ 0 };
+            std::vector<std::thread> loaders;
+            for (UINT t{ 0 }; t < loader_count; ++t)
+            {
+                loaders.emplace_back([&l, &go, &loaders_done, ops_per_loader, t] {
+                    constexpr UINT kept{ 64 };
+                    UINT ids[kept]{};
+                    while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                    for (UINT i{ 0 }; i < ops_per_loader; ++i)
+                    {
+                        UINT& id{ ids[i % kept] };
+                        if (i >= kept) l.remove(id);
+                        id = l.add(item{ i, t, 0, 0 });
+                    }
+                    for (UINT i{ 0 }; i < std::min(kept, ops_per_loader); ++i) l.remove(ids[i]);
+                    loaders_done.fetch_add(1, std::memory_order_release);
+                    });
+            }
+
+            UINT64 frames{ 0 };
+            bool sums_match{ true };
+            const auto start{ std::chrono::steady_clock::now() };
+            go.store(true, std::memory_order_release);
+            do
+            {
+                const UINT64 sum{ l.read_frame(frame_ids) };
+                sums_match &= sum == expected_sum;
+                do_not_optimize(sum);
+                ++frames;
+            } while (loaders_done.load(std::memory_order_acquire) < loader_count);
+            const auto read_stop{ std::chrono::steady_clock::now() };
+            for (std::thread& loader : loaders) loader.join();
+            const auto stop{ std::chrono::steady_clock::now() };
+
+            for (const UINT id : frame_ids) l.remove(id);
+
+            // NOTE: each loader does one add per op, and one remove for every add.
+            const UINT64 load_ops{ 2ull * loader_count * ops_per_loader };
+            contention_run run{};
+            run.load_ns = std::chrono::duration<double, std::nano>(stop - start).count() / (double)load_ops;
+            run.read_ns = std::chrono::duration<double, std::nano>(read_stop - start).count() / (double)(frames * frame_size);
+            run.sums_match = sums_match;
+            return run;
+        }
+
+        template<typename list>
+        void contention(runner& r, const char* name, UINT loader_count, UINT ops_per_loader, UINT frame_size)
+        {
+            const std::string prefix{ "concurrent_free_list/loaders=" + std::to_string(loader_count) };
+            const std::string load_name{ prefix + "/load/" + name };
+            const std::string read_name{ prefix + "/frame_read/" + name };
+            if (!r.is_selected(load_name) && !r.is_selected(read_name)) return;
+
+            std::vector<double> load_ns, read_ns;
+            for (UINT i{ 0 }; i < (UINT)r.size(9, 3); ++i)
+            {
+                const contention_run run{ run_contention<list>(loader_count, ops_per_loader, frame_size) };
+                load_ns.emplace_back(run.load_ns);
+                read_ns.emplace_back(run.read_ns);
+                r.check(run.sums_match, "concurrent_free_list: the render thread read a wrong item");
+            }
+            std::sort(load_ns.begin(), load_ns.end());
+            std::sort(read_ns.begin(), read_ns.end());
+
+            result load{};
+            load.name = load_name;
+            load.ops = 2ull * loader_count * ops_per_loader;
+            load.ns_per_op = load_ns[load_ns.size() / 2];
+            load.min_ns_per_op = load_ns.front();
+            if (r.is_selected(load_name)) r.add(load);
+
+            result read{};
+            read.name = read_name;
+            read.ops = frame_size;
+            read.ns_per_op = read_ns[read_ns.size() / 2];
+            read.min_ns_per_op = read_ns.front();
+            if (r.is_selected(read_name)) r.add(read);
+        }
+
+    } // anonymous namespace
+
+    // Content's lists with N loader threads and one render thread, see content::render_item.
+    // NOTE: the numbers depend on how many cores the machine has. With fewer cores than threads, the locked
+    //       list mostly measures how long a loader waits for the render thread's frame.
+    void run_concurrent_free_list_benchmarks(runner& r)
+    {
+        const UINT ops_per_loader{ (UINT)r.size(200'000, 20'000) };
+        const UINT frame_size{ 10'000 };
+        for (const UINT loader_count : { 1u, 2u, 4u })
+        {
+            contention<locked_list>(r, "free_list+mutex", loader_count, ops_per_loader, frame_size);
+            contention<lock_free_list>(r, "concurrent_free_list", loader_count, ops_per_loader, frame_size);
+        }
+    }
+}
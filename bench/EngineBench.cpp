@@ -0,0 +1,20 @@
+#include "Bench.h"
+
+// Microbenchmarks of the engine's containers and CPU-side code. See CMakeLists.txt for how to build and run them.
+int main(int argc, char** argv)
+{
+    bench::runner r{ argc, argv, "engine_bench" };
+    bench::run_vector_benchmarks(r);
+    bench::run_free_list_benchmarks(r);
+    bench::run_concurrent_free_list_benchmarks(r);
+    bench::run_sparse_free_list_benchmarks(r);
+    bench::run_hash_map_benchmarks(r);
+    bench::run_soa_vector_benchmarks(r);
+    bench::run_entity_spawn_benchmarks(r);
+    bench::run_entity_batch_benchmarks(r);
+    bench::run_entity_iteration_benchmarks(r);
+    bench::run_hash_benchmarks(r);
+    bench::run_transform_benchmarks(r);
+    bench::run_queue_benchmarks(r);
+    return r.finish();
+}
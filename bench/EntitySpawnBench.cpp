@@ -0,0 +1,408 @@
+#include "Bench.h"
+#include "Vector.h"
+#include "VmVector.h"
+#include "Entity.h"
+#include "Transform.h"
+#include "Geometry.h"
+#include "Content.h"
+#include "NullDevice.h"
+#include <algorithm>
+
+namespace bench {
+    namespace {
+
+        // The entity-indexed arrays of transform and game_entity, with the same item types (from before the
+        // transform data moved into the chunks, see run_entity_iteration_benchmarks()).
+        template<template<typename> typename array>
+        struct entity_arrays
+        {
+            // transform
+            array<XMFLOAT4X4>   to_worlds;
+            array<XMFLOAT4X4>   inverse_worlds;
+            array<XMFLOAT4>     rotations;
+            array<XMFLOAT3>     orientations;
+            array<XMFLOAT3>     positions;
+            array<XMFLOAT3>     scales;
+            array<UINT8>        changes_from_previous_frame;
+            // game_entity
+            array<UINT64>       locations;
+            array<UINT8>        generations;
+            array<UINT>         next_free_index;
+
+            // Grows every array once and writes the new entities, like transform::create_batch() and
+            // game_entity::create_batch() do.
+            void spawn(UINT count)
+            {
+                const UINT64 first{ positions.size() };
+                const UINT64 new_size{ first + count };
+                to_worlds.resize(new_size);
+                inverse_worlds.resize(new_size);
+                rotations.resize(new_size);
+                orientations.resize(new_size);
+                positions.resize(new_size);
+                scales.resize(new_size);
+                changes_from_previous_frame.resize(new_size);
+                locations.resize(new_size);
+                generations.resize(new_size);
+                next_free_index.resize(new_size);
+
+                for (UINT64 i{ first }; i < new_size; ++i)
+                {
+                    const float f{ (float)i };
+                    rotations[i] = XMFLOAT4{ 0.f, 0.f, 0.f, 1.f };
+                    orientations[i] = XMFLOAT3{ 0.f, 0.f, 1.f };
+                    positions[i] = XMFLOAT3{ f, f, f };
+                    scales[i] = XMFLOAT3{ 1.f, 1.f, 1.f };
+                    changes_from_previous_frame[i] = 0xff;
+                    locations[i] = i;
+                    generations[i] = 0;
+                    next_free_index[i] = Invalid_Index;
+                }
+            }
+        };
+
+        template<typename T>
+        using heap_array = utl::vector<T>;
+
+        // vm_vector with the engine's reservation size.
+        template<typename T>
+        class vm_array : public utl::vm_vector<T>
+        {
+        public:
+            vm_array() : utl::vm_vector<T>{ game_entity::max_entity_count } {}
+        };
+
+        struct spawn_run
+        {
+            double          worst_frame_ns{ 0 };
+            double          median_frame_ns{ 0 };
+            allocation_stats allocated{};
+        };
+
+        // Spawns 'total' entities, 'per_frame' of them in each frame, and times every frame.
+        template<template<typename> typename array>
+        [[nodiscard]] spawn_run run_spawn(UINT total, UINT per_frame)
+        {
+            auto arrays{ std::make_unique<entity_arrays<array>>() };
+            std::vector<double> frame_ns;
+            frame_ns.reserve(total / per_frame + 1);
+
+            const allocation_stats before{ allocations() };
+            for (UINT spawned{ 0 }; spawned < total; spawned += per_frame)
+            {
+                const auto start{ std::chrono::steady_clock::now() };
+                arrays->spawn(std::min(per_frame, total - spawned));
+                const auto stop{ std::chrono::steady_clock::now() };
+                frame_ns.emplace_back(std::chrono::duration<double, std::nano>(stop - start).count());
+            }
+            const allocation_stats after{ allocations() };
+            do_not_optimize(arrays->positions.data());
+
+            std::sort(frame_ns.begin(), frame_ns.end());
+            spawn_run run{};
+            run.worst_frame_ns = frame_ns.back();
+            run.median_frame_ns = frame_ns[frame_ns.size() / 2];
+            run.allocated = { after.bytes - before.bytes, after.count - before.count };
+            return run;
+        }
+
+        template<template<typename> typename array>
+        void spawn(runner& r, const char* name, UINT total, UINT per_frame)
+        {
+            const std::string worst_name{ std::string{ "entity_spawn/worst_frame/" } + name };
+            const std::string median_name{ std::string{ "entity_spawn/median_frame/" } + name };
+            if (!r.is_selected(worst_name) && !r.is_selected(median_name)) return;
+
+            std::vector<spawn_run> runs;
+            for (UINT i{ 0 }; i < (UINT)r.size(7, 2); ++i) runs.emplace_back(run_spawn<array>(total, per_frame));
+
+            // NOTE: one frame each, so ns/op is the frame time. The median is over the runs.
+            const auto add = [&](const std::string& result_name, double spawn_run::* frame_ns) {
+                std::vector<double> ns;
+                for (const spawn_run& run : runs) ns.emplace_back(run.*frame_ns);
+                std::sort(ns.begin(), ns.end());
+                result res{};
+                res.name = result_name;
+                res.ops = 1;
+                res.ns_per_op = ns[ns.size() / 2];
+                res.min_ns_per_op = ns.front();
+                res.bytes_allocated = runs.back().allocated.bytes;
+                res.allocations = runs.back().allocated.count;
+                if (r.is_selected(result_name)) r.add(std::move(res));
+            };
+            add(worst_name, &spawn_run::worst_frame_ns);
+            add(median_name, &spawn_run::median_frame_ns);
+        }
+
+        // Every fourth entity has a geometry, so the entities go to two archetypes. The geometry's mesh and
+        // material are in content, on a gpu::null_device.
+        struct entity_infos
+        {
+            gpu::null_device                        device{ 1 << 16 };
+            std::vector<transform::init_info>       transforms;
+            std::vector<game_entity::entity_info>   infos;
+            geometry::init_info                     geometry{};
+            UINT                                    material_id{ Invalid_Index };
+
+            explicit entity_infos(UINT count) : transforms(count), infos(count)
+            {
+                gpu::set_current(&device);
+                content::initialize();
+                const std::vector<UINT8> mesh{ make_mesh_blob(1, 3) };
+                content::material_init_info material{};
+                material.type = content::material_type::opaque;
+                material.shader_ids[shaders::shader_type::vertex] = shaders::engine_shader::normal_shader_vs;
+                material.shader_ids[shaders::shader_type::pixel] = shaders::engine_shader::pixel_shader_ps;
+                material_id = content::create_resource(&material, content::asset_type::material);
+
+                geometry.geometry_content_id = content::create_resource(std::span<const UINT8>{ mesh }, content::asset_type::mesh);
+                geometry.material_count = 1;
+                geometry.material_ids = &material_id;
+                for (UINT i{ 0 }; i < count; ++i)
+                {
+                    transforms[i].position[0] = (float)i;
+                    transforms[i].rotation[3] = 1.f;
+                    infos[i].transform = &transforms[i];
+                    infos[i].geometry = (i % 4) ? nullptr : &geometry;
+                }
+            }
+
+            // NOTE: the entities that use the mesh and material are removed first (see live_entities).
+            ~entity_infos()
+            {
+                content::destroy_resource(geometry.geometry_content_id, content::asset_type::mesh);
+                content::destroy_resource(material_id, content::asset_type::material);
+                content::shutdown();
+                gpu::set_current(nullptr);
+            }
+
+            entity_infos(const entity_infos&) = delete;
+            entity_infos& operator=(const entity_infos&) = delete;
+        };
+
+        // Entities that are removed when the state of a run is destroyed, so the next run starts from the same
+        // free ids. Not timed.
+        struct live_entities
+        {
+            std::vector<game_entity::entity>    entities;
+            std::vector<UINT>                   ids;
+
+            explicit live_entities(UINT count) : entities(count), ids(count) {}
+            live_entities(live_entities&&) = default;
+            live_entities& operator=(live_entities&&) = default;
+
+            ~live_entities()
+            {
+                if (!entities.empty() && entities.front().is_valid()) game_entity::remove_batch(collect_ids());
+            }
+
+            std::span<const UINT> collect_ids()
+            {
+                for (UINT64 i{ 0 }; i < entities.size(); ++i) ids[i] = entities[i].get_id();
+                return ids;
+            }
+        };
+
+        [[nodiscard]] bool all_alive(live_entities& live, bool alive)
+        {
+            for (const game_entity::entity& e : live.entities)
+            {
+                if (game_entity::is_alive(e.get_id()) != alive) return false;
+            }
+            return true;
+        }
+
+        // The layout before the components' data was in the chunks: one array per field indexed by the entity's
+        // index (what transform::component ids are), and the render items in a dense array that the geometry ids
+        // map into (Geometry.cpp's id_mapping). The chunks only held the ids.
+        struct entity_index_layout
+        {
+            std::vector<XMFLOAT3>   positions;
+            std::vector<XMFLOAT4X4> to_worlds;
+            std::vector<UINT>       id_mapping;
+            std::vector<UINT>       render_item_ids;
+
+            // Copies the data out of the chunks. The render items are in the order the geometries were created.
+            void copy_from_chunks(UINT entity_count)
+            {
+                positions.assign(entity_count, XMFLOAT3{});
+                to_worlds.assign(entity_count, XMFLOAT4X4{});
+                id_mapping.assign(entity_count, Invalid_Index);
+                game_entity::for_each_chunk(game_entity::component_type::transform, [this](const game_entity::chunk_view& chunk) {
+                    for (UINT i{ 0 }; i < chunk.count; ++i)
+                    {
+                        const UINT index{ chunk.transform_ids[i] };
+                        positions[index] = chunk.positions[i];
+                        to_worlds[index] = chunk.to_worlds[i];
+                        if (chunk.geometry_ids) id_mapping[index] = chunk.render_item_ids[i];
+                    }
+                    });
+
+                render_item_ids.clear();
+                for (UINT& id : id_mapping)
+                {
+                    if (id == Invalid_Index) continue;
+                    render_item_ids.emplace_back(id);
+                    id = (UINT)render_item_ids.size() - 1;
+                }
+            }
+        };
+
+        // What a draw loop reads of each entity with a geometry: its render item and world matrix.
+        [[nodiscard]] double sum_render_items(const entity_index_layout* layout)
+        {
+            double total{ 0 };
+            game_entity::for_each_chunk(game_entity::component_type::geometry, [layout, &total](const game_entity::chunk_view& chunk) {
+                for (UINT i{ 0 }; i < chunk.count; ++i)
+                {
+                    const UINT index{ chunk.transform_ids[i] };
+                    const UINT item_id{ layout ? layout->render_item_ids[layout->id_mapping[chunk.geometry_ids[i]]] : chunk.render_item_ids[i] };
+                    const XMFLOAT4X4& world{ layout ? layout->to_worlds[index] : chunk.to_worlds[i] };
+                    total += (double)item_id + world.m[3][0] + world.m[3][1] + world.m[3][2];
+                }
+                });
+            return total;
+        }
+
+        // What a system that moves every entity does: reads and writes the position.
+        void move_positions(entity_index_layout* layout)
+        {
+            game_entity::for_each_chunk(game_entity::component_type::transform, [layout](const game_entity::chunk_view& chunk) {
+                for (UINT i{ 0 }; i < chunk.count; ++i)
+                {
+                    XMFLOAT3& position{ layout ? layout->positions[chunk.transform_ids[i]] : chunk.positions[i] };
+                    position.y += 0.5f * position.x;
+                }
+                });
+        }
+
+    } // anonymous namespace
+
+    // game_entity::create_batch() and remove_batch() against create() and remove() for each entity, with
+    // Entity.cpp, Transform.cpp, Geometry.cpp and Content.cpp from the engine.
+    // ns/op is the time per entity. Runs after the first reuse the ids freed by the run before.
+    void run_entity_batch_benchmarks(runner& r)
+    {
+        const UINT count{ (UINT)r.size(100'000, 10'000) };
+        const entity_infos infos{ count };
+        const std::string count_name{ std::to_string(count) };
+
+        r.run("entity/create/one_at_a_time/" + count_name, count, [count] { return live_entities{ count }; },
+            [&infos, count](live_entities& live) {
+                for (UINT i{ 0 }; i < count; ++i) live.entities[i] = game_entity::create(infos.infos[i]);
+            });
+
+        r.run("entity/create/batch/" + count_name, count, [count] { return live_entities{ count }; },
+            [&infos](live_entities& live) {
+                game_entity::create_batch(infos.infos, live.entities.data());
+            });
+
+        const auto created = [&infos, count] {
+            live_entities live{ count };
+            game_entity::create_batch(infos.infos, live.entities.data());
+            live.collect_ids();
+            return live;
+        };
+
+        r.run("entity/remove/one_at_a_time/" + count_name, count, created,
+            [&r](live_entities& live) {
+                for (const UINT id : live.ids) game_entity::remove(id);
+                r.check(all_alive(live, false), "remove() removes every entity");
+                live.entities.clear();
+            });
+
+        r.run("entity/remove/batch/" + count_name, count, created,
+            [&r](live_entities& live) {
+                game_entity::remove_batch(live.ids);
+                r.check(all_alive(live, false), "remove_batch() removes every entity");
+                live.entities.clear();
+            });
+
+        // Both ways make the same entities.
+        if (r.is_selected("entity/"))
+        {
+            live_entities one{ count };
+            for (UINT i{ 0 }; i < count; ++i) one.entities[i] = game_entity::create(infos.infos[i]);
+            live_entities batch{ count };
+            game_entity::create_batch(infos.infos, batch.entities.data());
+            r.check(all_alive(one, true) && all_alive(batch, true), "every created entity is alive");
+
+            bool same{ true };
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                same &= one.entities[i].position().x == batch.entities[i].position().x;
+                same &= one.entities[i].geometry().is_valid() == batch.entities[i].geometry().is_valid();
+            }
+            r.check(same, "create() and create_batch() make the same entities");
+        }
+    }
+
+    // Iterating the entities chunk by chunk with the components' data in the chunk columns (chunks), against
+    // the same data in arrays indexed by entity index, reached through the chunks' id columns (entity_arrays).
+    // Half of the entities were removed in random order first, so entity indices are no longer in chunk order.
+    // ns/op is the time per entity that's visited.
+    void run_entity_iteration_benchmarks(runner& r)
+    {
+        const UINT count{ (UINT)r.size(100'000, 10'000) };
+        const std::string prefix{ "entity/iterate/" + std::to_string(count) + "/" };
+        bool selected{ false };
+        for (const char* const name : { "render_items/entity_arrays", "render_items/chunks", "positions/entity_arrays", "positions/chunks" })
+        {
+            selected |= r.is_selected(prefix + name);
+        }
+        if (!selected) return;
+
+        // Create twice as many and remove every other one at random.
+        const entity_infos infos{ 2 * count };
+        live_entities all{ 2 * count };
+        game_entity::create_batch(infos.infos, all.entities.data());
+        const std::span<const UINT> created{ all.collect_ids() };
+        std::vector<UINT> ids{ created.begin(), created.end() };
+        random rng{};
+        for (UINT i{ (UINT)ids.size() - 1 }; i > 0; --i) std::swap(ids[i], ids[rng.next(i + 1)]);
+        game_entity::remove_batch({ ids.data(), count });
+        ids.erase(ids.begin(), ids.begin() + count);
+        all.entities.clear();
+        live_entities live{ count };
+        for (UINT i{ 0 }; i < count; ++i) live.entities[i] = game_entity::entity{ ids[i] };
+        transform::calculate_missing_matrices(ids.data(), count);
+
+        // The data moves with the entity when it changes chunk.
+        bool moved{ true };
+        for (UINT i{ 0 }; i < std::min(count, 64u); ++i)
+        {
+            game_entity::entity e{ live.entities[i] };
+            const XMFLOAT3 position{ e.position() };
+            const bool had_geometry{ e.geometry().is_valid() };
+            if (had_geometry) game_entity::remove_geometry(e.get_id());
+            else game_entity::add_geometry(e.get_id(), infos.geometry);
+            moved &= e.position().x == position.x && e.geometry().is_valid() != had_geometry;
+            if (had_geometry) game_entity::add_geometry(e.get_id(), infos.geometry);
+            else game_entity::remove_geometry(e.get_id());
+            moved &= e.position().x == position.x && e.position().y == position.y && e.geometry().is_valid() == had_geometry;
+        }
+        r.check(moved, "an entity's transform moves with it to another chunk");
+
+        UINT geometry_count{ 0 };
+        game_entity::for_each_chunk(game_entity::component_type::geometry, [&](const game_entity::chunk_view& chunk) { geometry_count += chunk.count; });
+
+        entity_index_layout layout{};
+        layout.copy_from_chunks((UINT)infos.infos.size());
+        r.check(sum_render_items(&layout) == sum_render_items(nullptr), "both layouts have the same render items and matrices");
+
+        r.run(prefix + "render_items/entity_arrays", geometry_count, [&layout] { do_not_optimize(sum_render_items(&layout)); });
+        r.run(prefix + "render_items/chunks", geometry_count, [] { do_not_optimize(sum_render_items(nullptr)); });
+        r.run(prefix + "positions/entity_arrays", count, [&layout] { move_positions(&layout); });
+        r.run(prefix + "positions/chunks", count, [] { move_positions(nullptr); });
+    }
+
+    // Spawns 1M entities, 10k per frame, into the entity-indexed arrays. The worst frame is the one where
+    // utl::vector reallocates and copies everything spawned so far. vm_vector only commits more pages.
+    void run_entity_spawn_benchmarks(runner& r)
+    {
+        const UINT total{ (UINT)r.size(1'000'000, 100'000) };
+        const UINT per_frame{ 10'000 };
+        spawn<heap_array>(r, "utl::vector", total, per_frame);
+        spawn<vm_array>(r, "utl::vm_vector", total, per_frame);
+    }
+}
@@ -0,0 +1,76 @@
+#include "Bench.h"
+#include <fstream>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace bench {
+    namespace {
+
+        // ru_maxrss is in kilobytes on Linux.
+        [[nodiscard]] UINT64 child_peak_rss(const std::function<void()>& func)
+        {
+            fflush(stdout);
+            fflush(stderr);
+            const pid_t child{ fork() };
+            if (child < 0) return 0;
+            if (!child)
+            {
+                func();
+                _exit(0);
+            }
+
+            int status{ 0 };
+            struct rusage usage {};
+            if (wait4(child, &status, 0, &usage) != child || !WIFEXITED(status) || WEXITSTATUS(status)) return 0;
+            return (UINT64)usage.ru_maxrss * 1024;
+        }
+
+    } // anonymous namespace
+
+    temp_directory::temp_directory()
+        : _path{ std::filesystem::temp_directory_path() / ("raindrop_bench_" + std::to_string(getpid())) }
+    {
+        std::filesystem::create_directories(_path);
+    }
+
+    temp_directory::~temp_directory()
+    {
+        std::error_code error{};
+        std::filesystem::remove_all(_path, error);
+    }
+
+    std::filesystem::path temp_directory::write(std::string_view name, std::span<const UINT8> data) const
+    {
+        const std::filesystem::path path{ _path / name };
+        {
+            std::ofstream file{ path, std::ios::out | std::ios::binary | std::ios::trunc };
+            file.write((const char*)data.data(), (std::streamsize)data.size());
+            assert(file);
+        }
+
+        const int file{ open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+        if (file >= 0)
+        {
+            fsync(file);
+            close(file);
+        }
+        return path;
+    }
+
+    void drop_from_cache(const std::filesystem::path& path)
+    {
+        const int file{ open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+        if (file < 0) return;
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+    }
+
+    UINT64 measure_peak_rss(const std::function<void()>& func)
+    {
+        const UINT64 baseline{ child_peak_rss([] {}) };
+        const UINT64 peak{ child_peak_rss(func) };
+        return peak > baseline ? peak - baseline : 0;
+    }
+}
@@ -0,0 +1,387 @@
+#include "Bench.h"
+#include "NullDevice.h"
+#include "GraphicCache.h"
+#include "DrawList.h"
+#include "Content.h"
+#include "Entity.h"
+#include "Transform.h"
+#include "Geometry.h"
+#include "Scripts.h"
+#include "Lights.h"
+#include "Jobs.h"
+#include "Arena.h"
+#include "Math.h"
+#include <algorithm>
+
+// Headless frames: the CPU side of core::render for the render items, with no GPU and no window.
+// Scripts, lights, content and transforms are the engine's own code (Scripts.cpp, Lights.cpp, Content.cpp,
+// GraphicCache.cpp and Transform.cpp) running on a gpu::null_device, and the draw loops (DrawList.cpp) are
+// recorded into a trace instead of a D3D12 command list.
+// NOTE: light culling and the post process dispatch a fixed amount of GPU work per frame, so they aren't here.
+namespace bench {
+    namespace {
+
+        // Moves its entity up a little every frame, so the transforms of the scripted entities change.
+        class bench_mover : public script::entity_script
+        {
+        public:
+            explicit bench_mover(game_entity::entity entity) : script::entity_script{ entity } {}
+
+            void update(float dt) override
+            {
+                XMFLOAT3 p{ position() };
+                p.y += dt;
+                set_position(p);
+            }
+        };
+
+        REGISTER_SCRIPT(bench_mover);
+
+        // Keeps what a D3D12 command list would be sent, one entry per call.
+        class recording_command_list final : public command::command_list
+        {
+        public:
+            enum class command_type : UINT8 {
+                set_root_signature,
+                set_pipeline_state,
+                set_root_constant_buffer_view,
+                set_root_shader_resource_view,
+                set_index_buffer,
+                set_primitive_topology,
+                draw_indexed,
+            };
+
+            struct command
+            {
+                command_type    type;
+                UINT            parameter;
+                UINT64          value;
+            };
+
+            void set_root_signature(ID3D12RootSignature* const root_signature) override { add(command_type::set_root_signature, 0, (UINT64)root_signature); }
+            void set_pipeline_state(ID3D12PipelineState* const pipeline_state) override { add(command_type::set_pipeline_state, 0, (UINT64)pipeline_state); }
+            void set_root_constant_buffer_view(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address) override { add(command_type::set_root_constant_buffer_view, parameter, address); }
+            void set_root_shader_resource_view(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address) override { add(command_type::set_root_shader_resource_view, parameter, address); }
+            void set_index_buffer(const D3D12_INDEX_BUFFER_VIEW& view) override { add(command_type::set_index_buffer, view.SizeInBytes, view.BufferLocation); }
+            void set_primitive_topology(D3D_PRIMITIVE_TOPOLOGY topology) override { add(command_type::set_primitive_topology, topology, 0); }
+            void draw_indexed(UINT index_count) override { add(command_type::draw_indexed, index_count, 0); }
+
+            void clear() { _trace.clear(); }
+            [[nodiscard]] const std::vector<command>& trace() const { return _trace; }
+
+            [[nodiscard]] UINT count(command_type type) const
+            {
+                return (UINT)std::count_if(_trace.begin(), _trace.end(), [type](const command& c) { return c.type == type; });
+            }
+
+        private:
+            void add(command_type type, UINT parameter, UINT64 value) { _trace.emplace_back(command{ type, parameter, value }); }
+
+            std::vector<command> _trace;
+        };
+
+        using command_type = recording_command_list::command_type;
+
+        constexpr UINT mesh_count{ 15 };
+        constexpr UINT texture_count{ 4 };
+        constexpr UINT material_count{ 16 };
+        constexpr UINT cullable_light_count{ 256 };
+        constexpr UINT64 light_set_key{ 0 };
+
+        // The meshes, textures and materials the render items use, in content. Mesh k has 1 + k % 3 sub meshes,
+        // and the odd materials use the textures.
+        class scene_content
+        {
+        public:
+            scene_content()
+            {
+                for (UINT i{ 0 }; i < texture_count; ++i)
+                {
+                    const std::vector<UINT8> blob{ make_texture_blob(4, 4) };
+                    texture_ids[i] = content::create_resource(std::span<const UINT8>{ blob }, content::asset_type::texture);
+                }
+
+                for (UINT i{ 0 }; i < mesh_count; ++i)
+                {
+                    const std::vector<UINT8> blob{ make_mesh_blob(sub_mesh_count(i), 96 * (i + 1)) };
+                    mesh_ids[i] = content::create_resource(std::span<const UINT8>{ blob }, content::asset_type::mesh);
+                }
+
+                for (UINT i{ 0 }; i < material_count; ++i)
+                {
+                    content::material_init_info info{};
+                    info.type = content::material_type::opaque;
+                    info.surface.metallic = (float)(i & 1);
+                    if (i & 1)
+                    {
+                        info.shader_ids[shaders::shader_type::vertex] = shaders::engine_shader::normal_texture_shader_vs;
+                        info.shader_ids[shaders::shader_type::pixel] = shaders::engine_shader::texture_shader_ps;
+                        info.texture_count = 3;
+                        info.texture_ids = &texture_ids[(i / 2) % 2];
+                    }
+                    else
+                    {
+                        info.shader_ids[shaders::shader_type::vertex] = shaders::engine_shader::normal_shader_vs;
+                        info.shader_ids[shaders::shader_type::pixel] = shaders::engine_shader::pixel_shader_ps;
+                    }
+                    material_ids[i] = content::create_resource(&info, content::asset_type::material);
+                }
+            }
+
+            ~scene_content()
+            {
+                for (const UINT id : material_ids) content::destroy_resource(id, content::asset_type::material);
+                for (const UINT id : mesh_ids) content::destroy_resource(id, content::asset_type::mesh);
+                for (const UINT id : texture_ids) content::destroy_resource(id, content::asset_type::texture);
+            }
+
+            scene_content(const scene_content&) = delete;
+            scene_content& operator=(const scene_content&) = delete;
+
+            [[nodiscard]] static constexpr UINT sub_mesh_count(UINT mesh) { return 1 + mesh % 3; }
+
+            UINT texture_ids[texture_count]{};
+            UINT mesh_ids[mesh_count]{};
+            UINT material_ids[material_count]{};
+        };
+
+        // Entities with a geometry and 'item_count' render items in all, every 16th of them with a bench_mover,
+        // and the lights of light set 0: one directional light and 'cullable_light_count' point and spot lights.
+        struct scene
+        {
+            std::vector<game_entity::entity>    entities;
+            std::vector<lights::Light>          lights;
+            game_entity::entity                 scripted{};
+            float                               scripted_start_y{ 0.f };
+
+            scene(const scene_content& c, UINT item_count)
+            {
+                random rng{ 7 };
+                std::vector<transform::init_info> transforms;
+                std::vector<geometry::init_info> geometries;
+                std::vector<UINT> item_materials(item_count);
+                script::init_info mover{ script::detail::get_script_creator(utl::hashed_name{ "bench_mover" }) };
+
+                UINT items{ 0 };
+                while (items < item_count)
+                {
+                    const UINT i{ (UINT)transforms.size() };
+                    UINT mesh{ i % mesh_count };
+                    // The last entity takes the mesh that has as many sub meshes as there are items left.
+                    if (scene_content::sub_mesh_count(mesh) > item_count - items) mesh = item_count - items - 1;
+                    const UINT sub_meshes{ scene_content::sub_mesh_count(mesh) };
+                    for (UINT j{ 0 }; j < sub_meshes; ++j) item_materials[items + j] = c.material_ids[rng.next(material_count)];
+
+                    transform::init_info& t{ transforms.emplace_back() };
+                    t.position[0] = (float)(i % 100);
+                    t.position[1] = (float)(i / 100 % 100);
+                    t.position[2] = (float)(i / 10000);
+                    t.rotation[3] = 1.f;
+                    geometries.emplace_back(geometry::init_info{ c.mesh_ids[mesh], sub_meshes, &item_materials[items] });
+                    items += sub_meshes;
+                }
+
+                std::vector<game_entity::entity_info> infos(transforms.size());
+                for (UINT i{ 0 }; i < infos.size(); ++i)
+                {
+                    infos[i].transform = &transforms[i];
+                    infos[i].geometry = &geometries[i];
+                    infos[i].script = (i % 16) ? nullptr : &mover;
+                }
+                entities.resize(infos.size());
+                game_entity::create_batch(infos, entities.data());
+                scripted = entities.front();
+                scripted_start_y = scripted.position().y;
+
+                lights::create_light_set(light_set_key);
+                for (UINT i{ 0 }; i <= cullable_light_count; ++i)
+                {
+                    lights::light_init_info info{};
+                    info.set_key = light_set_key;
+                    info.entity_id = entities[(i * 7) % entities.size()].get_id();
+                    info.color = { 1.f, .5f, .25f };
+                    if (!i)
+                    {
+                        info.type = lights::light_type::directional;
+                    }
+                    else if (i & 1)
+                    {
+                        info.type = lights::light_type::point;
+                        info.point_params.range = 1.f;
+                        info.point_params.attenuation = { 1.f, 1.f, 1.f };
+                    }
+                    else
+                    {
+                        info.type = lights::light_type::spot;
+                        info.spot_params.range = 2.f;
+                        info.spot_params.umbra = .1f * math::pi;
+                        info.spot_params.penumbra = info.spot_params.umbra + .1f * math::pi;
+                        info.spot_params.attenuation = { 1.f, 1.f, 1.f };
+                    }
+                    lights.emplace_back(lights::create_light(info));
+                }
+            }
+
+            ~scene()
+            {
+                for (const lights::Light light : lights) lights::remove_light(light);
+                lights::remove_light_set(light_set_key);
+
+                std::vector<UINT> ids(entities.size());
+                for (UINT i{ 0 }; i < entities.size(); ++i) ids[i] = entities[i].get_id();
+                game_entity::remove_batch(ids);
+            }
+
+            scene(const scene&) = delete;
+            scene& operator=(const scene&) = delete;
+        };
+
+        // Pipeline state changes the draw loops should record: one at the first item, then one per change.
+        [[nodiscard]] UINT count_changes(ID3D12PipelineState* const* const states, UINT count)
+        {
+            UINT changes{ 0 };
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                if (!i || states[i] != states[i - 1]) ++changes;
+            }
+            return changes;
+        }
+
+        struct frame_stage
+        {
+            const char*         name;
+            std::vector<double> ns;
+        };
+
+        void run_frames(runner& r, UINT item_count)
+        {
+            const std::string prefix{ "frame/" + std::to_string(item_count) + "_items/" };
+            frame_stage stages[]{ { "scripts", {} }, { "lights", {} }, { "content", {} }, { "transforms", {} },
+                { "depth_prepass", {} }, { "graphic_pass", {} }, { "total", {} } };
+            bool selected{ false };
+            for (const frame_stage& stage : stages) selected |= r.is_selected(prefix + stage.name);
+            if (!selected) return;
+
+            // What core::initialize() sets up, minus the D3D12 side. The frame's constant buffer holds the
+            // per object data of every entity and the srv indices of every item.
+            utl::linear_arena arena{};
+            arena.initialize(item_count * 512 + (1 << 20));
+            utl::set_frame_arena(&arena);
+            gpu::null_device device{ item_count * 272 + (1 << 16) };
+            gpu::set_current(&device);
+            content::initialize();
+
+            // The light grid and index list come from the light culling compute shaders, so they're only buffers.
+            gpu::buffer light_grid{ device.create_upload_buffer(1024) };
+            gpu::buffer light_index_list{ device.create_upload_buffer(1024) };
+            XMFLOAT4X4 view_projection{};
+            for (UINT i{ 0 }; i < 4; ++i) view_projection.m[i][i] = 1.f;
+
+            const UINT frame_count{ (UINT)r.size(200, 10) };
+            {
+                const scene_content c{};
+                scene s{ c, item_count };
+                graphic_pass::graphic_cache cache{};
+                utl::vector<UINT> render_item_ids;
+                utl::vector<float> thresholds;
+                recording_command_list cmd_list{};
+                allocation_stats allocated{};
+                UINT frame_index{ 0 };
+
+                for (UINT frame{ 0 }; frame < frame_count; ++frame)
+                {
+                    const allocation_stats before{ allocations() };
+                    // core::render() resets the frame arena and the constant buffer at the start of the frame,
+                    // and the command list is reset by Command::begin_frame().
+                    frame_index = frame % Frame_Count;
+                    arena.reset();
+                    device.begin_frame();
+                    cmd_list.clear();
+
+                    const auto start{ std::chrono::steady_clock::now() };
+                    script::update(1.f / 60.f);
+                    const auto scripts_updated{ std::chrono::steady_clock::now() };
+                    lights::update_light_buffers(light_set_key, frame_index);
+                    const auto lights_updated{ std::chrono::steady_clock::now() };
+                    geometry::get_render_item_ids(render_item_ids);
+                    thresholds.resize(render_item_ids.size(), 0.f);
+                    graphic_pass::gather_render_items(render_item_ids.data(), thresholds.data(), (UINT)render_item_ids.size(), cache);
+                    const auto gathered{ std::chrono::steady_clock::now() };
+                    graphic_pass::fill_per_object_data(cache, view_projection);
+                    graphic_pass::fill_srv_indices(cache);
+                    const auto prepared{ std::chrono::steady_clock::now() };
+                    const D3D12_GPU_VIRTUAL_ADDRESS global_shader_data{ device.constants_gpu_address(device.allocate_constants(256)) };
+                    graphic_pass::record_depth_prepass(cmd_list, graphic_pass::get_draw_list(cache, cache.depth_pipeline_states), global_shader_data);
+                    const auto depth_recorded{ std::chrono::steady_clock::now() };
+                    const graphic_pass::light_views light_views{ lights::non_cullable_light_buffer(frame_index),
+                        lights::cullable_light_buffer(frame_index), light_grid.gpu_address, light_index_list.gpu_address };
+                    graphic_pass::record_graphic_pass(cmd_list, graphic_pass::get_draw_list(cache, cache.graphic_pipeline_states), global_shader_data, light_views);
+                    const auto stop{ std::chrono::steady_clock::now() };
+                    do_not_optimize(cmd_list.trace().data());
+                    const allocation_stats after{ allocations() };
+                    allocated = { after.bytes - before.bytes, after.count - before.count };
+
+                    using ns = std::chrono::duration<double, std::nano>;
+                    stages[0].ns.emplace_back(ns(scripts_updated - start).count());
+                    stages[1].ns.emplace_back(ns(lights_updated - scripts_updated).count());
+                    stages[2].ns.emplace_back(ns(gathered - lights_updated).count());
+                    stages[3].ns.emplace_back(ns(prepared - gathered).count());
+                    stages[4].ns.emplace_back(ns(depth_recorded - prepared).count());
+                    stages[5].ns.emplace_back(ns(stop - depth_recorded).count());
+                    stages[6].ns.emplace_back(ns(stop - start).count());
+                }
+
+                r.check(cache.size() == item_count, "every sub mesh of every entity is a render item");
+                r.check(cmd_list.count(command_type::draw_indexed) == 2 * item_count, "every render item is drawn once in each pass");
+                r.check(cmd_list.count(command_type::set_pipeline_state) == count_changes(cache.depth_pipeline_states, cache.size()) +
+                    count_changes(cache.graphic_pipeline_states, cache.size()), "pipeline states are only set when they change");
+                const recording_command_list::command& first_draw{ *std::find_if(cmd_list.trace().begin(), cmd_list.trace().end(),
+                    [](const recording_command_list::command& c) { return c.type == command_type::draw_indexed; }) };
+                const D3D12_INDEX_BUFFER_VIEW& first_view{ cache.index_buffer_views[0] };
+                r.check(first_draw.parameter == first_view.SizeInBytes / (first_view.Format == DXGI_FORMAT_R16_UINT ? 2 : 4), "index count of the first draw");
+                r.check(s.scripted.position().y > s.scripted_start_y, "the scripts move their entities");
+                r.check(lights::cullable_light_count(light_set_key) == cullable_light_count && lights::non_cullable_light_count(light_set_key) == 1,
+                    "the light set has every light");
+                r.check(lights::cullable_light_buffer(frame_index) && lights::non_cullable_light_buffer(frame_index), "the lights are in the frame's buffers");
+
+                // NOTE: one frame each, so ns/op is the time per frame. The allocations are of the last frame, after
+                //       the vectors and the trace have grown to their size.
+                for (frame_stage& stage : stages)
+                {
+                    std::sort(stage.ns.begin(), stage.ns.end());
+                    result res{};
+                    res.name = prefix + stage.name;
+                    res.ops = 1;
+                    res.ns_per_op = stage.ns[stage.ns.size() / 2];
+                    res.min_ns_per_op = stage.ns.front();
+                    res.bytes_allocated = allocated.bytes;
+                    res.allocations = allocated.count;
+                    if (r.is_selected(res.name)) r.add(std::move(res));
+                }
+            }
+
+            device.release_buffer(light_index_list);
+            device.release_buffer(light_grid);
+            content::shutdown();
+            lights::shutdown();
+            gpu::set_current(nullptr);
+            utl::set_frame_arena(nullptr);
+        }
+
+    } // anonymous namespace
+}
+
+// CPU cost per frame of core::render's stages for the render items, on a gpu::null_device instead of D3D12.
+// See CMakeLists.txt for how to build and run it.
+int main(int argc, char** argv)
+{
+    bench::runner r{ argc, argv, "frame_bench" };
+    jobs::initialize();
+    for (const UINT item_count : { 1'000u, 10'000u, 100'000u })
+    {
+        if (r.quick() && item_count > 10'000) break;
+        bench::run_frames(r, item_count);
+    }
+    jobs::shutdown();
+    return r.finish();
+}
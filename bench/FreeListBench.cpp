@@ -0,0 +1,251 @@
+#include "Bench.h"
+#include "FreeList.h"
+
+namespace bench {
+    namespace {
+
+        struct item
+        {
+            UINT a, b, c, d;
+        };
+
+        [[nodiscard]] constexpr item make_item(UINT i)
+        {
+            return { i, i * 3, i ^ 0x55, 1 };
+        }
+
+        // The usual way to do it with the standard library: the items in a std::vector and a stack of free ids.
+        class std_free_list
+        {
+        public:
+            UINT add(const item& x)
+            {
+                if (_free_ids.empty())
+                {
+                    _items.push_back(x);
+                    return (UINT)_items.size() - 1;
+                }
+                const UINT id{ _free_ids.back() };
+                _free_ids.pop_back();
+                _items[id] = x;
+                return id;
+            }
+
+            void remove(UINT id) { _free_ids.push_back(id); }
+            [[nodiscard]] item& operator[](UINT id) { return _items[id]; }
+
+        private:
+            std::vector<item>   _items;
+            std::vector<UINT>   _free_ids;
+        };
+
+        // Same scheme as utl::free_list (the next free index is kept in the free slot), in an array that is
+        // sized up front and never grows.
+        class array_free_list
+        {
+        public:
+            explicit array_free_list(UINT capacity) : _items{ (item*)malloc(capacity * sizeof(item)) }, _capacity{ capacity } {}
+            array_free_list(array_free_list&& o) : _items{ o._items }, _capacity{ o._capacity }, _size{ o._size }, _next_free{ o._next_free }
+            {
+                o._items = nullptr;
+            }
+            DISABLE_COPY(array_free_list);
+            ~array_free_list() { free(_items); }
+
+            UINT add(const item& x)
+            {
+                UINT id{ _next_free };
+                if (id == Invalid_Index)
+                {
+                    assert(_size < _capacity);
+                    id = _size++;
+                }
+                else
+                {
+                    memcpy(&_next_free, &_items[id], sizeof(UINT));
+                }
+                _items[id] = x;
+                return id;
+            }
+
+            void remove(UINT id)
+            {
+                memcpy(&_items[id], &_next_free, sizeof(UINT));
+                _next_free = id;
+            }
+
+            [[nodiscard]] item& operator[](UINT id) { return _items[id]; }
+
+        private:
+            item*   _items;
+            UINT    _capacity;
+            UINT    _size{ 0 };
+            UINT    _next_free{ Invalid_Index };
+        };
+
+        // A list and the ids of its live items.
+        template<typename list>
+        struct filled_list
+        {
+            template<typename... params>
+            explicit filled_list(params&&... p) : l{ std::forward<params>(p)... } {}
+            DISABLE_COPY_AND_MOVE(filled_list);
+
+            list                l;
+            std::vector<UINT>   ids;
+
+            // NOTE: utl::free_list asserts that it's empty when destroyed.
+            ~filled_list()
+            {
+                for (const UINT id : ids) l.remove(id);
+            }
+        };
+
+        template<typename list>
+        [[nodiscard]] list make_list(UINT capacity)
+        {
+            if constexpr (std::is_same_v<list, array_free_list>) return list{ capacity };
+            else return list{};
+        }
+
+        template<typename list>
+        [[nodiscard]] std::unique_ptr<filled_list<list>> fill(UINT count)
+        {
+            std::unique_ptr<filled_list<list>> f;
+            if constexpr (std::is_same_v<list, array_free_list>) f = std::make_unique<filled_list<list>>(count);
+            else f = std::make_unique<filled_list<list>>();
+            f->ids.reserve(count);
+            for (UINT i{ 0 }; i < count; ++i) f->ids.push_back(f->l.add(make_item(i)));
+            return f;
+        }
+
+        // Fills the list, then removes half of the items at random and adds them back. The new items
+        // land in the holes, in no particular order.
+        template<typename list>
+        [[nodiscard]] std::unique_ptr<filled_list<list>> fragment(UINT count)
+        {
+            auto f{ fill<list>(count) };
+            random rng{ 7 };
+            for (UINT i{ 0 }; i < count / 2; ++i)
+            {
+                const UINT index{ rng.next((UINT)f->ids.size()) };
+                f->l.remove(f->ids[index]);
+                f->ids[index] = f->ids.back();
+                f->ids.pop_back();
+            }
+            for (UINT i{ 0 }; i < count / 2; ++i) f->ids.push_back(f->l.add(make_item(i)));
+            return f;
+        }
+
+        template<typename list>
+        void add(runner& r, const char* name, UINT count)
+        {
+            r.run(std::string{ "free_list/add/" } + name, count, [&] { return make_list<list>(count); },
+                [&](list& l) {
+                    std::vector<UINT> ids(count);
+                    for (UINT i{ 0 }; i < count; ++i) ids[i] = l.add(make_item(i));
+                    do_not_optimize(ids.data());
+                    for (const UINT id : ids) l.remove(id);
+                });
+        }
+
+        // Removes a random item and adds a new one, 'count' times.
+        template<typename list>
+        void churn(runner& r, const char* name, UINT count)
+        {
+            r.run(std::string{ "free_list/churn/" } + name, count, [&] { return fill<list>(count); },
+                [&](std::unique_ptr<filled_list<list>>& f) {
+                    random rng{ 11 };
+                    for (UINT i{ 0 }; i < count; ++i)
+                    {
+                        UINT& id{ f->ids[rng.next(count)] };
+                        f->l.remove(id);
+                        id = f->l.add(make_item(i));
+                    }
+                });
+        }
+
+        // Reads 'count' live items at random.
+        template<typename list>
+        UINT64 random_access(runner& r, const char* name, UINT count)
+        {
+            auto f{ fill<list>(count) };
+            std::vector<UINT> ids(count);
+            random rng{ 13 };
+            for (UINT& id : ids) id = f->ids[rng.next(count)];
+
+            UINT64 sum{ 0 };
+            r.run(std::string{ "free_list/random_access/" } + name, count, [&] {
+                UINT64 s{ 0 };
+                for (const UINT id : ids) s += f->l[id].a;
+                sum = s;
+                do_not_optimize(sum);
+                });
+            return sum;
+        }
+
+        // Adds items to a list that has many holes.
+        template<typename list>
+        void fragmented_add(runner& r, const char* name, UINT count)
+        {
+            r.run(std::string{ "free_list/fragmented_add/" } + name, count / 2,
+                [&] {
+                    auto f{ fragment<list>(count) };
+                    // NOTE: take the items that were added back out again, so the timed part adds them.
+                    for (UINT i{ 0 }; i < count / 2; ++i)
+                    {
+                        f->l.remove(f->ids.back());
+                        f->ids.pop_back();
+                    }
+                    return f;
+                },
+                [&](std::unique_ptr<filled_list<list>>& f) {
+                    for (UINT i{ 0 }; i < count / 2; ++i) f->ids.push_back(f->l.add(make_item(i)));
+                });
+        }
+
+        // Reads all live items of a fragmented list, in the order they were added.
+        template<typename list>
+        UINT64 fragmented_access(runner& r, const char* name, UINT count)
+        {
+            auto f{ fragment<list>(count) };
+            UINT64 sum{ 0 };
+            r.run(std::string{ "free_list/fragmented_access/" } + name, count, [&] {
+                UINT64 s{ 0 };
+                for (const UINT id : f->ids) s += f->l[id].a;
+                sum = s;
+                do_not_optimize(sum);
+                });
+            return sum;
+        }
+
+        template<typename list>
+        void run_all(runner& r, const char* name, UINT count, UINT64& random_sum, UINT64& fragmented_sum)
+        {
+            add<list>(r, name, count);
+            churn<list>(r, name, count);
+            random_sum = random_access<list>(r, name, count);
+            fragmented_add<list>(r, name, count);
+            fragmented_sum = fragmented_access<list>(r, name, count);
+        }
+
+    } // anonymous namespace
+
+    void run_free_list_benchmarks(runner& r)
+    {
+        const UINT count{ (UINT)r.size(100'000, 10'000) };
+
+        // NOTE: all lists reuse the last freed slot first, so they hand out the same indices and read the same items.
+        UINT64 random_sums[4]{}, fragmented_sums[4]{};
+        run_all<utl::free_list<item>>(r, "utl::free_list", count, random_sums[0], fragmented_sums[0]);
+        run_all<utl::free_list<item, true>>(r, "utl::free_list<generational>", count, random_sums[1], fragmented_sums[1]);
+        run_all<std_free_list>(r, "std::vector", count, random_sums[2], fragmented_sums[2]);
+        run_all<array_free_list>(r, "array", count, random_sums[3], fragmented_sums[3]);
+
+        for (UINT i{ 1 }; i < 4; ++i)
+        {
+            r.check(random_sums[i] == random_sums[0] || !random_sums[i] || !random_sums[0], "free_list/random_access sums differ");
+            r.check(fragmented_sums[i] == fragmented_sums[0] || !fragmented_sums[i] || !fragmented_sums[0], "free_list/fragmented_access sums differ");
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#include "Bench.h"
+#include "CpuFeatures.h"
+#include "HashedName.h"
+#include "Math.h"
+
+namespace bench {
+    namespace {
+
+        // Hashes 'size' bytes at a time, starting at a new offset in 'data' for each call, until 'total'
+        // bytes are hashed.
+        template<typename hash_func>
+        [[nodiscard]] UINT64 hash_all(const std::vector<UINT8>& data, UINT64 size, UINT64 total, hash_func&& hash)
+        {
+            UINT64 sum{ 0 };
+            const UINT64 offsets{ data.size() - size + 1 };
+            UINT64 offset{ 0 };
+            for (UINT64 hashed{ 0 }; hashed < total; hashed += size)
+            {
+                sum += hash(&data[offset], size);
+                offset += 61;
+                if (offset >= offsets) offset -= offsets;
+            }
+            return sum;
+        }
+
+        void run_size(runner& r, const std::vector<UINT8>& data, UINT64 size, UINT64 total)
+        {
+            // NOTE: ops are bytes, so ns/op is ns per byte. 1 / (ns/op) is GB/s.
+            const UINT64 calls{ (total + size - 1) / size };
+            std::string prefix{ "hash/" };
+            prefix.append(std::to_string(size)).append("B/");
+
+            // NOTE: hash64() uses the CRC32C instruction when the CPU has it and --force-isa doesn't rule it out.
+            const bool hardware{ core::cpu::has(core::cpu::feature::crc32c) && core::cpu::isa_level() != core::cpu::isa::scalar };
+            UINT64 sums[2]{};
+            r.run(prefix + (hardware ? "math::hash64/crc32c" : "math::hash64/table"), calls * size, [&] {
+                    sums[0] = hash_all(data, size, total, [](const UINT8* at, UINT64 n) { return math::hash64(at, n); });
+                    do_not_optimize(sums[0]);
+                });
+
+            // What hashed names use. One byte per step, so it only shows what a byte-wise hash costs.
+            r.run(prefix + "utl::fnv1a_64", calls * size, [&] {
+                sums[1] = hash_all(data, size, total, [](const UINT8* at, UINT64 n) {
+                    return utl::fnv1a_64({ (const char*)at, n });
+                    });
+                do_not_optimize(sums[1]);
+                });
+        }
+
+    } // anonymous namespace
+
+    // math::hash64() (the PSO stream and content hashes) by input size, in the variant the CPU selects.
+    // Run with --force-isa=scalar to time the table-driven variant.
+    void run_hash_benchmarks(runner& r)
+    {
+        std::vector<UINT8> data(1 << 20);
+        random rng{ 23 };
+        for (UINT8& byte : data) byte = (UINT8)rng.next();
+
+        // NOTE: every variant gives the same hash, so these values check whichever one --force-isa selects.
+        UINT8 known[100];
+        for (UINT i{ 0 }; i < 100; ++i) known[i] = (UINT8)(i * 7 + 1);
+        r.check(math::hash64(known, 17) == 0x1d22ff5e132b7459ull, "hash64 of 17 bytes changed");
+        r.check(math::hash64(known, 100) == 0xebc60938de269ec2ull, "hash64 of 100 bytes changed");
+        r.check(math::hash64(nullptr, 0) == 0x9e69316645315758ull, "hash64 of 0 bytes changed");
+
+        const UINT64 total{ r.size(64ull << 20, 4ull << 20) };
+        for (const UINT64 size : { 4ull, 8ull, 24ull, 64ull, 256ull, 1024ull, 4096ull, 65536ull })
+        {
+            run_size(r, data, size, total);
+        }
+    }
+}
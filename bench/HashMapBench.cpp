@@ -0,0 +1,95 @@
+#include "Bench.h"
+#include "FlatHashMap.h"
+#include <unordered_map>
+
+namespace bench {
+    namespace {
+
+        struct keys
+        {
+            std::vector<UINT64> present;    // in the map, in insertion order.
+            std::vector<UINT64> lookups;    // 'present' keys in random order.
+            std::vector<UINT64> missing;    // never in the map.
+        };
+
+        [[nodiscard]] keys make_keys(UINT count)
+        {
+            keys k{};
+            random rng{ 17 };
+            k.present.resize(count);
+            k.missing.resize(count);
+            // NOTE: the low bit tells the two sets apart, so no missing key is ever present.
+            for (UINT64& key : k.present) key = rng.next() | 1;
+            for (UINT64& key : k.missing) key = rng.next() & ~1ull;
+            k.lookups.resize(count);
+            for (UINT64& key : k.lookups) key = k.present[rng.next(count)];
+            return k;
+        }
+
+        template<typename map>
+        [[nodiscard]] map filled(const keys& k)
+        {
+            map m;
+            for (UINT i{ 0 }; i < k.present.size(); ++i) m[k.present[i]] = i;
+            return m;
+        }
+
+        template<typename map>
+        [[nodiscard]] UINT64 lookup(const map& m, const std::vector<UINT64>& keys)
+        {
+            UINT64 sum{ 0 };
+            for (const UINT64 key : keys)
+            {
+                const auto it{ m.find(key) };
+                if (it != m.end()) sum += it->second + 1;
+            }
+            return sum;
+        }
+
+        template<typename map>
+        void run_map(runner& r, const char* map_name, const keys& k, UINT64& hit_sum, UINT64& miss_sum)
+        {
+            const UINT64 count{ k.present.size() };
+            std::string suffix{ "/" };
+            suffix.append(std::to_string(count)).append("/").append(map_name);
+
+            r.run("hash_map/insert" + suffix, count, [&] {
+                map m;
+                for (UINT i{ 0 }; i < count; ++i) m[k.present[i]] = i;
+                do_not_optimize(m.size());
+                });
+
+            r.run("hash_map/insert_reserved" + suffix, count, [&] {
+                map m;
+                m.reserve(count);
+                for (UINT i{ 0 }; i < count; ++i) m[k.present[i]] = i;
+                do_not_optimize(m.size());
+                });
+
+            const map m{ filled<map>(k) };
+            r.run("hash_map/lookup_hit" + suffix, count, [&] { hit_sum = lookup(m, k.lookups); do_not_optimize(hit_sum); });
+            r.run("hash_map/lookup_miss" + suffix, count, [&] { miss_sum = lookup(m, k.missing); do_not_optimize(miss_sum); });
+
+            r.run("hash_map/erase" + suffix, count, [&] { return filled<map>(k); },
+                [&](map& m) {
+                    for (const UINT64 key : k.present) m.erase(key);
+                    do_not_optimize(m.size());
+                });
+        }
+
+    } // anonymous namespace
+
+    // 64-bit keys, like the pipeline state keys in content and the light set keys.
+    void run_hash_map_benchmarks(runner& r)
+    {
+        for (const UINT count : { 1'000u, (UINT)r.size(1'000'000, 50'000) })
+        {
+            const keys k{ make_keys(count) };
+            UINT64 hit_sums[2]{}, miss_sums[2]{};
+            run_map<utl::flat_hash_map<UINT64, UINT>>(r, "utl::flat_hash_map", k, hit_sums[0], miss_sums[0]);
+            run_map<std::unordered_map<UINT64, UINT>>(r, "std::unordered_map", k, hit_sums[1], miss_sums[1]);
+            r.check(hit_sums[0] == hit_sums[1], "hash_map/lookup_hit results differ");
+            r.check(!miss_sums[0] && !miss_sums[1], "hash_map/lookup_miss found a missing key");
+        }
+    }
+}
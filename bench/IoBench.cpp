@@ -0,0 +1,12 @@
+#include "Bench.h"
+
+// Benchmarks of the engine's file loading. They write their files to a temp directory first.
+// See CMakeLists.txt for how to build and run them.
+int main(int argc, char** argv)
+{
+    bench::runner r{ argc, argv, "io_bench" };
+    bench::run_mapped_file_benchmarks(r);
+    bench::run_read_files_benchmarks(r);
+    bench::run_asset_pack_benchmarks(r);
+    return r.finish();
+}
@@ -0,0 +1,144 @@
+#include "Bench.h"
+#include "Jobs.h"
+#include "MappedFile.h"
+#include "Utilities.h"
+
+// Checks of the engine's file loading that don't need a GPU. Prints what failed and returns non-zero.
+namespace {
+
+    UINT failures{ 0 };
+
+    void check(bool condition, const char* what)
+    {
+        if (condition) return;
+        fprintf(stderr, "FAILED: %s\n", what);
+        ++failures;
+    }
+
+    // A file like the engine's assets: a header of primitives, a big-endian value and an array of floats.
+    [[nodiscard]] std::vector<UINT8> make_blob()
+    {
+        std::vector<UINT8> data(4 + 8 + 4 + 16 * sizeof(float));
+        utl::blob_stream_writer blob{ data.data(), data.size() };
+        blob.write<UINT32>(16);
+        blob.write<UINT64>(0x0123'4567'89ab'cdefull);
+        blob.write<UINT32>(0x1122'3344);
+        for (UINT i{ 0 }; i < 16; ++i) blob.write<float>((float)i * 0.5f);
+        // the big-endian value
+        std::reverse(data.begin() + 12, data.begin() + 16);
+        return data;
+    }
+
+    void test_mapped_file_through_blob_stream_reader(const bench::temp_directory& directory)
+    {
+        const std::vector<UINT8> data{ make_blob() };
+        const std::filesystem::path path{ directory.write("blob.bin", data) };
+
+        const utl::mapped_file file{ path };
+        check(file.is_open(), "mapped_file opens a file");
+        check(file.size() == data.size(), "mapped_file has the file's size");
+        if (!file.is_open() || file.size() != data.size()) return;
+        check(!memcmp(file.data(), data.data(), data.size()), "mapped_file has the file's bytes");
+
+        utl::blob_stream_reader blob{ file.span() };
+        const UINT32 count{ blob.read<UINT32>() };
+        check(count == 16, "read<UINT32>");
+        check(blob.read<UINT64>() == 0x0123'4567'89ab'cdefull, "read<UINT64>");
+        check(blob.read<UINT32, std::endian::big>() == 0x1122'3344, "read<UINT32, big>");
+
+        // The mapping is page aligned and the floats are at offset 16, so they're read in place.
+        const std::span<const float> values{ blob.read_span<float>(count) };
+        check(values.size() == count && (const UINT8*)values.data() == file.data() + 16, "read_span() reads the mapping in place");
+        bool same{ values.size() == count };
+        for (UINT i{ 0 }; same && i < count; ++i) same = values[i] == (float)i * 0.5f;
+        check(same, "read_span() values");
+
+        check(!blob.overrun() && blob.offset() == data.size(), "the whole file is read");
+        check(blob.read<UINT32>() == 0 && blob.overrun(), "a read past the end of the mapping sets overrun()");
+    }
+
+    void test_mapped_file_move_and_close(const bench::temp_directory& directory)
+    {
+        const std::vector<UINT8> data(3 * 4096 + 5, 0xab);
+        const std::filesystem::path path{ directory.write("pages.bin", data) };
+
+        utl::mapped_file file{ path, utl::mapped_file::access::random };
+        const UINT8* const mapping{ file.data() };
+        check(file.is_open() && file.size() == data.size(), "mapped_file opens a file for random access");
+        file.prefetch(4096, 4096);
+
+        utl::mapped_file moved{ std::move(file) };
+        check(!file.is_open() && !file.size(), "a moved from mapped_file is closed");
+        check(moved.data() == mapping && moved.size() == data.size(), "a moved to mapped_file has the mapping");
+        check(moved.is_open() && moved.data()[data.size() - 1] == 0xab, "the last byte is mapped");
+
+        moved.close();
+        check(!moved.is_open() && !moved.data(), "close()");
+    }
+
+    void test_mapped_file_fails(const bench::temp_directory& directory)
+    {
+        utl::mapped_file file{};
+        check(!file.open(directory.path() / "missing.bin"), "a missing file isn't mapped");
+        check(!file.open(directory.write("empty.bin", {})), "an empty file isn't mapped");
+        check(!file.is_open(), "a mapped_file that failed to open is closed");
+    }
+
+    struct read_result
+    {
+        std::vector<UINT8>  data;
+        UINT                calls{ 0 };
+    };
+
+    void copy_read(std::span<const UINT8> data, void* context)
+    {
+        read_result& result{ *(read_result*)context };
+        result.data.assign(data.begin(), data.end());
+        ++result.calls;
+    }
+
+    // More files than reads in flight, one of them missing. Each callback gets its own file's bytes.
+    void test_read_files(const bench::temp_directory& directory)
+    {
+        constexpr UINT file_count{ 9 };
+        std::vector<std::vector<UINT8>> contents(file_count);
+        std::vector<std::string> paths(file_count);
+        for (UINT i{ 0 }; i < file_count; ++i)
+        {
+            contents[i].resize(1000 + i * 70'001);
+            for (UINT64 j{ 0 }; j < contents[i].size(); ++j) contents[i][j] = (UINT8)(j * 31 + i);
+            paths[i] = (i == 4) ? (directory.path() / "missing.bin").string() : directory.write("read_" + std::to_string(i) + ".bin", contents[i]).string();
+        }
+
+        std::vector<read_result> results(file_count);
+        std::vector<utl::file_read> reads(file_count);
+        for (UINT i{ 0 }; i < file_count; ++i) reads[i] = { paths[i].c_str(), &copy_read, &results[i] };
+
+        utl::file_read_stats stats{};
+        utl::read_files(reads.data(), file_count, 4, &stats);
+
+        for (UINT i{ 0 }; i < file_count; ++i)
+        {
+            check(results[i].calls == 1, "read_files() calls each 'on_read' once");
+            if (i == 4) check(results[i].data.empty(), "a file that can't be read gets an empty span");
+            else check(results[i].data == contents[i], "read_files() reads the whole file");
+        }
+        check(stats.peak_in_flight >= 1 && stats.peak_in_flight <= 4, "read_files() keeps at most 'max_in_flight' reads in flight");
+    }
+
+} // anonymous namespace
+
+int main()
+{
+    const bench::temp_directory directory{};
+    test_mapped_file_through_blob_stream_reader(directory);
+    test_mapped_file_move_and_close(directory);
+    test_mapped_file_fails(directory);
+
+    jobs::initialize();
+    test_read_files(directory);
+    jobs::shutdown();
+
+    if (!failures) printf("io_test: all checks passed\n");
+    return failures ? 1 : 0;
+}
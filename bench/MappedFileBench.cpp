@@ -0,0 +1,107 @@
+#include "Bench.h"
+#include "MappedFile.h"
+#include "Utilities.h"
+#include <algorithm>
+
+namespace bench {
+    namespace {
+
+        // Touches one word in each 256KB, like a reader that only looks at a file's headers and tables.
+        // NOTE: more than the 64KB around a fault that Linux maps from the file cache in one go.
+        constexpr UINT64 sparse_stride{ 256 * 1024 };
+
+        enum class access { sequential, sparse };
+
+        [[nodiscard]] UINT64 sum(std::span<const UINT8> data, access a)
+        {
+            const UINT64 stride{ a == access::sequential ? sizeof(UINT64) : sparse_stride };
+            UINT64 total{ 0 };
+            for (UINT64 offset{ 0 }; offset + sizeof(UINT64) <= data.size(); offset += stride)
+            {
+                UINT64 word;
+                memcpy(&word, data.data() + offset, sizeof(UINT64));
+                total += word;
+            }
+            return total;
+        }
+
+        // How the engine read assets before mapped_file: the whole file copied to the heap.
+        [[nodiscard]] UINT64 load_with_read_file(const std::filesystem::path& path, access a)
+        {
+            std::unique_ptr<UINT8[]> data{};
+            UINT64 size{ 0 };
+            if (!utl::read_file(path, data, size)) return 0;
+            return sum({ data.get(), (size_t)size }, a);
+        }
+
+        [[nodiscard]] UINT64 load_with_mapped_file(const std::filesystem::path& path, access a)
+        {
+            const utl::mapped_file file{ path, a == access::sequential ? utl::mapped_file::access::sequential : utl::mapped_file::access::random };
+            if (!file.is_open()) return 0;
+            return sum(file.span(), a);
+        }
+
+        template<typename load_func>
+        void measure(runner& r, const std::string& name, const std::filesystem::path& path, bool cold, UINT64 expected, load_func&& load)
+        {
+            if (!r.is_selected(name)) return;
+
+            std::vector<double> ns;
+            allocation_stats allocated{};
+            for (UINT i{ 0 }; i < (UINT)r.size(9, 3); ++i)
+            {
+                if (cold) drop_from_cache(path);
+                const allocation_stats before{ allocations() };
+                const auto start{ std::chrono::steady_clock::now() };
+                const UINT64 total{ load() };
+                const auto stop{ std::chrono::steady_clock::now() };
+                const allocation_stats after{ allocations() };
+                allocated = { after.bytes - before.bytes, after.count - before.count };
+                ns.emplace_back(std::chrono::duration<double, std::nano>(stop - start).count());
+                r.check(total == expected, name + ": read different data");
+            }
+            std::sort(ns.begin(), ns.end());
+
+            if (cold) drop_from_cache(path);
+            result res{};
+            res.name = name;
+            res.ops = 1;
+            res.ns_per_op = ns[ns.size() / 2];
+            res.min_ns_per_op = ns.front();
+            res.bytes_allocated = allocated.bytes;
+            res.allocations = allocated.count;
+            res.peak_rss = measure_peak_rss([&load] { do_not_optimize(load()); });
+            r.add(std::move(res));
+        }
+
+    } // anonymous namespace
+
+    // Time to load a file and read it (all of it, or one word per 256KB), with utl::read_file() and with
+    // utl::mapped_file, and how much the peak RSS grows. ns/op is the time per file.
+    // Warm files are in the OS file cache. Cold files are dropped from it before each run, which only
+    // reaches the disk where the file system honors the hint.
+    void run_mapped_file_benchmarks(runner& r)
+    {
+        const temp_directory directory{};
+        random rng{};
+
+        for (const UINT64 size_mb : { (UINT64)1, r.size(64, 8) })
+        {
+            std::vector<UINT8> data(size_mb * 1024 * 1024);
+            for (UINT8& byte : data) byte = (UINT8)rng.next();
+            const std::filesystem::path path{ directory.write("mapped_file_" + std::to_string(size_mb) + "mb.bin", data) };
+
+            for (const access a : { access::sequential, access::sparse })
+            {
+                const UINT64 expected{ sum(data, a) };
+                for (const bool cold : { false, true })
+                {
+                    const std::string prefix{ "io/mapped_file/" + std::to_string(size_mb) + "MB/" + (cold ? "cold/" : "warm/") +
+                        (a == access::sequential ? "sequential/" : "sparse/") };
+                    measure(r, prefix + "read_file", path, cold, expected, [&path, a] { return load_with_read_file(path, a); });
+                    measure(r, prefix + "mapped_file", path, cold, expected, [&path, a] { return load_with_mapped_file(path, a); });
+                }
+            }
+        }
+    }
+}
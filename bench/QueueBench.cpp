@@ -0,0 +1,189 @@
+#include "Bench.h"
+#include "Queue.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace bench {
+    namespace {
+
+        constexpr UINT queue_capacity{ 1024 };
+
+        // What the upload frames and deferred releases used before the queues: a std::deque behind a mutex.
+        class locked_queue
+        {
+        public:
+            [[nodiscard]] bool try_push(UINT64 value)
+            {
+                std::lock_guard lock{ _mutex };
+                if (_items.size() == queue_capacity) return false;
+                _items.push_back(value);
+                return true;
+            }
+
+            [[nodiscard]] bool try_pop(UINT64& value)
+            {
+                std::lock_guard lock{ _mutex };
+                if (_items.empty()) return false;
+                value = _items.front();
+                _items.pop_front();
+                return true;
+            }
+
+        private:
+            std::deque<UINT64>  _items;
+            std::mutex          _mutex;
+        };
+
+        template<typename queue>
+        constexpr bool is_blocking{ false };
+
+        template<typename queue>
+        constexpr bool is_blocking<utl::blocking_queue<queue>>{ true };
+
+        struct queue_run
+        {
+            double  ns_per_item{ 0 };
+            bool    exactly_once{ true };
+        };
+
+        // Every producer pushes 'per_producer' values (its index in the high bits, a sequence number in the
+        // low bits), and the consumers pop until all are gone. Spinning queues retry with a yield when full
+        // or empty, blocking_queue sleeps in push() and pop() and is closed when the producers are done.
+        template<typename queue>
+        [[nodiscard]] queue_run run_queue(UINT producer_count, UINT consumer_count, UINT per_producer)
+        {
+            auto q{ std::make_unique<queue>() };
+            const UINT64 total{ (UINT64)producer_count * per_producer };
+            std::vector<std::vector<UINT64>> popped(consumer_count);
+            for (std::vector<UINT64>& values : popped) values.reserve(total);
+
+            std::atomic<bool> go{ false };
+            std::atomic<UINT64> pop_count{ 0 };
+            std::vector<std::thread> threads;
+
+            for (UINT p{ 0 }; p < producer_count; ++p)
+            {
+                threads.emplace_back([&q, &go, p, per_producer] {
+                    while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                    for (UINT i{ 0 }; i < per_producer; ++i)
+                    {
+                        const UINT64 value{ (UINT64)p << 32 | i };
+                        if constexpr (is_blocking<queue>)
+                        {
+                            q->push(value);
+                        }
+                        else
+                        {
+                            while (!q->try_push(value)) std::this_thread::yield();
+                        }
+                    }
+                    });
+            }
+
+            for (UINT c{ 0 }; c < consumer_count; ++c)
+            {
+                threads.emplace_back([&q, &go, &pop_count, &values = popped[c], total] {
+                    while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                    UINT64 value{ 0 };
+                    if constexpr (is_blocking<queue>)
+                    {
+                        while (q->pop(value)) values.emplace_back(value);
+                    }
+                    else
+                    {
+                        while (pop_count.load(std::memory_order_relaxed) < total)
+                        {
+                            if (!q->try_pop(value))
+                            {
+                                std::this_thread::yield();
+                                continue;
+                            }
+                            values.emplace_back(value);
+                            pop_count.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                    });
+            }
+
+            const auto start{ std::chrono::steady_clock::now() };
+            go.store(true, std::memory_order_release);
+            for (UINT p{ 0 }; p < producer_count; ++p) threads[p].join();
+            if constexpr (is_blocking<queue>) q->close();
+            for (UINT c{ 0 }; c < consumer_count; ++c) threads[producer_count + c].join();
+            const auto stop{ std::chrono::steady_clock::now() };
+
+            // Every value pushed is popped once: no value lost, none popped twice.
+            std::vector<UINT8> seen(total);
+            bool exactly_once{ true };
+            UINT64 count{ 0 };
+            for (const std::vector<UINT64>& values : popped)
+            {
+                for (const UINT64 value : values)
+                {
+                    const UINT64 producer{ value >> 32 };
+                    const UINT64 sequence{ value & 0xffff'ffff };
+                    if (producer >= producer_count || sequence >= per_producer) { exactly_once = false; continue; }
+                    UINT8& s{ seen[producer * per_producer + sequence] };
+                    exactly_once &= !s;
+                    s = 1;
+                    ++count;
+                }
+            }
+            exactly_once &= count == total;
+
+            queue_run run{};
+            run.ns_per_item = std::chrono::duration<double, std::nano>(stop - start).count() / (double)total;
+            run.exactly_once = exactly_once;
+            return run;
+        }
+
+        template<typename queue>
+        void measure(runner& r, const char* kind, const char* name, UINT producer_count, UINT consumer_count, UINT per_producer)
+        {
+            const std::string result_name{ std::string{ "queue/" } + kind + "/producers=" + std::to_string(producer_count) + "/" + name };
+            if (!r.is_selected(result_name)) return;
+
+            std::vector<double> ns;
+            for (UINT i{ 0 }; i < (UINT)r.size(5, 2); ++i)
+            {
+                const queue_run run{ run_queue<queue>(producer_count, consumer_count, per_producer) };
+                ns.emplace_back(run.ns_per_item);
+                r.check(run.exactly_once, result_name + ": a value was lost or popped twice");
+            }
+            std::sort(ns.begin(), ns.end());
+
+            result res{};
+            res.name = result_name;
+            res.ops = (UINT64)producer_count * per_producer;
+            res.ns_per_op = ns[ns.size() / 2];
+            res.min_ns_per_op = ns.front();
+            r.add(std::move(res));
+        }
+
+    } // anonymous namespace
+
+    // Items per second through utl's bounded queues at 1, 2, 4 and 8 producers. ns/op is wall time per item.
+    // SPSC has one producer and one consumer, MPSC one consumer, MPMC and blocking_queue as many consumers
+    // as producers. Each is compared with a std::deque behind a mutex in the same shape.
+    // NOTE: with fewer cores than threads this mostly measures how the threads share the cores.
+    void run_queue_benchmarks(runner& r)
+    {
+        const UINT items{ (UINT)r.size(400'000, 40'000) };
+
+        measure<utl::spsc_queue<UINT64, queue_capacity>>(r, "spsc", "utl::spsc_queue", 1, 1, items);
+        measure<locked_queue>(r, "spsc", "std::deque+mutex", 1, 1, items);
+
+        for (const UINT producer_count : { 1u, 2u, 4u, 8u })
+        {
+            const UINT per_producer{ items / producer_count };
+            measure<utl::mpsc_queue<UINT64, queue_capacity>>(r, "mpsc", "utl::mpsc_queue", producer_count, 1, per_producer);
+            measure<locked_queue>(r, "mpsc", "std::deque+mutex", producer_count, 1, per_producer);
+            measure<utl::mpmc_queue<UINT64, queue_capacity>>(r, "mpmc", "utl::mpmc_queue", producer_count, producer_count, per_producer);
+            measure<locked_queue>(r, "mpmc", "std::deque+mutex", producer_count, producer_count, per_producer);
+            measure<utl::blocking_queue<utl::mpmc_queue<UINT64, queue_capacity>>>(r, "blocking_mpmc", "utl::blocking_queue", producer_count, producer_count, per_producer);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "Bench.h"
+#include "Jobs.h"
+#include "Utilities.h"
+#include <algorithm>
+#include <atomic>
+
+namespace bench {
+    namespace {
+
+        struct read_totals
+        {
+            std::atomic<UINT64> bytes{ 0 };
+            std::atomic<UINT>   failed{ 0 };
+        };
+
+        void count_read(std::span<const UINT8> data, void* context)
+        {
+            read_totals& totals{ *(read_totals*)context };
+            if (data.empty()) totals.failed.fetch_add(1, std::memory_order_relaxed);
+            totals.bytes.fetch_add(data.size(), std::memory_order_relaxed);
+            do_not_optimize(data.data());
+        }
+
+        struct files
+        {
+            std::vector<std::string>    paths;
+            std::vector<utl::file_read> reads;
+            UINT64                      total_bytes{ 0 };
+        };
+
+        // One run: 'load(totals, stats)' reads all files once. Returns false if it didn't get every byte.
+        template<typename load_func>
+        void measure(runner& r, const std::string& name, files& f, bool cold, load_func&& load)
+        {
+            if (!r.is_selected(name)) return;
+
+            std::vector<double> ns;
+            utl::file_read_stats stats{};
+            for (UINT i{ 0 }; i < (UINT)r.size(7, 3); ++i)
+            {
+                if (cold) for (const std::string& path : f.paths) drop_from_cache(path);
+
+                read_totals totals{};
+                for (utl::file_read& read : f.reads) read.context = &totals;
+
+                const auto start{ std::chrono::steady_clock::now() };
+                load(stats);
+                const auto stop{ std::chrono::steady_clock::now() };
+                ns.emplace_back(std::chrono::duration<double, std::nano>(stop - start).count());
+                r.check(!totals.failed.load() && totals.bytes.load() == f.total_bytes, name + ": every file is read");
+            }
+            std::sort(ns.begin(), ns.end());
+
+            result res{};
+            res.name = name;
+            res.ops = f.reads.size();
+            res.ns_per_op = ns[ns.size() / 2] / (double)f.reads.size();
+            res.min_ns_per_op = ns.front() / (double)f.reads.size();
+            res.counters.emplace_back("MB/s", (double)f.total_bytes / (1024.0 * 1024.0) / (ns[ns.size() / 2] * 1e-9));
+            res.counters.emplace_back("mean_depth", stats.mean_in_flight);
+            res.counters.emplace_back("peak_depth", (double)stats.peak_in_flight);
+            r.add(std::move(res));
+        }
+
+    } // anonymous namespace
+
+    // utl::read_files() with 1, 16 and 256 reads in flight, against one blocking utl::read_file() after the
+    // other. ns/op is the time per file, from starting the reads until the last callback returned.
+    // mean_depth is how many reads were queued each time read_files() waited for completions.
+    // Warm files are in the OS file cache, cold ones are dropped from it before each run (see drop_from_cache()).
+    void run_read_files_benchmarks(runner& r)
+    {
+        const UINT file_count{ (UINT)r.size(512, 64) };
+        const UINT file_size{ (UINT)r.size(128 * 1024, 32 * 1024) };
+        const std::string prefix{ "io/read_files/" + std::to_string(file_count) + "x" + std::to_string(file_size / 1024) + "KB/" };
+
+        const temp_directory directory{};
+        random rng{};
+        files f{};
+        std::vector<UINT8> data(file_size);
+        for (UINT i{ 0 }; i < file_count; ++i)
+        {
+            for (UINT8& byte : data) byte = (UINT8)rng.next();
+            f.paths.emplace_back(directory.write("file_" + std::to_string(i) + ".bin", data).string());
+            f.total_bytes += file_size;
+        }
+        for (const std::string& path : f.paths) f.reads.emplace_back(utl::file_read{ path.c_str(), &count_read, nullptr });
+
+        jobs::initialize();
+        for (const bool cold : { false, true })
+        {
+            const std::string state{ cold ? "cold/" : "warm/" };
+            measure(r, prefix + state + "read_file", f, cold, [&f](utl::file_read_stats& stats) {
+                for (const utl::file_read& read : f.reads)
+                {
+                    std::unique_ptr<UINT8[]> bytes{};
+                    UINT64 size{ 0 };
+                    const bool succeeded{ utl::read_file(read.path, bytes, size) };
+                    read.on_read(succeeded ? std::span<const UINT8>{ bytes.get(), (size_t)size } : std::span<const UINT8>{}, read.context);
+                }
+                stats = { 1, 1.0 };
+                });
+
+            for (const UINT depth : { 1u, 16u, 256u })
+            {
+                measure(r, prefix + state + "read_files/depth=" + std::to_string(depth), f, cold, [&f, depth](utl::file_read_stats& stats) {
+                    utl::read_files(f.reads.data(), (UINT)f.reads.size(), depth, &stats);
+                    });
+            }
+        }
+        jobs::shutdown();
+    }
+}
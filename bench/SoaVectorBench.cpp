@@ -0,0 +1,327 @@
+#include "Bench.h"
+#include "SoaVector.h"
+
+namespace bench {
+    namespace {
+
+        // Stand-ins with the sizes of the D3D12 and HLSL types in graphic_pass::graphic_cache and LightSet.
+        struct index_buffer_view
+        {
+            UINT64  location;
+            UINT    size;
+            UINT    format;
+        };
+
+        struct float3
+        {
+            float x, y, z;
+        };
+
+        struct light_parameters // hlsl::LightParameters with USE_BOUNDING_SPHERES
+        {
+            float3  position;
+            float   intensity;
+            float3  direction;
+            float   range;
+            float3  color;
+            float   cos_umbra;
+            float3  attenuation;
+            float   cos_penumbra;
+        };
+
+        struct culling_info // hlsl::LightCullingLightInfo
+        {
+            float3  position;
+            float   range;
+            float3  direction;
+            float   cos_penumbra;
+        };
+
+        struct sphere // hlsl::Sphere
+        {
+            float3  center;
+            float   radius;
+        };
+
+        // The arrays of graphic_pass::graphic_cache, in the same order.
+        struct cache_arrays
+        {
+            UINT* entity_ids;
+            UINT* sub_mesh_gpu_ids;
+            UINT* material_ids;
+            void** graphic_pipeline_states;
+            void** depth_pipeline_states;
+            void** root_signatures;
+            UINT* material_types;
+            UINT** descriptor_indices;
+            UINT* texture_counts;
+            void** material_surfaces;
+            UINT64* position_buffers;
+            UINT64* element_buffers;
+            index_buffer_view* index_buffer_views;
+            UINT* primitive_topologies;
+            UINT* elements_types;
+            UINT64* per_object_data;
+            UINT64* srv_indices;
+        };
+
+        // graphic_cache::resize() before soa_vector: one block of count * struct_size bytes, carved by hand.
+        // NOTE: 8-byte arrays can start on a 4-byte boundary after an odd number of UINTs.
+        class carved_cache
+        {
+        public:
+            carved_cache() = default;
+            DISABLE_COPY_AND_MOVE(carved_cache);
+            ~carved_cache() { free(_buffer); }
+
+            [[nodiscard]] cache_arrays resize(UINT64 count)
+            {
+                free(_buffer);
+                _buffer = (UINT8*)malloc(count * struct_size);
+
+                cache_arrays a{};
+                a.entity_ids = (UINT*)_buffer;
+                a.sub_mesh_gpu_ids = (UINT*)&a.entity_ids[count];
+                a.material_ids = (UINT*)&a.sub_mesh_gpu_ids[count];
+                a.graphic_pipeline_states = (void**)&a.material_ids[count];
+                a.depth_pipeline_states = (void**)&a.graphic_pipeline_states[count];
+                a.root_signatures = (void**)&a.depth_pipeline_states[count];
+                a.material_types = (UINT*)&a.root_signatures[count];
+                a.descriptor_indices = (UINT**)&a.material_types[count];
+                a.texture_counts = (UINT*)&a.descriptor_indices[count];
+                a.material_surfaces = (void**)&a.texture_counts[count];
+                a.position_buffers = (UINT64*)&a.material_surfaces[count];
+                a.element_buffers = (UINT64*)&a.position_buffers[count];
+                a.index_buffer_views = (index_buffer_view*)&a.element_buffers[count];
+                a.primitive_topologies = (UINT*)&a.index_buffer_views[count];
+                a.elements_types = (UINT*)&a.primitive_topologies[count];
+                a.per_object_data = (UINT64*)&a.elements_types[count];
+                a.srv_indices = (UINT64*)&a.per_object_data[count];
+                return a;
+            }
+
+        private:
+            static constexpr UINT64 struct_size{ sizeof(UINT) * 3 + sizeof(void*) * 3 + sizeof(UINT) + sizeof(UINT*) + sizeof(UINT) +
+                sizeof(void*) + sizeof(UINT64) * 2 + sizeof(index_buffer_view) + sizeof(UINT) * 2 + sizeof(UINT64) * 2 };
+            UINT8* _buffer{ nullptr };
+        };
+
+        // graphic_cache::resize() now.
+        class soa_cache
+        {
+        public:
+            [[nodiscard]] cache_arrays resize(UINT64 count)
+            {
+                // NOTE: the frame arena is reset every frame. This is the closest thing on the heap.
+                _items = {};
+                _items.resize_uninitialized(count);
+                return { _items.data<0>(), _items.data<1>(), _items.data<2>(), _items.data<3>(), _items.data<4>(), _items.data<5>(),
+                    _items.data<6>(), _items.data<7>(), _items.data<8>(), _items.data<9>(), _items.data<10>(), _items.data<11>(),
+                    _items.data<12>(), _items.data<13>(), _items.data<14>(), _items.data<15>(), _items.data<16>() };
+            }
+
+        private:
+            utl::soa_vector<UINT, UINT, UINT, void*, void*, void*, UINT, UINT*, UINT, void*, UINT64, UINT64, index_buffer_view,
+                UINT, UINT, UINT64, UINT64> _items;
+        };
+
+        // What content::render_item::get_items, sub_mesh::get_views, material::get_materials and
+        // fill_per_object_data write for every render item.
+        void fill(const cache_arrays& a, UINT64 count)
+        {
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                a.entity_ids[i] = i;
+                a.sub_mesh_gpu_ids[i] = i & 0xff;
+                a.material_ids[i] = i & 0x3f;
+                a.graphic_pipeline_states[i] = (void*)(UINT64)(i & 7);
+                a.depth_pipeline_states[i] = (void*)(UINT64)(i & 3);
+                a.root_signatures[i] = (void*)(UINT64)(i & 1);
+                a.material_types[i] = 0;
+                a.descriptor_indices[i] = nullptr;
+                a.texture_counts[i] = 2;
+                a.material_surfaces[i] = nullptr;
+                a.position_buffers[i] = (UINT64)i << 16;
+                a.element_buffers[i] = ((UINT64)i << 16) + 0x1000;
+                a.index_buffer_views[i] = { ((UINT64)i << 16) + 0x2000, 6 * sizeof(UINT16), 57 };
+                a.primitive_topologies[i] = 4;
+                a.elements_types[i] = 1;
+                a.per_object_data[i] = (UINT64)i * 256;
+                a.srv_indices[i] = (UINT64)i * 16;
+            }
+        }
+
+        // What the depth prepass and the main pass read to record their draws.
+        [[nodiscard]] UINT64 read(const cache_arrays& a, UINT64 count)
+        {
+            UINT64 sum{ 0 };
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                sum += (UINT64)a.graphic_pipeline_states[i] + (UINT64)a.root_signatures[i] + a.position_buffers[i] + a.element_buffers[i] +
+                    a.index_buffer_views[i].location + a.index_buffer_views[i].size + a.primitive_topologies[i] + a.per_object_data[i] + a.srv_indices[i];
+            }
+            return sum;
+        }
+
+        template<typename cache>
+        UINT64 run_cache(runner& r, const char* name, UINT64 count)
+        {
+            UINT64 frame_sum{ 0 }, read_sum{ 0 };
+            r.run(std::string{ "soa_vector/graphic_cache/frame/" } + name, count, [&] {
+                cache c{};
+                const cache_arrays a{ c.resize(count) };
+                fill(a, count);
+                frame_sum = read(a, count);
+                do_not_optimize(frame_sum);
+                });
+
+            cache c{};
+            const cache_arrays a{ c.resize(count) };
+            fill(a, count);
+            r.run(std::string{ "soa_vector/graphic_cache/read/" } + name, count, [&] {
+                read_sum = read(a, count);
+                do_not_optimize(read_sum);
+                });
+            return frame_sum ? frame_sum : read_sum;
+        }
+
+        // LightSet's cullable lights before soa_vector: five vectors that must be kept the same size.
+        class parallel_lights
+        {
+        public:
+            UINT64 emplace_back()
+            {
+                _lights.emplace_back();
+                _culling_info.emplace_back();
+                _spheres.emplace_back();
+                _entity_ids.emplace_back();
+                _owner_ids.emplace_back();
+                return _lights.size() - 1;
+            }
+
+            void swap(UINT64 a, UINT64 b)
+            {
+                std::swap(_lights[a], _lights[b]);
+                std::swap(_culling_info[a], _culling_info[b]);
+                std::swap(_spheres[a], _spheres[b]);
+                std::swap(_entity_ids[a], _entity_ids[b]);
+                std::swap(_owner_ids[a], _owner_ids[b]);
+            }
+
+            [[nodiscard]] UINT64 size() const { return _lights.size(); }
+            [[nodiscard]] light_parameters* lights() { return _lights.data(); }
+            [[nodiscard]] culling_info* culling() { return _culling_info.data(); }
+            [[nodiscard]] sphere* spheres() { return _spheres.data(); }
+            [[nodiscard]] UINT* entity_ids() { return _entity_ids.data(); }
+            [[nodiscard]] UINT* owner_ids() { return _owner_ids.data(); }
+
+        private:
+            utl::vector<light_parameters>   _lights;
+            utl::vector<culling_info>       _culling_info;
+            utl::vector<sphere>             _spheres;
+            utl::vector<UINT>               _entity_ids;
+            utl::vector<UINT>               _owner_ids;
+        };
+
+        // LightSet::_cullable now.
+        class soa_lights
+        {
+        public:
+            UINT64 emplace_back() { return _cullable.emplace_back(); }
+            void swap(UINT64 a, UINT64 b) { _cullable.swap(a, b); }
+
+            [[nodiscard]] UINT64 size() const { return _cullable.size(); }
+            [[nodiscard]] light_parameters* lights() { return _cullable.data<0>(); }
+            [[nodiscard]] culling_info* culling() { return _cullable.data<1>(); }
+            [[nodiscard]] sphere* spheres() { return _cullable.data<2>(); }
+            [[nodiscard]] UINT* entity_ids() { return _cullable.data<3>(); }
+            [[nodiscard]] UINT* owner_ids() { return _cullable.data<4>(); }
+
+        private:
+            utl::soa_vector<light_parameters, culling_info, sphere, UINT, UINT> _cullable;
+        };
+
+        template<typename lights>
+        [[nodiscard]] std::unique_ptr<lights> make_lights(UINT count)
+        {
+            auto l{ std::make_unique<lights>() };
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                const UINT64 index{ l->emplace_back() };
+                l->lights()[index].range = 1.f + (float)(i & 15);
+                l->spheres()[index].radius = l->lights()[index].range;
+                l->entity_ids()[index] = i;
+                l->owner_ids()[index] = i;
+            }
+            return l;
+        }
+
+        template<typename lights>
+        UINT64 run_lights(runner& r, const char* name, UINT count, const std::vector<float3>& positions)
+        {
+            // Adding lights one at a time, like LightSet::add().
+            r.run(std::string{ "soa_vector/lights/add/" } + name, count, [&] {
+                auto l{ make_lights<lights>(count) };
+                do_not_optimize(l->lights());
+                });
+
+            // Enabling and disabling lights swaps rows.
+            r.run(std::string{ "soa_vector/lights/swap/" } + name, count, [&] { return make_lights<lights>(count); },
+                [&](std::unique_ptr<lights>& l) {
+                    random rng{ 21 };
+                    for (UINT i{ 0 }; i < count; ++i) l->swap(rng.next(count), rng.next(count));
+                    do_not_optimize(l->owner_ids());
+                });
+
+            // LightSet::update_transform_parameters() for every light.
+            UINT64 sum{ 0 };
+            auto l{ make_lights<lights>(count) };
+            r.run(std::string{ "soa_vector/lights/update_transforms/" } + name, count, [&] {
+                light_parameters* const params{ l->lights() };
+                culling_info* const culling{ l->culling() };
+                sphere* const spheres{ l->spheres() };
+                const UINT* const entity_ids{ l->entity_ids() };
+                for (UINT i{ 0 }; i < count; ++i)
+                {
+                    const float3& position{ positions[entity_ids[i]] };
+                    params[i].position = position;
+                    culling[i].position = position;
+                    spheres[i].center = position;
+                }
+                sum = 0;
+                for (UINT i{ 0 }; i < count; ++i) sum += (UINT64)(spheres[i].center.x + culling[i].position.y);
+                do_not_optimize(sum);
+                });
+
+            // The first three columns are copied to the GPU buffers as they are.
+            std::vector<UINT8> upload(count * (sizeof(light_parameters) + sizeof(culling_info) + sizeof(sphere)));
+            r.run(std::string{ "soa_vector/lights/upload/" } + name, count, [&] {
+                UINT8* dst{ upload.data() };
+                memcpy(dst, l->lights(), count * sizeof(light_parameters));
+                dst += count * sizeof(light_parameters);
+                memcpy(dst, l->culling(), count * sizeof(culling_info));
+                dst += count * sizeof(culling_info);
+                memcpy(dst, l->spheres(), count * sizeof(sphere));
+                do_not_optimize(upload.data());
+                });
+            return sum;
+        }
+
+    } // anonymous namespace
+
+    // utl::soa_vector against the layouts it replaced in graphic_pass::graphic_cache and LightSet.
+    void run_soa_vector_benchmarks(runner& r)
+    {
+        const UINT64 item_count{ r.size(100'000, 10'000) };
+        const UINT64 carved_sum{ run_cache<carved_cache>(r, "hand_carved", item_count) };
+        const UINT64 soa_sum{ run_cache<soa_cache>(r, "soa_vector", item_count) };
+        r.check(carved_sum == soa_sum || !carved_sum || !soa_sum, "soa_vector/graphic_cache sums differ");
+
+        const UINT light_count{ (UINT)r.size(10'000, 2'000) };
+        std::vector<float3> positions(light_count);
+        for (UINT i{ 0 }; i < light_count; ++i) positions[i] = { (float)i, (float)(i * 2), 1.f };
+        const UINT64 parallel_sum{ run_lights<parallel_lights>(r, "utl::vector x5", light_count, positions) };
+        const UINT64 soa_lights_sum{ run_lights<soa_lights>(r, "soa_vector", light_count, positions) };
+        r.check(parallel_sum == soa_lights_sum || !parallel_sum || !soa_lights_sum, "soa_vector/lights sums differ");
+    }
+}
@@ -0,0 +1,129 @@
+#include "Bench.h"
+#include "FreeList.h"
+
+namespace bench {
+    namespace {
+
+        struct item
+        {
+            UINT a, b, c, d;
+        };
+
+        // A free list and the ids of its live items. For utl::free_list, 'slots' is the table the
+        // owner keeps to find its items again (like LightSet's _non_cullable_owners_ids): one entry
+        // per slot, Invalid_Index where the slot is free.
+        template<typename list>
+        struct occupied_list
+        {
+            list                l;
+            std::vector<UINT>   ids;
+            std::vector<UINT>   slots;
+
+            DISABLE_COPY_AND_MOVE(occupied_list);
+            occupied_list() = default;
+            ~occupied_list()
+            {
+                for (const UINT id : ids) l.remove(id);
+            }
+        };
+
+        // Adds 'capacity' items, then removes items at random until 'occupancy' percent are left.
+        template<typename list>
+        [[nodiscard]] std::unique_ptr<occupied_list<list>> occupy(UINT capacity, UINT occupancy)
+        {
+            auto o{ std::make_unique<occupied_list<list>>() };
+            o->ids.reserve(capacity);
+            o->slots.resize(capacity);
+            for (UINT i{ 0 }; i < capacity; ++i)
+            {
+                const UINT id{ o->l.add(item{ i, i * 3, i ^ 0x55, 1 }) };
+                o->ids.emplace_back(id);
+                o->slots[i] = id;
+            }
+
+            random rng{ 5 };
+            const UINT live{ (UINT)((UINT64)capacity * occupancy / 100) };
+            while (o->ids.size() > live)
+            {
+                const UINT index{ rng.next((UINT)o->ids.size()) };
+                const UINT id{ o->ids[index] };
+                o->l.remove(id);
+                o->slots[id] = Invalid_Index;
+                o->ids[index] = o->ids.back();
+                o->ids.pop_back();
+            }
+            return o;
+        }
+
+        template<typename list>
+        [[nodiscard]] UINT64 iterate_live(const occupied_list<list>& o)
+        {
+            UINT64 sum{ 0 };
+            if constexpr (std::is_same_v<list, utl::sparse_free_list<item>>)
+            {
+                for (const item& x : o.l) sum += x.a;
+            }
+            else
+            {
+                for (const UINT id : o.slots)
+                {
+                    if (id != Invalid_Index) sum += o.l[id].a;
+                }
+            }
+            return sum;
+        }
+
+        template<typename list>
+        void run_list(runner& r, const char* name, UINT capacity, UINT occupancy, UINT64& iterate_sum, UINT64& lookup_sum)
+        {
+            std::string suffix{ "/" };
+            suffix.append(std::to_string(occupancy)).append("%/").append(name);
+            auto o{ occupy<list>(capacity, occupancy) };
+            const UINT live{ (UINT)o->ids.size() };
+
+            // Visits all live items, in whatever order the list keeps them.
+            r.run("sparse_free_list/iterate" + suffix, live, [&] {
+                iterate_sum = iterate_live(*o);
+                do_not_optimize(iterate_sum);
+                });
+
+            std::vector<UINT> lookups(live);
+            random rng{ 9 };
+            for (UINT& id : lookups) id = o->ids[rng.next(live)];
+            r.run("sparse_free_list/lookup" + suffix, live, [&] {
+                UINT64 sum{ 0 };
+                for (const UINT id : lookups) sum += o->l[id].a;
+                lookup_sum = sum;
+                do_not_optimize(lookup_sum);
+                });
+
+            // Removes a random live item and adds a new one. A sparse list moves its last item on every remove.
+            r.run("sparse_free_list/churn" + suffix, live, [&] {
+                random rng{ 3 };
+                for (UINT i{ 0 }; i < live; ++i)
+                {
+                    UINT& id{ o->ids[rng.next(live)] };
+                    o->l.remove(id);
+                    id = o->l.add(item{ i, 0, 0, 1 });
+                }
+                });
+        }
+
+    } // anonymous namespace
+
+    // utl::sparse_free_list against utl::free_list with the owner's slot table, at 10%, 50% and 90% of the
+    // slots in use. That's how LightSet's owners and the cameras were kept before they became sparse lists.
+    void run_sparse_free_list_benchmarks(runner& r)
+    {
+        const UINT capacity{ (UINT)r.size(100'000, 10'000) };
+        for (const UINT occupancy : { 10u, 50u, 90u })
+        {
+            UINT64 iterate_sums[2]{}, lookup_sums[2]{};
+            run_list<utl::sparse_free_list<item>>(r, "utl::sparse_free_list", capacity, occupancy, iterate_sums[0], lookup_sums[0]);
+            run_list<utl::free_list<item>>(r, "utl::free_list", capacity, occupancy, iterate_sums[1], lookup_sums[1]);
+            // NOTE: both lists are filled and emptied the same way, so they hold the same items under the same ids.
+            r.check(iterate_sums[0] == iterate_sums[1] || !iterate_sums[0] || !iterate_sums[1], "sparse_free_list/iterate sums differ");
+            r.check(lookup_sums[0] == lookup_sums[1] || !lookup_sums[0] || !lookup_sums[1], "sparse_free_list/lookup sums differ");
+        }
+    }
+}
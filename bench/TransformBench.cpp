@@ -0,0 +1,225 @@
+#include "Bench.h"
+#include "CpuFeatures.h"
+#include "TransformKernels.h"
+#include <algorithm>
+#include <cmath>
+#if __has_include(<DirectXMath.h>)
+#include <DirectXMath.h>
+#define BENCH_HAS_DIRECTXMATH 1
+#endif
+
+namespace bench {
+    namespace {
+
+        struct transforms
+        {
+            std::vector<XMFLOAT4>   rotations;
+            std::vector<XMFLOAT3>   positions;
+            std::vector<XMFLOAT3>   scales;
+            std::vector<XMFLOAT4X4> to_worlds;
+            std::vector<XMFLOAT4X4> inverse_worlds;
+            std::vector<UINT>       ids;
+
+            [[nodiscard]] transform::kernels::transform_arrays arrays()
+            {
+                return { rotations.data(), positions.data(), scales.data(), to_worlds.data(), inverse_worlds.data() };
+            }
+        };
+
+        // Unit quaternions, and scales between 0.5 and 2, like the rotation and scale setters produce.
+        [[nodiscard]] transforms make_transforms(UINT count)
+        {
+            transforms t{};
+            t.rotations.resize(count);
+            t.positions.resize(count);
+            t.scales.resize(count);
+            t.to_worlds.resize(count);
+            t.inverse_worlds.resize(count);
+            t.ids.resize(count);
+
+            random rng{ 31 };
+            const auto next_float = [&rng](float min, float max) {
+                return min + (max - min) * (float)(rng.next() >> 40) / (float)(1 << 24);
+            };
+            for (UINT i{ 0 }; i < count; ++i)
+            {
+                XMFLOAT4 q{ next_float(-1.f, 1.f), next_float(-1.f, 1.f), next_float(-1.f, 1.f), next_float(-1.f, 1.f) };
+                const float length{ std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w) };
+                t.rotations[i] = XMFLOAT4{ q.x / length, q.y / length, q.z / length, q.w / length };
+                t.positions[i] = XMFLOAT3{ next_float(-100.f, 100.f), next_float(-100.f, 100.f), next_float(-100.f, 100.f) };
+                t.scales[i] = XMFLOAT3{ next_float(.5f, 2.f), next_float(.5f, 2.f), next_float(.5f, 2.f) };
+                t.ids[i] = i;
+            }
+            return t;
+        }
+
+#if BENCH_HAS_DIRECTXMATH
+        constexpr const char* reference_name{ "DirectXMath" };
+
+        // What transform::calculate_transform_matrices() did for each entity before the kernels.
+        void reference_matrices(transforms& t, UINT id)
+        {
+            using namespace DirectX;
+            XMVECTOR r{ XMLoadFloat4(&t.rotations[id]) };
+            XMVECTOR p{ XMLoadFloat3(&t.positions[id]) };
+            XMVECTOR s{ XMLoadFloat3(&t.scales[id]) };
+
+            XMMATRIX world{ XMMatrixAffineTransformation(s, XMQuaternionIdentity(), r, p) };
+            XMStoreFloat4x4((DirectX::XMFLOAT4X4*)&t.to_worlds[id], world);
+
+            world.r[3] = XMVectorSet(0.f, 0.f, 0.f, 1.f);
+            XMMATRIX inverse_world{ XMMatrixInverse(nullptr, world) };
+            XMStoreFloat4x4((DirectX::XMFLOAT4X4*)&t.inverse_worlds[id], inverse_world);
+        }
+#else
+        // NOTE: without DirectXMath (it isn't part of the Linux toolchains), the baseline is the same math
+        //       written out in scalar code, like DirectXMath's _XM_NO_INTRINSICS_ path: a scaling matrix
+        //       times the rotation matrix, then a general 4x4 inverse by cofactors.
+        constexpr const char* reference_name{ "XMMatrix_no_intrinsics" };
+
+        struct matrix
+        {
+            float m[4][4];
+        };
+
+        [[nodiscard]] matrix multiply(const matrix& a, const matrix& b)
+        {
+            matrix result{};
+            for (UINT i{ 0 }; i < 4; ++i)
+            {
+                for (UINT j{ 0 }; j < 4; ++j)
+                {
+                    result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+                }
+            }
+            return result;
+        }
+
+        [[nodiscard]] matrix inverse(const matrix& matrix_in)
+        {
+            const float* const a{ &matrix_in.m[0][0] };
+            float c[16];
+            c[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+            c[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+            c[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+            c[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+            c[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+            c[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+            c[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+            c[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+            c[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+            c[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+            c[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+            c[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+            c[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+            c[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+            c[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+            c[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+            const float determinant{ a[0] * c[0] + a[1] * c[4] + a[2] * c[8] + a[3] * c[12] };
+            const float inverse_determinant{ 1.f / determinant };
+            matrix result;
+            for (UINT i{ 0 }; i < 16; ++i) (&result.m[0][0])[i] = c[i] * inverse_determinant;
+            return result;
+        }
+
+        // What transform::calculate_transform_matrices() did for each entity before the kernels.
+        void reference_matrices(transforms& t, UINT id)
+        {
+            const XMFLOAT4& q{ t.rotations[id] };
+            const XMFLOAT3& s{ t.scales[id] };
+            const XMFLOAT3& p{ t.positions[id] };
+
+            // XMMatrixRotationQuaternion()
+            const float x2{ q.x + q.x }, y2{ q.y + q.y }, z2{ q.z + q.z };
+            const matrix rotation{ {
+                { 1.f - q.y * y2 - q.z * z2, q.x * y2 + q.w * z2, q.x * z2 - q.w * y2, 0.f },
+                { q.x * y2 - q.w * z2, 1.f - q.x * x2 - q.z * z2, q.y * z2 + q.w * x2, 0.f },
+                { q.x * z2 + q.w * y2, q.y * z2 - q.w * x2, 1.f - q.x * x2 - q.y * y2, 0.f },
+                { 0.f, 0.f, 0.f, 1.f } } };
+            const matrix scaling{ { { s.x, 0.f, 0.f, 0.f }, { 0.f, s.y, 0.f, 0.f }, { 0.f, 0.f, s.z, 0.f }, { 0.f, 0.f, 0.f, 1.f } } };
+
+            // XMMatrixAffineTransformation() with the rotation origin at zero.
+            matrix world{ multiply(scaling, rotation) };
+            world.m[3][0] = p.x; world.m[3][1] = p.y; world.m[3][2] = p.z;
+            memcpy(&t.to_worlds[id], &world, sizeof(matrix));
+
+            world.m[3][0] = 0.f; world.m[3][1] = 0.f; world.m[3][2] = 0.f;
+            const matrix inverse_world{ inverse(world) };
+            memcpy(&t.inverse_worlds[id], &inverse_world, sizeof(matrix));
+        }
+#endif
+
+        // Same batches as transform::update(): the ids of a job's range, 64 at a time.
+        void kernel_matrices(transforms& t)
+        {
+            const transform::kernels::transform_arrays arrays{ t.arrays() };
+            constexpr UINT batch_size{ 64 };
+            const UINT count{ (UINT)t.ids.size() };
+            for (UINT i{ 0 }; i < count; i += batch_size)
+            {
+                transform::kernels::calculate_matrices(arrays, &t.ids[i], std::min(batch_size, count - i));
+            }
+        }
+
+        [[nodiscard]] float max_difference(const std::vector<XMFLOAT4X4>& a, const std::vector<XMFLOAT4X4>& b)
+        {
+            float difference{ 0.f };
+            for (UINT64 i{ 0 }; i < a.size(); ++i)
+            {
+                for (UINT j{ 0 }; j < 16; ++j)
+                {
+                    difference = std::max(difference, std::abs((&a[i].m[0][0])[j] - (&b[i].m[0][0])[j]));
+                }
+            }
+            return difference;
+        }
+
+        // The variant core::cpu::select() picks for the kernel, which has scalar, SSE4.2 and AVX2 variants.
+        [[nodiscard]] const char* kernel_variant_name()
+        {
+            using core::cpu::isa;
+            const isa::level level{ core::cpu::isa_level() };
+            if (level == isa::avx512) return core::cpu::isa_name(isa::avx2);
+            if (level == isa::neon) return core::cpu::isa_name(isa::scalar);
+            return core::cpu::isa_name(level);
+        }
+
+        void run_count(runner& r, UINT count)
+        {
+            std::string prefix{ "transform_matrices/" };
+            prefix.append(std::to_string(count)).append("/");
+
+            transforms reference{ make_transforms(count) };
+            r.run(prefix + reference_name, count, [&] {
+                for (const UINT id : reference.ids) reference_matrices(reference, id);
+                do_not_optimize(reference.to_worlds.data());
+                });
+
+            transforms kernel{ make_transforms(count) };
+            r.run(prefix + "kernels/" + kernel_variant_name(), count, [&] {
+                kernel_matrices(kernel);
+                do_not_optimize(kernel.to_worlds.data());
+                });
+
+            // NOTE: the kernels use the analytic inverse and FMA, so they differ from the reference by rounding.
+            if (r.is_selected(prefix + reference_name) && r.is_selected(prefix + "kernels/"))
+            {
+                r.check(max_difference(reference.to_worlds, kernel.to_worlds) < 1e-4f, "transform_matrices: world matrices differ");
+                r.check(max_difference(reference.inverse_worlds, kernel.inverse_worlds) < 1e-4f, "transform_matrices: inverse world matrices differ");
+            }
+        }
+
+    } // anonymous namespace
+
+    // transform::kernels::calculate_matrices() against the per-entity DirectXMath code it replaced.
+    // Run with --force-isa=scalar or --force-isa=sse4.2 to time the other variants.
+    void run_transform_benchmarks(runner& r)
+    {
+        for (const UINT count : { 10'000u, 100'000u, 1'000'000u })
+        {
+            if (r.quick() && count > 10'000) break;
+            run_count(r, count);
+        }
+    }
+}
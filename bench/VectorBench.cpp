@@ -0,0 +1,183 @@
+#include "Bench.h"
+#include "Vector.h"
+
+namespace bench {
+    namespace {
+
+        struct item
+        {
+            UINT a, b, c, d;
+        };
+
+        // A plain array that is sized up front: the lower bound for the vectors.
+        struct plain_array
+        {
+            item*   items{ nullptr };
+            UINT64  size{ 0 };
+
+            explicit plain_array(UINT64 capacity) : items{ (item*)malloc(capacity * sizeof(item)) } {}
+            plain_array(plain_array&& o) : items{ o.items }, size{ o.size } { o.items = nullptr; o.size = 0; }
+            DISABLE_COPY(plain_array);
+            ~plain_array() { free(items); }
+        };
+
+        [[nodiscard]] constexpr item make_item(UINT i)
+        {
+            return { i, i * 3, i ^ 0x55, 1 };
+        }
+
+        template<typename container>
+        [[nodiscard]] container filled(UINT64 count)
+        {
+            container c;
+            c.reserve(count);
+            for (UINT i{ 0 }; i < count; ++i) c.push_back(make_item(i));
+            return c;
+        }
+
+        [[nodiscard]] plain_array filled_array(UINT64 count)
+        {
+            plain_array a{ count };
+            for (UINT i{ 0 }; i < count; ++i) a.items[a.size++] = make_item(i);
+            return a;
+        }
+
+        template<typename container>
+        [[nodiscard]] UINT64 sum(const container& c)
+        {
+            UINT64 s{ 0 };
+            for (const item& x : c) s += x.a + x.d;
+            return s;
+        }
+
+        void push_back(runner& r, UINT64 count)
+        {
+            r.run("vector/push_back/utl::vector", count, [&] {
+                utl::vector<item> v;
+                for (UINT i{ 0 }; i < count; ++i) v.push_back(make_item(i));
+                do_not_optimize(v.data());
+                });
+
+            r.run("vector/push_back/std::vector", count, [&] {
+                std::vector<item> v;
+                for (UINT i{ 0 }; i < count; ++i) v.push_back(make_item(i));
+                do_not_optimize(v.data());
+                });
+
+            r.run("vector/push_back/array", count, [&] {
+                plain_array a{ count };
+                for (UINT i{ 0 }; i < count; ++i) a.items[a.size++] = make_item(i);
+                do_not_optimize(a.items);
+                });
+        }
+
+        // Erases from the middle until the container is empty. Every erase moves half of the items.
+        void erase(runner& r, UINT64 count)
+        {
+            r.run("vector/erase/utl::vector", count, [&] { return filled<utl::vector<item>>(count); },
+                [](utl::vector<item>& v) { while (!v.empty()) v.erase(v.size() / 2); });
+
+            r.run("vector/erase/std::vector", count, [&] { return filled<std::vector<item>>(count); },
+                [](std::vector<item>& v) { while (!v.empty()) v.erase(v.begin() + v.size() / 2); });
+
+            r.run("vector/erase/array", count, [&] { return filled_array(count); },
+                [](plain_array& a) {
+                    while (a.size)
+                    {
+                        const UINT64 index{ a.size / 2 };
+                        memmove(a.items + index, a.items + index + 1, (a.size - index - 1) * sizeof(item));
+                        --a.size;
+                    }
+                    do_not_optimize(a.items);
+                });
+        }
+
+        // Erases at random positions until the container is empty.
+        void erase_unordered(runner& r, UINT64 count)
+        {
+            r.run("vector/erase_unordered/utl::vector", count, [&] { return filled<utl::vector<item>>(count); },
+                [](utl::vector<item>& v) {
+                    random rng{};
+                    while (!v.empty()) v.erase_unordered(rng.next((UINT)v.size()));
+                });
+
+            r.run("vector/erase_unordered/std::vector", count, [&] { return filled<std::vector<item>>(count); },
+                [](std::vector<item>& v) {
+                    random rng{};
+                    while (!v.empty())
+                    {
+                        const UINT index{ rng.next((UINT)v.size()) };
+                        v[index] = v.back();
+                        v.pop_back();
+                    }
+                });
+
+            r.run("vector/erase_unordered/array", count, [&] { return filled_array(count); },
+                [](plain_array& a) {
+                    random rng{};
+                    while (a.size)
+                    {
+                        const UINT index{ rng.next((UINT)a.size) };
+                        a.items[index] = a.items[--a.size];
+                    }
+                    do_not_optimize(a.items);
+                });
+        }
+
+        void copy(runner& r, UINT64 count)
+        {
+            const utl::vector<item> utl_source{ filled<utl::vector<item>>(count) };
+            r.run("vector/copy/utl::vector", count, [&] {
+                const utl::vector<item> v{ utl_source };
+                do_not_optimize(v.data());
+                });
+
+            const std::vector<item> std_source{ filled<std::vector<item>>(count) };
+            r.run("vector/copy/std::vector", count, [&] {
+                const std::vector<item> v{ std_source };
+                do_not_optimize(v.data());
+                });
+
+            const plain_array array_source{ filled_array(count) };
+            r.run("vector/copy/array", count, [&] {
+                plain_array a{ count };
+                memcpy(a.items, array_source.items, count * sizeof(item));
+                a.size = count;
+                do_not_optimize(a.items);
+                });
+        }
+
+        void iterate(runner& r, UINT64 count)
+        {
+            const utl::vector<item> utl_vector{ filled<utl::vector<item>>(count) };
+            const std::vector<item> std_vector{ filled<std::vector<item>>(count) };
+            const plain_array array{ filled_array(count) };
+            const UINT64 expected{ sum(std_vector) };
+
+            // NOTE: a variant that isn't selected keeps the expected sum.
+            UINT64 utl_sum{ expected }, std_sum{ expected }, array_sum{ expected };
+            r.run("vector/iterate/utl::vector", count, [&] { utl_sum = sum(utl_vector); do_not_optimize(utl_sum); });
+            r.run("vector/iterate/std::vector", count, [&] { std_sum = sum(std_vector); do_not_optimize(std_sum); });
+            r.run("vector/iterate/array", count, [&] {
+                UINT64 s{ 0 };
+                for (UINT64 i{ 0 }; i < array.size; ++i) s += array.items[i].a + array.items[i].d;
+                array_sum = s;
+                do_not_optimize(array_sum);
+                });
+
+            r.check(utl_sum == expected && std_sum == expected && array_sum == expected, "vector/iterate sums differ");
+        }
+
+    } // anonymous namespace
+
+    void run_vector_benchmarks(runner& r)
+    {
+        const UINT64 count{ r.size(100'000, 10'000) };
+        push_back(r, count);
+        // NOTE: erase() is O(n) per call, so it gets fewer items.
+        erase(r, r.size(10'000, 2'000));
+        erase_unordered(r, count);
+        copy(r, count);
+        iterate(r, count);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// Stand-in for MSVC's <intrin.h>, for the engine files that detect CPU features and use SIMD intrinsics.
+// NOTE: GCC and Clang only allow an intrinsic in code built for its instruction set, so CMakeLists.txt
+//       builds those files with the flags they need.
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#include <cpuid.h>
+
+// MSVC's __cpuid(), __cpuidex() and _xgetbv(). <cpuid.h> has a __cpuid macro with other arguments, and
+// the compiler's _xgetbv() returns a signed value and needs -mxsave.
+namespace shim {
+    inline void cpuidex(int info[4], int leaf, int sub_leaf)
+    {
+        unsigned int a, b, c, d;
+        __cpuid_count(leaf, sub_leaf, a, b, c, d);
+        info[0] = (int)a; info[1] = (int)b; info[2] = (int)c; info[3] = (int)d;
+    }
+
+    inline unsigned long long xgetbv(unsigned int index)
+    {
+        unsigned int eax, edx;
+        asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+        return ((unsigned long long)edx << 32) | eax;
+    }
+}
+
+#undef __cpuid
+#undef __cpuidex
+#undef _xgetbv
+#define __cpuid(info, leaf) shim::cpuidex(info, leaf, 0)
+#define __cpuidex(info, leaf, sub_leaf) shim::cpuidex(info, leaf, sub_leaf)
+#define _xgetbv(index) shim::xgetbv(index)
+#endif
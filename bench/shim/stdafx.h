@@ -0,0 +1,273 @@
+#pragma once
+
+// Stand-in for RainDropTest/stdafx.h, so the engine's CPU-side code builds on Linux without the Windows SDK.
+// CMakeLists.txt copies the engine sources next to this file, so their #include "stdafx.h" finds it.
+// NOTE: keep the constants and macros in sync with RainDropTest/stdafx.h.
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using UINT = unsigned int;
+using UINT8 = std::uint8_t;
+using UINT16 = std::uint16_t;
+using UINT32 = std::uint32_t;
+using UINT64 = std::uint64_t;
+using INT8 = std::int8_t;
+using INT16 = std::int16_t;
+using INT32 = std::int32_t;
+using INT64 = std::int64_t;
+using BOOL = int;
+using DWORD = unsigned long;
+using HRESULT = long;
+using HANDLE = void*;
+using HWND = void*;
+using LPCWSTR = const wchar_t*;
+using WPARAM = std::uint64_t;
+using LPARAM = std::int64_t;
+
+// The engine's x64 code paths check for MSVC's architecture macro.
+#if defined(__x86_64__) && !defined(_M_X64)
+#define _M_X64 1
+#endif
+
+constexpr UINT Frame_Count{ 3 };
+constexpr UINT Invalid_Index{ 0xffffffff };
+
+#ifndef DISABLE_COPY
+#define DISABLE_COPY(T)                     \
+            explicit T(const T&) = delete;  \
+            T& operator=(const T&) = delete;
+#endif
+
+#ifndef DISABLE_MOVE
+#define DISABLE_MOVE(T)                 \
+            explicit T(T&&) = delete;   \
+            T& operator=(T&&) = delete;
+#endif
+
+#ifndef DISABLE_COPY_AND_MOVE
+#define DISABLE_COPY_AND_MOVE(T) DISABLE_COPY(T) DISABLE_MOVE(T)
+#endif
+
+#ifdef _DEBUG
+#define DEBUG_OP(x) x
+#else
+#define DEBUG_OP(x)
+#endif
+
+#ifndef _countof
+#define _countof(a) (sizeof(a) / sizeof(a[0]))
+#endif
+
+// MSVC declares _mm_popcnt_u32() in <intrin.h> for any x64 code.
+#include <intrin.h>
+#if !defined(__x86_64__) || !defined(__POPCNT__)
+#define _mm_popcnt_u32(x) __builtin_popcount(x)
+#endif
+
+// DirectXMath's storage types. The engine code the benchmarks build only stores and copies them.
+struct XMFLOAT2
+{
+    float x, y;
+};
+
+struct XMFLOAT3
+{
+    float x, y, z;
+
+    XMFLOAT3() = default;
+    constexpr XMFLOAT3(float _x, float _y, float _z) : x{ _x }, y{ _y }, z{ _z } {}
+    explicit XMFLOAT3(const float* p) : x{ p[0] }, y{ p[1] }, z{ p[2] } {}
+};
+
+struct XMFLOAT4
+{
+    float x, y, z, w;
+
+    XMFLOAT4() = default;
+    constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x{ _x }, y{ _y }, z{ _z }, w{ _w } {}
+    explicit XMFLOAT4(const float* p) : x{ p[0] }, y{ p[1] }, z{ p[2] }, w{ p[3] } {}
+};
+
+struct XMFLOAT4X4
+{
+    float m[4][4];
+};
+
+struct alignas(16) XMFLOAT4X4A : public XMFLOAT4X4 {};
+
+struct XMUINT2
+{
+    UINT x, y;
+};
+
+struct XMUINT3
+{
+    UINT x, y, z;
+};
+
+struct XMUINT4
+{
+    UINT x, y, z, w;
+};
+
+// The DirectXMath functions that the engine code built here calls, in plain scalar code.
+#include <cmath>
+
+namespace DirectX {
+    struct XMVECTOR
+    {
+        float v[4];
+    };
+
+    // Row-major, like XMFLOAT4X4.
+    struct XMMATRIX
+    {
+        float m[4][4];
+    };
+
+    inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+    inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p) { return { { p->x, p->y, p->z, 0.f } }; }
+    inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p) { return { { p->x, p->y, p->z, p->w } }; }
+    inline void XMStoreFloat3(XMFLOAT3* p, XMVECTOR v) { *p = XMFLOAT3{ v.v[0], v.v[1], v.v[2] }; }
+    inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* p) { XMMATRIX r; memcpy(&r, p, sizeof(r)); return r; }
+    inline void XMStoreFloat4x4(XMFLOAT4X4* p, const XMMATRIX& m) { memcpy(p, &m, sizeof(m)); }
+
+    inline XMVECTOR operator+(XMVECTOR a, XMVECTOR b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+    inline XMVECTOR operator*(float s, XMVECTOR v) { return { { s * v.v[0], s * v.v[1], s * v.v[2], s * v.v[3] } }; }
+
+    inline float XMScalarCos(float value) { return std::cos(value); }
+
+    inline XMMATRIX XMMatrixMultiply(const XMMATRIX& a, const XMMATRIX& b)
+    {
+        XMMATRIX r;
+        for (UINT i{ 0 }; i < 4; ++i)
+            for (UINT j{ 0 }; j < 4; ++j)
+                r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+        return r;
+    }
+
+    inline XMVECTOR XMVector3Normalize(XMVECTOR v)
+    {
+        const float length{ std::sqrt(v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2]) };
+        if (length > 0.f) for (UINT i{ 0 }; i < 3; ++i) v.v[i] /= length;
+        return v;
+    }
+
+    // v + 2w(q x v) + 2q x (q x v), for a unit quaternion q.
+    inline XMVECTOR XMVector3Rotate(XMVECTOR v, XMVECTOR q)
+    {
+        const float x{ q.v[0] }, y{ q.v[1] }, z{ q.v[2] }, w{ q.v[3] };
+        const float tx{ 2.f * (y * v.v[2] - z * v.v[1]) };
+        const float ty{ 2.f * (z * v.v[0] - x * v.v[2]) };
+        const float tz{ 2.f * (x * v.v[1] - y * v.v[0]) };
+        return { { v.v[0] + w * tx + (y * tz - z * ty), v.v[1] + w * ty + (z * tx - x * tz), v.v[2] + w * tz + (x * ty - y * tx), 0.f } };
+    }
+}
+using namespace DirectX;
+
+// The D3D12 types that the draw loops (DrawList.h) and gpu::device (GpuDevice.h) take. Pipeline states and
+// root signatures are only compared and passed on, so gpu::null_device's handles point at nothing.
+struct ID3D12RootSignature;
+struct ID3D12PipelineState;
+using D3D12_GPU_VIRTUAL_ADDRESS = UINT64;
+
+constexpr UINT D3D12_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_MULTIPLE{ 4 };
+constexpr UINT D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT{ 256 };
+
+enum DXGI_FORMAT : UINT
+{
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+    DXGI_FORMAT_R32_UINT = 42,
+    DXGI_FORMAT_R16_UINT = 57,
+};
+
+enum D3D_PRIMITIVE_TOPOLOGY : UINT
+{
+    D3D_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+    D3D_PRIMITIVE_TOPOLOGY_POINTLIST = 1,
+    D3D_PRIMITIVE_TOPOLOGY_LINELIST = 2,
+    D3D_PRIMITIVE_TOPOLOGY_LINESTRIP = 3,
+    D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4,
+    D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP = 5,
+};
+
+struct D3D12_VERTEX_BUFFER_VIEW
+{
+    D3D12_GPU_VIRTUAL_ADDRESS   BufferLocation;
+    UINT                        SizeInBytes;
+    UINT                        StrideInBytes;
+};
+
+struct D3D12_INDEX_BUFFER_VIEW
+{
+    D3D12_GPU_VIRTUAL_ADDRESS   BufferLocation;
+    UINT                        SizeInBytes;
+    DXGI_FORMAT                 Format;
+};
+
+// VirtualAlloc() and VirtualFree() for utl::vm_vector: reserve with PROT_NONE, commit with mprotect().
+// NOTE: only the flags vm_vector uses. munmap() needs the size that VirtualFree(MEM_RELEASE) doesn't
+//       pass, so reservations are remembered here.
+#include <sys/mman.h>
+#include <unordered_map>
+
+constexpr DWORD MEM_COMMIT{ 0x1000 };
+constexpr DWORD MEM_RESERVE{ 0x2000 };
+constexpr DWORD MEM_RELEASE{ 0x8000 };
+constexpr DWORD PAGE_NOACCESS{ 0x01 };
+constexpr DWORD PAGE_READWRITE{ 0x04 };
+
+namespace shim {
+    struct reservations
+    {
+        std::mutex                          mutex;
+        std::unordered_map<void*, size_t>   sizes;
+    };
+
+    inline reservations& get_reservations()
+    {
+        static reservations r;
+        return r;
+    }
+}
+
+inline void* VirtualAlloc(void* address, size_t size, DWORD type, DWORD protect)
+{
+    if (type & MEM_RESERVE)
+    {
+        assert(!address);
+        void* const memory{ mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) };
+        if (memory == MAP_FAILED) return nullptr;
+        shim::reservations& r{ shim::get_reservations() };
+        std::lock_guard lock{ r.mutex };
+        r.sizes[memory] = size;
+        return memory;
+    }
+
+    assert(type == MEM_COMMIT && protect == PAGE_READWRITE);
+    return mprotect(address, size, PROT_READ | PROT_WRITE) ? nullptr : address;
+}
+
+inline BOOL VirtualFree(void* address, size_t, DWORD type)
+{
+    assert(type == MEM_RELEASE);
+    shim::reservations& r{ shim::get_reservations() };
+    std::lock_guard lock{ r.mutex };
+    const auto it{ r.sizes.find(address) };
+    if (it == r.sizes.end()) return 0;
+    munmap(address, it->second);
+    r.sizes.erase(it);
+    return 1;
+}